@@ -0,0 +1,77 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Log circular append-only de batches pendientes de subir (store-and-forward).
+//
+// Cada registro ocupa un slot fijo dentro de un sector. Un registro se escribe
+// una sola vez (con CRC) y se "confirma" poniendo a 0 su palabra ack, cosa que
+// la NOR flash permite sin borrar. Los sectores solo se borran cuando la cabeza
+// vuelve a entrar en ellos, así que cada sector se borra una vez por vuelta.
+// Al montar se reconstruyen cabeza y cursor de reenvío escaneando los slots:
+// un registro a medio escribir (corte de luz) no pasa el CRC y se ignora.
+//
+// No es thread-safe: un único dueño (uploader_task) debe usarlo.
+
+#define BATCH_LOG_PARTITION_LABEL "batchlog"
+#define BATCH_LOG_PAYLOAD_MAX     64
+
+// Backend de almacenamiento. Offsets relativos al inicio de la región.
+// En el equipo es una partición de flash; en host puede ser un archivo o RAM.
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint32_t off, void *buf, size_t len);
+    esp_err_t (*write)(void *ctx, uint32_t off, const void *buf, size_t len);
+    esp_err_t (*erase)(void *ctx, uint32_t off, size_t len);
+    uint32_t size;        // múltiplo de sector_size
+    uint32_t sector_size; // unidad mínima de borrado
+    void *ctx;
+} batch_log_io_t;
+
+typedef struct {
+    uint32_t seq;   // número de secuencia monotónico (no se repite entre reinicios)
+    int64_t  ts;    // epoch (s) del batch
+    uint16_t len;
+    uint8_t  payload[BATCH_LOG_PAYLOAD_MAX];
+} batch_log_entry_t;
+
+typedef struct {
+    batch_log_io_t io;
+    uint32_t slots_per_sector;
+    uint32_t slot_count;
+    uint32_t head;        // próximo slot a escribir
+    uint32_t tail;        // slot del registro pendiente más antiguo (cursor de reenvío)
+    uint32_t next_seq;
+    uint32_t pending;     // registros válidos sin confirmar
+    uint32_t overwritten; // pendientes perdidos por log lleno (desde el montaje)
+    uint32_t erases;      // sectores borrados (desde el montaje)
+} batch_log_t;
+
+// Escanea el backend y reconstruye cabeza/cursor. Un backend vacío es válido.
+esp_err_t batch_log_mount(batch_log_t *log, const batch_log_io_t *io);
+
+// Añade un batch. Si el log está lleno pisa los pendientes más antiguos.
+esp_err_t batch_log_append(batch_log_t *log, int64_t ts, const void *payload, size_t len, uint32_t *out_seq);
+
+// Copia hasta 'max' pendientes, del más antiguo al más nuevo. Devuelve cuántos.
+size_t batch_log_peek(batch_log_t *log, batch_log_entry_t *out, size_t max);
+
+// Confirma los 'n' pendientes más antiguos (llamar solo tras un 2xx del servidor).
+esp_err_t batch_log_ack(batch_log_t *log, size_t n);
+
+static inline size_t batch_log_pending(const batch_log_t *log) { return log->pending; }
+
+// Backend sobre la partición 'label' (tipo data). Ver partitions.csv.
+esp_err_t batch_log_partition_io(const char *label, batch_log_io_t *out);
+
+// Backend volátil en heap, para cuando no existe la partición (o en host).
+esp_err_t batch_log_ram_io(uint32_t size, uint32_t sector_size, batch_log_io_t *out);
+
+#ifdef __cplusplus
+}
+#endif
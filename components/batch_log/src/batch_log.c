@@ -0,0 +1,218 @@
+#include "batch_log.h"
+#include <string.h>
+#include <stddef.h>
+
+#define REC_MAGIC      0x42544C31u  // "BTL1"
+#define REC_ACK_OPEN   0xFFFFFFFFu
+#define REC_ACK_DONE   0x00000000u
+
+// Formato en flash (little endian, tamaño fijo)
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    int64_t  ts;
+    uint16_t len;
+    uint16_t reserved;
+    uint8_t  payload[BATCH_LOG_PAYLOAD_MAX];
+    uint32_t crc;   // CRC32 de magic..payload
+    uint32_t ack;   // se escribe a 0 al confirmar (1->0 sin borrar)
+    uint32_t pad;
+} rec_t;
+
+_Static_assert(sizeof(rec_t) == 96, "rec_t debe medir 96 bytes");
+
+typedef enum { SLOT_BLANK, SLOT_PENDING, SLOT_ACKED, SLOT_GARBAGE } slot_state_t;
+
+static uint32_t crc32_le(const uint8_t *p, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+    while (len--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+static uint32_t slot_offset(const batch_log_t *log, uint32_t slot) {
+    return (slot / log->slots_per_sector) * log->io.sector_size
+         + (slot % log->slots_per_sector) * (uint32_t)sizeof(rec_t);
+}
+
+static uint32_t next_slot(const batch_log_t *log, uint32_t slot) {
+    return (slot + 1 == log->slot_count) ? 0 : slot + 1;
+}
+
+static bool rec_is_blank(const rec_t *r) {
+    const uint8_t *p = (const uint8_t *)r;
+    for (size_t i = 0; i < sizeof(*r); i++) if (p[i] != 0xFF) return false;
+    return true;
+}
+
+static slot_state_t read_slot(batch_log_t *log, uint32_t slot, rec_t *r) {
+    if (log->io.read(log->io.ctx, slot_offset(log, slot), r, sizeof(*r)) != ESP_OK) return SLOT_GARBAGE;
+    if (rec_is_blank(r)) return SLOT_BLANK;
+    if (r->magic != REC_MAGIC || r->len > BATCH_LOG_PAYLOAD_MAX) return SLOT_GARBAGE;
+    if (crc32_le((const uint8_t *)r, offsetof(rec_t, crc)) != r->crc) return SLOT_GARBAGE;
+    return (r->ack == REC_ACK_OPEN) ? SLOT_PENDING : SLOT_ACKED;
+}
+
+// Avanza desde 'slot' hasta el siguiente pendiente (o hasta 'limit' si no hay).
+static uint32_t seek_pending(batch_log_t *log, uint32_t slot, uint32_t limit) {
+    rec_t r;
+    while (slot != limit) {
+        if (read_slot(log, slot, &r) == SLOT_PENDING) return slot;
+        slot = next_slot(log, slot);
+    }
+    return slot;
+}
+
+esp_err_t batch_log_mount(batch_log_t *log, const batch_log_io_t *io) {
+    if (!log || !io || !io->read || !io->write || !io->erase) return ESP_ERR_INVALID_ARG;
+    if (io->sector_size < sizeof(rec_t) || io->size < 2 * io->sector_size || io->size % io->sector_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(log, 0, sizeof(*log));
+    log->io = *io;
+    log->slots_per_sector = io->sector_size / sizeof(rec_t);
+    log->slot_count = (io->size / io->sector_size) * log->slots_per_sector;
+
+    // 1) Registro más nuevo (max seq) y último confirmado
+    bool any = false, any_acked = false;
+    uint32_t max_seq = 0, max_slot = 0, max_acked_seq = 0;
+    rec_t r;
+    for (uint32_t s = 0; s < log->slot_count; s++) {
+        slot_state_t st = read_slot(log, s, &r);
+        if (st != SLOT_PENDING && st != SLOT_ACKED) continue;
+        if (!any || (int32_t)(r.seq - max_seq) > 0) { max_seq = r.seq; max_slot = s; any = true; }
+        if (st == SLOT_ACKED && (!any_acked || (int32_t)(r.seq - max_acked_seq) > 0)) {
+            max_acked_seq = r.seq; any_acked = true;
+        }
+    }
+    if (!any) {
+        log->head = 0;
+        log->tail = 0;
+        log->next_seq = 1;
+        return ESP_OK;
+    }
+    log->head = next_slot(log, max_slot);
+    log->next_seq = max_seq + 1;
+
+    // 2) Pendientes = sufijo (en orden de anillo) posterior al último confirmado
+    log->tail = log->head;
+    bool tail_set = false;
+    uint32_t s = log->head;
+    for (uint32_t i = 0; i < log->slot_count; i++) {
+        if (read_slot(log, s, &r) == SLOT_PENDING &&
+            (!any_acked || (int32_t)(r.seq - max_acked_seq) > 0)) {
+            if (!tail_set) { log->tail = s; tail_set = true; }
+            log->pending++;
+        }
+        s = next_slot(log, s);
+    }
+    return ESP_OK;
+}
+
+// Prepara el sector que empieza en log->head: si tiene datos, descarta los
+// pendientes que queden ahí (log lleno) y lo borra.
+static esp_err_t prepare_sector(batch_log_t *log) {
+    uint32_t first = log->head;
+    bool dirty = false;
+    uint32_t lost = 0;
+    rec_t r;
+    for (uint32_t i = 0; i < log->slots_per_sector; i++) {
+        slot_state_t st = read_slot(log, first + i, &r);
+        if (st != SLOT_BLANK) dirty = true;
+        if (st == SLOT_PENDING && log->pending > 0) {
+            // Solo cuentan los que están dentro de la ventana tail..head
+            uint32_t tail_sector = log->tail / log->slots_per_sector;
+            if (tail_sector == first / log->slots_per_sector) lost++;
+        }
+    }
+    if (!dirty) return ESP_OK;
+
+    uint32_t sector_off = (first / log->slots_per_sector) * log->io.sector_size;
+    esp_err_t err = log->io.erase(log->io.ctx, sector_off, log->io.sector_size);
+    if (err != ESP_OK) return err;
+    log->erases++;
+
+    if (lost) {
+        log->overwritten += lost;
+        log->pending = (log->pending > lost) ? log->pending - lost : 0;
+        uint32_t after = (first + log->slots_per_sector) % log->slot_count;
+        // head apunta al sector recién borrado: recorrer el resto del anillo
+        log->tail = log->pending ? seek_pending(log, after, first) : first;
+    }
+    return ESP_OK;
+}
+
+esp_err_t batch_log_append(batch_log_t *log, int64_t ts, const void *payload, size_t len, uint32_t *out_seq) {
+    if (!log || (!payload && len) || len > BATCH_LOG_PAYLOAD_MAX) return ESP_ERR_INVALID_ARG;
+
+    rec_t r;
+    memset(&r, 0xFF, sizeof(r));
+    r.magic = REC_MAGIC;
+    r.seq = log->next_seq;
+    r.ts = ts;
+    r.len = (uint16_t)len;
+    memset(r.payload, 0, sizeof(r.payload));
+    if (len) memcpy(r.payload, payload, len);
+    r.crc = crc32_le((const uint8_t *)&r, offsetof(rec_t, crc));
+
+    // Un slot a medio escribir (corte previo) no se puede reutilizar sin borrar: saltarlo.
+    for (uint32_t tries = 0; tries <= log->slots_per_sector; tries++) {
+        if (log->head % log->slots_per_sector == 0) {
+            esp_err_t err = prepare_sector(log);
+            if (err != ESP_OK) return err;
+        }
+        rec_t cur;
+        if (read_slot(log, log->head, &cur) != SLOT_BLANK) {
+            log->head = next_slot(log, log->head);
+            continue;
+        }
+        esp_err_t err = log->io.write(log->io.ctx, slot_offset(log, log->head), &r, offsetof(rec_t, ack));
+        if (err != ESP_OK) return err;
+
+        if (log->pending == 0) log->tail = log->head;
+        log->pending++;
+        log->head = next_slot(log, log->head);
+        log->next_seq++;
+        if (out_seq) *out_seq = r.seq;
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+size_t batch_log_peek(batch_log_t *log, batch_log_entry_t *out, size_t max) {
+    size_t n = 0;
+    rec_t r;
+    // Con el anillo lleno tail == head: se recorre por cantidad de slots
+    uint32_t s = log->tail;
+    for (uint32_t i = 0; i < log->slot_count && n < max && n < log->pending; i++, s = next_slot(log, s)) {
+        if (read_slot(log, s, &r) != SLOT_PENDING) continue;
+        out[n].seq = r.seq;
+        out[n].ts = r.ts;
+        out[n].len = r.len;
+        memcpy(out[n].payload, r.payload, r.len);
+        n++;
+    }
+    return n;
+}
+
+esp_err_t batch_log_ack(batch_log_t *log, size_t n) {
+    const uint32_t done = REC_ACK_DONE;
+    rec_t r;
+    uint32_t s = log->tail;
+    for (uint32_t i = 0; i < log->slot_count && n > 0 && log->pending > 0; i++) {
+        if (read_slot(log, s, &r) == SLOT_PENDING) {
+            esp_err_t err = log->io.write(log->io.ctx, slot_offset(log, s) + offsetof(rec_t, ack), &done, sizeof(done));
+            if (err != ESP_OK) {
+                log->tail = s;
+                return err;
+            }
+            log->pending--;
+            n--;
+        }
+        s = next_slot(log, s);
+    }
+    log->tail = seek_pending(log, s, log->head);
+    return ESP_OK;
+}
@@ -0,0 +1,34 @@
+#include "batch_log.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+
+static const char *TAG = "batch_log";
+
+static esp_err_t part_read(void *ctx, uint32_t off, void *buf, size_t len) {
+    return esp_partition_read((const esp_partition_t *)ctx, off, buf, len);
+}
+
+static esp_err_t part_write(void *ctx, uint32_t off, const void *buf, size_t len) {
+    return esp_partition_write((const esp_partition_t *)ctx, off, buf, len);
+}
+
+static esp_err_t part_erase(void *ctx, uint32_t off, size_t len) {
+    return esp_partition_erase_range((const esp_partition_t *)ctx, off, len);
+}
+
+esp_err_t batch_log_partition_io(const char *label, batch_log_io_t *out) {
+    if (!label || !out) return ESP_ERR_INVALID_ARG;
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!part) {
+        ESP_LOGE(TAG, "Partición '%s' no encontrada (revisa partitions.csv)", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    out->read = part_read;
+    out->write = part_write;
+    out->erase = part_erase;
+    out->sector_size = part->erase_size;
+    out->size = part->size - (part->size % part->erase_size);
+    out->ctx = (void *)part;
+    ESP_LOGI(TAG, "Partición '%s': %u bytes @0x%x", label, (unsigned)out->size, (unsigned)part->address);
+    return ESP_OK;
+}
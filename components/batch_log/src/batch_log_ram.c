@@ -0,0 +1,35 @@
+#include "batch_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Emula NOR flash: borrar pone 0xFF y escribir solo puede bajar bits (AND).
+static esp_err_t ram_read(void *ctx, uint32_t off, void *buf, size_t len) {
+    memcpy(buf, (const uint8_t *)ctx + off, len);
+    return ESP_OK;
+}
+
+static esp_err_t ram_write(void *ctx, uint32_t off, const void *buf, size_t len) {
+    uint8_t *dst = (uint8_t *)ctx + off;
+    const uint8_t *src = (const uint8_t *)buf;
+    for (size_t i = 0; i < len; i++) dst[i] &= src[i];
+    return ESP_OK;
+}
+
+static esp_err_t ram_erase(void *ctx, uint32_t off, size_t len) {
+    memset((uint8_t *)ctx + off, 0xFF, len);
+    return ESP_OK;
+}
+
+esp_err_t batch_log_ram_io(uint32_t size, uint32_t sector_size, batch_log_io_t *out) {
+    if (!out || !sector_size || size % sector_size) return ESP_ERR_INVALID_ARG;
+    uint8_t *mem = malloc(size);
+    if (!mem) return ESP_ERR_NO_MEM;
+    memset(mem, 0xFF, size);
+    out->read = ram_read;
+    out->write = ram_write;
+    out->erase = ram_erase;
+    out->size = size;
+    out->sector_size = sector_size;
+    out->ctx = mem;
+    return ESP_OK;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "stdbool.h"
+#include <stdint.h>
+#include "esp_err.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sesión de Firebase persistida en NVS (namespace propio, junto a wifi_store).
+// Guarda el refresh token y, si se quiere, el ID token con su expiración (epoch),
+// asociados al email de la cuenta: si la cuenta cambia, la sesión no se usa.
+// Para cifrarla en flash, activar CONFIG_NVS_ENCRYPTION.
+
+#define AUTH_STORE_REFRESH_MAX 512
+#define AUTH_STORE_ID_MAX      1280
+
+// Devuelve ESP_ERR_NVS_NOT_FOUND si no hay sesión o es de otra cuenta.
+// id_token queda "" y *expires_at a 0 si solo se guardó el refresh token.
+esp_err_t auth_store_load(const char *email,
+                          char *refresh, size_t refresh_len,
+                          char *id_token, size_t id_len, int64_t *expires_at);
+esp_err_t auth_store_save(const char *email, const char *refresh,
+                          const char *id_token, int64_t expires_at);
+esp_err_t auth_store_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 #include "esp_err.h"
 #include "stdbool.h"
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,6 +44,8 @@ esp_err_t captive_manager_enter_recaptive(void);
 void captive_manager_enable_nat(void);
 void captive_manager_disable_nat(void);
 bool connectivity_portal_open(void);
+// Estado del estimador de RTT del chequeo de conectividad (srtt 0: sin muestras)
+void connectivity_check_rtt(uint32_t *srtt_ms, uint32_t *rttvar_ms, uint32_t *timeout_ms);
 
 bool captive_manager_using_saved(void);
 
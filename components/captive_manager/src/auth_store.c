@@ -0,0 +1,73 @@
+#include "auth_store.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include <string.h>
+
+//definicion de namespace y keys
+#define AUTH_STORE_NS    "auth_cfg"
+#define AUTH_KEY_EMAIL   "email"
+#define AUTH_KEY_REFRESH "refresh"
+#define AUTH_KEY_ID      "id"
+#define AUTH_KEY_EXP     "exp"
+
+//leer sesión
+esp_err_t auth_store_load(const char *email,
+                          char *refresh, size_t refresh_len,
+                          char *id_token, size_t id_len, int64_t *expires_at) {
+    if (!email || !refresh || !id_token || !expires_at) return ESP_ERR_INVALID_ARG;
+    refresh[0] = 0; id_token[0] = 0; *expires_at = 0;
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(AUTH_STORE_NS, NVS_READONLY, &h);
+    if (err != ESP_OK) return err;
+
+    char saved_email[96];
+    size_t len = sizeof(saved_email);
+    err = nvs_get_str(h, AUTH_KEY_EMAIL, saved_email, &len);
+    if (err == ESP_OK && strcmp(saved_email, email) != 0) err = ESP_ERR_NVS_NOT_FOUND;
+    if (err == ESP_OK) {
+        len = refresh_len;
+        err = nvs_get_str(h, AUTH_KEY_REFRESH, refresh, &len);
+    }
+    if (err == ESP_OK) {
+        len = id_len;
+        if (nvs_get_str(h, AUTH_KEY_ID, id_token, &len) != ESP_OK ||
+            nvs_get_i64(h, AUTH_KEY_EXP, expires_at) != ESP_OK) {
+            id_token[0] = 0; *expires_at = 0;
+        }
+    }
+    nvs_close(h);
+    if (err != ESP_OK) refresh[0] = 0;
+    return err;
+}
+
+//guardar sesión
+esp_err_t auth_store_save(const char *email, const char *refresh,
+                          const char *id_token, int64_t expires_at) {
+    if (!email || !refresh) return ESP_ERR_INVALID_ARG;
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(AUTH_STORE_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_str(h, AUTH_KEY_EMAIL, email);
+    if (err == ESP_OK) err = nvs_set_str(h, AUTH_KEY_REFRESH, refresh);
+    if (err == ESP_OK && id_token && id_token[0]) {
+        err = nvs_set_str(h, AUTH_KEY_ID, id_token);
+        if (err == ESP_OK) err = nvs_set_i64(h, AUTH_KEY_EXP, expires_at);
+    } else if (err == ESP_OK) {
+        nvs_erase_key(h, AUTH_KEY_ID);
+        nvs_erase_key(h, AUTH_KEY_EXP);
+    }
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+//Borrar sesión
+esp_err_t auth_store_clear(void) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(AUTH_STORE_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    nvs_erase_all(h);
+    err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
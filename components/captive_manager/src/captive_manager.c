@@ -13,6 +13,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_http_client.h"
+#include "esp_timer.h"
 
 #include "mdns.h"
 
@@ -770,6 +771,45 @@ void captive_manager_disable_nat(void) {
     }
 }
 
+// Timeout del chequeo según su RTT medido (media y desvío suavizados, como el
+// RTO de TCP). Cada chequeo sin respuesta lo duplica hasta el techo: en un
+// enlace lento el chequeo deja de fallar por timeout y en uno muerto falla rápido.
+#define CHECK_TIMEOUT_INITIAL_MS 2000
+#define CHECK_TIMEOUT_FLOOR_MS   1000
+#define CHECK_TIMEOUT_CEIL_MS    8000
+static int32_t  s_check_srtt_ms = 0;     // 0: sin muestras
+static int32_t  s_check_rttvar_ms = 0;
+static uint32_t s_check_backoff = 0;
+
+static void check_rtt_sample(int32_t rtt_ms) {
+    if (rtt_ms < 1) rtt_ms = 1;
+    if (s_check_srtt_ms == 0) {
+        s_check_srtt_ms = rtt_ms;
+        s_check_rttvar_ms = rtt_ms / 2;
+    } else {
+        int32_t delta = s_check_srtt_ms - rtt_ms;
+        if (delta < 0) delta = -delta;
+        s_check_rttvar_ms += (delta - s_check_rttvar_ms) / 4;
+        s_check_srtt_ms += (rtt_ms - s_check_srtt_ms) / 8;
+    }
+    s_check_backoff = 0;
+}
+
+static int check_timeout_ms(void) {
+    int64_t t = CHECK_TIMEOUT_INITIAL_MS;
+    if (s_check_srtt_ms > 0) t = 2LL * (s_check_srtt_ms + 4LL * s_check_rttvar_ms);
+    t <<= s_check_backoff;
+    if (t < CHECK_TIMEOUT_FLOOR_MS) t = CHECK_TIMEOUT_FLOOR_MS;
+    if (t > CHECK_TIMEOUT_CEIL_MS) t = CHECK_TIMEOUT_CEIL_MS;
+    return (int)t;
+}
+
+void connectivity_check_rtt(uint32_t *srtt_ms, uint32_t *rttvar_ms, uint32_t *timeout_ms) {
+    if (srtt_ms) *srtt_ms = (uint32_t)s_check_srtt_ms;
+    if (rttvar_ms) *rttvar_ms = (uint32_t)s_check_rttvar_ms;
+    if (timeout_ms) *timeout_ms = (uint32_t)check_timeout_ms();
+}
+
 // Stub de verificación de portal/conectividad. Ajusta según tu lógica real.
 bool connectivity_portal_open(void) {
     // Verifica conectividad saliente intentando acceder a un endpoint conocido
@@ -777,7 +817,7 @@ bool connectivity_portal_open(void) {
     // Evitamos seguir redirecciones para detectar portales cautivos (3xx/200 con contenido).
     esp_http_client_config_t cfg = {
         .url = "http://connectivitycheck.gstatic.com/generate_204",
-        .timeout_ms = 2000,
+        .timeout_ms = check_timeout_ms(),
         .disable_auto_redirect = true,
     };
     esp_http_client_handle_t client = esp_http_client_init(&cfg);
@@ -785,14 +825,21 @@ bool connectivity_portal_open(void) {
         ESP_LOGW(TAG, "connectivity_check: init failed");
         return false;
     }
+    int64_t t0 = esp_timer_get_time();
     esp_err_t err = esp_http_client_open(client, 0);
     if (err != ESP_OK) {
-        ESP_LOGI(TAG, "connectivity_check: open err=%s", esp_err_to_name(err));
+        ESP_LOGI(TAG, "connectivity_check: open err=%s (timeout %d ms)", esp_err_to_name(err), cfg.timeout_ms);
         esp_http_client_cleanup(client);
+        if (s_check_backoff < 3) s_check_backoff++;
         return false;
     }
     int64_t hdrs = esp_http_client_fetch_headers(client);
     int status = esp_http_client_get_status_code(client);
+    if (hdrs >= 0 && status > 0) {
+        check_rtt_sample((int32_t)((esp_timer_get_time() - t0) / 1000));
+    } else if (s_check_backoff < 3) {
+        s_check_backoff++;
+    }
     // Cerrar y limpiar
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
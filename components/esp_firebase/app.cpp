@@ -1,14 +1,22 @@
 
 #include <iostream>
+#include <cstring>
+#include <strings.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "sdkconfig.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
 #include "esp_tls.h"
 #include "esp_crt_bundle.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include <time.h>
 
 #include "app.h"
+#include "request_metrics.h"
 
 
 
@@ -22,14 +30,41 @@
 
 #define HTTP_TAG "HTTP_CLIENT"
 #define FIREBASE_APP_TAG "FirebaseApp"
+// Antes de esto el reloj no está sincronizado (SNTP) y no sirve para expiraciones
+#define CLOCK_VALID_EPOCH 1609459200
 
 // Prefer ESP-IDF certificate bundle over embedded certs
 
 
 
-static int output_len = 0; 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+namespace ESPFirebase {
+
+namespace {
+
+// Lee campos del primer nivel del body en ctx->buffer sin construir un
+// Json::Value ni pedir memoria: pila y token del parser usan lo que queda libre
+// del mismo buffer (cualquier token cabe si sobra al menos otro body entero).
+bool extractFields(FirebaseApp::request_ctx_t* ctx, Json::FieldExtractor::Field* fields, size_t count)
+{
+    constexpr size_t PARSER_DEPTH = 16;
+    size_t used = ctx->len + 1;
+    size_t scratch_len = sizeof(ctx->buffer) - used;
+    if (scratch_len >= ctx->len + PARSER_DEPTH) {
+        return Json::FieldExtractor::extract(ctx->buffer, ctx->len, fields, count, ctx->buffer + used, scratch_len);
+    }
+    // No queda lugar: mismo parser con memoria dinámica
+    Json::FieldExtractor extractor(fields, count);
+    Json::StreamReader reader(extractor);
+    reader.feed(ctx->buffer, ctx->len);
+    return reader.finish();
+}
+
+}
+
+esp_err_t FirebaseApp::httpEventHandler(esp_http_client_event_t *evt)
 {
+    // Cada request lleva su propio contexto: nada de estado compartido entre tareas
+    request_ctx_t* ctx = static_cast<request_ctx_t*>(evt->user_data);
 
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
@@ -37,153 +72,539 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
             break;
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_CONNECTED");
-            memset(evt->user_data, 0, HTTP_RECV_BUFFER_SIZE);
-            output_len = 0;
+            if (ctx && ctx->slot) {
+                FirebaseApp* app = ctx->app;
+                conn_slot_t* slot = ctx->slot;
+                ctx->connected_us = esp_timer_get_time();
+                int64_t hs_us = ctx->connected_us - ctx->start_us;
+                slot->conn_open = true;
+                xSemaphoreTake(app->lock, portMAX_DELAY);
+                rttSample(slot->connect, (int)(hs_us / 1000));
+                app->stats.handshakes++;
+                app->stats.handshake_time_us += hs_us;
+                // Con el transporte propio se sabe si el server aceptó el ticket;
+                // con el SSL de esp_http_client solo que se ofreció
+                if (slot->transport) {
+                    tls_handshake_t hs = tlsTransportLastHandshake(slot->transport);
+                    if (hs.offered) app->stats.ticket_offers++;
+                    if (hs.resumed) {
+                        app->stats.ticket_handshakes++;
+                        app->stats.ticket_handshake_time_us += hs_us;
+                    }
+                } else if (slot->handshakes > 0) {
+                    app->stats.ticket_offers++;
+                }
+                xSemaphoreGive(app->lock);
+                slot->handshakes++;
+            }
             break;
         case HTTP_EVENT_HEADER_SENT:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_HEADER_SENT");
+            if (ctx) ctx->sent_us = esp_timer_get_time();
             break;
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            if (ctx && ctx->first_byte_us == 0) ctx->first_byte_us = esp_timer_get_time();
+            if (ctx && evt->header_key && evt->header_value && strcasecmp(evt->header_key, "ETag") == 0) {
+                strncpy(ctx->etag, evt->header_value, sizeof(ctx->etag) - 1);
+                ctx->etag[sizeof(ctx->etag) - 1] = '\0';
+                // Mismo dato que el que ya tenemos: no hace falta parsearlo otra vez
+                if (ctx->if_none_match && strcmp(ctx->if_none_match, ctx->etag) == 0) ctx->etag_matched = true;
+            }
             break;
         case HTTP_EVENT_REDIRECT:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_REDIRECT");
             break;
         case HTTP_EVENT_ON_FINISH:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_FINISH");
-            output_len = 0;
             break;
         case HTTP_EVENT_ON_DATA:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            if (evt->user_data && evt->data && evt->data_len > 0) {
-                int capacity = HTTP_RECV_BUFFER_SIZE - 1; // deja 1 para terminador
-                int space = capacity - output_len;
-                if (space > 0) {
-                    int to_copy = evt->data_len < space ? evt->data_len : space;
-                    memcpy((char*)evt->user_data + output_len, evt->data, to_copy);
-                    output_len += to_copy;
-                    ((char*)evt->user_data)[output_len] = '\0';
+            if (ctx && evt->data_len > 0) ctx->rx_bytes += (size_t)evt->data_len;
+            if (ctx && ctx->etag_matched) {
+                // body ya conocido (ETag igual al cacheado): se descarta
+            } else if (ctx && ctx->sink && evt->data && evt->data_len > 0) {
+                // Parseo incremental: no hace falta tener el documento entero en memoria
+                Json::StreamReader* sink = ctx->sink;
+                if (!sink->failed() && !sink->feed(static_cast<const char*>(evt->data), evt->data_len)) {
+                    ESP_LOGW(HTTP_TAG, "JSON invalido en byte %u: %s", (unsigned)sink->offset(), sink->error().c_str());
+                }
+            } else if (ctx && evt->data && evt->data_len > 0) {
+                size_t capacity = sizeof(ctx->buffer) - 1; // deja 1 para terminador
+                size_t space = capacity - ctx->len;
+                size_t to_copy = (size_t)evt->data_len < space ? (size_t)evt->data_len : space;
+                if (to_copy < (size_t)evt->data_len) ctx->truncated = true;
+                if (to_copy > 0) {
+                    memcpy(ctx->buffer + ctx->len, evt->data, to_copy);
+                    ctx->len += to_copy;
+                    ctx->buffer[ctx->len] = '\0';
                 }
             }
             break;
         case HTTP_EVENT_DISCONNECTED:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_DISCONNECTED");
+            if (ctx && ctx->slot) ctx->slot->conn_open = false;
+            break;
+        default:
             break;
     }
     return ESP_OK;
 }
 
-namespace ESPFirebase {
+// Errores de transporte típicos de una conexión reusada que el server ya cerró
+bool FirebaseApp::isConnectionError(esp_err_t err)
+{
+    return err == ESP_ERR_HTTP_CONNECT || err == ESP_ERR_HTTP_WRITE_DATA ||
+           err == ESP_ERR_HTTP_FETCH_HEADER || err == ESP_ERR_HTTP_CONNECTION_CLOSED ||
+           err == ESP_FAIL;
+}
+
+bool FirebaseApp::isTimeout(esp_err_t err, int64_t elapsed_us, int timeout_ms)
+{
+    // esp_http_client no distingue la causa en modo bloqueante (FETCH_HEADER,
+    // CONNECT): un intento que agotó su plazo es un timeout
+    if (err == ESP_OK) return false;
+    return err == ESP_ERR_HTTP_EAGAIN || elapsed_us >= (int64_t)timeout_ms * 1000 * 9 / 10;
+}
+
+bool FirebaseApp::hostFromUrl(const char* url, char* host, size_t host_len)
+{
+    const char* p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    size_t n = strcspn(p, "/?:");
+    if (n == 0 || n >= host_len) return false;
+    memcpy(host, p, n);
+    host[n] = '\0';
+    return true;
+}
+
+// Busca el slot del host de la URL; si no existe lo crea, reciclando el menos usado
+// que esté libre. Llamar con 'lock' tomado.
+FirebaseApp::conn_slot_t* FirebaseApp::slotForUrl(const char* url)
+{
+    char host[sizeof(slots[0].host)];
+    if (!hostFromUrl(url, host, sizeof(host))) {
+        ESP_LOGE(FIREBASE_APP_TAG, "URL sin host valido: %s", url);
+        return nullptr;
+    }
+    conn_slot_t* victim = nullptr;
+    for (int i = 0; i < MAX_HOSTS; ++i) {
+        if (slots[i].client && strcmp(slots[i].host, host) == 0) return &slots[i];
+        if (slots[i].users > 0) continue; // en uso por otra tarea
+        if (!slots[i].client) { victim = &slots[i]; break; }
+        if (!victim || slots[i].last_activity_us < victim->last_activity_us) victim = &slots[i];
+    }
+    if (!victim) {
+        ESP_LOGE(FIREBASE_APP_TAG, "Sin cliente libre para %s", host);
+        return nullptr;
+    }
+    if (victim->client) {
+        ESP_LOGD(FIREBASE_APP_TAG, "Reciclando cliente de %s para %s", victim->host, host);
+        esp_http_client_cleanup(victim->client);
+        // La sesión TLS del host queda guardada en tls_transport
+        if (victim->transport) esp_transport_destroy(victim->transport);
+    }
+    SemaphoreHandle_t busy = victim->busy;
+    memset(victim, 0, sizeof(*victim));
+    victim->busy = busy;
+    strcpy(victim->host, host);
+    victim->keep_open = (persistent_host == host);
+    firebaseClientInit(victim);
+    return victim->client ? victim : nullptr;
+}
 
 // TODO: protect this function from breaking 
-void FirebaseApp::firebaseClientInit(void)
+void FirebaseApp::firebaseClientInit(conn_slot_t* slot)
 {   
+    std::string url = std::string("https://") + slot->host;
     esp_http_client_config_t config = {};
-    config.url = "https://google.com";    // you have to set this as https link of some sort so that it can init properly, you cant leave it empty
-    config.event_handler = http_event_handler;
+    config.url = url.c_str();
+    config.event_handler = FirebaseApp::httpEventHandler;
     // Use global certificate bundle (requires CONFIG_MBEDTLS_CERTIFICATE_BUNDLE)
     config.crt_bundle_attach = esp_crt_bundle_attach;
-    config.user_data = FirebaseApp::local_response_buffer;
-    config.buffer_size_tx = 4096;
-    config.buffer_size = HTTP_RECV_BUFFER_SIZE;
+    // user_data se fija en cada request (su request_ctx_t)
+    config.user_data = nullptr;
+    // Buffers internos de lectura/escritura; la respuesta se acumula aparte en
+    // el request_ctx_t, así que no hace falta que sean tan grandes (hay uno por host)
+    config.buffer_size_tx = 2048;
+    config.buffer_size = HTTP_CLIENT_RX_BUFFER_SIZE;
     // Timeout razonable (ms)
-    config.timeout_ms = 20000; // 20s
-    this->default_timeout_ms = config.timeout_ms;  // 20 s por defecto
-    // Deshabilitamos keep-alive: el server parece cerrar tras inactividad (~10 min) provocando RST en primer write
-    config.keep_alive_enable = false;
-    FirebaseApp::client = esp_http_client_init(&config);
-    ESP_LOGD(FIREBASE_APP_TAG, "HTTP Client Initialized");
+    config.timeout_ms = this->default_timeout_ms; // 20 s por defecto
+    // La conexión HTTP se reusa entre requests (no se cierra tras cada éxito).
+    // El server corta tras ~10 min ociosa: performRequest la cierra antes de
+    // IDLE_RECONNECT_US y, si aun así llega un RST, reconecta sin reportar error.
+    // TCP keep-alive ayuda a detectar antes una conexión muerta.
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = 60;
+    config.keep_alive_interval = 10;
+    config.keep_alive_count = 3;
+#if CONFIG_ESP_HTTP_CLIENT_ENABLE_CUSTOM_TRANSPORT
+    // TLS propio: sesión por host persistida en NVS y resultado real de cada handshake
+    slot->transport = tlsTransportCreate(slot->host);
+    config.transport = slot->transport;
+#endif
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    // Sin transporte propio: el SSL de esp_http_client guarda el ticket en RAM
+    if (!slot->transport) config.save_client_session = true;
+#endif
+    slot->client = esp_http_client_init(&config);
+    if (!slot->client && slot->transport) {
+        esp_transport_destroy(slot->transport);
+        slot->transport = nullptr;
+    }
+    ESP_LOGD(FIREBASE_APP_TAG, "HTTP Client Initialized for %s", slot->host);
 
 }
 
 
+void FirebaseApp::setPersistentHost(const char* url)
+{
+    char host[sizeof(slots[0].host)];
+    if (!hostFromUrl(url, host, sizeof(host))) return;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    persistent_host = host;
+    for (int i = 0; i < MAX_HOSTS; ++i) {
+        if (slots[i].client) slots[i].keep_open = (persistent_host == slots[i].host);
+    }
+    xSemaphoreGive(lock);
+}
+
 esp_err_t FirebaseApp::setHeader(const char* header, const char* value)
 {
-    return esp_http_client_set_header(FirebaseApp::client, header, value);
+    // Aplica a todos los clientes: el siguiente request puede ir a cualquier host
+    // (espera a que termine el request en curso de cada uno)
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < MAX_HOSTS; ++i) {
+        xSemaphoreTake(slots[i].busy, portMAX_DELAY);
+        if (slots[i].client) {
+            esp_err_t err = esp_http_client_set_header(slots[i].client, header, value);
+            if (err != ESP_OK) ret = err;
+        }
+        xSemaphoreGive(slots[i].busy);
+    }
+    return ret;
+}
+
+FirebaseApp::request_ctx_t* FirebaseApp::acquireRequest(Json::StreamReader* sink)
+{
+    xSemaphoreTake(pool_free, portMAX_DELAY);
+    xSemaphoreTake(lock, portMAX_DELAY);
+    request_ctx_t* ctx = nullptr;
+    for (int i = 0; i < HTTP_REQUEST_POOL_SIZE; ++i) {
+        if (!request_pool[i].in_use) { ctx = &request_pool[i]; break; }
+    }
+    // pool_free garantiza que hay uno libre
+    ctx->in_use = true;
+    xSemaphoreGive(lock);
+
+    ctx->len = 0;
+    ctx->buffer[0] = '\0';
+    ctx->truncated = false;
+    ctx->status_code = -1;
+    ctx->etag[0] = '\0';
+    ctx->want_etag = false;
+    ctx->if_none_match = nullptr;
+    ctx->send_if_none_match = false;
+    ctx->etag_matched = false;
+    ctx->sink = sink;
+    ctx->timeout_ms = 0;
+    ctx->timeouts = nullptr;
+    ctx->retry = nullptr;
+    ctx->app = this;
+    ctx->slot = nullptr;
+    return ctx;
+}
+
+void FirebaseApp::releaseRequest(request_ctx_t* ctx)
+{
+    if (!ctx) return;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    ctx->in_use = false;
+    ctx->sink = nullptr;
+    xSemaphoreGive(lock);
+    xSemaphoreGive(pool_free);
 }
 
 http_ret_t FirebaseApp::performRequest(const char* url,
                                        esp_http_client_method_t method,
                                        std::string post_field)
 {
-    const int MAX_ATTEMPTS = 5; // 1 intento + 1 reintento
+    request_ctx_t* ctx = acquireRequest();
+    http_ret_t ret = performRequest(url, method, post_field.data(), post_field.size(), ctx);
+    releaseRequest(ctx);
+    return ret;
+}
+
+http_ret_t FirebaseApp::performRequest(const char* url,
+                                       esp_http_client_method_t method,
+                                       const char* body,
+                                       size_t body_len,
+                                       request_ctx_t* ctx)
+{
+    const retry_policy_t& policy = ctx->retry ? *ctx->retry : FirebaseApp::retry_policy;
+    retry_class_t result = RETRY_TRANSIENT;
     esp_err_t err = ESP_FAIL;
     int status_code = -1;
+    bool stale_retry_done = false;
+
+    const int64_t t_begin = esp_timer_get_time();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FirebaseApp::stats.requests++;
+    conn_slot_t* slot = slotForUrl(url);
+    bool allowed = slot && breakerAllow(slot->breaker, t_begin);
+    if (slot && allowed) slot->users++;
+    if (slot && !allowed) FirebaseApp::stats.breaker_rejects++;
+    xSemaphoreGive(lock);
+    if (!slot) {
+        ESP_LOGE(FIREBASE_APP_TAG, "http_client_init fallo");
+        return {ESP_FAIL, -1};
+    }
+    if (!allowed) {
+        ESP_LOGD(FIREBASE_APP_TAG, "Circuito de %s abierto: request no intentado", slot->host);
+        ctx->status_code = -1;
+        return {ESP_ERR_NOT_FINISHED, -1};
+    }
 
-    for (int attempt = 1; attempt <= MAX_ATTEMPTS; ++attempt) {
-        // Inicializa o reusa el cliente
-        if (FirebaseApp::client == nullptr) {
-            esp_http_client_config_t cfg = {};
-            cfg.url = url;
-            cfg.crt_bundle_attach = esp_crt_bundle_attach;
-            FirebaseApp::client = esp_http_client_init(&cfg);
-            if (!FirebaseApp::client) {
-                ESP_LOGE(FIREBASE_APP_TAG, "http_client_init fallo");
-                break;
-            }
-        } else {
-            esp_http_client_set_url(FirebaseApp::client, url);
-        }
+    // El cliente del host es de este request hasta el final
+    xSemaphoreTake(slot->busy, portMAX_DELAY);
+    esp_http_client_handle_t client = slot->client;
+    ctx->slot = slot;
+    esp_http_client_set_user_data(client, ctx);
+
+    // Conexión ociosa demasiado tiempo: cerrarla antes de que el server nos dé RST
+    bool idle_reconnect = false;
+    if (slot->conn_open && t_begin - slot->last_activity_us > IDLE_RECONNECT_US) {
+        ESP_LOGD(FIREBASE_APP_TAG, "Conexión a %s ociosa %lld s: reconectando", slot->host,
+                 (long long)((t_begin - slot->last_activity_us) / 1000000));
+        esp_http_client_close(client);
+        slot->conn_open = false;
+        idle_reconnect = true;
+    }
+
+    // Headers de lectura condicional: solo para este request
+    bool conditional = ctx->send_if_none_match && ctx->if_none_match && ctx->if_none_match[0];
+    if (ctx->want_etag) esp_http_client_set_header(client, "X-Firebase-ETag", "true");
+    if (conditional) esp_http_client_set_header(client, "if-none-match", ctx->if_none_match);
 
-        if (esp_http_client_set_method(FirebaseApp::client, method) != ESP_OK) {
+    bool reused = false;
+    int stale_retries = 0;
+    int retries = 0;
+    uint64_t tx_bytes = 0;
+    ctx->rx_bytes = 0;
+    for (int attempt = 1; ; ++attempt) {
+        esp_http_client_set_url(client, url);
+
+        if (esp_http_client_set_method(client, method) != ESP_OK) {
             ESP_LOGE(FIREBASE_APP_TAG, "set_method fallo");
         }
 
         // Métodos con body
         if (method == HTTP_METHOD_POST || method == HTTP_METHOD_PUT || method == HTTP_METHOD_PATCH) {
-            if (esp_http_client_set_post_field(FirebaseApp::client,
-                                               post_field.c_str(),
-                                               post_field.length()) != ESP_OK) {
+            if (esp_http_client_set_post_field(client, body, (int)body_len) != ESP_OK) {
                 ESP_LOGE(FIREBASE_APP_TAG, "set_post_field fallo");
             }
-            setHeader("content-type", "application/json");
+            esp_http_client_set_header(client, "content-type", "application/json");
+            tx_bytes += body_len;
         } else {
             // Métodos SIN body (DELETE/GET): limpiar payload y forzar Content-Length: 0
-            esp_http_client_set_post_field(FirebaseApp::client, "", 0);
-            esp_http_client_set_header(FirebaseApp::client, "Content-Length", "0");
+            esp_http_client_set_post_field(client, "", 0);
+            esp_http_client_set_header(client, "Content-Length", "0");
         }
 
-        err = esp_http_client_perform(FirebaseApp::client);
-        status_code = esp_http_client_get_status_code(FirebaseApp::client);
+        // Cada intento empieza con la respuesta vacía
+        ctx->len = 0;
+        ctx->buffer[0] = '\0';
+        ctx->truncated = false;
+        ctx->etag[0] = '\0';
+        ctx->etag_matched = false;
+        if (ctx->sink) ctx->sink->reset();
+
+        reused = slot->conn_open;
+        uint32_t handshakes_before = slot->handshakes;
+        const int timeout_ms = attemptTimeoutMs(slot, ctx);
+        esp_http_client_set_timeout_ms(client, timeout_ms);
+        ctx->connected_us = 0;
+        ctx->sent_us = 0;
+        ctx->first_byte_us = 0;
+        ctx->start_us = esp_timer_get_time();
+        err = esp_http_client_perform(client);
+        status_code = esp_http_client_get_status_code(client);
+        slot->last_activity_us = esp_timer_get_time();
+        const request_spans_t spans = {ctx->start_us, ctx->connected_us, ctx->sent_us,
+                                       ctx->first_byte_us, slot->last_activity_us};
+
+        // RTT: del envío al primer header. Solo un timeout de verdad duplica el
+        // RTO: DNS, conexión rechazada o alerta TLS fallan rápido y no dicen
+        // nada del enlace, ni una conexión reusada que el server ya cerró.
+        xSemaphoreTake(lock, portMAX_DELAY);
+        metricsRecordAttempt(FirebaseApp::metrics.method[metricsMethod(method)], spans);
+        if (ctx->sent_us > 0 && ctx->first_byte_us >= ctx->sent_us) {
+            rttSample(slot->rtt, (int)((ctx->first_byte_us - ctx->sent_us) / 1000));
+        } else if (isTimeout(err, slot->last_activity_us - ctx->start_us, timeout_ms) &&
+                   !(reused && !stale_retry_done && isConnectionError(err))) {
+            bool connected = reused || slot->handshakes != handshakes_before;
+            rttOnTimeout(connected ? slot->rtt : slot->connect);
+        }
+        xSemaphoreGive(lock);
 
         // Aceptar cualquier 2xx como éxito (DELETE puede devolver 204)
-        if (err == ESP_OK && status_code >= 200 && status_code < 300) {
-            esp_http_client_close(FirebaseApp::client);
-            return {err, status_code};
+        result = policy.classify(err, status_code);
+        if (result == RETRY_SUCCESS) {
+            // Host persistente: la conexión queda abierta para el siguiente request.
+            // El resto se cierra, pero el ticket TLS queda guardado en su cliente.
+            if (!slot->keep_open) esp_http_client_close(client);
+            break;
         }
 
-        ESP_LOGE(FIREBASE_APP_TAG,
-                "request: url=%s\nmethod=%d\npost_field=%s",
-                url, method, post_field.c_str());
-        ESP_LOGE(FIREBASE_APP_TAG, "response=\n%s", local_response_buffer);
+        // La conexión reusada estaba muerta (RST/cierre del server): reabrir y
+        // repetir una vez sin contarlo como intento ni reportarlo como error.
+        if (reused && !stale_retry_done && isConnectionError(err)) {
+            ESP_LOGD(FIREBASE_APP_TAG, "Conexión reusada caída (%s): reconectando", esp_err_to_name(err));
+            esp_http_client_close(client);
+            slot->conn_open = false;
+            stale_retries++;
+            stale_retry_done = true;
+            --attempt;
+            continue;
+        }
 
-        // Reintento: asegurar headers/estado del body correctos
-        if (method == HTTP_METHOD_POST || method == HTTP_METHOD_PUT || method == HTTP_METHOD_PATCH) {
-            setHeader("content-type", "application/json");
+        ESP_LOGE(FIREBASE_APP_TAG,
+                "request: url=%s\nmethod=%d\npost_field=%.*s",
+                url, method, (int)body_len, body ? body : "");
+        if (ctx->sink) {
+            ESP_LOGE(FIREBASE_APP_TAG, "response: %u bytes (streaming)", (unsigned)ctx->sink->offset());
         } else {
-            esp_http_client_set_post_field(FirebaseApp::client, "", 0);
-            esp_http_client_set_header(FirebaseApp::client, "Content-Length", "0");
+            ESP_LOGE(FIREBASE_APP_TAG, "response=\n%s", ctx->buffer);
         }
-        vTaskDelay(pdMS_TO_TICKS(500));
+
+        // Error de transporte: el estado de la conexión es incierto, empezar limpio
+        if (err != ESP_OK) {
+            esp_http_client_close(client);
+            slot->conn_open = false;
+        }
+
+        // Solo se repiten los fallos transitorios, con backoff y dentro del plazo
+        int backoff_ms = retryBackoffMs(policy, attempt + 1, esp_random());
+        int64_t elapsed_ms = (esp_timer_get_time() - t_begin) / 1000;
+        if (!retryShouldContinue(policy, result, attempt, elapsed_ms, backoff_ms)) break;
+        ESP_LOGW(FIREBASE_APP_TAG, "Intento %d a %s fallo (err=0x%x, status=%d): reintento en %d ms",
+                 attempt, slot->host, (unsigned)err, status_code, backoff_ms);
+        retries++;
+        vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+    }
+    ctx->status_code = status_code;
+    if (ctx->want_etag) esp_http_client_delete_header(client, "X-Firebase-ETag");
+    if (conditional) esp_http_client_delete_header(client, "if-none-match");
+    esp_http_client_set_user_data(client, nullptr);
+    xSemaphoreGive(slot->busy);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    slot->users--;
+    if (breakerRecord(slot->breaker, FirebaseApp::breaker_config, result, esp_timer_get_time())) {
+        FirebaseApp::stats.breaker_opens++;
+        ESP_LOGW(FIREBASE_APP_TAG, "Circuito de %s abierto tras %d fallos seguidos", slot->host, slot->breaker.failures);
+    }
+    FirebaseApp::stats.retries += retries;
+    if (idle_reconnect) FirebaseApp::stats.idle_reconnects++;
+    FirebaseApp::stats.stale_retries += stale_retries;
+    if (reused && err == ESP_OK && status_code >= 200 && status_code < 300) FirebaseApp::stats.reused++;
+    const int64_t total_us = esp_timer_get_time() - t_begin;
+    FirebaseApp::stats.request_time_us += total_us;
+    FirebaseApp::stats.tx_body_bytes += tx_bytes;
+    FirebaseApp::stats.rx_body_bytes += ctx->rx_bytes;
+    metricsRecordRequest(FirebaseApp::metrics.method[metricsMethod(method)], result == RETRY_SUCCESS,
+                         total_us, tx_bytes, ctx->rx_bytes);
+    uint32_t heap_free = esp_get_free_heap_size();
+    if (FirebaseApp::metrics.heap_min_at_request == 0 || heap_free < FirebaseApp::metrics.heap_min_at_request) {
+        FirebaseApp::metrics.heap_min_at_request = heap_free;
     }
+    xSemaphoreGive(lock);
     return {err, status_code};
 }
 
+void FirebaseApp::setRetryPolicy(const retry_policy_t& policy)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FirebaseApp::retry_policy = policy;
+    if (!FirebaseApp::retry_policy.classify) FirebaseApp::retry_policy.classify = defaultRetryClassifier;
+    xSemaphoreGive(lock);
+}
 
-void FirebaseApp::clearHTTPBuffer(void)
-{   
-    memset(FirebaseApp::local_response_buffer, 0, HTTP_RECV_BUFFER_SIZE);
-    output_len = 0;
+void FirebaseApp::setBreakerConfig(const breaker_config_t& config)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FirebaseApp::breaker_config = config;
+    xSemaphoreGive(lock);
+}
+
+void FirebaseApp::getMetrics(firebase_metrics_t& out)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    out = FirebaseApp::metrics;
+    xSemaphoreGive(lock);
+    out.heap_min_free = esp_get_minimum_free_heap_size();
+}
+
+void FirebaseApp::setTimeoutProfile(const timeout_profile_t& profile)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FirebaseApp::timeout_profile = profile;
+    xSemaphoreGive(lock);
 }
 
-void FirebaseApp::setHttpTimeoutMs(int ms) {
-    if (this->client) esp_http_client_set_timeout_ms(this->client, ms);
+int FirebaseApp::attemptTimeoutMs(conn_slot_t* slot, const request_ctx_t* ctx)
+{
+    if (ctx->timeout_ms > 0) return ctx->timeout_ms;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    const timeout_profile_t& profile = ctx->timeouts ? *ctx->timeouts : FirebaseApp::timeout_profile;
+    int timeout_ms = rttTimeoutMs(slot->rtt, profile, default_timeout_ms);
+    // Hay que abrir conexión: el mismo timeout cubre el handshake
+    if (!slot->conn_open) {
+        int connect_ms = rttTimeoutMs(slot->connect, CONNECT_TIMEOUT_PROFILE, default_timeout_ms);
+        if (connect_ms > timeout_ms) timeout_ms = connect_ms;
+    }
+    xSemaphoreGive(lock);
+    return timeout_ms;
 }
 
-void FirebaseApp::restoreDefaultHttpTimeout() {
-    if (this->client) esp_http_client_set_timeout_ms(this->client, this->default_timeout_ms);
+int FirebaseApp::hostRtt(firebase_host_rtt_t* out, int max)
+{
+    int n = 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < MAX_HOSTS && n < max; ++i) {
+        const conn_slot_t& slot = slots[i];
+        if (!slot.client) continue;
+        firebase_host_rtt_t& h = out[n++];
+        memset(&h, 0, sizeof(h));
+        strncpy(h.host, slot.host, sizeof(h.host) - 1);
+        h.srtt_ms = (uint32_t)slot.rtt.srtt_ms;
+        h.rttvar_ms = (uint32_t)slot.rtt.rttvar_ms;
+        h.rto_ms = (uint32_t)rttRtoMs(slot.rtt);
+        h.samples = slot.rtt.samples;
+        h.timeouts = slot.rtt.timeouts;
+        h.connect_srtt_ms = (uint32_t)slot.connect.srtt_ms;
+        h.connect_timeouts = slot.connect.timeouts;
+        h.timeout_ms = (uint32_t)rttTimeoutMs(slot.rtt, FirebaseApp::timeout_profile, default_timeout_ms);
+    }
+    xSemaphoreGive(lock);
+    return n;
 }
 
+bool FirebaseApp::circuitOpen(const char* url)
+{
+    char host[sizeof(slots[0].host)];
+    if (!hostFromUrl(url, host, sizeof(host))) return false;
+    bool open = false;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < MAX_HOSTS; ++i) {
+        if (slots[i].client && strcmp(slots[i].host, host) == 0) {
+            open = breakerIsOpen(slots[i].breaker, esp_timer_get_time());
+        }
+    }
+    xSemaphoreGive(lock);
+    return open;
+}
 
 esp_err_t FirebaseApp::getRefreshToken(bool register_account)
 {
@@ -197,31 +618,35 @@ esp_err_t FirebaseApp::getRefreshToken(bool register_account)
     account_json += FirebaseApp::user_account.user_password;
     account_json += R"(", "returnSecureToken": true})"; 
 
-    FirebaseApp::setHeader("content-type", "application/json");
+    request_ctx_t* ctx = FirebaseApp::acquireRequest();
     if (register_account)
     {
-        http_ret = FirebaseApp::performRequest(FirebaseApp::register_url.c_str(), HTTP_METHOD_POST, account_json);
+        http_ret = FirebaseApp::performRequest(FirebaseApp::register_url.c_str(), HTTP_METHOD_POST, account_json, ctx);
     }
     else
     {
-        http_ret = FirebaseApp::performRequest(FirebaseApp::login_url.c_str(), HTTP_METHOD_POST, account_json);
+        http_ret = FirebaseApp::performRequest(FirebaseApp::login_url.c_str(), HTTP_METHOD_POST, account_json, ctx);
     }
 
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200)
+    if (http_ret.err == ESP_OK && http_ret.status_code == 200 && !ctx->truncated)
     {
-        // std::cout << FirebaseApp::local_response_buffer << '\n';
-        const char* begin = FirebaseApp::local_response_buffer;
-        const char* end = begin + strlen(FirebaseApp::local_response_buffer);
-        Json::Reader reader;
-        Json::Value data;
-        reader.parse(begin, end, data, false);
-        FirebaseApp::refresh_token = data["refreshToken"].asString();
+        // El buffer de URL ya no se usa: recibe el refresh token
+        Json::FieldExtractor::Field fields[] = {{"refreshToken", ctx->url, sizeof(ctx->url)}};
+        if (!extractFields(ctx, fields, 1) || !fields[0].found) {
+            ESP_LOGE(FIREBASE_APP_TAG, "Respuesta de login sin refreshToken");
+            FirebaseApp::releaseRequest(ctx);
+            return ESP_FAIL;
+        }
+        FirebaseApp::refresh_token = fields[0].out;
+        FirebaseApp::releaseRequest(ctx);
 
         ESP_LOGD(FIREBASE_APP_TAG, "Refresh Token=%s", FirebaseApp::refresh_token.c_str());
         return ESP_OK;
     }
     else 
     {
+        if (ctx->truncated) ESP_LOGE(FIREBASE_APP_TAG, "Respuesta de login truncada");
+        FirebaseApp::releaseRequest(ctx);
         return ESP_FAIL;
     }
 }
@@ -233,30 +658,66 @@ esp_err_t FirebaseApp::getAuthToken()
     token_post_data+= FirebaseApp::refresh_token + "\"}";
 
 
-    FirebaseApp::setHeader("content-type", "application/json");
-    http_ret = FirebaseApp::performRequest(FirebaseApp::auth_url.c_str(), HTTP_METHOD_POST, token_post_data);
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200)
+    request_ctx_t* ctx = FirebaseApp::acquireRequest();
+    http_ret = FirebaseApp::performRequest(FirebaseApp::auth_url.c_str(), HTTP_METHOD_POST, token_post_data, ctx);
+    if (http_ret.err == ESP_OK && http_ret.status_code == 200 && !ctx->truncated)
     {
-        const char* begin = FirebaseApp::local_response_buffer;
-        const char* end = begin + strlen(FirebaseApp::local_response_buffer);
-        Json::Reader reader;
-        Json::Value data;
-        reader.parse(begin, end, data, false);
-        FirebaseApp::auth_token = data["access_token"].asString();
+        // Una pasada sin DOM; los buffers de URL y body del ctx ya no se usan
+        char expires_in[16];
+        char expires_in_alt[16];
+        Json::FieldExtractor::Field fields[] = {
+            {"access_token", ctx->send, sizeof(ctx->send)},
+            {"refresh_token", ctx->url, sizeof(ctx->url)},
+            {"expires_in", expires_in, sizeof(expires_in)},
+            {"expiresIn", expires_in_alt, sizeof(expires_in_alt)},  // por si cambia el campo
+        };
+        if (!extractFields(ctx, fields, 4) || !fields[0].found) {
+            ESP_LOGE(FIREBASE_APP_TAG, "Respuesta de refresh sin access_token");
+            FirebaseApp::releaseRequest(ctx);
+            return ESP_FAIL;
+        }
+        xSemaphoreTake(token_lock, portMAX_DELAY);
+        FirebaseApp::auth_token = fields[0].out;
+        FirebaseApp::token_generation++;
+        xSemaphoreGive(token_lock);
+        // securetoken puede rotar el refresh token
+        if (fields[1].found) FirebaseApp::refresh_token = fields[1].out;
         // expires_in llega como string en segundos
-        if (data.isMember("expires_in")) {
-            FirebaseApp::auth_expires_in = atoi(data["expires_in"].asCString());
-        } else if (data.isMember("expiresIn")) { // por si cambia el campo
-            FirebaseApp::auth_expires_in = atoi(data["expiresIn"].asCString());
+        if (fields[2].found) {
+            FirebaseApp::auth_expires_in = atoi(expires_in);
+        } else if (fields[3].found) {
+            FirebaseApp::auth_expires_in = atoi(expires_in_alt);
         } else {
             FirebaseApp::auth_expires_in = 3600; // fallback 1h
         }
-        FirebaseApp::auth_obtained_time = time(NULL);
-
-        ESP_LOGI(FIREBASE_APP_TAG, "Auth Token acquired (expira en %d s)", FirebaseApp::auth_expires_in);
+        FirebaseApp::releaseRequest(ctx);
+        if (FirebaseApp::auth_expires_in <= 0) FirebaseApp::auth_expires_in = 3600;
+
+        // Renovar antes de que expire; el jitter evita que varios equipos
+        // (o varios arranques a la vez) renueven en el mismo segundo
+        int lead_s = AUTH_REFRESH_MARGIN_S + (int)(esp_random() % AUTH_REFRESH_JITTER_S);
+        if (lead_s > FirebaseApp::auth_expires_in / 2) lead_s = FirebaseApp::auth_expires_in / 2;
+        FirebaseApp::auth_refresh_at_us = esp_timer_get_time() +
+            (int64_t)(FirebaseApp::auth_expires_in - lead_s) * 1000000;
+
+        ESP_LOGI(FIREBASE_APP_TAG, "Auth Token acquired (expira en %d s, renovación en %d s)",
+                 FirebaseApp::auth_expires_in, FirebaseApp::auth_expires_in - lead_s);
+        if (FirebaseApp::token_listener) {
+            time_t now = time(NULL);
+            int64_t expires_at = (now > CLOCK_VALID_EPOCH) ? (int64_t)now + FirebaseApp::auth_expires_in : 0;
+            FirebaseApp::token_listener(FirebaseApp::refresh_token.c_str(), FirebaseApp::auth_token.c_str(),
+                                        expires_at, FirebaseApp::token_listener_user);
+        }
         return ESP_OK;
     }
     else {
+        if (ctx->truncated) ESP_LOGE(FIREBASE_APP_TAG, "Respuesta de refresh truncada");
+        FirebaseApp::releaseRequest(ctx);
+        // 400/401/403: refresh token revocado o inválido. El resto (red, 5xx) es transitorio.
+        if (http_ret.err == ESP_OK && (http_ret.status_code == 400 || http_ret.status_code == 401 ||
+                                       http_ret.status_code == 403)) {
+            return ESP_ERR_INVALID_STATE;
+        }
         return ESP_FAIL;
     }
 
@@ -266,105 +727,205 @@ esp_err_t FirebaseApp::getAuthToken()
 FirebaseApp::FirebaseApp(const char* api_key)
     : api_key(api_key)
 {
-    
-    FirebaseApp::local_response_buffer = new char[HTTP_RECV_BUFFER_SIZE];
+    FirebaseApp::lock = xSemaphoreCreateMutex();
+    FirebaseApp::auth_lock = xSemaphoreCreateMutex();
+    FirebaseApp::token_lock = xSemaphoreCreateMutex();
+    FirebaseApp::pool_free = xSemaphoreCreateCounting(HTTP_REQUEST_POOL_SIZE, HTTP_REQUEST_POOL_SIZE);
+    for (int i = 0; i < MAX_HOSTS; ++i) {
+        slots[i].busy = xSemaphoreCreateMutex();
+    }
     FirebaseApp::register_url += FirebaseApp::api_key; 
     FirebaseApp::login_url += FirebaseApp::api_key;
     FirebaseApp::auth_url += FirebaseApp::api_key;
-    firebaseClientInit();
 }
 
 FirebaseApp::~FirebaseApp()
 {
-    delete[] FirebaseApp::local_response_buffer;
-    esp_http_client_cleanup(FirebaseApp::client);
+    for (int i = 0; i < MAX_HOSTS; ++i) {
+        if (slots[i].client) esp_http_client_cleanup(slots[i].client);
+        if (slots[i].transport) esp_transport_destroy(slots[i].transport);
+        vSemaphoreDelete(slots[i].busy);
+    }
+    vSemaphoreDelete(FirebaseApp::pool_free);
+    vSemaphoreDelete(FirebaseApp::lock);
+    vSemaphoreDelete(FirebaseApp::auth_lock);
+    vSemaphoreDelete(FirebaseApp::token_lock);
 }
 
-esp_err_t FirebaseApp::registerUserAccount(const user_account_t& account)
+void FirebaseApp::lockAuth()
 {
-    if (FirebaseApp::user_account.user_email != account.user_email || FirebaseApp::user_account.user_password != account.user_password)
-    {
-        FirebaseApp::user_account.user_email = account.user_email;
-        FirebaseApp::user_account.user_password = account.user_password;
-    }
-    esp_err_t err = FirebaseApp::getRefreshToken(true);
+    if (xSemaphoreTake(auth_lock, 0) == pdTRUE) return;
+    // Otra tarea está renovando: esperar su resultado en vez de pedir otro
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FirebaseApp::stats.auth_waits++;
+    xSemaphoreGive(lock);
+    xSemaphoreTake(auth_lock, portMAX_DELAY);
+}
+
+esp_err_t FirebaseApp::loginLocked(bool register_account)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FirebaseApp::stats.auth_logins++;
+    xSemaphoreGive(lock);
+
+    esp_err_t err = FirebaseApp::getRefreshToken(register_account);
     if (err != ESP_OK)
     {
         ESP_LOGE(FIREBASE_APP_TAG, "Failed to get refresh token");
         return ESP_FAIL;
     }
-    FirebaseApp::clearHTTPBuffer();
     err = FirebaseApp::getAuthToken();
     if (err != ESP_OK)
     {
         ESP_LOGE(FIREBASE_APP_TAG, "Failed to get auth token");
         return ESP_FAIL;
     }
-    FirebaseApp::clearHTTPBuffer();
-    ESP_LOGI(FIREBASE_APP_TAG, "Created user successfully");
-
     return ESP_OK;
 }
 
-esp_err_t FirebaseApp::loginUserAccount(const user_account_t& account)
+esp_err_t FirebaseApp::refreshLocked()
+{
+    if (FirebaseApp::refresh_token.empty()) return FirebaseApp::loginLocked(false);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FirebaseApp::stats.auth_refreshes++;
+    xSemaphoreGive(lock);
+
+    esp_err_t err = FirebaseApp::getAuthToken();
+    if (err == ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(FIREBASE_APP_TAG, "Refresh token rechazado: login completo");
+        return FirebaseApp::loginLocked(false);
+    }
+    if (err != ESP_OK) {
+        // Sin red o server caído: el token actual puede seguir valiendo; reintentar pronto
+        xSemaphoreTake(lock, portMAX_DELAY);
+        FirebaseApp::stats.auth_refresh_failures++;
+        xSemaphoreGive(lock);
+        FirebaseApp::auth_refresh_at_us = esp_timer_get_time() + (int64_t)AUTH_RETRY_S * 1000000;
+        ESP_LOGW(FIREBASE_APP_TAG, "Fallo refresh (transitorio); reintento en %d s", AUTH_RETRY_S);
+    }
+    return err;
+}
+
+esp_err_t FirebaseApp::registerUserAccount(const user_account_t& account)
 {
     if (FirebaseApp::user_account.user_email != account.user_email || FirebaseApp::user_account.user_password != account.user_password)
     {
         FirebaseApp::user_account.user_email = account.user_email;
         FirebaseApp::user_account.user_password = account.user_password;
     }
-    esp_err_t err = FirebaseApp::getRefreshToken(false);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(FIREBASE_APP_TAG, "Failed to get refresh token");
-        return ESP_FAIL;
-    }
-    FirebaseApp::clearHTTPBuffer();
+    FirebaseApp::lockAuth();
+    esp_err_t err = FirebaseApp::loginLocked(true);
+    xSemaphoreGive(auth_lock);
+    if (err != ESP_OK) return ESP_FAIL;
+    ESP_LOGI(FIREBASE_APP_TAG, "Created user successfully");
 
-    err = FirebaseApp::getAuthToken();
-    if (err != ESP_OK)
+    return ESP_OK;
+}
+
+esp_err_t FirebaseApp::loginUserAccount(const user_account_t& account)
+{
+    if (FirebaseApp::user_account.user_email != account.user_email || FirebaseApp::user_account.user_password != account.user_password)
     {
-        ESP_LOGE(FIREBASE_APP_TAG, "Failed to get auth token");
-        return ESP_FAIL;
+        FirebaseApp::user_account.user_email = account.user_email;
+        FirebaseApp::user_account.user_password = account.user_password;
     }
-    FirebaseApp::clearHTTPBuffer();
+    FirebaseApp::lockAuth();
+    esp_err_t err = FirebaseApp::loginLocked(false);
+    xSemaphoreGive(auth_lock);
+    if (err != ESP_OK) return ESP_FAIL;
     ESP_LOGI(FIREBASE_APP_TAG, "Login to user successful");
     return ESP_OK;
 }
 
-esp_err_t FirebaseApp::refreshAuthIfNeeded()
+uint32_t FirebaseApp::validTokenGeneration()
 {
+    FirebaseApp::lockAuth();
     if (FirebaseApp::auth_token.empty()) {
         ESP_LOGW(FIREBASE_APP_TAG, "No auth token yet, logging in again");
-        return FirebaseApp::loginUserAccount(FirebaseApp::user_account);
+        FirebaseApp::loginLocked(false);
+    } else if (esp_timer_get_time() >= FirebaseApp::auth_refresh_at_us) {
+        ESP_LOGI(FIREBASE_APP_TAG, "Auth token por expirar: renovando");
+        // Si falla por red se sigue con el token actual (puede que aún valga)
+        FirebaseApp::refreshLocked();
+    }
+    uint32_t generation = FirebaseApp::auth_token.empty() ? 0 : FirebaseApp::token_generation;
+    xSemaphoreGive(auth_lock);
+    return generation;
+}
+
+uint32_t FirebaseApp::tokenGeneration()
+{
+    xSemaphoreTake(token_lock, portMAX_DELAY);
+    uint32_t generation = FirebaseApp::auth_token.empty() ? 0 : FirebaseApp::token_generation;
+    xSemaphoreGive(token_lock);
+    return generation;
+}
+
+size_t FirebaseApp::copyToken(char* out, size_t cap, uint32_t* generation)
+{
+    xSemaphoreTake(token_lock, portMAX_DELAY);
+    size_t len = FirebaseApp::auth_token.size();
+    if (len < cap) memcpy(out, FirebaseApp::auth_token.c_str(), len + 1);
+    if (generation) *generation = (len == 0) ? 0 : FirebaseApp::token_generation;
+    xSemaphoreGive(token_lock);
+    return len;
+}
+
+uint32_t FirebaseApp::onUnauthorized(uint32_t rejected)
+{
+    FirebaseApp::lockAuth();
+    // Si mientras tanto otra tarea ya lo renovó, basta con usar el nuevo
+    if (FirebaseApp::auth_token.empty() || FirebaseApp::token_generation == rejected) {
+        ESP_LOGW(FIREBASE_APP_TAG, "401 con el token actual: renovando");
+        FirebaseApp::refreshLocked();
     }
+    uint32_t generation = FirebaseApp::auth_token.empty() ? 0 : FirebaseApp::token_generation;
+    xSemaphoreGive(auth_lock);
+    return generation;
+}
+
+esp_err_t FirebaseApp::restoreSession(const char* refresh, const char* id_token, int64_t expires_at)
+{
+    if (!refresh || !refresh[0]) return ESP_ERR_INVALID_ARG;
+    FirebaseApp::lockAuth();
+    FirebaseApp::refresh_token = refresh;
     time_t now = time(NULL);
-    if (FirebaseApp::auth_expires_in <= 0) return ESP_OK; // sin info, confiar
-    int elapsed = (int)(now - FirebaseApp::auth_obtained_time);
-    int remaining = FirebaseApp::auth_expires_in - elapsed;
-    if (remaining < 30) { // menos de 30s, renovar
-        ESP_LOGI(FIREBASE_APP_TAG, "Auth token a punto de expirar (%d s). Renovando...", remaining);
-        if (FirebaseApp::getAuthToken() == ESP_OK) {
-            FirebaseApp::clearHTTPBuffer();
-            return ESP_OK;
-        } else {
-            ESP_LOGW(FIREBASE_APP_TAG, "Fallo refresh directo, intentando login completo");
-            esp_err_t err = FirebaseApp::loginUserAccount(FirebaseApp::user_account);
-            return err;
-        }
+    int64_t remaining = (now > CLOCK_VALID_EPOCH && expires_at > 0) ? expires_at - (int64_t)now : 0;
+    esp_err_t err;
+    if (id_token && id_token[0] && remaining > AUTH_REFRESH_MARGIN_S) {
+        // Arranque en caliente: el ID token guardado todavía vale
+        xSemaphoreTake(token_lock, portMAX_DELAY);
+        FirebaseApp::auth_token = id_token;
+        FirebaseApp::token_generation++;
+        xSemaphoreGive(token_lock);
+        FirebaseApp::auth_expires_in = (int)remaining;
+        FirebaseApp::auth_refresh_at_us = esp_timer_get_time() + (remaining - AUTH_REFRESH_MARGIN_S) * 1000000;
+        ESP_LOGI(FIREBASE_APP_TAG, "Sesión restaurada (ID token válido %lld s más)", (long long)remaining);
+        err = ESP_OK;
+    } else {
+        ESP_LOGI(FIREBASE_APP_TAG, "Sesión restaurada: renovando ID token");
+        err = FirebaseApp::refreshLocked();
     }
-    return ESP_OK;
+    xSemaphoreGive(auth_lock);
+    return err;
+}
+
+void FirebaseApp::setTokenListener(token_listener_t listener, void* user)
+{
+    FirebaseApp::lockAuth();
+    FirebaseApp::token_listener = listener;
+    FirebaseApp::token_listener_user = user;
+    xSemaphoreGive(auth_lock);
 }
 
 esp_err_t FirebaseApp::forceRefreshAuth()
 {
     ESP_LOGI(FIREBASE_APP_TAG, "Forzando refresh de auth token...");
-    if (FirebaseApp::getAuthToken() == ESP_OK) {
-        FirebaseApp::clearHTTPBuffer();
-        return ESP_OK;
-    }
-    ESP_LOGW(FIREBASE_APP_TAG, "Fallo refresh directo, intentando login completo");
-    return FirebaseApp::loginUserAccount(FirebaseApp::user_account);
+    FirebaseApp::lockAuth();
+    esp_err_t err = FirebaseApp::refreshLocked();
+    xSemaphoreGive(auth_lock);
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
 }
 
 
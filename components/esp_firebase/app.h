@@ -1,11 +1,28 @@
 #ifndef _ESP_FIREBASE_H_
 #define  _ESP_FIREBASE_H_
 #include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <string>
+#include "firebase.h"
+#include "retry_policy.h"
+#include "rtt_estimator.h"
+#include "tls_transport.h"
 
+namespace Json { class StreamReader; }
 
-// Buffer de recepción HTTP ampliado para respuestas más grandes
-#define HTTP_RECV_BUFFER_SIZE 16384
+
+// Buffer de recepción HTTP de cada request_ctx_t, para respuestas pequeñas (auth,
+// errores). Las lecturas de la RTDB no pasan por aquí: se parsean en streaming (sink)
+#define HTTP_RECV_BUFFER_SIZE 6144
+// Requests simultáneos (de distintas tareas) que admite una FirebaseApp
+#define HTTP_REQUEST_POOL_SIZE 2
+// Buffer interno de lectura de cada esp_http_client (uno por host)
+#define HTTP_CLIENT_RX_BUFFER_SIZE 4096
+// URL de cada request_ctx_t: base + ruta + query + auth (el ID token ronda 1 KB)
+#define HTTP_URL_BUFFER_SIZE 2048
+// Body de envío de cada request_ctx_t para Json::Value serializados (ver RequestBuilder)
+#define HTTP_SEND_BUFFER_SIZE 2048
 
 namespace ESPFirebase 
 {
@@ -21,6 +38,10 @@ namespace ESPFirebase
         esp_err_t err;
         int status_code;
     }; 
+
+    // Avisa cada vez que cambian los tokens (para persistirlos). expires_at es
+    // epoch del ID token, 0 si el reloj aún no está en hora.
+    typedef void (*token_listener_t)(const char* refresh_token, const char* id_token, int64_t expires_at, void* user);
     /**
      * @brief Class over the esp_http_client, handles auth and should be passed as ptr to other classes such as RTDB 
      * 
@@ -33,51 +54,195 @@ namespace ESPFirebase
             std::string login_url = "https://identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key=";
             std::string auth_url = "https://securetoken.googleapis.com/v1/token?key=";
             std::string refresh_token = "";
-            esp_http_client_handle_t client;
-            bool client_initialized = false;
-            // Control de expiración
-            time_t auth_obtained_time = 0;   // epoch cuando se obtuvo el access token
-            int auth_expires_in = 0;         // segundos que dura el token
+            std::string auth_token = "";
+
+            // Gestor de auth: el token se renueva antes de expirar, según el
+            // expires_in real menos un margen y un jitter aleatorio. Un solo
+            // refresh en vuelo (auth_lock): las demás tareas esperan su resultado.
+            // El login con email/password solo se usa si el refresh token es rechazado.
+            // auth_lock nunca se toma con un request_ctx_t en la mano: quien lo
+            // tiene (el refresh) puede estar esperando uno del pool.
+            static constexpr int AUTH_REFRESH_MARGIN_S = 300;
+            static constexpr int AUTH_REFRESH_JITTER_S = 120;
+            static constexpr int AUTH_RETRY_S = 30;       // tras un refresh fallido por red
+            SemaphoreHandle_t auth_lock = nullptr;
+            int auth_expires_in = 0;                      // segundos que dura el token
+            int64_t auth_refresh_at_us = 0;               // esp_timer: cuándo renovar
+            uint32_t token_generation = 0;                // sube con cada auth_token nuevo; 0: sin token
+            // auth_token y token_generation para leerlos sin auth_lock (con un
+            // request_ctx_t tomado). Se escriben con los dos; solo copias cortas.
+            SemaphoreHandle_t token_lock = nullptr;
+            token_listener_t token_listener = nullptr;
+            void* token_listener_user = nullptr;
 
             int default_timeout_ms = 20000;
 
-            void firebaseClientInit(void);
+            // Gestión de la conexión persistente. El server corta conexiones
+            // ociosas a los ~10 min (RST en el primer write); la cerramos antes.
+            static constexpr int64_t IDLE_RECONNECT_US = 8LL * 60 * 1000000; // 8 min
+
+            // Un cliente por host (identitytoolkit, securetoken, RTDB): cada uno
+            // ofrece el ticket de sesión TLS de su host (ver tls_transport.h), así
+            // cambiar de host no tira la sesión del otro y las reconexiones, y el
+            // primer request tras un reinicio, hacen handshake abreviado.
+            // Solo el host persistente (RTDB) mantiene el socket abierto; los de
+            // auth se cierran tras cada request pero conservan el ticket.
+            // Un esp_http_client no admite dos requests a la vez: 'busy' lo serializa
+            // y 'users' impide reciclar un slot que otra tarea va a usar.
+            static constexpr int MAX_HOSTS = 3;
+            struct conn_slot_t
+            {
+                char host[64];
+                esp_http_client_handle_t client;
+                esp_transport_handle_t transport; // TLS propio; nullptr: el SSL de esp_http_client
+                bool conn_open;            // lo mantienen los eventos CONNECTED/DISCONNECTED
+                bool keep_open;
+                uint32_t handshakes;       // conexiones abiertas por este cliente
+                int64_t last_activity_us;
+                int users;                 // protegido por 'lock'
+                circuit_breaker_t breaker; // idem
+                rtt_estimator_t rtt;       // idem: envío del request -> primer byte de la respuesta
+                rtt_estimator_t connect;   // idem: conexión nueva (TCP + TLS)
+                SemaphoreHandle_t busy;
+            };
+            conn_slot_t slots[MAX_HOSTS] = {};
+            std::string persistent_host = "";
+            firebase_stats_t stats = {};
+            firebase_metrics_t metrics = {};
+            SemaphoreHandle_t lock = nullptr;      // slots, pool y stats
+            SemaphoreHandle_t pool_free = nullptr; // cuenta los request_ctx_t libres
+            retry_policy_t retry_policy = DEFAULT_RETRY_POLICY;
+            breaker_config_t breaker_config = DEFAULT_BREAKER_CONFIG;
+            timeout_profile_t timeout_profile = DEFAULT_TIMEOUT_PROFILE;
+
+        public:
+            /**
+             * @brief Estado de un request en curso. Se pasa al handler de eventos como
+             * user_data, así que cada request escribe en su propio buffer y varias
+             * tareas pueden tener requests en vuelo a la vez. Sale de un pool fijo.
+             */
+            struct request_ctx_t
+            {
+                char buffer[HTTP_RECV_BUFFER_SIZE]; // body si no hay sink, terminado en '\0'
+                size_t len;
+                bool truncated;            // el body no cupo en buffer
+                int status_code;
+                char etag[64];             // header ETag de la respuesta ("" si no vino)
+                bool want_etag;            // pedir el ETag (X-Firebase-ETag)
+                const char* if_none_match; // ETag ya conocido: se compara con el de la respuesta
+                bool send_if_none_match;   // además mandarlo en if-none-match (304 si no cambió)
+                bool etag_matched;         // vino 200 con ese mismo ETag: el body no se procesa
+                size_t rx_bytes;           // body recibido, todos los intentos
+                char url[HTTP_URL_BUFFER_SIZE];   // para armar la URL sin memoria dinámica
+                char send[HTTP_SEND_BUFFER_SIZE]; // idem, body serializado
+                Json::StreamReader* sink;  // si no es nullptr recibe el body por trozos
+                int timeout_ms;            // fijo; 0: según el RTT medido del host (ver 'timeouts')
+                const timeout_profile_t* timeouts; // nullptr: el de la app
+                const retry_policy_t* retry;      // nullptr: el de la app
+                // Internos de FirebaseApp
+                FirebaseApp* app;
+                conn_slot_t* slot;
+                int64_t start_us;
+                int64_t connected_us;      // conexión abierta en este intento (0: reusada)
+                int64_t sent_us;           // headers enviados (intento actual)
+                int64_t first_byte_us;     // primer header de la respuesta
+                bool in_use;
+            };
+
+            // Toma un contexto del pool (espera si están todos en uso). 'sink' se
+            // resetea al empezar cada intento. Devolverlo con releaseRequest().
+            request_ctx_t* acquireRequest(Json::StreamReader* sink = nullptr);
+            void releaseRequest(request_ctx_t* ctx);
+
+        private:
+            request_ctx_t request_pool[HTTP_REQUEST_POOL_SIZE] = {};
+
+            static esp_err_t httpEventHandler(esp_http_client_event_t *evt);
+            static bool isConnectionError(esp_err_t err);
+            // Falló por agotar el plazo (no por DNS, RST o alerta TLS)
+            static bool isTimeout(esp_err_t err, int64_t elapsed_us, int timeout_ms);
+            static bool hostFromUrl(const char* url, char* host, size_t host_len);
+            conn_slot_t* slotForUrl(const char* url);
+            int attemptTimeoutMs(conn_slot_t* slot, const request_ctx_t* ctx);
+            void firebaseClientInit(conn_slot_t* slot);
         
             esp_err_t getRefreshToken(bool register_account);
+            // ESP_ERR_INVALID_STATE: el server rechazó el refresh token (hay que hacer login)
             esp_err_t getAuthToken();
+            // Con auth_lock tomado
+            void lockAuth();
+            esp_err_t loginLocked(bool register_account);
+            esp_err_t refreshLocked();
             
 
         public:
             user_account_t user_account = {"", ""};
 
-            char* local_response_buffer;
-
-            std::string auth_token = "";
-
             /**
-             * @brief Standard http request. Use after firebaseClientInit(). response stored in local_response_buffer. 
+             * @brief Standard http request. Response stored in ctx (buffer or ctx->sink).
              * 
              * @param url Request url
              * @param method Request method
-             * @param post_field Optional post field. Used when method is POST
+             * @param body Body for POST/PUT/PATCH (not copied: must outlive the call)
+             * @param body_len Body length
+             * @param ctx Context from acquireRequest()
              * @return Returns struct http_ret_t: esp_err_t + http status code.
              */
+            http_ret_t performRequest(const char* url, esp_http_client_method_t method, const char* body, size_t body_len, request_ctx_t* ctx);
+            http_ret_t performRequest(const char* url, esp_http_client_method_t method, const std::string& post_field, request_ctx_t* ctx)
+            {
+                return performRequest(url, method, post_field.data(), post_field.size(), ctx);
+            }
+            // Igual, con un contexto temporal: para cuando el body de la respuesta no interesa
             http_ret_t performRequest(const char* url, esp_http_client_method_t method, std::string post_field = "");
             esp_err_t setHeader(const char* header, const char* value);
-            
-            void clearHTTPBuffer(void);
 
-            void setHttpTimeoutMs(int ms);
-            void restoreDefaultHttpTimeout();
+            // Contadores de conexión (handshakes, reuso, tiempo por request)
+            const firebase_stats_t& getStats() const { return stats; }
+            // Tiempos por tramo, histogramas y bytes por método (ver request_metrics.h)
+            void getMetrics(firebase_metrics_t& out);
+
+            // Host cuya conexión se mantiene abierta entre requests (la RTDB)
+            void setPersistentHost(const char* url);
+
+            // Reintentos de performRequest (por defecto DEFAULT_RETRY_POLICY) y
+            // circuit breaker por host. Con el circuito abierto performRequest
+            // devuelve ESP_ERR_NOT_FINISHED sin tocar la red.
+            void setRetryPolicy(const retry_policy_t& policy);
+            void setBreakerConfig(const breaker_config_t& config);
+            bool circuitOpen(const char* url);
+
+            // Timeouts adaptativos: cada intento usa el RTO del host (RTT medido)
+            // según 'profile', y el de conexión si hay que abrir una. Sin muestras,
+            // el timeout por defecto. Un request con ctx->timeout_ms lo fija a mano.
+            void setTimeoutProfile(const timeout_profile_t& profile);
+            // Estado de los estimadores, un elemento por host. Devuelve cuántos llenó.
+            int hostRtt(firebase_host_rtt_t* out, int max);
             
             FirebaseApp(const char * api_key);
             ~FirebaseApp();
             esp_err_t registerUserAccount(const user_account_t& account);
             esp_err_t loginUserAccount(const user_account_t& account);
-            // Comprueba y renueva si faltan <30s
-            esp_err_t refreshAuthIfNeeded();
-            // Forzar refresh inmediato (si falla intentará login)
+            // Deja un token válido para el próximo request: renueva antes si toca (o
+            // espera al refresh que otra tarea ya tenga en vuelo). Devuelve su
+            // generación (0: no hay sesión). No llamar con un request_ctx_t tomado.
+            uint32_t validTokenGeneration();
+            // Estas dos no esperan a un refresh en curso (no toman auth_lock): se
+            // pueden llamar con un request_ctx_t tomado.
+            uint32_t tokenGeneration();
+            // Copia el token actual (sin renovar) en out, terminado en '\0'. Devuelve
+            // su longitud; si es >= cap no copia nada. 'generation' puede ser nullptr.
+            size_t copyToken(char* out, size_t cap, uint32_t* generation);
+            // El server respondió 401 al token de generación 'rejected': renueva salvo
+            // que otra tarea ya lo haya hecho. Devuelve la generación a usar.
+            uint32_t onUnauthorized(uint32_t rejected);
+            // Forzar refresh inmediato (login solo si el refresh token es rechazado)
             esp_err_t forceRefreshAuth();
+            // Sesión guardada de un arranque anterior: si el ID token aún vale se usa
+            // tal cual (sin round-trips); si no, un refresh. Solo hace login si el
+            // refresh token es rechazado.
+            esp_err_t restoreSession(const char* refresh, const char* id_token, int64_t expires_at);
+            void setTokenListener(token_listener_t listener, void* user);
         };
 }
 
@@ -0,0 +1,263 @@
+#include "firebase.h"
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#define ASYNC_TAG "FirebaseAsync"
+
+// PUTs agrupados como máximo en un mismo PATCH multi-ruta
+#define ASYNC_BATCH_MAX     8
+// Resultados que se guardan para firebase_async_poll()
+#define ASYNC_RESULTS_KEEP  16
+// Mismo camino que uploader_task (handshake TLS, refresh del token, parseo):
+// el mismo stack que le da main (SENSOR_TASK_STACK)
+#define ASYNC_WORKER_STACK  10240
+#define ASYNC_WORKER_PRIO   3
+
+namespace {
+
+struct async_req_t
+{
+    firebase_async_handle_t handle;
+    firebase_op_t op;
+    firebase_prio_t prio;
+    uint32_t order;     // orden de llegada: FIFO dentro de la misma prioridad
+    std::string path;
+    std::string body;
+    firebase_done_cb_t cb;
+    void* user;
+};
+
+struct async_result_t
+{
+    firebase_async_handle_t handle;
+    int result;
+};
+
+SemaphoreHandle_t s_lock = nullptr;
+// Cuenta requests en s_queue. Se da con s_lock tomado, así nunca hay en la
+// cola un request sin contar (el worker puede sacarlo al agrupar y descontarlo)
+SemaphoreHandle_t s_items = nullptr;
+TaskHandle_t s_worker = nullptr;
+std::vector<async_req_t> s_queue;
+firebase_async_handle_t s_next_handle = 1;
+uint32_t s_next_order = 0;
+firebase_async_handle_t s_in_flight[ASYNC_BATCH_MAX];
+size_t s_in_flight_count = 0;
+async_result_t s_results[ASYNC_RESULTS_KEEP];
+size_t s_results_pos = 0;
+
+// Siguiente request a despachar (mayor prioridad; el más antiguo). Con s_lock.
+int next_index()
+{
+    int best = -1;
+    for (size_t i = 0; i < s_queue.size(); ++i) {
+        const async_req_t& r = s_queue[i];
+        if (best < 0 || r.prio > s_queue[best].prio ||
+            (r.prio == s_queue[best].prio && (int32_t)(r.order - s_queue[best].order) < 0)) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+// "/a/b/c" -> "/a/b" (la raíz queda como "/")
+std::string parent_of(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos || slash == 0) return "/";
+    return path.substr(0, slash);
+}
+
+// Ruta relativa a 'root' para el cuerpo del PATCH multi-ruta
+std::string relative_to(const std::string& root, const std::string& path)
+{
+    size_t skip = (root == "/") ? 1 : root.size() + 1;
+    return path.substr(skip);
+}
+
+// Puede ir en el mismo PATCH que 'batch': PUT, misma prioridad, mismo padre y
+// ruta no repetida (dos valores para la misma clave no tienen orden definido).
+bool can_join(const std::vector<async_req_t>& batch, const async_req_t& r)
+{
+    const async_req_t& first = batch.front();
+    if (r.op != FIREBASE_OP_PUT || r.prio != first.prio) return false;
+    if (parent_of(r.path) != parent_of(first.path)) return false;
+    for (const async_req_t& b : batch) {
+        if (b.path == r.path) return false;
+    }
+    return true;
+}
+
+int run_one(const async_req_t& r)
+{
+    const char* body = r.body.c_str();
+    switch (r.op) {
+        case FIREBASE_OP_PUT:         return firebase_putData(r.path.c_str(), body);
+        case FIREBASE_OP_POST:        return firebase_push(r.path.c_str(), body);
+        case FIREBASE_OP_PATCH:       return firebase_patch(r.path.c_str(), body);
+        case FIREBASE_OP_DELETE:      return firebase_delete(r.path.c_str());
+        case FIREBASE_OP_TRIM_OLDEST: return firebase_trim_oldest_batch(r.path.c_str(), atoi(body));
+        case FIREBASE_OP_PURGE_PAGE:  return firebase_purge_page(r.path.c_str(), body, FIREBASE_PURGE_PAGE);
+    }
+    return -1;
+}
+
+void run_batch(std::vector<async_req_t>& batch, std::vector<int>& results)
+{
+    results.assign(batch.size(), -1);
+    if (batch.size() == 1) {
+        results[0] = run_one(batch[0]);
+        return;
+    }
+
+    std::string root = parent_of(batch[0].path);
+    std::vector<std::string> rel;
+    std::vector<const char*> rel_ptrs, body_ptrs;
+    rel.reserve(batch.size());
+    for (const async_req_t& r : batch) {
+        rel.push_back(relative_to(root, r.path));
+        rel_ptrs.push_back(rel.back().c_str());
+        body_ptrs.push_back(r.body.c_str());
+    }
+    ESP_LOGD(ASYNC_TAG, "Agrupando %u PUT bajo %s", (unsigned)batch.size(), root.c_str());
+    int written = firebase_multi_update(root.c_str(), rel_ptrs.data(), body_ptrs.data(), (int)batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (written < 0) results[i] = written;
+        else results[i] = ((int)i < written) ? 0 : -1;
+    }
+}
+
+void worker_task(void*)
+{
+    std::vector<async_req_t> batch;
+    std::vector<int> results;
+    batch.reserve(ASYNC_BATCH_MAX);
+
+    while (1) {
+        xSemaphoreTake(s_items, portMAX_DELAY);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int idx = next_index();
+        if (idx < 0) {
+            // No debería pasar (ver s_items): nada que hacer
+            xSemaphoreGive(s_lock);
+            continue;
+        }
+        batch.push_back(std::move(s_queue[idx]));
+        s_queue.erase(s_queue.begin() + idx);
+        if (batch[0].op == FIREBASE_OP_PUT) {
+            while (batch.size() < ASYNC_BATCH_MAX && (idx = next_index()) >= 0 && can_join(batch, s_queue[idx])) {
+                batch.push_back(std::move(s_queue[idx]));
+                s_queue.erase(s_queue.begin() + idx);
+                xSemaphoreTake(s_items, 0); // ya contado: lo sacamos nosotros
+            }
+        }
+        s_in_flight_count = batch.size();
+        for (size_t i = 0; i < batch.size(); ++i) s_in_flight[i] = batch[i].handle;
+        xSemaphoreGive(s_lock);
+
+        run_batch(batch, results);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            s_results[s_results_pos] = {batch[i].handle, results[i]};
+            s_results_pos = (s_results_pos + 1) % ASYNC_RESULTS_KEEP;
+        }
+        s_in_flight_count = 0;
+        xSemaphoreGive(s_lock);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (results[i] < 0) {
+                ESP_LOGW(ASYNC_TAG, "Op %d en %s fallo (%d)", (int)batch[i].op, batch[i].path.c_str(), results[i]);
+            }
+            if (batch[i].cb) batch[i].cb(batch[i].handle, results[i], batch[i].user);
+        }
+        batch.clear();
+    }
+}
+
+}
+
+extern "C" {
+
+int firebase_async_start(void) {
+    if (s_worker) return 0;
+    s_lock = xSemaphoreCreateMutex();
+    s_items = xSemaphoreCreateCounting(FIREBASE_ASYNC_QUEUE_LEN, 0);
+    if (!s_lock || !s_items) return -1;
+    s_queue.reserve(FIREBASE_ASYNC_QUEUE_LEN);
+    if (xTaskCreate(worker_task, "fb_async", ASYNC_WORKER_STACK, NULL, ASYNC_WORKER_PRIO, &s_worker) != pdPASS) {
+        s_worker = nullptr;
+        return -1;
+    }
+    return 0;
+}
+
+firebase_async_handle_t firebase_submit_async(firebase_op_t op, const char* path, const char* body,
+                                              firebase_prio_t prio, firebase_done_cb_t cb, void* user) {
+    if (!s_worker) return -1;
+    if (!path) return -1;
+
+    // Un POST se encola como PUT con la clave ya fijada: reintentos y agrupado
+    // escriben siempre en el mismo hijo
+    char key[FIREBASE_KEY_LEN + 1];
+    bool has_key = op == FIREBASE_OP_POST && firebase_new_key(key, sizeof(key)) == 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_queue.size() >= FIREBASE_ASYNC_QUEUE_LEN) {
+        xSemaphoreGive(s_lock);
+        return -2;
+    }
+    async_req_t r;
+    r.handle = s_next_handle;
+    s_next_handle = (s_next_handle == INT32_MAX) ? 1 : s_next_handle + 1;
+    r.op = op;
+    r.prio = prio;
+    r.order = s_next_order++;
+    r.path = path;
+    if (has_key) {
+        r.op = FIREBASE_OP_PUT;
+        r.path += "/";
+        r.path += key;
+    }
+    r.body = body ? body : "";
+    r.cb = cb;
+    r.user = user;
+    firebase_async_handle_t handle = r.handle;
+    s_queue.push_back(std::move(r));
+    xSemaphoreGive(s_items);
+    xSemaphoreGive(s_lock);
+    return handle;
+}
+
+int firebase_async_poll(firebase_async_handle_t handle, int* result) {
+    if (!s_worker || handle <= 0) return FIREBASE_ASYNC_UNKNOWN;
+    int state = FIREBASE_ASYNC_UNKNOWN;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (const async_req_t& r : s_queue) {
+        if (r.handle == handle) state = FIREBASE_ASYNC_PENDING;
+    }
+    for (size_t i = 0; i < s_in_flight_count; ++i) {
+        if (s_in_flight[i] == handle) state = FIREBASE_ASYNC_PENDING;
+    }
+    if (state == FIREBASE_ASYNC_UNKNOWN) {
+        for (size_t i = 0; i < ASYNC_RESULTS_KEEP; ++i) {
+            if (s_results[i].handle == handle) {
+                if (result) *result = s_results[i].result;
+                state = FIREBASE_ASYNC_DONE;
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return state;
+}
+
+}
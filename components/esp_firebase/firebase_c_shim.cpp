@@ -1,5 +1,9 @@
 #include "app.h"
 #include "rtdb.h"
+#include "request_metrics.h"
+#include "esp_timer.h"
+#include <cstring>
+#include <new>
 #include <string>
 
 // Acceso a claves privadas centralizadas
@@ -12,27 +16,82 @@ static RTDB* g_rtdb = nullptr;
 
 extern "C" {
 
-int firebase_init(void) {
+static firebase_session_cb_t g_session_cb = nullptr;
+static firebase_write_mode_t g_write_mode = FIREBASE_WRITE_SILENT;
+static uint32_t g_key_node = 0;
+static uint32_t g_key_boot = 0;
+
+static void session_listener(const char* refresh, const char* id_token, int64_t expires_at, void* user) {
+	if (g_session_cb) g_session_cb(refresh, id_token, expires_at);
+}
+
+void firebase_set_session_listener(firebase_session_cb_t cb) {
+	g_session_cb = cb;
+	if (g_app) g_app->setTokenListener(cb ? session_listener : nullptr, nullptr);
+}
+
+int firebase_init_session(const char* refresh_token, const char* id_token, int64_t expires_at) {
 	if (g_app) return 0;
 	// Create Firebase app with API key
 	g_app = new FirebaseApp(API_KEY);
+	g_app->user_account = { USER_EMAIL, USER_PASSWORD };
+	if (g_session_cb) g_app->setTokenListener(session_listener, nullptr);
+
+	// Sesión guardada: sin login si el refresh token sigue valiendo
+	esp_err_t err = ESP_FAIL;
+	if (refresh_token && refresh_token[0]) {
+		err = g_app->restoreSession(refresh_token, id_token, expires_at);
+	}
 
 	// Login using email/password
-	g_app->user_account = { USER_EMAIL, USER_PASSWORD };
-	esp_err_t err = g_app->loginUserAccount(g_app->user_account);
+	if (err != ESP_OK) err = g_app->loginUserAccount(g_app->user_account);
 	if (err != ESP_OK) {
 		// Try register then login as fallback
 		if (g_app->registerUserAccount(g_app->user_account) == ESP_OK) {
 			err = g_app->loginUserAccount(g_app->user_account);
 		}
 	}
-	if (err != ESP_OK) return -2;
+	if (err != ESP_OK) {
+		delete g_app;
+		g_app = nullptr;
+		return -2;
+	}
 
 	// Create RTDB client
 	g_rtdb = new RTDB(g_app, DATABASE_URL);
+	g_rtdb->setWriteMode(g_write_mode);
+	g_rtdb->setKeySeed(g_key_node, g_key_boot);
+	return 0;
+}
+
+void firebase_set_key_seed(uint32_t device_id, uint32_t boot_count) {
+	g_key_node = device_id;
+	g_key_boot = boot_count;
+	if (g_rtdb) g_rtdb->setKeySeed(device_id, boot_count);
+}
+
+int firebase_make_key(int64_t ts_ms, uint32_t seq, char* out, size_t len) {
+	if (!out || len <= PUSH_ID_LEN) return -1;
+	pushIdMake(ts_ms, g_key_node, seq, out);
+	return 0;
+}
+
+int firebase_key_bound(int64_t ts_ms, char* out, size_t len) {
+	if (!out || len <= PUSH_ID_LEN) return -1;
+	pushIdBound(ts_ms, out);
 	return 0;
 }
 
+int firebase_new_key(char* out, size_t len) {
+	if (!g_rtdb || !out || len <= PUSH_ID_LEN) return -1;
+	g_rtdb->newKey(out);
+	return 0;
+}
+
+int firebase_init(void) {
+	return firebase_init_session(NULL, NULL, 0);
+}
+
 int firebase_refresh_token(void) {
 	if (!g_app) return -1;
 	// Forzamos refresh usando el refresh_token almacenado;
@@ -41,9 +100,107 @@ int firebase_refresh_token(void) {
 	return -2;
 }
 
+struct listen_adapter_t {
+	firebase_listen_cb_t cb;
+	void* user;
+};
+
+// firebase_json_t es un Json::Value visto desde C
+static const Json::Value& json_of(const firebase_json_t* value) {
+	static const Json::Value null_value;
+	return value ? *reinterpret_cast<const Json::Value*>(value) : null_value;
+}
+
+static const firebase_json_t* to_c(const Json::Value* value) {
+	return reinterpret_cast<const firebase_json_t*>(value);
+}
+
+firebase_json_type_t firebase_json_type(const firebase_json_t* value) {
+	switch (json_of(value).type()) {
+		case Json::booleanValue: return FIREBASE_JSON_BOOL;
+		case Json::intValue:
+		case Json::uintValue:
+		case Json::realValue:    return FIREBASE_JSON_NUMBER;
+		case Json::stringValue:  return FIREBASE_JSON_STRING;
+		case Json::arrayValue:   return FIREBASE_JSON_ARRAY;
+		case Json::objectValue:  return FIREBASE_JSON_OBJECT;
+		default:                 return FIREBASE_JSON_NULL;
+	}
+}
+
+const firebase_json_t* firebase_json_get(const firebase_json_t* value, const char* key) {
+	const Json::Value& v = json_of(value);
+	if (!key || !v.isObject()) return nullptr;
+	return to_c(v.find(key, key + strlen(key)));
+}
+
+size_t firebase_json_size(const firebase_json_t* value) {
+	const Json::Value& v = json_of(value);
+	return (v.isObject() || v.isArray()) ? v.size() : 0;
+}
+
+int firebase_json_number(const firebase_json_t* value, double* out) {
+	const Json::Value& v = json_of(value);
+	if (!v.isNumeric()) return -1;
+	if (out) *out = v.asDouble();
+	return 0;
+}
+
+int firebase_json_bool(const firebase_json_t* value, bool* out) {
+	const Json::Value& v = json_of(value);
+	if (!v.isBool()) return -1;
+	if (out) *out = v.asBool();
+	return 0;
+}
+
+const char* firebase_json_string(const firebase_json_t* value) {
+	const Json::Value& v = json_of(value);
+	return v.isString() ? v.asCString() : nullptr;
+}
+
+firebase_json_t* firebase_json_copy(const firebase_json_t* value) {
+	// deepCopy: los strings del evento apuntan a su texto (parse in situ)
+	Json::Value* copy = new (std::nothrow) Json::Value(json_of(value).deepCopy());
+	return reinterpret_cast<firebase_json_t*>(copy);
+}
+
+void firebase_json_free(firebase_json_t* value) {
+	delete reinterpret_cast<Json::Value*>(value);
+}
+
+// El árbol del evento pasa tal cual: ni se serializa ni el callback lo parsea
+static void listen_adapter(const char* event, const char* path, const Json::Value& data, void* user) {
+	listen_adapter_t* adapter = static_cast<listen_adapter_t*>(user);
+	adapter->cb(event, path, to_c(&data), adapter->user);
+}
+
+int firebase_listen(const char* path, firebase_listen_cb_t cb, void* user) {
+	if (!g_rtdb) return -1;
+	if (!path || !cb) return -1;
+	// Vive lo mismo que la escucha (toda la ejecución)
+	listen_adapter_t* adapter = new listen_adapter_t{cb, user};
+	if (!g_rtdb->listen(path, listen_adapter, adapter)) {
+		delete adapter;
+		return -2;
+	}
+	return 0;
+}
+
+int firebase_circuit_open(void) {
+	if (!g_app) return 0;
+	return g_app->circuitOpen(DATABASE_URL) ? 1 : 0;
+}
+
+int firebase_set_write_mode(firebase_write_mode_t mode) {
+	if (mode == FIREBASE_WRITE_DEFAULT) return -1;
+	g_write_mode = mode;
+	if (g_rtdb) g_rtdb->setWriteMode(mode);
+	return 0;
+}
+
 int firebase_push(const char* path, const char* json) {
 	if (!g_rtdb) return -1;
-	// RTDB::postData corresponds to push semantics
+	// RTDB::postData: PUT bajo una clave generada aquí (idempotente)
 	esp_err_t err = g_rtdb->postData(path, json);
 	return err == ESP_OK ? 0 : (int)err;
 }
@@ -54,6 +211,18 @@ int firebase_putData(const char* path, const char* json) {
 	return err == ESP_OK ? 0 : (int)err;
 }
 
+int firebase_patch(const char* path, const char* json) {
+	if (!g_rtdb) return -1;
+	esp_err_t err = g_rtdb->patchData(path, json);
+	return err == ESP_OK ? 0 : (int)err;
+}
+
+int firebase_multi_update(const char* root_path, const char* const* rel_paths, const char* const* jsons, int count) {
+	if (!g_rtdb) return -1;
+	if (count <= 0) return 0;
+	return g_rtdb->multiUpdate(root_path, rel_paths, jsons, (size_t)count);
+}
+
 int firebase_delete(const char* path) {
 	if (!g_rtdb) return -1;
 	esp_err_t err = g_rtdb->deleteData(path);
@@ -71,5 +240,38 @@ int firebase_trim_oldest_batch(const char* root_path, int batch_size) {
     return g_rtdb->trimOldestBatch(root_path, batch_size);
 }
 
+int firebase_purge_page(const char* root_path, const char* end_key, int page_size) {
+    if (!g_rtdb) return -1;
+    return g_rtdb->trimRange(root_path, end_key, page_size);
+}
+
+int firebase_get_stats(firebase_stats_t* out) {
+    if (!g_app || !out) return -1;
+    *out = g_app->getStats();
+    if (g_rtdb) g_rtdb->readCacheStats(out->read_cache_hits, out->read_cache_misses);
+    return 0;
+}
+
+int firebase_get_metrics(firebase_metrics_t* out) {
+    if (!g_app || !out) return -1;
+    g_app->getMetrics(*out);
+    return 0;
+}
+
+int firebase_metrics_json(char* out, size_t len) {
+    if (!g_app || !out || len == 0) return -1;
+    // Copia en el heap: la estructura no es chica para la pila de quien llama
+    firebase_metrics_t* metrics = new firebase_metrics_t;
+    g_app->getMetrics(*metrics);
+    size_t n = metricsToJson(*metrics, esp_timer_get_time(), out, len);
+    delete metrics;
+    return n < len ? (int)n : -1;
+}
+
+int firebase_get_host_rtt(firebase_host_rtt_t* out, int max) {
+    if (!g_app || !out) return -1;
+    return g_app->hostRtt(out, max);
+}
+
 }
 
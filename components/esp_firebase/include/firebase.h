@@ -1,17 +1,216 @@
 #pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Contadores del cliente HTTP(S) de Firebase
+typedef struct {
+    uint32_t requests;          // llamadas a performRequest
+    uint32_t handshakes;        // conexiones nuevas (TCP + TLS)
+    uint32_t reused;            // requests OK sobre una conexión ya abierta
+    uint32_t idle_reconnects;   // cierres proactivos por inactividad
+    uint32_t stale_retries;     // conexiones reusadas que el server ya había cerrado
+    uint64_t handshake_time_us; // tiempo total hasta HTTP_EVENT_ON_CONNECTED
+    uint32_t ticket_offers;     // de ellos, ofreciendo una sesión TLS guardada (ticket)
+    uint32_t ticket_handshakes; // de ellos, reanudados: el server aceptó el ticket (abreviados)
+    uint64_t ticket_handshake_time_us;
+    uint64_t request_time_us;   // tiempo total de performRequest (incluye reintentos)
+    uint32_t auth_logins;       // logins email/password (identitytoolkit)
+    uint32_t auth_refreshes;    // refresh con refresh token (securetoken)
+    uint32_t auth_refresh_failures; // refresh fallidos por red/5xx
+    uint32_t auth_waits;        // requests que esperaron un refresh ya en vuelo
+    uint64_t tx_body_bytes;     // bodies enviados (incluye reintentos)
+    uint64_t rx_body_bytes;     // bodies recibidos (sin headers)
+    uint32_t retries;           // intentos extra por fallos transitorios
+    uint32_t breaker_opens;     // veces que se abrió el circuito de un host
+    uint32_t breaker_rejects;   // requests no intentados por circuito abierto
+    uint32_t read_cache_hits;   // lecturas resueltas con la caché (304 / mismo ETag)
+    uint32_t read_cache_misses; // lecturas con body nuevo
+} firebase_stats_t;
+
+// Métricas por request, agregadas por método HTTP desde el arranque
+#define FIREBASE_METRICS_BUCKETS 12  // latencia: < 25 ms * 2^i; el último sin techo
+typedef enum {
+    FIREBASE_METHOD_GET = 0,
+    FIREBASE_METHOD_PUT,
+    FIREBASE_METHOD_POST,
+    FIREBASE_METHOD_PATCH,
+    FIREBASE_METHOD_DELETE,
+    FIREBASE_METHOD_OTHER,
+    FIREBASE_METHOD_COUNT,
+} firebase_method_t;
+
+typedef struct {
+    uint32_t requests;          // llamadas a performRequest
+    uint32_t errors;            // sin 2xx/304 tras los reintentos
+    uint32_t attempts;          // intentos, incluidos reintentos
+    uint32_t connects;          // intentos que abrieron conexión
+    uint32_t responses;         // intentos con respuesta (tienen los tres tramos)
+    uint64_t connect_us;        // DNS + TCP + TLS
+    uint64_t send_us;           // conexión lista -> headers enviados
+    uint64_t wait_us;           // headers enviados -> primer header de la respuesta
+    uint64_t receive_us;        // primer header -> fin del body
+    uint64_t total_us;          // request completo, con reintentos y esperas
+    uint32_t max_ms;
+    uint64_t tx_bytes;          // bodies, con reintentos
+    uint64_t rx_bytes;
+    uint32_t latency_hist[FIREBASE_METRICS_BUCKETS];
+} firebase_method_metrics_t;
+
+typedef struct {
+    firebase_method_metrics_t method[FIREBASE_METHOD_COUNT];
+    uint32_t heap_min_free;       // mínimo de heap libre desde el arranque
+    uint32_t heap_min_at_request; // menor heap libre visto al terminar un request
+} firebase_metrics_t;
+
+// Estimador de RTT de un host (timeouts adaptativos)
+typedef struct {
+    char host[64];
+    uint32_t srtt_ms;           // RTT suavizado: envío del request -> primer byte
+    uint32_t rttvar_ms;         // su desvío
+    uint32_t rto_ms;            // srtt + 4 * rttvar (0: sin muestras)
+    uint32_t timeout_ms;        // el que usaría ahora un request normal
+    uint32_t samples;
+    uint32_t timeouts;          // intentos sin respuesta
+    uint32_t connect_srtt_ms;   // conexión nueva (TCP + TLS)
+    uint32_t connect_timeouts;
+} firebase_host_rtt_t;
+
+// Qué devuelve la RTDB tras una escritura (PUT/POST/PATCH/DELETE):
+// SILENT: nada (204, print=silent); ECHO: el dato escrito; PRETTY: ídem, indentado
+typedef enum {
+    FIREBASE_WRITE_DEFAULT = -1, // el modo global (firebase_set_write_mode)
+    FIREBASE_WRITE_SILENT = 0,
+    FIREBASE_WRITE_ECHO,
+    FIREBASE_WRITE_PRETTY,
+} firebase_write_mode_t;
+
+// Claves estilo push ID de Firebase: FIREBASE_KEY_LEN caracteres, orden por
+// clave = orden cronológico, sin colisiones entre equipos ni arranques.
+#define FIREBASE_KEY_LEN 20
+// Identificador del equipo (p. ej. de la MAC) y contador de arranques. Llamar
+// antes de generar claves (y del init).
+void firebase_set_key_seed(uint32_t device_id, uint32_t boot_count);
+// Clave determinista para un dato con número de secuencia propio y persistente
+// (mismo ts_ms y seq: misma clave, así reenviarlo es idempotente). len > FIREBASE_KEY_LEN
+int firebase_make_key(int64_t ts_ms, uint32_t seq, char* out, size_t len);
+// Clave mayor o igual que toda clave con tiempo <= ts_ms (límite de purgas)
+int firebase_key_bound(int64_t ts_ms, char* out, size_t len);
+// Clave nueva (la de firebase_push). -1 si Firebase no está inicializado
+int firebase_new_key(char* out, size_t len);
+
 int firebase_init(void);
+// Arranque con la sesión guardada de un arranque anterior (refresh token y, si
+// aún vale, el ID token con su expiración en epoch). Solo hace login con
+// email/password si no hay sesión o el refresh token es rechazado.
+int firebase_init_session(const char* refresh_token, const char* id_token, int64_t expires_at);
+// Llamado cada vez que cambian los tokens, para persistirlos. Registrar antes del init.
+typedef void (*firebase_session_cb_t)(const char* refresh_token, const char* id_token, int64_t expires_at);
+void firebase_set_session_listener(firebase_session_cb_t cb);
 int firebase_auth(void);
 int firebase_refresh_token(void);
+// 1 si el circuito de la RTDB está abierto (caída del server o de la red): no
+// tiene sentido intentar subir nada hasta que se cierre
+int firebase_circuit_open(void);
+// Valor JSON ya parseado (solo lectura), sin serializarlo ni volver a
+// parsearlo. Un puntero NULL se lee como null.
+typedef struct firebase_json firebase_json_t;
+typedef enum {
+    FIREBASE_JSON_NULL = 0,
+    FIREBASE_JSON_BOOL,
+    FIREBASE_JSON_NUMBER,
+    FIREBASE_JSON_STRING,
+    FIREBASE_JSON_ARRAY,
+    FIREBASE_JSON_OBJECT,
+} firebase_json_type_t;
+firebase_json_type_t firebase_json_type(const firebase_json_t* value);
+// Miembro 'key' de un objeto; NULL si falta o 'value' no es un objeto
+const firebase_json_t* firebase_json_get(const firebase_json_t* value, const char* key);
+// Elementos de un array o miembros de un objeto (0 para el resto)
+size_t firebase_json_size(const firebase_json_t* value);
+// 0 y el valor en 'out' si es del tipo pedido; -1 si no
+int firebase_json_number(const firebase_json_t* value, double* out);
+int firebase_json_bool(const firebase_json_t* value, bool* out);
+// NULL si no es un string
+const char* firebase_json_string(const firebase_json_t* value);
+// Copia en el heap que sigue valiendo después del callback (el original no).
+// Se libera con firebase_json_free. NULL si no hay memoria.
+firebase_json_t* firebase_json_copy(const firebase_json_t* value);
+void firebase_json_free(firebase_json_t* value);
+
+// Escucha en vivo de una ruta (streaming de la RTDB, en su propia tarea).
+// event: "put" (reemplaza el valor en 'path' por 'data') o "patch" (actualiza
+// los hijos presentes en 'data'); path es relativo a la ruta escuchada ("/" =
+// ella misma). Al conectar (y al reconectar) llega un "put" en "/" con el
+// valor completo. 'data' solo vale durante el callback (firebase_json_copy).
+typedef void (*firebase_listen_cb_t)(const char* event, const char* path, const firebase_json_t* data, void* user);
+int firebase_listen(const char* path, firebase_listen_cb_t cb, void* user);
+// Modo global de escritura (por defecto SILENT)
+int firebase_set_write_mode(firebase_write_mode_t mode);
+// Agrega 'json' bajo path con una clave nueva generada en el equipo (PUT en
+// path/<clave>): los reintentos sobrescriben en vez de duplicar
 int firebase_push(const char* path, const char* json);
 int firebase_putData(const char* path, const char* json);
+int firebase_patch(const char* path, const char* json);
+// PATCH multi-ruta bajo root_path. Devuelve cuántos items (en orden) se escribieron.
+int firebase_multi_update(const char* root_path, const char* const* rel_paths, const char* const* jsons, int count);
 int firebase_delete(const char* path);
 int firebase_trim_days(const char* root_path, int max_days);
 int firebase_trim_oldest_batch(const char* root_path, int batch_size);
+// Borra una página de hasta page_size hijos de root_path con clave <= end_key.
+// Devuelve cuántos borró (0: ya no queda ninguno en el rango) o <0 si falló.
+int firebase_purge_page(const char* root_path, const char* end_key, int page_size);
+int firebase_get_stats(firebase_stats_t* out);
+int firebase_get_metrics(firebase_metrics_t* out);
+// Las métricas como un nodo JSON compacto, para subirlo a la RTDB. Devuelve la
+// longitud, o -1 si no hay init o no cabe en len
+int firebase_metrics_json(char* out, size_t len);
+// Un elemento por host con conexión; devuelve cuántos llenó (-1 sin init)
+int firebase_get_host_rtt(firebase_host_rtt_t* out, int max);
+
+// ---- Cola asíncrona ----
+// Una única tarea worker ejecuta las operaciones en orden de prioridad (FIFO
+// dentro de cada una). Los PUT consecutivos bajo un mismo padre se agrupan en
+// un PATCH multi-ruta. El resultado es el mismo que devolvería la función
+// síncrona equivalente (0 OK; para TRIM_OLDEST y PURGE_PAGE, los borrados o <0).
+typedef enum {
+    FIREBASE_OP_PUT,
+    FIREBASE_OP_POST,
+    FIREBASE_OP_PATCH,
+    FIREBASE_OP_DELETE,
+    FIREBASE_OP_TRIM_OLDEST,    // body: tamaño del lote en decimal ("50")
+    FIREBASE_OP_PURGE_PAGE,     // body: clave final (inclusive); FIREBASE_PURGE_PAGE hijos
+} firebase_op_t;
+
+typedef enum {
+    FIREBASE_PRIO_LOW,
+    FIREBASE_PRIO_NORMAL,
+    FIREBASE_PRIO_HIGH,
+} firebase_prio_t;
+
+typedef int32_t firebase_async_handle_t;
+// Se llama desde la tarea worker: no bloquear
+typedef void (*firebase_done_cb_t)(firebase_async_handle_t handle, int result, void* user);
+
+#define FIREBASE_ASYNC_QUEUE_LEN 16
+#define FIREBASE_PURGE_PAGE      50
+
+#define FIREBASE_ASYNC_DONE      0
+#define FIREBASE_ASYNC_PENDING   1
+#define FIREBASE_ASYNC_UNKNOWN  -1  // handle inválido o resultado ya descartado
+
+// Crea la tarea worker (idempotente)
+int firebase_async_start(void);
+// Encola sin bloquear. Devuelve un handle > 0, -1 si el worker no está
+// arrancado o -2 si la cola está llena. path y body se copian.
+firebase_async_handle_t firebase_submit_async(firebase_op_t op, const char* path, const char* body,
+                                              firebase_prio_t prio, firebase_done_cb_t cb, void* user);
+// Estado de un handle; con DONE deja el resultado en *result (si no es NULL)
+int firebase_async_poll(firebase_async_handle_t handle, int* result);
 
 #ifdef __cplusplus
 }
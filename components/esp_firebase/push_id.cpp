@@ -0,0 +1,65 @@
+#include "push_id.h"
+
+namespace ESPFirebase {
+
+namespace {
+
+const char PUSH_CHARS[] = "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+
+constexpr int TIME_CHARS = 8;
+constexpr int NODE_CHARS = 4;
+constexpr int SEQ_CHARS = 8;
+constexpr uint64_t TIME_FLAG = 1ULL << 47;       // ver push_id.h
+constexpr uint64_t GEN_FLAG = 1ULL << 47;        // secuencias de pushIdNext: nunca chocan con las de pushIdMake
+constexpr uint32_t GEN_COUNTER_BITS = 24;
+
+// 'chars' dígitos base 64 de 'value', el más significativo primero
+char* encode(uint64_t value, int chars, char* out)
+{
+    for (int i = chars - 1; i >= 0; --i) {
+        out[i] = PUSH_CHARS[value & 0x3F];
+        value >>= 6;
+    }
+    return out + chars;
+}
+
+void compose(int64_t ts_ms, uint32_t node, uint64_t seq, char* out)
+{
+    uint64_t time = ((uint64_t)(ts_ms > 0 ? ts_ms : 0) & (TIME_FLAG - 1)) | TIME_FLAG;
+    out = encode(time, TIME_CHARS, out);
+    out = encode(node & 0xFFFFFF, NODE_CHARS, out);
+    out = encode(seq, SEQ_CHARS, out);
+    *out = '\0';
+}
+
+}
+
+void pushIdMake(int64_t ts_ms, uint32_t node, uint32_t seq, char out[PUSH_ID_LEN + 1])
+{
+    compose(ts_ms, node, seq, out);
+}
+
+void pushIdBound(int64_t ts_ms, char out[PUSH_ID_LEN + 1])
+{
+    compose(ts_ms, 0, 0, out);
+    for (size_t i = TIME_CHARS; i < PUSH_ID_LEN; ++i) out[i] = PUSH_CHARS[63];
+}
+
+void pushIdNext(push_id_gen_t& gen, int64_t now_ms, char out[PUSH_ID_LEN + 1])
+{
+    if (now_ms > gen.last_ms) {
+        gen.last_ms = now_ms;
+        gen.counter = 0;
+    } else {
+        // Mismo ms (o reloj hacia atrás): el contador desempata
+        ++gen.counter;
+        if (gen.counter >= (1u << GEN_COUNTER_BITS)) {
+            ++gen.last_ms;
+            gen.counter = 0;
+        }
+    }
+    uint64_t seq = GEN_FLAG | ((uint64_t)(gen.boot & 0x7FFFFF) << GEN_COUNTER_BITS) | gen.counter;
+    compose(gen.last_ms, gen.node, seq, out);
+}
+
+}
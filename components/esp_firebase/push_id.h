@@ -0,0 +1,44 @@
+#ifndef _ESP_FIREBASE_PUSH_ID_H_
+#define  _ESP_FIREBASE_PUSH_ID_H_
+#include <cstddef>
+#include <cstdint>
+
+namespace ESPFirebase 
+{
+
+    /**
+     * @brief Claves al estilo de los push IDs de Firebase: 20 caracteres de un
+     * alfabeto ordenado ("-0-9A-Z_a-z"), así el orden por clave es cronológico.
+     *
+     *   [8: ms desde epoch][4: equipo][8: secuencia]
+     *
+     * El tiempo lleva el bit 47 fijo: las claves empiezan por 'V' o mayor y
+     * ordenan después de las del formato anterior ("yy-mm-dd_HH-MM-SS").
+     * Con la misma clave un reintento sobrescribe en vez de duplicar.
+     */
+    static constexpr size_t PUSH_ID_LEN = 20;   // sin '\0'
+
+    // Clave determinista: mismo (ts_ms, node, seq) da la misma clave. 'seq'
+    // debe ser único por equipo (p. ej. el número de secuencia de un log en flash).
+    void pushIdMake(int64_t ts_ms, uint32_t node, uint32_t seq, char out[PUSH_ID_LEN + 1]);
+
+    // Mayor o igual que cualquier clave con tiempo <= ts_ms (para "endAt")
+    void pushIdBound(int64_t ts_ms, char out[PUSH_ID_LEN + 1]);
+
+    // Generador para claves sin secuencia persistente. La secuencia lleva el
+    // contador de arranques: no se repite entre reinicios aunque el reloj vuelva atrás.
+    struct push_id_gen_t
+    {
+        uint32_t node;
+        uint32_t boot;
+        int64_t last_ms;
+        uint32_t counter;
+    };
+
+    // Siempre creciente aunque el reloj retroceda (se queda en el último ms usado)
+    void pushIdNext(push_id_gen_t& gen, int64_t now_ms, char out[PUSH_ID_LEN + 1]);
+
+}
+
+
+#endif
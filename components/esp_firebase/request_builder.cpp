@@ -0,0 +1,230 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "request_builder.h"
+
+#include "value.h"
+#include "writer.h"
+
+namespace ESPFirebase {
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+bool isUnreserved(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+}
+
+RequestBuilder::RequestBuilder(char* buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), len(0), has_query(false)
+{
+    if (capacity) buffer[0] = '\0';
+}
+
+void RequestBuilder::clear()
+{
+    len = 0;
+    has_query = false;
+    if (capacity) buffer[0] = '\0';
+}
+
+void RequestBuilder::put(char c)
+{
+    // Siempre queda sitio para el '\0'; lo que no cabe solo se cuenta
+    if (len + 1 < capacity) {
+        buffer[len] = c;
+        buffer[len + 1] = '\0';
+    }
+    ++len;
+}
+
+RequestBuilder& RequestBuilder::append(const char* str)
+{
+    return append(str, strlen(str));
+}
+
+RequestBuilder& RequestBuilder::append(const char* str, size_t n)
+{
+    if (len + n < capacity) {
+        memcpy(buffer + len, str, n);
+        buffer[len + n] = '\0';
+        len += n;
+    } else {
+        for (size_t i = 0; i < n; ++i) put(str[i]);
+    }
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::append(char c)
+{
+    put(c);
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::appendInt(long long value)
+{
+    char tmp[24];
+    int n = snprintf(tmp, sizeof(tmp), "%lld", value);
+    return append(tmp, (size_t)n);
+}
+
+RequestBuilder& RequestBuilder::appendEncoded(const char* str, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)str[i];
+        if (isUnreserved(c)) {
+            put((char)c);
+        } else {
+            put('%');
+            put(HEX_DIGITS[c >> 4]);
+            put(HEX_DIGITS[c & 0x0F]);
+        }
+    }
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::param(const char* name, const char* value)
+{
+    put(has_query ? '&' : '?');
+    has_query = true;
+    append(name);
+    put('=');
+    return appendEncoded(value, strlen(value));
+}
+
+RequestBuilder& RequestBuilder::param(const char* name, long long value)
+{
+    put(has_query ? '&' : '?');
+    has_query = true;
+    append(name);
+    put('=');
+    return appendInt(value);
+}
+
+RequestBuilder& RequestBuilder::paramQuoted(const char* name, const char* value)
+{
+    put(has_query ? '&' : '?');
+    has_query = true;
+    append(name);
+    append("=%22", 4);
+    appendEncoded(value, strlen(value));
+    return append("%22", 3);
+}
+
+RequestBuilder& RequestBuilder::paramRaw(const char* encoded, size_t n)
+{
+    put(has_query ? '&' : '?');
+    has_query = true;
+    return append(encoded, n);
+}
+
+RequestBuilder& RequestBuilder::appendQuery(const char* query)
+{
+    if (!query || !query[0]) return *this;
+    has_query = true;
+    return append(query);
+}
+
+void RequestBuilder::appendDouble(double value)
+{
+    // Representación más corta que se lee de vuelta al mismo double ("21.5" y
+    // no "21.499999999999999"), con ".0" en los enteros para que sigan siendo reales
+    if (!std::isfinite(value)) {
+        append(std::isnan(value) ? "null" : (value < 0 ? "-1e+9999" : "1e+9999"));
+        return;
+    }
+    char tmp[32];
+    append(tmp, Json::writeShortestDouble(value, tmp));
+}
+
+RequestBuilder& RequestBuilder::appendJsonString(const char* str, size_t n)
+{
+    put('"');
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)str[i];
+        switch (c) {
+            case '"':  append("\\\"", 2); break;
+            case '\\': append("\\\\", 2); break;
+            case '\b': append("\\b", 2); break;
+            case '\f': append("\\f", 2); break;
+            case '\n': append("\\n", 2); break;
+            case '\r': append("\\r", 2); break;
+            case '\t': append("\\t", 2); break;
+            default:
+                if (c < 0x20) {
+                    append("\\u00", 4);
+                    put(HEX_DIGITS[c >> 4]);
+                    put(HEX_DIGITS[c & 0x0F]);
+                } else {
+                    put((char)c); // UTF-8 tal cual: JSON válido
+                }
+        }
+    }
+    put('"');
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::appendJson(const Json::Value& value)
+{
+    switch (value.type()) {
+        case Json::nullValue:
+            append("null", 4);
+            break;
+        case Json::intValue:
+            appendInt((long long)value.asLargestInt());
+            break;
+        case Json::uintValue: {
+            char tmp[24];
+            int n = snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)value.asLargestUInt());
+            append(tmp, (size_t)n);
+            break;
+        }
+        case Json::realValue:
+            appendDouble(value.asDouble());
+            break;
+        case Json::stringValue: {
+            const char* begin = nullptr;
+            const char* end = nullptr;
+            if (value.getString(&begin, &end)) appendJsonString(begin, (size_t)(end - begin));
+            else append("\"\"", 2);
+            break;
+        }
+        case Json::booleanValue:
+            value.asBool() ? append("true", 4) : append("false", 5);
+            break;
+        case Json::arrayValue: {
+            put('[');
+            Json::ArrayIndex size = value.size();
+            for (Json::ArrayIndex i = 0; i < size; ++i) {
+                if (i) put(',');
+                appendJson(value[i]);
+            }
+            put(']');
+            break;
+        }
+        case Json::objectValue: {
+            put('{');
+            bool first = true;
+            for (Json::Value::const_iterator it = value.begin(); it != value.end(); ++it) {
+                if (!first) put(',');
+                first = false;
+                const char* name_end = nullptr;
+                const char* name = it.memberName(&name_end);
+                appendJsonString(name, (size_t)(name_end - name));
+                put(':');
+                appendJson(*it);
+            }
+            put('}');
+            break;
+        }
+    }
+    return *this;
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef _ESP_FIREBASE_REQUEST_BUILDER_H_
+#define  _ESP_FIREBASE_REQUEST_BUILDER_H_
+#include <cstddef>
+#include <cstdint>
+
+namespace Json { class Value; }
+
+namespace ESPFirebase 
+{
+
+    /**
+     * @brief Arma URLs (ruta, query) y bodies JSON sobre un buffer fijo del
+     * llamador, sin memoria dinámica. Si algo no cabe deja de escribir pero
+     * sigue contando: needed() dice cuántos bytes (con el '\0') habrían hecho falta.
+     */
+    class RequestBuilder
+    {
+    public:
+        RequestBuilder(char* buffer, size_t capacity);
+
+        void clear();
+
+        RequestBuilder& append(const char* str);
+        RequestBuilder& append(const char* str, size_t len);
+        RequestBuilder& append(char c);
+        RequestBuilder& appendInt(long long value);
+        // Percent-encoding (RFC 3986): todo salvo los caracteres no reservados
+        RequestBuilder& appendEncoded(const char* str, size_t len);
+
+        // "?name=value" la primera vez, "&name=value" después. El value se codifica.
+        RequestBuilder& param(const char* name, const char* value);
+        RequestBuilder& param(const char* name, long long value);
+        // Igual, con el value entre comillas JSON (orderBy, startAt, endAt...)
+        RequestBuilder& paramQuoted(const char* name, const char* value);
+        // Parámetro ya codificado ("name=value", p. ej. un auth cacheado)
+        RequestBuilder& paramRaw(const char* encoded, size_t len);
+        // Query completa ("?a=b&c=d") armada con otro RequestBuilder
+        RequestBuilder& appendQuery(const char* query);
+
+        // JSON compacto como Json::FastWriter (sin el \n final; UTF-8 va sin escapar)
+        RequestBuilder& appendJson(const Json::Value& value);
+        RequestBuilder& appendJsonString(const char* str, size_t len);
+
+        const char* c_str() const { return buffer; }
+        size_t size() const { return ok() ? len : 0; }
+        size_t needed() const { return len + 1; }
+        bool ok() const { return len < capacity; }
+
+    private:
+        char* buffer;
+        size_t capacity;
+        size_t len;        // longitud lógica: puede pasar de capacity
+        bool has_query;
+
+        void put(char c);
+        void appendDouble(double value);
+    };
+
+}
+
+
+#endif
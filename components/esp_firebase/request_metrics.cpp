@@ -0,0 +1,116 @@
+#include <cstdio>
+#include "request_metrics.h"
+
+namespace ESPFirebase {
+
+namespace {
+
+constexpr int64_t FIRST_BUCKET_US = 25000;
+
+const char* const METHOD_NAMES[FIREBASE_METHOD_COUNT] = {"GET", "PUT", "POST", "PATCH", "DELETE", "OTHER"};
+
+uint32_t avgMs(uint64_t total_us, uint32_t n)
+{
+    return n ? (uint32_t)(total_us / n / 1000) : 0;
+}
+
+// snprintf acumulado: sigue contando aunque ya no quepa
+struct JsonOut
+{
+    char* out;
+    size_t cap;
+    size_t len = 0;
+
+    JsonOut(char* out, size_t cap) : out(out), cap(cap) {}
+
+    template <typename... Args>
+    void put(const char* fmt, Args... args)
+    {
+        char* dst = len < cap ? out + len : nullptr;
+        size_t space = len < cap ? cap - len : 0;
+        int n = snprintf(dst, space, fmt, args...);
+        if (n > 0) len += (size_t)n;
+    }
+};
+
+}
+
+firebase_method_t metricsMethod(esp_http_client_method_t method)
+{
+    switch (method) {
+        case HTTP_METHOD_GET:    return FIREBASE_METHOD_GET;
+        case HTTP_METHOD_PUT:    return FIREBASE_METHOD_PUT;
+        case HTTP_METHOD_POST:   return FIREBASE_METHOD_POST;
+        case HTTP_METHOD_PATCH:  return FIREBASE_METHOD_PATCH;
+        case HTTP_METHOD_DELETE: return FIREBASE_METHOD_DELETE;
+        default:                 return FIREBASE_METHOD_OTHER;
+    }
+}
+
+int metricsBucket(int64_t latency_us)
+{
+    int bucket = 0;
+    int64_t limit = FIRST_BUCKET_US;
+    while (bucket < FIREBASE_METRICS_BUCKETS - 1 && latency_us >= limit) {
+        ++bucket;
+        limit *= 2;
+    }
+    return bucket;
+}
+
+void metricsRecordAttempt(firebase_method_metrics_t& m, const request_spans_t& spans)
+{
+    m.attempts++;
+    int64_t send_from = spans.start_us;
+    if (spans.connected_us > 0) {
+        m.connects++;
+        m.connect_us += (uint64_t)(spans.connected_us - spans.start_us);
+        send_from = spans.connected_us;
+    }
+    // Solo intentos con respuesta: si no, los tramos no están completos
+    if (spans.sent_us > 0 && spans.first_byte_us >= spans.sent_us) {
+        m.responses++;
+        m.send_us += (uint64_t)(spans.sent_us - send_from);
+        m.wait_us += (uint64_t)(spans.first_byte_us - spans.sent_us);
+        m.receive_us += (uint64_t)(spans.end_us - spans.first_byte_us);
+    }
+}
+
+void metricsRecordRequest(firebase_method_metrics_t& m, bool ok, int64_t total_us,
+                          uint64_t tx_bytes, uint64_t rx_bytes)
+{
+    m.requests++;
+    if (!ok) m.errors++;
+    m.total_us += (uint64_t)total_us;
+    if ((uint32_t)(total_us / 1000) > m.max_ms) m.max_ms = (uint32_t)(total_us / 1000);
+    m.tx_bytes += tx_bytes;
+    m.rx_bytes += rx_bytes;
+    m.latency_hist[metricsBucket(total_us)]++;
+}
+
+size_t metricsToJson(const firebase_metrics_t& metrics, int64_t now_us, char* out, size_t cap)
+{
+    JsonOut json(out, cap);
+    json.put("{\"uptime_s\":%lld,\"heap_min\":%u,\"heap_min_req\":%u",
+             (long long)(now_us / 1000000), (unsigned)metrics.heap_min_free, (unsigned)metrics.heap_min_at_request);
+    for (int i = 0; i < FIREBASE_METHOD_COUNT; ++i) {
+        const firebase_method_metrics_t& m = metrics.method[i];
+        if (m.requests == 0) continue;
+        // ms: [conexión, envío, espera, recepción] medios por intento; h: histograma
+        json.put(",\"%s\":{\"n\":%u,\"err\":%u,\"try\":%u,\"conn\":%u,\"ms\":[%u,%u,%u,%u],"
+                 "\"avg\":%u,\"max\":%u,\"tx\":%llu,\"rx\":%llu,\"h\":[",
+                 METHOD_NAMES[i], (unsigned)m.requests, (unsigned)m.errors, (unsigned)m.attempts,
+                 (unsigned)m.connects, (unsigned)avgMs(m.connect_us, m.connects),
+                 (unsigned)avgMs(m.send_us, m.responses), (unsigned)avgMs(m.wait_us, m.responses),
+                 (unsigned)avgMs(m.receive_us, m.responses), (unsigned)avgMs(m.total_us, m.requests),
+                 (unsigned)m.max_ms, (unsigned long long)m.tx_bytes, (unsigned long long)m.rx_bytes);
+        for (int b = 0; b < FIREBASE_METRICS_BUCKETS; ++b) {
+            json.put(b ? ",%u" : "%u", (unsigned)m.latency_hist[b]);
+        }
+        json.put("]}");
+    }
+    json.put("}");
+    return json.len;
+}
+
+}
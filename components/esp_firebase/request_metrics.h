@@ -0,0 +1,36 @@
+#ifndef _ESP_FIREBASE_REQUEST_METRICS_H_
+#define  _ESP_FIREBASE_REQUEST_METRICS_H_
+#include <cstddef>
+#include <cstdint>
+#include "esp_http_client.h"
+#include "firebase.h"
+
+namespace ESPFirebase 
+{
+
+    // Tiempos de un intento (esp_timer, us). 0: el evento no llegó
+    struct request_spans_t
+    {
+        int64_t start_us;          // esp_http_client_perform
+        int64_t connected_us;      // HTTP_EVENT_ON_CONNECTED (solo si abrió conexión)
+        int64_t sent_us;           // HTTP_EVENT_HEADER_SENT
+        int64_t first_byte_us;     // primer HTTP_EVENT_ON_HEADER
+        int64_t end_us;            // vuelta de perform
+    };
+
+    firebase_method_t metricsMethod(esp_http_client_method_t method);
+    // Bucket del histograma de latencia: < 25 ms * 2^i; el último sin techo
+    int metricsBucket(int64_t latency_us);
+
+    void metricsRecordAttempt(firebase_method_metrics_t& m, const request_spans_t& spans);
+    void metricsRecordRequest(firebase_method_metrics_t& m, bool ok, int64_t total_us,
+                              uint64_t tx_bytes, uint64_t rx_bytes);
+
+    // Un nodo JSON compacto (tiempos medios en ms). Devuelve la longitud sin
+    // '\0', o el tamaño que haría falta (>= cap) si no cabe.
+    size_t metricsToJson(const firebase_metrics_t& metrics, int64_t now_us, char* out, size_t cap);
+
+}
+
+
+#endif
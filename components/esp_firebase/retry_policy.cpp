@@ -0,0 +1,102 @@
+#include "retry_policy.h"
+#include "esp_http_client.h"
+
+namespace ESPFirebase {
+
+const retry_policy_t DEFAULT_RETRY_POLICY = {
+    4,       // max_attempts
+    500,     // base_backoff_ms
+    8000,    // max_backoff_ms
+    50,      // jitter_pct
+    60000,   // deadline_ms
+    defaultRetryClassifier,
+};
+
+const breaker_config_t DEFAULT_BREAKER_CONFIG = {
+    5,       // failure_threshold
+    30000,   // open_ms
+    300000,  // max_open_ms
+};
+
+retry_class_t defaultRetryClassifier(esp_err_t err, int status_code)
+{
+    if (err == ESP_OK) {
+        if (status_code >= 200 && status_code < 300) return RETRY_SUCCESS;
+        if (status_code == 304) return RETRY_SUCCESS;     // lectura condicional: no cambió
+        if (status_code == 401) return RETRY_UNAUTHORIZED;
+        if (status_code == 408 || status_code == 429 || status_code >= 500) return RETRY_TRANSIENT;
+        return RETRY_PERMANENT;
+    }
+    // Errores locales: repetir da lo mismo
+    if (err == ESP_ERR_NO_MEM || err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE ||
+        err == ESP_ERR_NOT_FINISHED) {
+        return RETRY_PERMANENT;
+    }
+    // Conexión, TLS, timeout, cierre del server...
+    return RETRY_TRANSIENT;
+}
+
+int retryBackoffMs(const retry_policy_t& policy, int attempt, uint32_t random)
+{
+    if (attempt < 2) return 0;
+    int64_t backoff = policy.base_backoff_ms;
+    for (int i = 2; i < attempt && backoff < policy.max_backoff_ms; ++i) backoff *= 2;
+    if (backoff > policy.max_backoff_ms) backoff = policy.max_backoff_ms;
+    int64_t jitter = backoff * policy.jitter_pct / 100;
+    if (jitter > 0) backoff -= (int64_t)(random % (uint32_t)(jitter + 1));
+    return (int)backoff;
+}
+
+bool retryShouldContinue(const retry_policy_t& policy, retry_class_t result,
+                         int attempt, int64_t elapsed_ms, int backoff_ms)
+{
+    if (result != RETRY_TRANSIENT) return false;
+    if (attempt >= policy.max_attempts) return false;
+    if (policy.deadline_ms > 0 && elapsed_ms + backoff_ms >= policy.deadline_ms) return false;
+    return true;
+}
+
+bool breakerAllow(circuit_breaker_t& breaker, int64_t now_us)
+{
+    if (breaker.open_until_us == 0) return true;
+    if (now_us < breaker.open_until_us) return false;
+    if (breaker.probing) return false;
+    breaker.probing = true;
+    return true;
+}
+
+bool breakerIsOpen(const circuit_breaker_t& breaker, int64_t now_us)
+{
+    return breaker.open_until_us != 0 && (now_us < breaker.open_until_us || breaker.probing);
+}
+
+bool breakerRecord(circuit_breaker_t& breaker, const breaker_config_t& config,
+                   retry_class_t result, int64_t now_us)
+{
+    if (result != RETRY_TRANSIENT) {
+        // El server contestó (aunque sea un 4xx): el host está vivo
+        breaker.failures = 0;
+        breaker.opens = 0;
+        breaker.open_until_us = 0;
+        breaker.probing = false;
+        return false;
+    }
+    breaker.failures++;
+    bool open_now = false;
+    if (breaker.probing) {
+        breaker.probing = false;
+        open_now = true;                      // la prueba falló: otra vez abierto
+    } else if (breaker.open_until_us == 0 && breaker.failures >= config.failure_threshold) {
+        open_now = true;
+    }
+    if (!open_now) return false;
+
+    int64_t open_ms = config.open_ms;
+    for (int i = 0; i < breaker.opens && open_ms < config.max_open_ms; ++i) open_ms *= 2;
+    if (open_ms > config.max_open_ms) open_ms = config.max_open_ms;
+    breaker.opens++;
+    breaker.open_until_us = now_us + open_ms * 1000;
+    return true;
+}
+
+}
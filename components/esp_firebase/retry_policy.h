@@ -0,0 +1,78 @@
+#ifndef _ESP_FIREBASE_RETRY_POLICY_H_
+#define  _ESP_FIREBASE_RETRY_POLICY_H_
+#include <cstdint>
+#include "esp_err.h"
+
+namespace ESPFirebase 
+{
+
+    enum retry_class_t
+    {
+        RETRY_SUCCESS,       // 2xx, 304
+        RETRY_TRANSIENT,     // red, timeout, 408, 429, 5xx: puede salir bien más tarde
+        RETRY_PERMANENT,     // 4xx, errores locales: repetir no sirve
+        RETRY_UNAUTHORIZED,  // 401: lo resuelve quien tiene el token, no un reintento
+    };
+
+    typedef retry_class_t (*retry_classifier_t)(esp_err_t err, int status_code);
+    retry_class_t defaultRetryClassifier(esp_err_t err, int status_code);
+
+    /**
+     * @brief Cuántas veces y con qué espera se repite un request. La espera del
+     * intento n es base * 2^(n-2) acotada a max, menos un jitter aleatorio de
+     * hasta jitter_pct % (para que varios equipos no reintenten a la vez).
+     */
+    struct retry_policy_t
+    {
+        int max_attempts;          // incluye el primero
+        int base_backoff_ms;
+        int max_backoff_ms;
+        int jitter_pct;            // 0..100
+        int deadline_ms;           // no se empieza otro intento pasado este plazo; 0: sin tope
+        retry_classifier_t classify;
+    };
+
+    extern const retry_policy_t DEFAULT_RETRY_POLICY;
+
+    // Espera antes del intento 'attempt' (2, 3...). 'random' es cualquier uint32 al azar.
+    int retryBackoffMs(const retry_policy_t& policy, int attempt, uint32_t random);
+
+    // Hay que intentar de nuevo? 'elapsed_ms' desde el primer intento, sin la espera.
+    bool retryShouldContinue(const retry_policy_t& policy, retry_class_t result,
+                             int attempt, int64_t elapsed_ms, int backoff_ms);
+
+    /**
+     * @brief Circuit breaker por host. Tras 'failure_threshold' requests
+     * seguidos con fallo transitorio deja de intentar durante open_ms (que se
+     * duplica en cada reapertura hasta max_open_ms); luego deja pasar un solo
+     * request de prueba. Mientras tanto los datos esperan en el store-and-forward.
+     * Estado a cero = cerrado (se puede poner a cero con memset).
+     */
+    struct breaker_config_t
+    {
+        int failure_threshold;
+        int open_ms;
+        int max_open_ms;
+    };
+
+    extern const breaker_config_t DEFAULT_BREAKER_CONFIG;
+
+    struct circuit_breaker_t
+    {
+        int failures;              // requests seguidos con fallo transitorio
+        int opens;                 // aperturas seguidas sin un éxito en medio
+        int64_t open_until_us;     // 0: cerrado
+        bool probing;              // medio abierto con el request de prueba en vuelo
+    };
+
+    // false: abierto, no intentar
+    bool breakerAllow(circuit_breaker_t& breaker, int64_t now_us);
+    bool breakerIsOpen(const circuit_breaker_t& breaker, int64_t now_us);
+    // Resultado final del request (tras sus reintentos). true si el circuito se acaba de abrir.
+    bool breakerRecord(circuit_breaker_t& breaker, const breaker_config_t& config,
+                       retry_class_t result, int64_t now_us);
+
+}
+
+
+#endif
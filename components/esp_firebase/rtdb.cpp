@@ -1,11 +1,14 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <sys/time.h>
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "rtdb.h"
+#include "rtdb_query.h"
 
 #include "value.h"
 #include "json.h"
@@ -14,203 +17,330 @@
 
 namespace ESPFirebase {
 
-
 RTDB::RTDB(FirebaseApp* app, const char * database_url)
     : app(app), base_database_url(database_url)
 
 {
-    
+    auth_param_lock = xSemaphoreCreateMutex();
+    read_cache_lock = xSemaphoreCreateMutex();
+    push_id_lock = xSemaphoreCreateMutex();
+    // La RTDB es el host con tráfico regular: su conexión se mantiene abierta
+    this->app->setPersistentHost(database_url);
 }
-Json::Value RTDB::getData(const char* path)
+
+RTDB::~RTDB()
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
+    vSemaphoreDelete(auth_param_lock);
+    vSemaphoreDelete(read_cache_lock);
+    vSemaphoreDelete(push_id_lock);
+}
 
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200)
-    {
-        const char* begin = this->app->local_response_buffer;
-        const char* end = begin + strlen(this->app->local_response_buffer);
+bool RTDB::buildUrl(RequestBuilder& url, const char* path, const char* query, uint32_t& generation)
+{
+    url.append(base_database_url.c_str(), base_database_url.size());
+    url.append(path);
+    url.append(".json", 5);
+    url.appendQuery(query);
+
+    xSemaphoreTake(auth_param_lock, portMAX_DELAY);
+    if (auth_param_len == 0 || auth_param_generation != this->app->tokenGeneration()) {
+        // El ID token es un JWT (base64url): va en la URL sin codificar
+        memcpy(auth_param, "auth=", 5);
+        size_t n = this->app->copyToken(auth_param + 5, sizeof(auth_param) - 5, &auth_param_generation);
+        auth_param_len = (n > 0 && n < sizeof(auth_param) - 5) ? n + 5 : 0;
+        if (n >= sizeof(auth_param) - 5) ESP_LOGE(RTDB_TAG, "ID token de %u bytes: no cabe", (unsigned)n);
+    }
+    generation = auth_param_generation;
+    if (auth_param_len) url.paramRaw(auth_param, auth_param_len);
+    xSemaphoreGive(auth_param_lock);
+
+    if (!url.ok()) {
+        ESP_LOGE(RTDB_TAG, "URL de %s no cabe (%u bytes)", path, (unsigned)url.needed());
+        return false;
+    }
+    return true;
+}
 
-        Json::Reader reader;
-        Json::Value data;
+http_ret_t RTDB::send(esp_http_client_method_t method, const char* path, const char* query,
+                      const char* body, size_t body_len, const Json::Value* value,
+                      Json::StreamReader* sink, const timeout_profile_t* timeouts, const char* what,
+                      read_cond_t* cond)
+{
+    // Renovar (si toca) antes de tomar un contexto: el refresh necesita uno
+    this->app->validTokenGeneration();
+
+    http_ret_t http_ret = {ESP_FAIL, -1};
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        FirebaseApp::request_ctx_t* ctx = this->app->acquireRequest(sink);
+        ctx->timeouts = timeouts;
+        if (cond) {
+            ctx->want_etag = true;
+            ctx->if_none_match = cond->if_none_match;
+            ctx->send_if_none_match = this->if_none_match;
+        }
 
-        reader.parse(begin, end, data, false);
+        const char* data = body;
+        size_t data_len = body_len;
+        std::string spilled;
+        if (!body && value) {
+            RequestBuilder out(ctx->send, sizeof(ctx->send));
+            out.appendJson(*value);
+            if (out.ok()) {
+                data = out.c_str();
+                data_len = out.size();
+            } else {
+                // No cabe en el buffer del contexto: serializar en el heap
+                ESP_LOGD(RTDB_TAG, "%s: body de %u bytes fuera del buffer", what, (unsigned)out.needed());
+                spilled.resize(out.needed());
+                RequestBuilder big(&spilled[0], spilled.size());
+                big.appendJson(*value);
+                data = big.c_str();
+                data_len = big.size();
+            }
+        }
 
-        ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
-        this->app->clearHTTPBuffer();
-        return data;
-    }
-    else
-    {   
-        ESP_LOGE(RTDB_TAG, "Error while getting data at path %s| esp_err_t=%d | status_code=%d", path, (int)http_ret.err, http_ret.status_code);
-    ESP_LOGI(RTDB_TAG, "Token expired ? Trying refreshing auth");
-    this->app->loginUserAccount(this->app->user_account);
-        this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
-        if (http_ret.err == ESP_OK && http_ret.status_code == 200)
-        {
-            const char* begin = this->app->local_response_buffer;
-            const char* end = begin + strlen(this->app->local_response_buffer);
-
-            Json::Reader reader;
-            Json::Value data;
-
-            reader.parse(begin, end, data, false);
-
-            ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
-            this->app->clearHTTPBuffer();
-            return data;
+        RequestBuilder url(ctx->url, sizeof(ctx->url));
+        uint32_t generation = 0;
+        if (RTDB::buildUrl(url, path, query, generation)) {
+            http_ret = this->app->performRequest(url.c_str(), method, data, data_len, ctx);
+        } else {
+            http_ret = {ESP_ERR_INVALID_SIZE, -1};
         }
-        else
-        {
-            ESP_LOGE(RTDB_TAG, "Failed to get data after refreshing token. double check account credentials or database rules");
-            this->app->clearHTTPBuffer();
-            return Json::Value();
+        if (cond) {
+            memcpy(cond->etag, ctx->etag, sizeof(cond->etag));
+            cond->matched = ctx->etag_matched;
         }
+        // El refresh usa su propio contexto: no retener este mientras (pool chico)
+        this->app->releaseRequest(ctx);
+
+        if (http_ret.status_code != 401 || attempt > 0) break;
+        ESP_LOGW(RTDB_TAG, "%s 401 -> intentando refresh auth", what);
+        this->app->onUnauthorized(generation);
     }
+    return http_ret;
 }
 
-esp_err_t RTDB::putData(const char* path, const char* json_str)
+http_ret_t RTDB::getStreamed(const char* path, const char* query, Json::StreamHandler& handler, bool& parsed,
+                             read_cond_t* cond)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PUT, json_str);
-    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) && http_ret.status_code == 401) {
-        ESP_LOGW(RTDB_TAG, "PUT 401 -> intentando refresh auth");
-        this->app->forceRefreshAuth();
-        url = RTDB::base_database_url; url += path; url += ".json?auth=" + this->app->auth_token;
-        this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PUT, json_str);
+    Json::StreamReader reader(handler);
+    http_ret_t http_ret = RTDB::send(HTTP_METHOD_GET, path, query, nullptr, 0, nullptr, &reader, nullptr, "GET", cond);
+    parsed = reader.finish();
+    if (cond) cond->body_bytes = reader.offset();
+    bool skipped = cond && cond->matched;
+    if (!parsed && !skipped && http_ret.err == ESP_OK && http_ret.status_code == 200) {
+        ESP_LOGE(RTDB_TAG, "Respuesta JSON invalida (byte %u): %s", (unsigned)reader.offset(), reader.error().c_str());
     }
-    this->app->clearHTTPBuffer();
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200) {
-        ESP_LOGI(RTDB_TAG, "PUT successful");
-        return ESP_OK;
+    return http_ret;
+}
+
+http_ret_t RTDB::query(const char* path, const Query& query, Json::StreamHandler& handler, bool& parsed)
+{
+    char text[QUERY_MAX];
+    RequestBuilder query_text(text, sizeof(text));
+    parsed = false;
+    if (!query.build(query_text)) {
+        ESP_LOGE(RTDB_TAG, "Query de %s no cabe en %u bytes", path, (unsigned)sizeof(text));
+        return {ESP_ERR_INVALID_SIZE, -1};
     }
-    ESP_LOGE(RTDB_TAG, "PUT failed");
-    return ESP_FAIL;
+    return RTDB::getStreamed(path, text, handler, parsed);
 }
 
-esp_err_t RTDB::putData(const char* path, const Json::Value& data)
+Json::Value RTDB::getData(const char* path, const Query& query)
 {
-    Json::FastWriter writer;
-    std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::putData(path, json_str.c_str());
-    return err;
+    Json::Value data;
+    Json::ValueBuilder builder(data);
+    bool parsed = false;
+    http_ret_t http_ret = RTDB::query(path, query, builder, parsed);
+    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) || !parsed) {
+        ESP_LOGE(RTDB_TAG, "Query GET fallo: %s", path);
+        return Json::Value();
+    }
+    return data;
+}
 
+// Con read_cache_lock
+RTDB::read_cache_entry_t* RTDB::findCached(const char* path)
+{
+    for (int i = 0; i < READ_CACHE_SIZE; ++i) {
+        if (read_cache[i].last_use != 0 && read_cache[i].path == path) return &read_cache[i];
+    }
+    return nullptr;
 }
 
-esp_err_t RTDB::postData(const char* path, const char* json_str)
+Json::Value RTDB::getData(const char* path)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_POST, json_str);
-    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) && http_ret.status_code == 401) {
-        ESP_LOGW(RTDB_TAG, "POST 401 -> intentando refresh auth");
-        this->app->forceRefreshAuth();
-        url = RTDB::base_database_url; url += path; url += ".json?auth=" + this->app->auth_token;
-        this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_POST, json_str);
+    read_cond_t cond = {};
+    char known_etag[sizeof(cond.etag)] = "";
+    xSemaphoreTake(read_cache_lock, portMAX_DELAY);
+    read_cache_entry_t* cached = RTDB::findCached(path);
+    if (cached) memcpy(known_etag, cached->etag, sizeof(known_etag));
+    xSemaphoreGive(read_cache_lock);
+    cond.if_none_match = known_etag[0] ? known_etag : nullptr;
+
+    Json::Value data;
+    Json::ValueBuilder builder(data);
+    bool parsed = false;
+    http_ret_t http_ret = RTDB::getStreamed(path, nullptr, builder, parsed, &cond);
+    // 200 con el mismo ETag es el caso normal; 304 solo con setIfNoneMatch(true)
+    bool not_modified = http_ret.err == ESP_OK &&
+                        (http_ret.status_code == 304 || (http_ret.status_code == 200 && cond.matched));
+    bool fresh = http_ret.err == ESP_OK && http_ret.status_code == 200 && !cond.matched;
+
+    xSemaphoreTake(read_cache_lock, portMAX_DELAY);
+    cached = RTDB::findCached(path);
+    if (not_modified && cached) {
+        read_cache_hits++;
+        cached->last_use = ++read_cache_clock;
+        data = cached->value;
+    } else if (fresh) {
+        read_cache_misses++;
+        if (parsed && cond.etag[0] && cond.body_bytes <= READ_CACHE_MAX_BODY) {
+            if (!cached) {
+                // Libre o el menos usado
+                cached = &read_cache[0];
+                for (int i = 1; i < READ_CACHE_SIZE; ++i) {
+                    if (read_cache[i].last_use < cached->last_use) cached = &read_cache[i];
+                }
+                cached->path = path;
+            }
+            memcpy(cached->etag, cond.etag, sizeof(cached->etag));
+            // La entrada dura lo que la RTDB: nada de strings prestados
+            cached->value = data.deepCopy();
+            cached->last_use = ++read_cache_clock;
+        }
     }
-    this->app->clearHTTPBuffer();
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200) {
-        ESP_LOGI(RTDB_TAG, "POST successful");
-        return ESP_OK;
+    xSemaphoreGive(read_cache_lock);
+
+    if (not_modified && !cached) {
+        // Se desalojó mientras tanto: leer entero
+        ESP_LOGD(RTDB_TAG, "%s sin cambios pero fuera de la caché: lectura completa", path);
+        builder.reset();
+        parsed = false;
+        http_ret = RTDB::getStreamed(path, nullptr, builder, parsed);
+        not_modified = false;
     }
-    ESP_LOGE(RTDB_TAG, "POST failed");
-    return ESP_FAIL;
+    if (not_modified)
+    {
+        ESP_LOGI(RTDB_TAG, "Data with path=%s not modified (cache)", path);
+        return data;
+    }
+    if (http_ret.err == ESP_OK && http_ret.status_code == 200)
+    {
+        ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
+        return parsed ? data : Json::Value();
+    }
+    if (http_ret.status_code == 401)
+    {
+        ESP_LOGE(RTDB_TAG, "Failed to get data after refreshing token. double check account credentials or database rules");
+    }
+    else
+    {
+        ESP_LOGE(RTDB_TAG, "Error while getting data at path %s| esp_err_t=%d | status_code=%d", path, (int)http_ret.err, http_ret.status_code);
+    }
+    return Json::Value();
 }
 
-esp_err_t RTDB::postData(const char* path, const Json::Value& data)
+void RTDB::readCacheStats(uint32_t& hits, uint32_t& misses)
 {
-    Json::FastWriter writer;
-    std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::postData(path, json_str.c_str());
-    return err;
-
+    xSemaphoreTake(read_cache_lock, portMAX_DELAY);
+    hits = read_cache_hits;
+    misses = read_cache_misses;
+    xSemaphoreGive(read_cache_lock);
 }
-esp_err_t RTDB::patchData(const char* path, const char* json_str)
+
+esp_err_t RTDB::write(esp_http_client_method_t method, const char* path,
+                      const char* json_str, const Json::Value* value,
+                      firebase_write_mode_t mode, const char* what)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PATCH, json_str);
-    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) && http_ret.status_code == 401) {
-        ESP_LOGW(RTDB_TAG, "PATCH 401 -> intentando refresh auth");
-        this->app->forceRefreshAuth();
-        url = RTDB::base_database_url; url += path; url += ".json?auth=" + this->app->auth_token;
-        this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PATCH, json_str);
-    }
-    this->app->clearHTTPBuffer();
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200) {
-        ESP_LOGI(RTDB_TAG, "PATCH successful");
+    if (mode == FIREBASE_WRITE_DEFAULT) mode = RTDB::write_mode;
+    // ECHO: sin query (la RTDB devuelve el dato por defecto)
+    const char* query = nullptr;
+    if (mode == FIREBASE_WRITE_SILENT) query = "?print=silent";
+    else if (mode == FIREBASE_WRITE_PRETTY) query = "?print=pretty";
+
+    size_t len = json_str ? strlen(json_str) : 0;
+    http_ret_t http_ret = RTDB::send(method, path, query, json_str, len, value, nullptr, nullptr, what);
+    // print=silent responde 204 sin body
+    if (http_ret.err == ESP_OK && http_ret.status_code >= 200 && http_ret.status_code < 300) {
+        ESP_LOGI(RTDB_TAG, "%s successful", what);
         return ESP_OK;
     }
-    ESP_LOGE(RTDB_TAG, "PATCH failed");
+    ESP_LOGE(RTDB_TAG, "%s failed", what);
     return ESP_FAIL;
 }
 
-esp_err_t RTDB::patchData(const char* path, const Json::Value& data)
+esp_err_t RTDB::putData(const char* path, const char* json_str, firebase_write_mode_t mode)
 {
-    Json::FastWriter writer;
-    std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::patchData(path, json_str.c_str());
-    return err;
+    return RTDB::write(HTTP_METHOD_PUT, path, json_str, nullptr, mode, "PUT");
 }
 
-esp_err_t RTDB::deleteData(const char* path)
+esp_err_t RTDB::putData(const char* path, const Json::Value& data, firebase_write_mode_t mode)
 {
-    // --- URL con writeSizeLimit=unlimited (sin print=silent en DELETE) ---
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?writeSizeLimit=unlimited&auth=" + this->app->auth_token;
+    return RTDB::write(HTTP_METHOD_PUT, path, nullptr, &data, mode, "PUT");
+}
 
-    // --- Timeout largo SOLO para esta operación ---
-    constexpr int LONG_TIMEOUT_MS = 600000;  // 10 min
-    this->app->setHttpTimeoutMs(LONG_TIMEOUT_MS);
+void RTDB::setKeySeed(uint32_t device_id, uint32_t boot_count)
+{
+    xSemaphoreTake(push_id_lock, portMAX_DELAY);
+    push_ids.node = device_id;
+    push_ids.boot = boot_count;
+    xSemaphoreGive(push_id_lock);
+}
 
-    // --- Headers mínimos para DELETE sin cuerpo ---
-    this->app->setHeader("Content-Length", "0");
-    this->app->setHeader("Accept", "application/json");
+void RTDB::newKey(char out[PUSH_ID_LEN + 1])
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t now_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    xSemaphoreTake(push_id_lock, portMAX_DELAY);
+    pushIdNext(push_ids, now_ms, out);
+    xSemaphoreGive(push_id_lock);
+}
 
-    // --- Primer intento ---
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_DELETE, "");
+esp_err_t RTDB::postData(const char* path, const char* json_str, firebase_write_mode_t mode)
+{
+    char key[PUSH_ID_LEN + 1];
+    RTDB::newKey(key);
+    std::string child = std::string(path) + "/" + key;
+    return RTDB::write(HTTP_METHOD_PUT, child.c_str(), json_str, nullptr, mode, "POST");
+}
 
-    // --- Si el token expiró, refresca y reintenta UNA vez ---
-    if (!(http_ret.err == ESP_OK && (http_ret.status_code >= 200 && http_ret.status_code < 300))
-        && http_ret.status_code == 401) {
+esp_err_t RTDB::postData(const char* path, const Json::Value& data, firebase_write_mode_t mode)
+{
+    char key[PUSH_ID_LEN + 1];
+    RTDB::newKey(key);
+    std::string child = std::string(path) + "/" + key;
+    return RTDB::write(HTTP_METHOD_PUT, child.c_str(), nullptr, &data, mode, "POST");
+}
 
-        ESP_LOGW(RTDB_TAG, "DELETE 401 -> intentando refresh de auth y reintento");
-        this->app->forceRefreshAuth();
+esp_err_t RTDB::patchData(const char* path, const char* json_str, firebase_write_mode_t mode)
+{
+    return RTDB::write(HTTP_METHOD_PATCH, path, json_str, nullptr, mode, "PATCH");
+}
 
-        std::string url2 = RTDB::base_database_url;
-        url2 += path;
-        url2 += ".json?writeSizeLimit=unlimited&auth=" + this->app->auth_token;
+esp_err_t RTDB::patchData(const char* path, const Json::Value& data, firebase_write_mode_t mode)
+{
+    return RTDB::write(HTTP_METHOD_PATCH, path, nullptr, &data, mode, "PATCH");
+}
 
-        this->app->setHeader("Content-Length", "0");
-        this->app->setHeader("Accept", "application/json");
+void RTDB::setWriteMode(firebase_write_mode_t mode)
+{
+    if (mode != FIREBASE_WRITE_DEFAULT) RTDB::write_mode = mode;
+}
 
-        http_ret = this->app->performRequest(url2.c_str(), HTTP_METHOD_DELETE, "");
-    }
+esp_err_t RTDB::deleteData(const char* path)
+{
+    // --- Timeout propio: borrar un subárbol grande tarda en el server antes de
+    // responder, así que el RTO se estira más y con techo de 10 min ---
+    static const timeout_profile_t DELETE_TIMEOUTS = {8, 15000, 600000};
 
-    // --- Restaurar timeout SIEMPRE ---
-    this->app->restoreDefaultHttpTimeout();
+    // --- Headers mínimos para DELETE sin cuerpo (Content-Length lo pone performRequest) ---
+    this->app->setHeader("Accept", "application/json");
 
-    // --- Limpiar buffer compartido ---
-    this->app->clearHTTPBuffer();
+    // --- URL con writeSizeLimit=unlimited (sin print=silent en DELETE); reintento tras 401 ---
+    http_ret_t http_ret = RTDB::send(HTTP_METHOD_DELETE, path, "?writeSizeLimit=unlimited",
+                                     nullptr, 0, nullptr, nullptr, &DELETE_TIMEOUTS, "DELETE");
 
     // --- Resultado ---
     if (http_ret.err == ESP_OK && (http_ret.status_code >= 200 && http_ret.status_code < 300)) {
@@ -222,35 +352,88 @@ esp_err_t RTDB::deleteData(const char* path)
     return ESP_FAIL;
 }
 
+int RTDB::multiUpdate(const char* root_path,
+                      const std::vector<std::pair<std::string, std::string>>& items,
+                      size_t max_body_bytes)
+{
+    std::vector<const char*> paths, jsons;
+    paths.reserve(items.size());
+    jsons.reserve(items.size());
+    for (const auto& item : items) {
+        paths.push_back(item.first.c_str());
+        jsons.push_back(item.second.c_str());
+    }
+    return multiUpdate(root_path, paths.data(), jsons.data(), items.size(), max_body_bytes);
+}
+
+int RTDB::multiUpdate(const char* root_path, const char* const* paths, const char* const* jsons,
+                      size_t count, size_t max_body_bytes)
+{
+    if (count == 0) return 0;
+    if (max_body_bytes < 2) max_body_bytes = 2;
+    int written = 0;
+    size_t i = 0;
+    std::string body(max_body_bytes + 1, '\0');   // + '\0'
+    std::string spilled;
+    RequestBuilder chunk(&body[0], body.size());
+    while (i < count) {
+        size_t first = i;
+        chunk.clear();
+        chunk.append('{');
+        for (; i < count; ++i) {
+            // La clave va escapada: se mide sin escribir
+            size_t path_len = strlen(paths[i]);
+            RequestBuilder key(nullptr, 0);
+            key.appendJsonString(paths[i], path_len);
+            size_t json_len = strlen(jsons[i]);
+            // [","] "clave":json, más la '}' final
+            size_t entry_len = (i > first ? 1 : 0) + (key.needed() - 1) + 1 + json_len;
+            if (i > first && (chunk.needed() - 1) + entry_len + 1 > max_body_bytes) break;
+            if (i > first) chunk.append(',');
+            chunk.appendJsonString(paths[i], path_len).append(':').append(jsons[i], json_len);
+        }
+        chunk.append('}');
+
+        const char* data = chunk.c_str();
+        if (!chunk.ok()) {
+            // Un item solo que no cabe en max_body_bytes: va aislado en un buffer a medida
+            spilled.assign(chunk.needed(), '\0');
+            RequestBuilder big(&spilled[0], spilled.size());
+            big.append('{').appendJsonString(paths[first], strlen(paths[first]))
+               .append(':').append(jsons[first]).append('}');
+            data = big.c_str();
+        }
+        ESP_LOGI(RTDB_TAG, "multiUpdate %s: items %u..%u (%u bytes)", root_path,
+                 (unsigned)first, (unsigned)(i - 1), (unsigned)strlen(data));
+        if (RTDB::patchData(root_path, data) != ESP_OK) {
+            ESP_LOGE(RTDB_TAG, "multiUpdate: fallo el trozo desde el item %u", (unsigned)first);
+            break;
+        }
+        written += (int)(i - first);
+    }
+    return written;
+}
+
 esp_err_t RTDB::trimDays(const char* root_path, int max_days)
 {
     if (max_days <= 0) return ESP_OK;
 
-    // Listar días (claves) bajo root con shallow=true
-    std::string url = RTDB::base_database_url;
-    url += root_path;
-    url += ".json?shallow=true&auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
+    // Listar días (claves) bajo root: shallow no admite orderBy, así que el
+    // listado llega completo y se ordena acá (mismo orden que la RTDB)
+    KeyListing listing;
+    bool parsed = false;
+    http_ret_t http_ret = RTDB::query(root_path, Query().shallow(), listing, parsed);
     if (!(http_ret.err == ESP_OK && http_ret.status_code == 200)) {
         ESP_LOGE(RTDB_TAG, "trimDays: fallo GET shallow status=%d", http_ret.status_code);
-        this->app->clearHTTPBuffer();
         return ESP_FAIL;
     }
+    if (!parsed) return ESP_FAIL; // listado incompleto: mejor no borrar nada
 
-    const char* begin = this->app->local_response_buffer;
-    const char* end = begin + strlen(this->app->local_response_buffer);
-    Json::Reader reader;
-    Json::Value days_obj;
-    reader.parse(begin, end, days_obj, false);
-    this->app->clearHTTPBuffer();
-    if (!days_obj.isObject()) return ESP_OK; // nada que recortar
-
-    std::vector<std::string> days = days_obj.getMemberNames();
+    std::vector<std::string>& days = listing.keys;
     if ((int)days.size() <= max_days) return ESP_OK;
 
-    // Las fechas deben estar en formato YYYY-MM-DD para que el orden lex sea cronológico
-    std::sort(days.begin(), days.end()); // asc: más antiguo primero si YYYY-MM-DD
+    // Las fechas deben estar en formato YYYY-MM-DD para que el orden sea cronológico
+    std::sort(days.begin(), days.end(), rtdbKeyLess);
 
     int to_delete = (int)days.size() - max_days;
     for (int i = 0; i < to_delete; ++i) {
@@ -264,26 +447,19 @@ esp_err_t RTDB::trimDays(const char* root_path, int max_days)
 
 // Borra los N elementos más antiguos bajo root_path usando orderBy=$key y PATCH con print=silent
 int RTDB::trimOldestBatch(const char* root_path, int batch_size)
+{
+    return RTDB::trimRange(root_path, nullptr, batch_size);
+}
+
+int RTDB::trimRange(const char* root_path, const char* end_key, int batch_size)
 {
     if (batch_size <= 0) return 0;
-    std::string list_url = RTDB::base_database_url;
-    list_url += root_path;
-    list_url += ".json?orderBy=%22%24key%22&limitToFirst=" + std::to_string(batch_size) + "&auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t get_ret = this->app->performRequest(list_url.c_str(), HTTP_METHOD_GET, "");
-    if (!(get_ret.err == ESP_OK && get_ret.status_code == 200)) {
-        this->app->clearHTTPBuffer();
-        return -1;
-    }
-    const char* begin = this->app->local_response_buffer;
-    const char* end = begin + strlen(this->app->local_response_buffer);
-    Json::Reader reader;
-    Json::Value obj;
-    reader.parse(begin, end, obj, false);
-    this->app->clearHTTPBuffer();
-    if (!obj.isObject()) return 0;
-    std::vector<std::string> keys = obj.getMemberNames();
-    if (keys.empty()) return 0;
+    // Solo interesan las claves: los batches se saltan sin construirlos. Cada
+    // llamada borra lo que lista, así que basta con la primera página.
+    PageIterator pages(*this, root_path, batch_size);
+    pages.endAt(end_key);
+    if (!pages.next()) return pages.failed() ? -1 : 0;
+    const std::vector<std::string>& keys = pages.keys();
 
     std::string patch_body;
     patch_body.reserve(1024);
@@ -294,12 +470,8 @@ int RTDB::trimOldestBatch(const char* root_path, int batch_size)
     }
     patch_body += "}";
 
-    std::string patch_url = RTDB::base_database_url;
-    patch_url += root_path;
-    patch_url += ".json?auth=" + this->app->auth_token + "&print=silent";
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t patch_ret = this->app->performRequest(patch_url.c_str(), HTTP_METHOD_PATCH, patch_body);
-    this->app->clearHTTPBuffer();
+    http_ret_t patch_ret = RTDB::send(HTTP_METHOD_PATCH, root_path, "?print=silent",
+                                      patch_body.data(), patch_body.size(), nullptr, nullptr, nullptr, "PATCH");
     if (!(patch_ret.err == ESP_OK && patch_ret.status_code >= 200 && patch_ret.status_code < 300)) {
         return -2;
     }
@@ -1,7 +1,11 @@
 #ifndef _ESP_FIREBASE_RTDB_H_
 #define  _ESP_FIREBASE_RTDB_H_
 #include "app.h"
-
+#include "request_builder.h"
+#include "push_id.h"
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "value.h"
 #include "json.h"
@@ -9,7 +13,7 @@
 namespace ESPFirebase 
 {
 
-    
+    class Query;
     
     class RTDB
     {
@@ -17,25 +21,156 @@ namespace ESPFirebase
         FirebaseApp* app;
         std::string base_database_url;
 
+        // "auth=<ID token>" listo para la query. Se rearma solo cuando cambia la
+        // generación del token, no en cada request.
+        static constexpr size_t AUTH_PARAM_MAX = 1300;
+        char auth_param[AUTH_PARAM_MAX] = {};
+        size_t auth_param_len = 0;
+        uint32_t auth_param_generation = 0;
+        SemaphoreHandle_t auth_param_lock = nullptr;
+
+        // Caché LRU de getData: últimos valores leídos con su ETag. Cada lectura
+        // igual pregunta al server, así que nunca se sirve un dato viejo. Lo que
+        // pasa en la práctica: la RTDB contesta 200 con el body completo y el
+        // ETag (X-Firebase-ETag); si es el mismo que el cacheado el body se
+        // descarta sin parsearlo y se devuelve la copia. Ahorra CPU y heap, no
+        // bytes. El 304 sin body solo llega si se manda if-none-match, que la
+        // REST API no documenta para GET: por eso va detrás de setIfNoneMatch().
+        static constexpr int READ_CACHE_SIZE = 4;
+        static constexpr size_t READ_CACHE_MAX_BODY = 4096;  // nodos más grandes no se guardan
+        struct read_cache_entry_t
+        {
+            std::string path;
+            char etag[64] = {};
+            Json::Value value;
+            uint32_t last_use = 0; // 0: libre
+        };
+        read_cache_entry_t read_cache[READ_CACHE_SIZE];
+        uint32_t read_cache_clock = 0;
+        uint32_t read_cache_hits = 0;
+        uint32_t read_cache_misses = 0;
+        SemaphoreHandle_t read_cache_lock = nullptr;
+
+        // Lectura condicional: entra el ETag conocido, sale el de la respuesta
+        struct read_cond_t
+        {
+            const char* if_none_match;
+            char etag[64];
+            bool matched;          // 200 con el mismo ETag: body descartado
+            size_t body_bytes;
+        };
+        read_cache_entry_t* findCached(const char* path);
+
+        // base + path + ".json" + query ("?a=b", opcional) + auth. 'generation' es
+        // la del token que quedó en la URL. false si no cabe en el buffer.
+        bool buildUrl(RequestBuilder& url, const char* path, const char* query, uint32_t& generation);
+
+        // Request autenticado; tras un 401 renueva el token y reintenta una vez.
+        // El body es 'body' o, si es nullptr, 'value' serializado en el ctx (o
+        // nada). Con 'sink' la respuesta se parsea en streaming. 'timeouts'
+        // nullptr: el perfil de la app.
+        http_ret_t send(esp_http_client_method_t method, const char* path, const char* query,
+                        const char* body, size_t body_len, const Json::Value* value,
+                        Json::StreamReader* sink, const timeout_profile_t* timeouts, const char* what,
+                        read_cond_t* cond = nullptr);
+        esp_err_t write(esp_http_client_method_t method, const char* path,
+                        const char* json_str, const Json::Value* value,
+                        firebase_write_mode_t mode, const char* what);
+
+        firebase_write_mode_t write_mode = FIREBASE_WRITE_SILENT;
+        bool if_none_match = false;
+
+        // Claves de postData (ver push_id.h)
+        push_id_gen_t push_ids = {};
+        SemaphoreHandle_t push_id_lock = nullptr;
+
+    public:
+        // Evento de listen(): "put" reemplaza el valor en 'path' (relativo a la
+        // ruta escuchada, "/" es ella misma) por 'data'; "patch" solo los hijos
+        // presentes en 'data'. null en un put significa borrado. 'data' solo vale
+        // durante el callback (vive en una Json::Arena y sus strings apuntan al
+        // texto del evento): lo que se guarde, data.deepCopy().
+        typedef void (*listen_cb_t)(const char* event, const char* path, const Json::Value& data, void* user);
+        struct Listener;
+
+    private:
+        static void listenTask(void* pv);
+        static void onStreamEvent(const char* event, std::string& data, void* user);
+        void runListener(Listener& listener);
+
+        // GET que parsea el body en streaming hacia 'handler' (sin buffer fijo).
+        // 'parsed' queda a true si llegó un documento JSON completo y válido.
+        http_ret_t getStreamed(const char* path, const char* query, Json::StreamHandler& handler, bool& parsed,
+                               read_cond_t* cond = nullptr);
+
 
     public:
                 
+        // Lectura condicional con caché (ver read_cache)
         Json::Value getData(const char* path);
+        // Lectura filtrada (orderBy/startAt/endAt/limit, ver rtdb_query.h). Sin
+        // caché. Para recorrer colecciones grandes sin traerlas enteras: PageIterator.
+        Json::Value getData(const char* path, const Query& query);
+        static constexpr size_t QUERY_MAX = 256;  // query armada, con '\0'
+        http_ret_t query(const char* path, const Query& query, Json::StreamHandler& handler, bool& parsed);
+        void readCacheStats(uint32_t& hits, uint32_t& misses);
+        // getData manda también if-none-match con el ETag cacheado (por defecto
+        // no). Solo si el server responde 304 a eso; si no, nada cambia.
+        void setIfNoneMatch(bool enabled) { if_none_match = enabled; }
 
-        esp_err_t putData(const char* path, const char* json_str);
-        esp_err_t putData(const char* path, const Json::Value& data);
+        // Escrituras: 'mode' decide si la RTDB devuelve el dato escrito (ECHO,
+        // PRETTY) o nada (SILENT, responde 204). DEFAULT: el de setWriteMode().
+        // postData no usa POST: genera la clave en el equipo (newKey) y hace PUT
+        // en path/<clave>, así un reintento tras un timeout no duplica el dato.
+        esp_err_t putData(const char* path, const char* json_str, firebase_write_mode_t mode = FIREBASE_WRITE_DEFAULT);
+        esp_err_t putData(const char* path, const Json::Value& data, firebase_write_mode_t mode = FIREBASE_WRITE_DEFAULT);
 
-        esp_err_t postData(const char* path, const char* json_str);
-        esp_err_t postData(const char* path, const Json::Value& data);
+        esp_err_t postData(const char* path, const char* json_str, firebase_write_mode_t mode = FIREBASE_WRITE_DEFAULT);
+        esp_err_t postData(const char* path, const Json::Value& data, firebase_write_mode_t mode = FIREBASE_WRITE_DEFAULT);
 
-        esp_err_t patchData(const char* path, const char* json_str);
-        esp_err_t patchData(const char* path, const Json::Value& data);
+        esp_err_t patchData(const char* path, const char* json_str, firebase_write_mode_t mode = FIREBASE_WRITE_DEFAULT);
+        esp_err_t patchData(const char* path, const Json::Value& data, firebase_write_mode_t mode = FIREBASE_WRITE_DEFAULT);
+
+        // Semilla de newKey: identificador del equipo (se usan 24 bits) y
+        // contador de arranques. Llamar antes del primer postData.
+        void setKeySeed(uint32_t device_id, uint32_t boot_count);
+        // Clave nueva, única y creciente, de PUSH_ID_LEN caracteres
+        void newKey(char out[PUSH_ID_LEN + 1]);
+
+        void setWriteMode(firebase_write_mode_t mode);
+        firebase_write_mode_t writeMode() const { return write_mode; }
         
         esp_err_t deleteData(const char* path);
+
+        // Escritura multi-ruta: un PATCH sobre root_path con {"rel/path": json, ...}.
+        // Parte el cuerpo en trozos de como máximo max_body_bytes (un item que
+        // no cabe solo se envía aislado). Los trozos se envían en orden y se
+        // para en el primero que falle. Devuelve cuántos items quedaron escritos.
+        static constexpr size_t MULTI_UPDATE_MAX_BODY = 8192;
+        int multiUpdate(const char* root_path,
+                        const std::vector<std::pair<std::string, std::string>>& items,
+                        size_t max_body_bytes = MULTI_UPDATE_MAX_BODY);
+        // Igual, sobre arrays de 'count' rutas y JSON (sin copiarlos)
+        int multiUpdate(const char* root_path, const char* const* paths, const char* const* jsons,
+                        size_t count, size_t max_body_bytes = MULTI_UPDATE_MAX_BODY);
         // Opcionales de mantenimiento
         esp_err_t trimDays(const char* root_path, int max_days);
         int trimOldestBatch(const char* root_path, int batch_size);
+        // Borra (una página de) hasta batch_size hijos con clave <= end_key, de la
+        // más antigua a la más nueva. end_key nullptr o "": sin límite. Devuelve
+        // cuántos borró (0: no quedan), -1 si falló el listado, -2 si falló el PATCH.
+        int trimRange(const char* root_path, const char* end_key, int batch_size);
+        // Escucha 'path' con el streaming REST de la RTDB (text/event-stream) en
+        // su propia tarea y conexión. Al conectar llega un "put" con el valor
+        // completo; después, cada cambio. Reconecta sola con backoff (y renueva
+        // el token si la RTDB lo revoca): como al reconectar vuelve a llegar el
+        // valor completo, no se pierden cambios. nullptr si no pudo arrancar.
+        Listener* listen(const char* path, listen_cb_t cb, void* user);
+        // La tarea termina en cuanto pueda y libera 'listener': no volver a usarlo
+        void stopListening(Listener* listener);
+
         RTDB(FirebaseApp* app, const char* database_url);
+        ~RTDB();
     };
 
 
@@ -0,0 +1,192 @@
+#include <cstring>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_crt_bundle.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "rtdb.h"
+#include "sse_parser.h"
+
+#include "value.h"
+#include "json.h"
+#define RTDB_LISTEN_TAG "RTDB-listen"
+
+// Firebase manda un keep-alive cada 30 s: sin nada en este tiempo, la conexión está muerta
+#define LISTEN_SILENCE_US       (75LL * 1000000)
+#define LISTEN_READ_TIMEOUT_MS  10000
+#define LISTEN_MAX_EVENT        8192
+#define LISTEN_MAX_REDIRECTS    3
+#define LISTEN_TASK_STACK       8192
+#define LISTEN_TASK_PRIO        3
+
+
+namespace ESPFirebase {
+
+namespace {
+
+// Esperas entre reconexiones (el máximo de intentos no aplica: se reintenta siempre)
+const retry_policy_t LISTEN_RETRY = {
+    0,       // max_attempts
+    1000,    // base_backoff_ms
+    60000,   // max_backoff_ms
+    50,      // jitter_pct
+    0,       // deadline_ms
+    defaultRetryClassifier,
+};
+
+}
+
+struct RTDB::Listener
+{
+    RTDB* rtdb;
+    std::string path;
+    listen_cb_t cb;
+    void* user;
+    volatile bool stop;
+    bool reconnect;            // el evento recibido obliga a reconectar
+    bool auth_revoked;
+    char url[HTTP_URL_BUFFER_SIZE];
+    Json::Arena arena;         // árbol de cada evento: se libera entero al terminarlo
+};
+
+RTDB::Listener* RTDB::listen(const char* path, listen_cb_t cb, void* user)
+{
+    if (!path || !cb) return nullptr;
+    Listener* listener = new Listener();
+    listener->rtdb = this;
+    listener->path = path;
+    listener->cb = cb;
+    listener->user = user;
+    if (xTaskCreate(RTDB::listenTask, "rtdb_listen", LISTEN_TASK_STACK, listener, LISTEN_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(RTDB_LISTEN_TAG, "No se pudo crear la tarea para %s", path);
+        delete listener;
+        return nullptr;
+    }
+    return listener;
+}
+
+void RTDB::stopListening(Listener* listener)
+{
+    if (listener) listener->stop = true;
+}
+
+void RTDB::listenTask(void* pv)
+{
+    Listener* listener = static_cast<Listener*>(pv);
+    listener->rtdb->runListener(*listener);
+    ESP_LOGI(RTDB_LISTEN_TAG, "Fin de la escucha de %s", listener->path.c_str());
+    delete listener;
+    vTaskDelete(NULL);
+}
+
+void RTDB::onStreamEvent(const char* event, std::string& data, void* user)
+{
+    Listener* listener = static_cast<Listener*>(user);
+    if (strcmp(event, "keep-alive") == 0) return;
+
+    if (strcmp(event, "put") == 0 || strcmp(event, "patch") == 0) {
+        // data = {"path": "/rel", "data": <valor>}. El árbol se arma en la arena
+        // y sus strings sin escapes se quedan en 'data' (parse in situ): nada
+        // se copia, pero solo vale hasta que vuelva el callback.
+        {
+            Json::Value message;
+            Json::ValueBuilder builder(message, &listener->arena);
+            Json::StreamReader reader(builder);
+            if (!reader.parseInSitu(&data[0], data.size()) || !message.isObject()) {
+                ESP_LOGW(RTDB_LISTEN_TAG, "Evento %s invalido: %s", event, reader.error().c_str());
+            } else {
+                const Json::Value& rel = message["path"];
+                listener->cb(event, rel.isString() ? rel.asCString() : "/", message["data"], listener->user);
+            }
+        }
+        listener->arena.reset();
+    } else if (strcmp(event, "auth_revoked") == 0) {
+        // El token expiró o fue revocado: hay que reconectar con uno nuevo
+        ESP_LOGI(RTDB_LISTEN_TAG, "Token revocado en %s: reconectando", listener->path.c_str());
+        listener->auth_revoked = true;
+        listener->reconnect = true;
+    } else if (strcmp(event, "cancel") == 0) {
+        // Las reglas ya no permiten leer la ruta
+        ESP_LOGW(RTDB_LISTEN_TAG, "Escucha de %s cancelada por el server: %s", listener->path.c_str(), data.c_str());
+        listener->reconnect = true;
+    }
+}
+
+void RTDB::runListener(Listener& listener)
+{
+    SseParser parser(RTDB::onStreamEvent, &listener, LISTEN_MAX_EVENT);
+    char chunk[512];
+    int failures = 0;
+
+    while (!listener.stop) {
+        // Renovar (si toca) antes de armar la URL con el token
+        this->app->validTokenGeneration();
+        RequestBuilder url(listener.url, sizeof(listener.url));
+        uint32_t generation = 0;
+        if (!RTDB::buildUrl(url, listener.path.c_str(), nullptr, generation)) return;
+
+        esp_http_client_config_t config = {};
+        config.url = url.c_str();
+        config.crt_bundle_attach = esp_crt_bundle_attach;
+        config.timeout_ms = LISTEN_READ_TIMEOUT_MS;
+        config.buffer_size = 1024;
+        config.keep_alive_enable = true;
+        esp_http_client_handle_t client = esp_http_client_init(&config);
+        if (!client) {
+            vTaskDelay(pdMS_TO_TICKS(retryBackoffMs(LISTEN_RETRY, ++failures + 1, esp_random())));
+            continue;
+        }
+        esp_http_client_set_header(client, "Accept", "text/event-stream");
+
+        // La RTDB puede redirigir el stream a otro servidor (307)
+        int status = -1;
+        for (int redirects = 0; redirects <= LISTEN_MAX_REDIRECTS; ++redirects) {
+            if (esp_http_client_open(client, 0) != ESP_OK) break;
+            esp_http_client_fetch_headers(client);
+            status = esp_http_client_get_status_code(client);
+            if (status != 301 && status != 302 && status != 307 && status != 308) break;
+            esp_http_client_set_redirection(client);
+            esp_http_client_close(client);
+        }
+
+        listener.reconnect = false;
+        listener.auth_revoked = false;
+        if (status == 200) {
+            ESP_LOGI(RTDB_LISTEN_TAG, "Escuchando %s", listener.path.c_str());
+            failures = 0;
+            parser.reset();
+            int64_t last_rx_us = esp_timer_get_time();
+            while (!listener.stop && !listener.reconnect) {
+                int n = esp_http_client_read(client, chunk, sizeof(chunk));
+                if (n > 0) {
+                    last_rx_us = esp_timer_get_time();
+                    parser.feed(chunk, (size_t)n);
+                } else if (n == -ESP_ERR_HTTP_EAGAIN) {
+                    if (esp_timer_get_time() - last_rx_us > LISTEN_SILENCE_US) {
+                        ESP_LOGW(RTDB_LISTEN_TAG, "Sin keep-alive en %s: reconectando", listener.path.c_str());
+                        break;
+                    }
+                } else {
+                    break; // cierre del server o error de red
+                }
+            }
+        } else if (status == 401) {
+            listener.auth_revoked = true;
+        } else {
+            ESP_LOGW(RTDB_LISTEN_TAG, "No se pudo escuchar %s (status=%d)", listener.path.c_str(), status);
+        }
+        esp_http_client_close(client);
+        esp_http_client_cleanup(client);
+        if (listener.stop) break;
+
+        if (listener.auth_revoked) this->app->onUnauthorized(generation);
+        // Tras una sesión sana se reconecta casi enseguida; si falla, con backoff
+        int wait_ms = retryBackoffMs(LISTEN_RETRY, ++failures + 1, esp_random());
+        ESP_LOGD(RTDB_LISTEN_TAG, "Reconectando %s en %d ms", listener.path.c_str(), wait_ms);
+        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+    }
+}
+
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include "esp_log.h"
+
+#include "rtdb_query.h"
+
+#define RTDB_QUERY_TAG "RTDB-query"
+
+namespace ESPFirebase {
+
+namespace {
+
+// Clave que la RTDB ordena como número: entero de 32 bits sin ceros a la izquierda
+bool keyAsInt(const std::string& key, long& value)
+{
+    if (key.empty() || key.size() > 11) return false;
+    size_t i = (key[0] == '-') ? 1 : 0;
+    if (i == key.size()) return false;
+    if (key[i] == '0' && (key.size() > i + 1 || i == 1)) return false;
+    for (size_t j = i; j < key.size(); ++j) {
+        if (key[j] < '0' || key[j] > '9') return false;
+    }
+    errno = 0;
+    long long v = strtoll(key.c_str(), nullptr, 10);
+    if (errno || v < INT32_MIN || v > INT32_MAX) return false;
+    value = (long)v;
+    return true;
+}
+
+}
+
+bool rtdbKeyLess(const std::string& a, const std::string& b)
+{
+    long ia = 0, ib = 0;
+    bool a_int = keyAsInt(a, ia);
+    bool b_int = keyAsInt(b, ib);
+    if (a_int && b_int) return ia < ib;
+    if (a_int != b_int) return a_int;
+    return a < b;
+}
+
+Query& Query::orderByKey()
+{
+    order_by = "$key";
+    return *this;
+}
+
+Query& Query::orderByValue()
+{
+    order_by = "$value";
+    return *this;
+}
+
+Query& Query::orderByChild(const char* child)
+{
+    order_by = child;
+    return *this;
+}
+
+void Query::setBound(bound_t& bound, const char* key)
+{
+    bound.set = true;
+    bound.quoted = true;
+    bound.text = key;
+}
+
+void Query::setBound(bound_t& bound, double value)
+{
+    char tmp[32];
+    snprintf(tmp, sizeof(tmp), "%.17g", value);
+    bound.set = true;
+    bound.quoted = false;
+    bound.text = tmp;
+}
+
+Query& Query::startAt(const char* key) { setBound(start, key); return *this; }
+Query& Query::startAt(double value) { setBound(start, value); return *this; }
+Query& Query::endAt(const char* key) { setBound(end, key); return *this; }
+Query& Query::endAt(double value) { setBound(end, value); return *this; }
+
+Query& Query::limitToFirst(int count)
+{
+    limit_first = count;
+    limit_last = 0;
+    return *this;
+}
+
+Query& Query::limitToLast(int count)
+{
+    limit_last = count;
+    limit_first = 0;
+    return *this;
+}
+
+Query& Query::shallow()
+{
+    is_shallow = true;
+    return *this;
+}
+
+bool Query::build(RequestBuilder& out) const
+{
+    if (is_shallow) {
+        // La REST API rechaza shallow junto con orderBy y compañía
+        if (!order_by.empty() || start.set || end.set || limit_first || limit_last) {
+            ESP_LOGE(RTDB_QUERY_TAG, "shallow no admite otros parámetros");
+            return false;
+        }
+        out.param("shallow", "true");
+        return out.ok();
+    }
+    if (!order_by.empty()) out.paramQuoted("orderBy", order_by.c_str());
+    const bound_t* bounds[] = {&start, &end};
+    const char* names[] = {"startAt", "endAt"};
+    for (int i = 0; i < 2; ++i) {
+        if (!bounds[i]->set) continue;
+        if (bounds[i]->quoted) out.paramQuoted(names[i], bounds[i]->text.c_str());
+        else out.param(names[i], bounds[i]->text.c_str());
+    }
+    if (limit_first > 0) out.param("limitToFirst", (long long)limit_first);
+    if (limit_last > 0) out.param("limitToLast", (long long)limit_last);
+    return out.ok();
+}
+
+PageIterator::PageIterator(RTDB& rtdb, const char* path, int page_size, bool with_values)
+    : rtdb(rtdb), path(path), page_size(page_size > 0 ? page_size : 1), with_values(with_values)
+{
+}
+
+PageIterator& PageIterator::startAt(const char* key)
+{
+    start_key = key ? key : "";
+    return *this;
+}
+
+PageIterator& PageIterator::endAt(const char* key)
+{
+    end_key = key ? key : "";
+    return *this;
+}
+
+bool PageIterator::next()
+{
+    if (done) return false;
+    page_keys.clear();
+    page_values = Json::Value();
+    arena.reset();
+
+    // Con cursor se pide uno más: la primera clave es la última de la página anterior
+    Query query;
+    query.orderByKey();
+    if (has_cursor) query.startAt(cursor.c_str());
+    else if (!start_key.empty()) query.startAt(start_key.c_str());
+    if (!end_key.empty()) query.endAt(end_key.c_str());
+    int requested = page_size + (has_cursor ? 1 : 0);
+    query.limitToFirst(requested);
+
+    bool parsed = false;
+    http_ret_t http_ret;
+    if (with_values) {
+        Json::ValueBuilder builder(page_values, &arena);
+        http_ret = rtdb.query(path.c_str(), query, builder, parsed);
+        if (parsed && page_values.isObject()) page_keys = page_values.getMemberNames();
+    } else {
+        KeyListing listing;
+        http_ret = rtdb.query(path.c_str(), query, listing, parsed);
+        page_keys.swap(listing.keys);
+    }
+    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) || !parsed) {
+        ESP_LOGE(RTDB_QUERY_TAG, "Página de %s fallo (status=%d)", path.c_str(), http_ret.status_code);
+        page_keys.clear();
+        error = true;
+        done = true;
+        return false;
+    }
+
+    // El JSON de la respuesta no respeta el orden: se ordena acá
+    std::sort(page_keys.begin(), page_keys.end(), rtdbKeyLess);
+    size_t received = page_keys.size();
+    if (has_cursor && !page_keys.empty() && page_keys.front() == cursor) {
+        if (with_values) page_values.removeMember(cursor);
+        page_keys.erase(page_keys.begin());
+    }
+    if ((int)received < requested) done = true;
+    if (page_keys.empty()) {
+        done = true;
+        return false;
+    }
+    cursor = page_keys.back();
+    has_cursor = true;
+    return true;
+}
+
+}
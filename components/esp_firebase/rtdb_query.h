@@ -0,0 +1,127 @@
+#ifndef _ESP_FIREBASE_RTDB_QUERY_H_
+#define  _ESP_FIREBASE_RTDB_QUERY_H_
+#include <string>
+#include <vector>
+
+#include "rtdb.h"
+#include "request_builder.h"
+
+#include "value.h"
+#include "json.h"
+
+namespace ESPFirebase 
+{
+
+    // Orden de claves de la RTDB: las que son enteros de 32 bits van primero y en
+    // orden numérico; el resto después, en orden lexicográfico.
+    bool rtdbKeyLess(const std::string& a, const std::string& b);
+
+    /**
+     * @brief Filtro/orden de una lectura (parámetros de query de la REST API).
+     * Los límites van con comillas si son texto; shallow no se combina con el resto.
+     */
+    class Query
+    {
+    public:
+        Query& orderByKey();
+        Query& orderByValue();
+        Query& orderByChild(const char* child);
+        Query& startAt(const char* key);
+        Query& startAt(double value);
+        Query& endAt(const char* key);
+        Query& endAt(double value);
+        Query& limitToFirst(int count);
+        Query& limitToLast(int count);
+        Query& shallow();
+
+        // "?orderBy=...&...". false si no cabe en 'out'
+        bool build(RequestBuilder& out) const;
+
+    private:
+        struct bound_t
+        {
+            bool set = false;
+            bool quoted = false;
+            std::string text;
+        };
+        std::string order_by;
+        bound_t start;
+        bound_t end;
+        int limit_first = 0;
+        int limit_last = 0;
+        bool is_shallow = false;
+
+        static void setBound(bound_t& bound, const char* key);
+        static void setBound(bound_t& bound, double value);
+    };
+
+    // Junta solo las claves del primer nivel de un objeto e ignora los valores,
+    // que nunca llegan a construirse (listados shallow o de batches completos).
+    class KeyListing : public Json::StreamHandler
+    {
+    public:
+        std::vector<std::string> keys;
+
+        bool startObject() override { ++depth; return true; }
+        bool endObject() override { --depth; return true; }
+        bool startArray() override { ++depth; return true; }
+        bool endArray() override { --depth; return true; }
+        bool key(const char* str, size_t len) override
+        {
+            if (depth == 1) keys.emplace_back(str, len);
+            return true;
+        }
+        void reset() override { keys.clear(); depth = 0; }
+
+    private:
+        int depth = 0;
+    };
+
+    /**
+     * @brief Recorre los hijos de una ruta por orden de clave, de a páginas de
+     * page_size, usando la última clave de cada página como cursor de la
+     * siguiente. Solo la página actual está en memoria.
+     *
+     *   PageIterator pages(rtdb, "/historial", 50);
+     *   while (pages.next()) { for (const std::string& k : pages.keys()) ... }
+     *   if (pages.failed()) ...
+     */
+    class PageIterator
+    {
+    public:
+        // with_values=false: solo claves (los valores se saltan al parsear)
+        PageIterator(RTDB& rtdb, const char* path, int page_size, bool with_values = false);
+
+        // Límites opcionales (inclusivos), antes del primer next()
+        PageIterator& startAt(const char* key);
+        PageIterator& endAt(const char* key);
+
+        // Trae la siguiente página. false: no quedan o falló la lectura (failed())
+        bool next();
+        bool failed() const { return error; }
+
+        const std::vector<std::string>& keys() const { return page_keys; }   // en orden RTDB
+        // Con with_values. El árbol vive en una Json::Arena que se vacía en cada
+        // next(): lo que tenga que durar más que la página, con deepCopy().
+        const Json::Value& values() const { return page_values; }
+
+    private:
+        RTDB& rtdb;
+        std::string path;
+        int page_size;
+        bool with_values;
+        std::string start_key;
+        std::string end_key;
+        std::string cursor;
+        bool has_cursor = false;
+        bool done = false;
+        bool error = false;
+        std::vector<std::string> page_keys;
+        Json::Arena arena;         // antes que page_values: se destruye después
+        Json::Value page_values;
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,64 @@
+#include "rtt_estimator.h"
+
+namespace ESPFirebase {
+
+const timeout_profile_t DEFAULT_TIMEOUT_PROFILE = {
+    2,       // multiplier
+    2000,    // floor_ms
+    20000,   // ceiling_ms
+};
+
+const timeout_profile_t CONNECT_TIMEOUT_PROFILE = {
+    2,       // multiplier
+    4000,    // floor_ms: el handshake TLS también es CPU del ESP
+    20000,   // ceiling_ms
+};
+
+namespace {
+
+constexpr int RTT_GRANULARITY_MS = 10;   // G de la RFC: piso del término de varianza
+constexpr uint8_t RTT_MAX_BACKOFF = 6;
+
+}
+
+void rttSample(rtt_estimator_t& est, int rtt_ms)
+{
+    if (rtt_ms < 1) rtt_ms = 1;
+    if (est.samples == 0) {
+        est.srtt_ms = rtt_ms;
+        est.rttvar_ms = rtt_ms / 2;
+    } else {
+        int32_t delta = est.srtt_ms - rtt_ms;
+        if (delta < 0) delta = -delta;
+        est.rttvar_ms += (delta - est.rttvar_ms) / 4;
+        est.srtt_ms += (rtt_ms - est.srtt_ms) / 8;
+    }
+    est.samples++;
+    est.backoff = 0;
+}
+
+void rttOnTimeout(rtt_estimator_t& est)
+{
+    est.timeouts++;
+    if (est.backoff < RTT_MAX_BACKOFF) est.backoff++;
+}
+
+int rttRtoMs(const rtt_estimator_t& est)
+{
+    if (est.samples == 0) return 0;
+    int32_t var = 4 * est.rttvar_ms;
+    if (var < RTT_GRANULARITY_MS) var = RTT_GRANULARITY_MS;
+    return est.srtt_ms + var;
+}
+
+int rttTimeoutMs(const rtt_estimator_t& est, const timeout_profile_t& profile, int fallback_ms)
+{
+    if (est.samples == 0) return fallback_ms < profile.ceiling_ms ? fallback_ms : profile.ceiling_ms;
+    int64_t timeout = (int64_t)rttRtoMs(est) * profile.multiplier;
+    timeout <<= est.backoff;
+    if (timeout < profile.floor_ms) timeout = profile.floor_ms;
+    if (timeout > profile.ceiling_ms) timeout = profile.ceiling_ms;
+    return (int)timeout;
+}
+
+}
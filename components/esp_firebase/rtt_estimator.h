@@ -0,0 +1,44 @@
+#ifndef _ESP_FIREBASE_RTT_ESTIMATOR_H_
+#define  _ESP_FIREBASE_RTT_ESTIMATOR_H_
+#include <cstdint>
+
+namespace ESPFirebase 
+{
+
+    /**
+     * @brief Estimador de RTT al estilo del RTO de TCP (RFC 6298): media
+     * suavizada (srtt, alfa 1/8) y desvío (rttvar, beta 1/4). RTO = srtt +
+     * 4 * rttvar. Cada timeout sin respuesta duplica el RTO hasta la próxima
+     * muestra. Estado a cero = sin muestras (se puede poner a cero con memset).
+     */
+    struct rtt_estimator_t
+    {
+        int32_t srtt_ms;
+        int32_t rttvar_ms;
+        uint32_t samples;
+        uint32_t timeouts;         // total, para métricas
+        uint8_t backoff;           // timeouts seguidos desde la última muestra
+    };
+
+    // Timeout de una operación: RTO * multiplier acotado a [floor_ms, ceiling_ms]
+    struct timeout_profile_t
+    {
+        int multiplier;
+        int floor_ms;
+        int ceiling_ms;
+    };
+
+    extern const timeout_profile_t DEFAULT_TIMEOUT_PROFILE;   // requests normales
+    extern const timeout_profile_t CONNECT_TIMEOUT_PROFILE;   // conexión nueva (TCP + TLS)
+
+    void rttSample(rtt_estimator_t& est, int rtt_ms);
+    void rttOnTimeout(rtt_estimator_t& est);
+    // 0 si aún no hay muestras
+    int rttRtoMs(const rtt_estimator_t& est);
+    // Sin muestras: fallback_ms (acotado al techo del perfil)
+    int rttTimeoutMs(const rtt_estimator_t& est, const timeout_profile_t& profile, int fallback_ms);
+
+}
+
+
+#endif
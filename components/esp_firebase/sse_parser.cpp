@@ -0,0 +1,80 @@
+#include "sse_parser.h"
+
+namespace ESPFirebase {
+
+SseParser::SseParser(event_cb_t on_event, void* user, size_t max_event_bytes)
+    : on_event(on_event), user(user), max_event_bytes(max_event_bytes)
+{
+}
+
+void SseParser::reset()
+{
+    line.clear();
+    event.clear();
+    data.clear();
+    has_data = false;
+    overflow = false;
+    skip_lf = false;
+}
+
+void SseParser::feed(const char* bytes, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        char c = bytes[i];
+        if (skip_lf) {
+            skip_lf = false;
+            if (c == '\n') continue;   // "\r\n" es un solo fin de línea
+        }
+        if (c == '\r' || c == '\n') {
+            skip_lf = (c == '\r');
+            processLine();
+            line.clear();
+            continue;
+        }
+        // Línea más larga que el máximo: se sigue leyendo pero no se guarda
+        if (line.size() < max_event_bytes) line += c;
+        else overflow = true;
+    }
+}
+
+void SseParser::processLine()
+{
+    if (line.empty()) {
+        dispatch();
+        return;
+    }
+    if (line[0] == ':') return;       // comentario
+
+    size_t colon = line.find(':');
+    std::string field = line.substr(0, colon);
+    size_t value_at = (colon == std::string::npos) ? line.size() : colon + 1;
+    if (value_at < line.size() && line[value_at] == ' ') ++value_at;
+
+    if (field == "event") {
+        event.assign(line, value_at, std::string::npos);
+    } else if (field == "data") {
+        if (has_data) data += '\n';
+        data.append(line, value_at, std::string::npos);
+        has_data = true;
+        if (data.size() > max_event_bytes) {
+            overflow = true;
+            data.clear();
+        }
+    }
+    // id, retry y otros campos: Firebase no los usa
+}
+
+void SseParser::dispatch()
+{
+    if (overflow) {
+        dropped_events++;
+    } else if (has_data && on_event) {
+        on_event(event.empty() ? "message" : event.c_str(), data, user);
+    }
+    event.clear();
+    data.clear();
+    has_data = false;
+    overflow = false;
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef _ESP_FIREBASE_SSE_PARSER_H_
+#define  _ESP_FIREBASE_SSE_PARSER_H_
+#include <cstddef>
+#include <string>
+
+namespace ESPFirebase 
+{
+
+    /**
+     * @brief Parser incremental de text/event-stream (Server-Sent Events). Se le
+     * dan los bytes tal como llegan, en trozos de cualquier tamaño, y llama a
+     * 'on_event' al cerrarse cada evento (línea en blanco). Las líneas 'data'
+     * se juntan con '\n'; comentarios (':') y campos desconocidos se ignoran.
+     * El callback puede modificar 'data' (se descarta al volver).
+     */
+    class SseParser
+    {
+    public:
+        typedef void (*event_cb_t)(const char* event, std::string& data, void* user);
+
+        // Un evento con más de max_event_bytes de data se descarta entero
+        SseParser(event_cb_t on_event, void* user, size_t max_event_bytes = 8192);
+
+        void feed(const char* bytes, size_t len);
+        void reset();
+
+        size_t dropped() const { return dropped_events; }
+
+    private:
+        event_cb_t on_event;
+        void* user;
+        size_t max_event_bytes;
+
+        std::string line;
+        std::string event;
+        std::string data;
+        bool has_data = false;
+        bool overflow = false;
+        bool skip_lf = false;      // la línea anterior terminó en '\r'
+        size_t dropped_events = 0;
+
+        void processLine();
+        void dispatch();
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,318 @@
+#include "tls_transport.h"
+#include <cstdlib>
+#include <cstring>
+#include <sys/select.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_tls.h"
+#include "esp_crt_bundle.h"
+#include "mbedtls/ssl.h"
+#include "nvs.h"
+
+#define TLS_TAG "FirebaseTLS"
+
+namespace ESPFirebase {
+
+#if CONFIG_ESP_HTTP_CLIENT_ENABLE_CUSTOM_TRANSPORT && CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+
+namespace {
+
+// Un host por cliente de FirebaseApp (MAX_HOSTS); si aparece otro se recicla
+// la sesión usada hace más tiempo
+constexpr int SESSION_HOSTS = 3;
+// Una sesión serializada lleva el ticket y el certificado del server
+// (CONFIG_MBEDTLS_SSL_KEEP_PEER_CERTIFICATE): ~2 KB
+constexpr size_t SESSION_BLOB_MAX = 4096;
+const char* const SESSION_NVS_NAMESPACE = "fb_tls";
+
+struct cached_session_t
+{
+    char host[64];
+    esp_tls_client_session_t* session;  // nullptr: sin sesión guardada
+    bool nvs_checked;                   // ya se buscó en NVS
+    bool connecting;                    // un connect la está ofreciendo: no reciclar
+    uint32_t last_use;
+};
+cached_session_t s_sessions[SESSION_HOSTS] = {};
+uint32_t s_sessions_clock = 0;
+SemaphoreHandle_t s_sessions_lock = nullptr;
+
+// esp_tls_client_session_t (esp-tls sobre mbedTLS) es solo un mbedtls_ssl_session,
+// pero su definición no siempre está en esp_tls.h: se accede con esta réplica.
+// esp_tls_free_client_session libera lo armado así (session_free + free).
+struct client_session_layout_t
+{
+    mbedtls_ssl_session saved_session;
+};
+
+mbedtls_ssl_session* savedSession(esp_tls_client_session_t* session)
+{
+    return &reinterpret_cast<client_session_layout_t*>(session)->saved_session;
+}
+
+struct tls_transport_t
+{
+    char host[64];
+    esp_tls_t* tls;
+    tls_handshake_t last;
+};
+
+// Clave NVS (máx. 15 caracteres): "s" + FNV-1a del host
+void nvsKey(const char* host, char key[16])
+{
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)host; *p; ++p) h = (h ^ *p) * 16777619u;
+    snprintf(key, 16, "s%08x", (unsigned)h);
+}
+
+esp_tls_client_session_t* loadSession(const char* host)
+{
+    nvs_handle_t h;
+    if (nvs_open(SESSION_NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return nullptr;
+    char key[16];
+    nvsKey(host, key);
+    esp_tls_client_session_t* session = nullptr;
+    size_t len = 0;
+    if (nvs_get_blob(h, key, nullptr, &len) == ESP_OK && len > 0 && len <= SESSION_BLOB_MAX) {
+        unsigned char* blob = (unsigned char*)malloc(len);
+        client_session_layout_t* loaded = (client_session_layout_t*)calloc(1, sizeof(client_session_layout_t));
+        if (blob && loaded && nvs_get_blob(h, key, blob, &len) == ESP_OK) {
+            mbedtls_ssl_session_init(&loaded->saved_session);
+            session = reinterpret_cast<esp_tls_client_session_t*>(loaded);
+            // Falla si el firmware cambió la configuración de mbedTLS: se descarta
+            int ret = mbedtls_ssl_session_load(&loaded->saved_session, blob, len);
+            if (ret != 0) {
+                ESP_LOGD(TLS_TAG, "Sesión de %s en NVS no válida (-0x%04x)", host, (unsigned)-ret);
+                esp_tls_free_client_session(session);
+                session = nullptr;
+            }
+        } else {
+            free(loaded);
+        }
+        free(blob);
+    }
+    nvs_close(h);
+    if (session) ESP_LOGI(TLS_TAG, "Sesión TLS de %s recuperada de NVS (%u bytes)", host, (unsigned)len);
+    return session;
+}
+
+void storeSession(const char* host, esp_tls_client_session_t* session)
+{
+    size_t len = 0;
+    mbedtls_ssl_session_save(savedSession(session), nullptr, 0, &len);
+    if (len == 0 || len > SESSION_BLOB_MAX) return;
+    unsigned char* blob = (unsigned char*)malloc(len);
+    if (!blob) return;
+    nvs_handle_t h;
+    if (mbedtls_ssl_session_save(savedSession(session), blob, len, &len) == 0 &&
+        nvs_open(SESSION_NVS_NAMESPACE, NVS_READWRITE, &h) == ESP_OK) {
+        char key[16];
+        nvsKey(host, key);
+        if (nvs_set_blob(h, key, blob, len) != ESP_OK || nvs_commit(h) != ESP_OK) {
+            ESP_LOGW(TLS_TAG, "No se pudo guardar la sesión de %s en NVS", host);
+        }
+        nvs_close(h);
+    }
+    free(blob);
+}
+
+// Entrada del host; la primera vez trae la sesión de NVS. Con s_sessions_lock.
+cached_session_t* sessionFor(const char* host)
+{
+    cached_session_t* victim = nullptr;
+    for (int i = 0; i < SESSION_HOSTS; ++i) {
+        cached_session_t& e = s_sessions[i];
+        if (e.host[0] && strcmp(e.host, host) == 0) return &e;
+        if (e.connecting) continue;
+        if (!victim || !e.host[0] || (victim->host[0] && e.last_use < victim->last_use)) victim = &e;
+    }
+    if (!victim) return nullptr;
+    if (victim->session) esp_tls_free_client_session(victim->session);
+    memset(victim, 0, sizeof(*victim));
+    strncpy(victim->host, host, sizeof(victim->host) - 1);
+    return victim;
+}
+
+// Mismo master secret que la sesión ofrecida: el server la reanudó
+bool sameMaster(const mbedtls_ssl_session& a, const mbedtls_ssl_session& b)
+{
+    return memcmp(a.MBEDTLS_PRIVATE(master), b.MBEDTLS_PRIVATE(master), sizeof(a.MBEDTLS_PRIVATE(master))) == 0;
+}
+
+tls_transport_t* context(esp_transport_handle_t t)
+{
+    return static_cast<tls_transport_t*>(esp_transport_get_context_data(t));
+}
+
+int tlsClose(esp_transport_handle_t t)
+{
+    tls_transport_t* tt = context(t);
+    if (tt->tls) {
+        esp_tls_conn_destroy(tt->tls);
+        tt->tls = nullptr;
+    }
+    return 0;
+}
+
+int tlsConnect(esp_transport_handle_t t, const char* host, int port, int timeout_ms)
+{
+    tls_transport_t* tt = context(t);
+    tlsClose(t);
+    tt->last = {};
+
+    xSemaphoreTake(s_sessions_lock, portMAX_DELAY);
+    cached_session_t* entry = sessionFor(tt->host);
+    if (entry && !entry->nvs_checked) {
+        entry->nvs_checked = true;
+        entry->session = loadSession(tt->host);
+    }
+    esp_tls_client_session_t* offered = entry ? entry->session : nullptr;
+    if (entry) {
+        entry->connecting = true;
+        entry->last_use = ++s_sessions_clock;
+    }
+    xSemaphoreGive(s_sessions_lock);
+
+    // Mismo keep-alive que el transporte SSL de firebaseClientInit
+    tls_keep_alive_cfg_t keep_alive = {};
+    keep_alive.keep_alive_enable = true;
+    keep_alive.keep_alive_idle = 60;
+    keep_alive.keep_alive_interval = 10;
+    keep_alive.keep_alive_count = 3;
+    esp_tls_cfg_t cfg = {};
+    cfg.crt_bundle_attach = esp_crt_bundle_attach;
+    cfg.timeout_ms = timeout_ms;
+    cfg.keep_alive_cfg = &keep_alive;
+    cfg.client_session = offered;
+
+    tt->tls = esp_tls_init();
+    bool ok = tt->tls && esp_tls_conn_new_sync(host, (int)strlen(host), port, &cfg, tt->tls) == 1;
+    esp_tls_client_session_t* fresh = ok ? esp_tls_get_client_session(tt->tls) : nullptr;
+    tt->last.offered = offered != nullptr;
+    tt->last.resumed = offered && fresh && sameMaster(*savedSession(offered), *savedSession(fresh));
+    // Solo un handshake completo trae una sesión nueva que valga la pena
+    // persistir; tras una reanudación basta con la copia en RAM (ticket renovado)
+    if (fresh && !tt->last.resumed) storeSession(tt->host, fresh);
+
+    xSemaphoreTake(s_sessions_lock, portMAX_DELAY);
+    if (entry) {
+        entry->connecting = false;
+        if (fresh) {
+            if (entry->session) esp_tls_free_client_session(entry->session);
+            entry->session = fresh;
+            fresh = nullptr;
+        }
+    }
+    xSemaphoreGive(s_sessions_lock);
+    if (fresh) esp_tls_free_client_session(fresh);
+
+    if (!ok) {
+        ESP_LOGD(TLS_TAG, "No se pudo conectar a %s:%d", host, port);
+        tlsClose(t);
+        return -1;
+    }
+    ESP_LOGD(TLS_TAG, "%s: handshake %s", host, tt->last.resumed ? "abreviado" : "completo");
+    return 0;
+}
+
+// select() sobre el socket: 1 listo, 0 timeout, -1 error
+int pollSocket(esp_tls_t* tls, bool read, int timeout_ms)
+{
+    int fd = -1;
+    if (!tls || esp_tls_get_conn_sockfd(tls, &fd) != ESP_OK || fd < 0) return -1;
+    fd_set ready, errors;
+    FD_ZERO(&ready);
+    FD_ZERO(&errors);
+    FD_SET(fd, &ready);
+    FD_SET(fd, &errors);
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    int ret = select(fd + 1, read ? &ready : nullptr, read ? nullptr : &ready, &errors,
+                     timeout_ms < 0 ? nullptr : &tv);
+    if (ret > 0 && FD_ISSET(fd, &errors)) return -1;
+    return ret;
+}
+
+int tlsPollRead(esp_transport_handle_t t, int timeout_ms)
+{
+    tls_transport_t* tt = context(t);
+    // Lo que mbedTLS ya descifró no se ve en el socket
+    if (tt->tls && esp_tls_get_bytes_avail(tt->tls) > 0) return 1;
+    return pollSocket(tt->tls, true, timeout_ms);
+}
+
+int tlsPollWrite(esp_transport_handle_t t, int timeout_ms)
+{
+    return pollSocket(context(t)->tls, false, timeout_ms);
+}
+
+int tlsRead(esp_transport_handle_t t, char* buffer, int len, int timeout_ms)
+{
+    tls_transport_t* tt = context(t);
+    int poll = tlsPollRead(t, timeout_ms);
+    if (poll < 0) return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    if (poll == 0) return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    ssize_t ret = esp_tls_conn_read(tt->tls, buffer, (size_t)len);
+    if (ret == 0) return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_TIMEOUT) return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    if (ret < 0) return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    return (int)ret;
+}
+
+int tlsWrite(esp_transport_handle_t t, const char* buffer, int len, int timeout_ms)
+{
+    tls_transport_t* tt = context(t);
+    int poll = tlsPollWrite(t, timeout_ms);
+    if (poll <= 0) return poll;
+    ssize_t ret = esp_tls_conn_write(tt->tls, buffer, (size_t)len);
+    return ret < 0 ? -1 : (int)ret;
+}
+
+int tlsDestroy(esp_transport_handle_t t)
+{
+    tlsClose(t);
+    free(context(t));
+    return 0;
+}
+
+}
+
+esp_transport_handle_t tlsTransportCreate(const char* host)
+{
+    if (!s_sessions_lock) s_sessions_lock = xSemaphoreCreateMutex();
+    if (!s_sessions_lock) return nullptr;
+    tls_transport_t* tt = (tls_transport_t*)calloc(1, sizeof(tls_transport_t));
+    esp_transport_handle_t t = tt ? esp_transport_init() : nullptr;
+    if (!t) {
+        free(tt);
+        return nullptr;
+    }
+    strncpy(tt->host, host, sizeof(tt->host) - 1);
+    esp_transport_set_context_data(t, tt);
+    esp_transport_set_func(t, tlsConnect, tlsRead, tlsWrite, tlsClose, tlsPollRead, tlsPollWrite, tlsDestroy);
+    esp_transport_set_default_port(t, 443);
+    return t;
+}
+
+tls_handshake_t tlsTransportLastHandshake(esp_transport_handle_t transport)
+{
+    return transport ? context(transport)->last : tls_handshake_t{};
+}
+
+#else
+
+esp_transport_handle_t tlsTransportCreate(const char*)
+{
+    return nullptr;
+}
+
+tls_handshake_t tlsTransportLastHandshake(esp_transport_handle_t)
+{
+    return tls_handshake_t{};
+}
+
+#endif
+
+}
@@ -0,0 +1,36 @@
+#ifndef _ESP_FIREBASE_TLS_TRANSPORT_H_
+#define  _ESP_FIREBASE_TLS_TRANSPORT_H_
+#include "esp_transport.h"
+
+namespace ESPFirebase
+{
+
+    /**
+     * @brief Transporte TLS para esp_http_client (config.transport, requiere
+     * CONFIG_ESP_HTTP_CLIENT_ENABLE_CUSTOM_TRANSPORT) que deja a mano la sesión
+     * TLS de cada host, cosa que el transporte SSL de ESP-IDF no expone:
+     *  - al conectar ofrece la última sesión del host (ticket) para un
+     *    handshake abreviado;
+     *  - sabe si el server la aceptó: una sesión reanudada conserva el master
+     *    secret de la guardada, un handshake completo negocia otro;
+     *  - tras cada handshake completo guarda la sesión en NVS, así el primer
+     *    request después de un reinicio ya puede ser abreviado.
+     * Sin esas opciones de sdkconfig tlsTransportCreate devuelve nullptr y el
+     * cliente usa su transporte SSL de siempre.
+     */
+    struct tls_handshake_t
+    {
+        bool offered;   // se ofreció una sesión guardada
+        bool resumed;   // y el server la aceptó (sin certificado ni intercambio de claves)
+    };
+
+    // 'host' identifica la sesión (RAM y NVS). Lo destruye quien lo crea
+    // (esp_transport_destroy), después de esp_http_client_cleanup.
+    esp_transport_handle_t tlsTransportCreate(const char* host);
+    // Resultado del último connect; válido desde HTTP_EVENT_ON_CONNECTED
+    tls_handshake_t tlsTransportLastHandshake(esp_transport_handle_t transport);
+
+}
+
+
+#endif
@@ -0,0 +1,178 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_ARENA_H_INCLUDED
+#define JSON_ARENA_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "config.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#pragma pack(push)
+#pragma pack()
+
+namespace Json {
+
+/** \brief Monotonic allocator for short-lived Value trees.
+ *
+ * While an ArenaScope is active on the calling thread, every Value payload
+ * created there (string buffers, object/array containers, their map nodes
+ * and member keys) is carved out of the arena instead of the heap. Freeing
+ * those pieces is a no-op; reset() gives all of it back at once, so a
+ * parse/free cycle leaves no holes behind in a small heap.
+ *
+ * Memory is taken from malloc in chunks of chunkSize bytes (requests larger
+ * than a chunk get a chunk of their own). If a chunk cannot be allocated the
+ * payload silently falls back to the heap and is freed as usual.
+ *
+ * Rules: every Value whose payload lives in the arena must be destroyed (or
+ * reassigned) before reset() or the arena's destructor. Copying a Value
+ * allocates in the arena of the scope active at that point, or in the heap
+ * when there is none, so copy out whatever must outlive the arena; moving or
+ * swapping keeps the payload where it is. An arena is not thread-safe: use
+ * one per thread.
+ *
+ * \code
+ * Json::Arena arena;
+ * {
+ *   Json::Value root;
+ *   Json::Reader reader;
+ *   reader.setArena(&arena);
+ *   if (reader.parse(doc, root)) use(root);
+ * }
+ * arena.reset();
+ * \endcode
+ */
+class JSON_API Arena {
+public:
+  static constexpr size_t defaultChunkSize = 2048;
+
+  explicit Arena(size_t chunkSize = defaultChunkSize);
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /// Aligned block of size bytes, or nullptr if malloc failed.
+  void* allocate(size_t size);
+  /// True if p points into one of the chunks.
+  bool owns(const void* p) const;
+  /// Frees every chunk but one, which is kept for the next parse.
+  void reset();
+
+  /// Bytes handed out since the last reset().
+  size_t used() const { return used_; }
+  /// Bytes held in chunks (headers included).
+  size_t reserved() const { return reserved_; }
+  unsigned chunks() const { return chunks_; }
+  /// allocate() calls that failed since the last reset() (served by the heap).
+  unsigned failures() const { return failures_; }
+
+  /// Arena of the innermost ArenaScope on this thread, or nullptr.
+  static Arena* current();
+
+private:
+  struct Chunk {
+    Chunk* next;
+    size_t size; // usable bytes after the header
+    size_t used;
+  };
+  Chunk* newChunk(size_t minSize);
+
+  Chunk* head_ = nullptr;
+  size_t chunkSize_;
+  size_t used_ = 0;
+  size_t reserved_ = 0;
+  unsigned chunks_ = 0;
+  unsigned failures_ = 0;
+};
+
+/** \brief Routes Value allocations on this thread to an Arena while alive.
+ *
+ * Scopes nest; a nullptr arena leaves the current one (if any) in place.
+ */
+class JSON_API ArenaScope {
+public:
+  explicit ArenaScope(Arena* arena);
+  ~ArenaScope();
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+  Arena* previous_;
+};
+
+/** \brief Allocator for the containers inside a Value.
+ *
+ * Captures the current arena when constructed: a container built inside an
+ * ArenaScope keeps allocating its nodes from that arena, whatever scope is
+ * active later. Copies of a container pick the arena current at copy time.
+ */
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  ArenaAllocator() : arena_(Arena::current()) {}
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  pointer allocate(size_type n) {
+    if (arena_) {
+      void* p = arena_->allocate(n * sizeof(T));
+      if (p)
+        return static_cast<pointer>(p);
+    }
+    return static_cast<pointer>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type) {
+    // Only a failed arena allocation can have left heap blocks behind
+    if (arena_ && (arena_->failures() == 0 || arena_->owns(p)))
+      return;
+    ::operator delete(p);
+  }
+
+  template <typename... Args> void construct(pointer p, Args&&... args) {
+    ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+  }
+  void destroy(pointer p) { p->~T(); }
+
+  size_type max_size() const { return size_t(-1) / sizeof(T); }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  Arena* arena() const { return arena_; }
+  template <typename U> struct rebind { using other = ArenaAllocator<U>; };
+
+private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_ARENA_H_INCLUDED
@@ -12,6 +12,10 @@
 
 namespace Json {
 
+// arena.h
+class Arena;
+class ArenaScope;
+
 // writer.h
 class StreamWriter;
 class StreamWriterBuilder;
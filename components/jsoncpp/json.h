@@ -6,9 +6,11 @@
 #ifndef JSON_JSON_H_INCLUDED
 #define JSON_JSON_H_INCLUDED
 
+#include "arena.h"
 #include "config.h"
 #include "json_features.h"
 #include "reader.h"
+#include "stream_reader.h"
 #include "value.h"
 #include "writer.h"
 
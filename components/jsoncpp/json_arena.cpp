@@ -0,0 +1,118 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "arena.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstdlib>
+
+namespace Json {
+
+namespace {
+// Enough for every member of Value, CZString and the map nodes (64-bit
+// integers and doubles included)
+constexpr size_t kArenaAlign = 8;
+constexpr size_t alignUp(size_t n) {
+  return (n + kArenaAlign - 1) & ~(kArenaAlign - 1);
+}
+
+thread_local Arena* tCurrentArena = nullptr;
+} // namespace
+
+Arena::Arena(size_t chunkSize)
+    : chunkSize_(alignUp(chunkSize ? chunkSize : defaultChunkSize)) {}
+
+Arena::~Arena() {
+  while (head_) {
+    Chunk* next = head_->next;
+    free(head_);
+    head_ = next;
+  }
+}
+
+Arena::Chunk* Arena::newChunk(size_t minSize) {
+  size_t size = minSize > chunkSize_ ? minSize : chunkSize_;
+  size_t header = alignUp(sizeof(Chunk));
+  auto chunk = static_cast<Chunk*>(malloc(header + size));
+  if (chunk == nullptr)
+    return nullptr;
+  chunk->size = size;
+  chunk->used = 0;
+  if (size > chunkSize_ && head_) {
+    // Dedicated chunk: the current one keeps serving the small requests
+    chunk->next = head_->next;
+    head_->next = chunk;
+  } else {
+    chunk->next = head_;
+    head_ = chunk;
+  }
+  reserved_ += header + size;
+  ++chunks_;
+  return chunk;
+}
+
+void* Arena::allocate(size_t size) {
+  size = alignUp(size ? size : 1);
+  Chunk* chunk = head_;
+  if (chunk == nullptr || chunk->size - chunk->used < size) {
+    chunk = newChunk(size);
+    if (chunk == nullptr) {
+      ++failures_;
+      return nullptr;
+    }
+  }
+  char* p =
+      reinterpret_cast<char*>(chunk) + alignUp(sizeof(Chunk)) + chunk->used;
+  chunk->used += size;
+  used_ += size;
+  return p;
+}
+
+bool Arena::owns(const void* p) const {
+  auto c = static_cast<const char*>(p);
+  for (const Chunk* chunk = head_; chunk; chunk = chunk->next) {
+    const char* begin =
+        reinterpret_cast<const char*>(chunk) + alignUp(sizeof(Chunk));
+    if (c >= begin && c < begin + chunk->size)
+      return true;
+  }
+  return false;
+}
+
+void Arena::reset() {
+  // One regular chunk stays, so a parse/reset loop does not touch the heap
+  Chunk* keep = nullptr;
+  while (head_) {
+    Chunk* next = head_->next;
+    if (keep == nullptr && head_->size == chunkSize_) {
+      keep = head_;
+    } else {
+      free(head_);
+    }
+    head_ = next;
+  }
+  head_ = keep;
+  chunks_ = 0;
+  reserved_ = 0;
+  if (keep) {
+    keep->next = nullptr;
+    keep->used = 0;
+    chunks_ = 1;
+    reserved_ = alignUp(sizeof(Chunk)) + keep->size;
+  }
+  used_ = 0;
+  failures_ = 0;
+}
+
+Arena* Arena::current() { return tCurrentArena; }
+
+ArenaScope::ArenaScope(Arena* arena) : previous_(tCurrentArena) {
+  if (arena != nullptr)
+    tCurrentArena = arena;
+}
+
+ArenaScope::~ArenaScope() { tCurrentArena = previous_; }
+
+} // namespace Json
@@ -0,0 +1,427 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+// Double to text without floating point arithmetic (the ESP32-C3 has no FPU,
+// so every double operation in snprintf is a soft-float call):
+// - writeShortestDouble(): Grisu2 (Florian Loitsch, "Printing Floating-Point
+//   Numbers Quickly and Accurately with Integers", PLDI 2010). The output
+//   always reads back as the same double; it is the shortest such string,
+//   with the closest digits, for all but ~0.1% of the inputs (one or two
+//   digits more, or a last digit off by one). A shortest text lying exactly
+//   halfway to the next double (1e23) is never chosen.
+// - writeFixedDouble(): "%.*f" for a few decimals, exact, in 64-bit integers.
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "json_tool.h"
+#include <writer.h>
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstdint>
+#include <cstring>
+
+namespace Json {
+
+namespace {
+
+const uint32_t kPow10[] = {1,      10,      100,      1000,      10000,
+                           100000, 1000000, 10000000, 100000000, 1000000000};
+
+// Up to 10^19 for the fractional digits, where the scale outgrows 32 bits
+const uint64_t kPow10U64[] = {UINT64_C(1),
+                              UINT64_C(10),
+                              UINT64_C(100),
+                              UINT64_C(1000),
+                              UINT64_C(10000),
+                              UINT64_C(100000),
+                              UINT64_C(1000000),
+                              UINT64_C(10000000),
+                              UINT64_C(100000000),
+                              UINT64_C(1000000000),
+                              UINT64_C(10000000000),
+                              UINT64_C(100000000000),
+                              UINT64_C(1000000000000),
+                              UINT64_C(10000000000000),
+                              UINT64_C(100000000000000),
+                              UINT64_C(1000000000000000),
+                              UINT64_C(10000000000000000),
+                              UINT64_C(100000000000000000),
+                              UINT64_C(1000000000000000000),
+                              UINT64_C(10000000000000000000)};
+
+const uint64_t kHiddenBit = UINT64_C(0x0010000000000000);
+const uint64_t kSignificandMask = UINT64_C(0x000FFFFFFFFFFFFF);
+const int kExponentBias = 0x3FF + 52;
+
+uint64_t doubleBits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/// f * 2^e, with a 64-bit significand.
+struct DiyFp {
+  uint64_t f;
+  int e;
+
+  DiyFp() : f(0), e(0) {}
+  DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+  explicit DiyFp(double d) {
+    uint64_t bits = doubleBits(d);
+    int biasedE = static_cast<int>((bits >> 52) & 0x7FF);
+    uint64_t significand = bits & kSignificandMask;
+    if (biasedE != 0) {
+      f = significand + kHiddenBit;
+      e = biasedE - kExponentBias;
+    } else {
+      f = significand;
+      e = 1 - kExponentBias;
+    }
+  }
+
+  DiyFp operator-(const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+
+  // Upper 64 bits of the 128-bit product, rounded
+  DiyFp operator*(const DiyFp& rhs) const {
+    const uint64_t M32 = 0xFFFFFFFF;
+    uint64_t a = f >> 32, b = f & M32, c = rhs.f >> 32, d = rhs.f & M32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += uint64_t(1) << 31;
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+  }
+
+  DiyFp normalize() const {
+    DiyFp res = *this;
+    while (!(res.f & (kHiddenBit << 11))) {
+      res.f <<= 1;
+      res.e--;
+    }
+    return res;
+  }
+
+  // Boundaries m- and m+ of the rounding interval, normalized to m+'s exponent
+  void normalizedBoundaries(DiyFp* minus, DiyFp* plus) const {
+    DiyFp pl = DiyFp((f << 1) + 1, e - 1);
+    while (!(pl.f & (kHiddenBit << 1))) {
+      pl.f <<= 1;
+      pl.e--;
+    }
+    pl.f <<= 10;
+    pl.e -= 10;
+    DiyFp mi = (f == kHiddenBit) ? DiyFp((f << 2) - 1, e - 2)
+                                 : DiyFp((f << 1) - 1, e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus = pl;
+    *minus = mi;
+  }
+};
+
+// 10^k for k = -348, -340, ..., 340, normalized (64-bit significand)
+const uint64_t kCachedPowersF[] = {
+    UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76),
+    UINT64_C(0x8b16fb203055ac76), UINT64_C(0xcf42894a5dce35ea),
+    UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f),
+    UINT64_C(0xbe5691ef416bd60c), UINT64_C(0x8dd01fad907ffc3c),
+    UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d),
+    UINT64_C(0x823c12795db6ce57), UINT64_C(0xc21094364dfb5637),
+    UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+    UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5),
+    UINT64_C(0xb23867fb2a35b28e), UINT64_C(0x84c8d4dfd2c63f3b),
+    UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+    UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6),
+    UINT64_C(0xf3e2f893dec3f126), UINT64_C(0xb5b5ada8aaff80b8),
+    UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd),
+    UINT64_C(0xa6dfbd9fb8e5b88f), UINT64_C(0xf8a95fcf88747d94),
+    UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac),
+    UINT64_C(0xe45c10c42a2b3b06), UINT64_C(0xaa242499697392d3),
+    UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+    UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c),
+    UINT64_C(0x9c40000000000000), UINT64_C(0xe8d4a51000000000),
+    UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70),
+    UINT64_C(0xd5d238a4abe98068), UINT64_C(0x9f4f2726179a2245),
+    UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a),
+    UINT64_C(0x924d692ca61be758), UINT64_C(0xda01ee641a708dea),
+    UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2),
+    UINT64_C(0xc83553c5c8965d3d), UINT64_C(0x952ab45cfa97a0b3),
+    UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+    UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece),
+    UINT64_C(0x88fcf317f22241e2), UINT64_C(0xcc20ce9bd35c78a5),
+    UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c),
+    UINT64_C(0xbb764c4ca7a44410), UINT64_C(0x8bab8eefb6409c1a),
+    UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429),
+    UINT64_C(0x80444b5e7aa7cf85), UINT64_C(0xbf21e44003acdd2d),
+    UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+    UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9),
+    UINT64_C(0xaf87023b9bf0ee6b)
+};
+const int16_t kCachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+    -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369,
+    -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77,
+    -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216,
+    242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508,
+    534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800,
+    827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066
+};
+
+// c = 10^-K such that w * c has its exponent in [-60, -32]
+DiyFp cachedPower(int e, int* K) {
+  // k = ceil((-61 - e) * log10(2)) + 347, in integers:
+  // floor(x * log10(2)) == (x * 78913) >> 18 for |x| < 1650
+  int x = -61 - e;
+  int k = ((x * 78913) >> 18) + 347 + (x != 0 ? 1 : 0);
+  unsigned index = static_cast<unsigned>((k >> 3) + 1);
+  *K = -(-348 + static_cast<int>(index << 3));
+  return DiyFp(kCachedPowersF[index], kCachedPowersE[index]);
+}
+
+void grisuRound(char* buffer, int len, uint64_t delta, uint64_t rest,
+                uint64_t tenKappa, uint64_t wpW) {
+  while (rest < wpW && delta - rest >= tenKappa &&
+         (rest + tenKappa < wpW || wpW - rest > rest + tenKappa - wpW)) {
+    buffer[len - 1]--;
+    rest += tenKappa;
+  }
+}
+
+int countDecimalDigits(uint32_t n) {
+  int digits = 1;
+  while (digits < 10 && n >= kPow10[digits])
+    ++digits;
+  return digits;
+}
+
+void digitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer,
+              int* len, int* K) {
+  const DiyFp one(uint64_t(1) << -Mp.e, Mp.e);
+  const DiyFp wpW = Mp - W;
+  uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = countDecimalDigits(p1);
+  *len = 0;
+
+  while (kappa > 0) {
+    uint32_t div = kPow10[kappa - 1];
+    uint32_t d = p1 / div;
+    p1 %= div;
+    if (d || *len)
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    kappa--;
+    uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (tmp <= delta) {
+      *K += kappa;
+      grisuRound(buffer, *len, delta, tmp,
+                 static_cast<uint64_t>(kPow10[kappa]) << -one.e, wpW.f);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = static_cast<char>(p2 >> -one.e);
+    if (d || *len)
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *K += kappa;
+      int index = -kappa;
+      grisuRound(buffer, *len, delta, p2, one.f,
+                 wpW.f * (index < 20 ? kPow10U64[index] : 0));
+      return;
+    }
+  }
+}
+
+// Digits (no sign, no leading zeros) and decimal exponent: v = digits * 10^K
+void grisu2(double value, char* buffer, int* length, int* K) {
+  const DiyFp v(value);
+  DiyFp wm, wp;
+  v.normalizedBoundaries(&wm, &wp);
+  const DiyFp cmk = cachedPower(wp.e, K);
+  const DiyFp W = v.normalize() * cmk;
+  DiyFp Wp = wp * cmk;
+  DiyFp Wm = wm * cmk;
+  Wm.f++;
+  Wp.f--;
+  digitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+char* writeExponent(int K, char* out) {
+  *out++ = 'e';
+  if (K < 0) {
+    *out++ = '-';
+    K = -K;
+  } else {
+    *out++ = '+';
+  }
+  // Two digits at least, like "%g"
+  if (K >= 100) {
+    *out++ = static_cast<char>('0' + K / 100);
+    K %= 100;
+  }
+  *out++ = static_cast<char>('0' + K / 10);
+  *out++ = static_cast<char>('0' + K % 10);
+  return out;
+}
+
+// digits * 10^k as a JSON number that still reads back as a real ("1.0")
+char* prettify(char* buffer, int length, int k, char* out) {
+  const int kk = length + k; // 10^(kk-1) <= v < 10^kk
+  if (k >= 0 && kk <= 21) {
+    // 1234e7 -> 12340000000.0
+    std::memcpy(out, buffer, static_cast<size_t>(length));
+    out += length;
+    for (int i = length; i < kk; i++)
+      *out++ = '0';
+    *out++ = '.';
+    *out++ = '0';
+  } else if (0 < kk && kk <= 21) {
+    // 1234e-2 -> 12.34
+    std::memcpy(out, buffer, static_cast<size_t>(kk));
+    out += kk;
+    *out++ = '.';
+    std::memcpy(out, buffer + kk, static_cast<size_t>(length - kk));
+    out += length - kk;
+  } else if (-6 < kk && kk <= 0) {
+    // 1234e-6 -> 0.001234
+    *out++ = '0';
+    *out++ = '.';
+    for (int i = kk; i < 0; i++)
+      *out++ = '0';
+    std::memcpy(out, buffer, static_cast<size_t>(length));
+    out += length;
+  } else if (length == 1) {
+    // 1e30 -> 1e+30
+    *out++ = buffer[0];
+    out = writeExponent(kk - 1, out);
+  } else {
+    // 1234e30 -> 1.234e+33
+    *out++ = buffer[0];
+    *out++ = '.';
+    std::memcpy(out, buffer + 1, static_cast<size_t>(length - 1));
+    out += length - 1;
+    out = writeExponent(kk - 1, out);
+  }
+  return out;
+}
+
+} // namespace
+
+size_t writeShortestDouble(double value, char* out) {
+  char* start = out;
+  uint64_t bits = doubleBits(value);
+  if (bits >> 63)
+    *out++ = '-';
+  if ((bits & ~(uint64_t(1) << 63)) == 0) {
+    std::memcpy(out, "0.0", 4);
+    return static_cast<size_t>(out + 3 - start);
+  }
+  char digits[20];
+  int length = 0;
+  int K = 0;
+  grisu2(bits >> 63 ? -value : value, digits, &length, &K);
+  out = prettify(digits, length, K, out);
+  *out = '\0';
+  return static_cast<size_t>(out - start);
+}
+
+bool writeFixedDouble(double value, unsigned int decimals, char* out,
+                      size_t* length) {
+  if (decimals >= sizeof(kPow10) / sizeof(kPow10[0]))
+    return false;
+  uint64_t bits = doubleBits(value);
+  int biasedE = static_cast<int>((bits >> 52) & 0x7FF);
+  if (biasedE == 0x7FF)
+    return false;
+  uint64_t m = bits & kSignificandMask;
+  int e;
+  if (biasedE != 0) {
+    m += kHiddenBit;
+    e = biasedE - kExponentBias;
+  } else {
+    e = 1 - kExponentBias;
+  }
+  const uint64_t scale = kPow10[decimals];
+
+  // q = value * 10^decimals rounded half to even, like printf
+  uint64_t q;
+  if (e >= 0) {
+    if (e > 10 || m > (UINT64_MAX >> e) / scale)
+      return false; // too big for 64 bits: leave it to snprintf
+    q = (m << e) * scale;
+  } else {
+    // product = m * 10^decimals (< 2^83) as hi:lo, then q = product >> shift
+    const uint64_t M32 = 0xFFFFFFFF;
+    uint64_t high = (m >> 32) * scale, low = (m & M32) * scale;
+    uint64_t lo = low + (high << 32);
+    uint64_t hi = (high >> 32) + (lo < low ? 1 : 0);
+    int shift = -e;
+    if (shift >= 128) {
+      q = 0; // below one half
+    } else {
+      uint64_t restHi, restLo, halfHi, halfLo;
+      if (shift < 64) {
+        if (hi >> shift)
+          return false; // q does not fit in 64 bits
+        q = (hi << (64 - shift)) | (lo >> shift);
+        restHi = 0;
+        restLo = lo & ((uint64_t(1) << shift) - 1);
+        halfHi = 0;
+        halfLo = uint64_t(1) << (shift - 1);
+      } else {
+        int s = shift - 64;
+        q = hi >> s;
+        restHi = hi & ((uint64_t(1) << s) - 1);
+        restLo = lo;
+        halfHi = s ? uint64_t(1) << (s - 1) : 0;
+        halfLo = s ? 0 : uint64_t(1) << 63;
+      }
+      bool tie = restHi == halfHi && restLo == halfLo;
+      if (restHi > halfHi || (restHi == halfHi && restLo > halfLo) ||
+          (tie && (q & 1))) {
+        if (++q == 0)
+          return false;
+      }
+    }
+  }
+
+  char* start = out;
+  if (bits >> 63)
+    *out++ = '-';
+  UIntToStringBuffer intBuffer;
+  char* current = intBuffer + sizeof(intBuffer);
+  uintToString(static_cast<LargestUInt>(q / scale), current);
+  size_t intLength =
+      static_cast<size_t>(intBuffer + sizeof(intBuffer) - current) - 1;
+  std::memcpy(out, current, intLength);
+  out += intLength;
+  if (decimals > 0) {
+    *out++ = '.';
+    uint32_t frac = static_cast<uint32_t>(q % scale);
+    for (unsigned int i = decimals; i > 0; --i) {
+      out[i - 1] = static_cast<char>('0' + frac % 10);
+      frac /= 10;
+    }
+    out += decimals;
+  }
+  *out = '\0';
+  *length = static_cast<size_t>(out - start);
+  return true;
+}
+
+} // namespace Json
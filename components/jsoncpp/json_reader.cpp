@@ -111,6 +111,7 @@ bool Reader::parse(std::istream& is, Value& root, bool collectComments) {
 
 bool Reader::parse(const char* beginDoc, const char* endDoc, Value& root,
                    bool collectComments) {
+  ArenaScope arenaScope(arena_);
   if (!features_.allowComments_) {
     collectComments = false;
   }
@@ -599,17 +600,9 @@ bool Reader::decodeDouble(Token& token) {
 
 bool Reader::decodeDouble(Token& token, Value& decoded) {
   double value = 0;
-  String buffer(token.start_, token.end_);
-  IStringStream is(buffer);
-  if (!(is >> value)) {
-    if (value == std::numeric_limits<double>::max())
-      value = std::numeric_limits<double>::infinity();
-    else if (value == std::numeric_limits<double>::lowest())
-      value = -std::numeric_limits<double>::infinity();
-    else if (!std::isinf(value))
-      return addError(
+  if (!parseDouble(token.start_, token.end_, &value))
+    return addError(
         "'" + String(token.start_, token.end_) + "' is not a number.", token);
-  }
   decoded = value;
   return true;
 }
@@ -1651,17 +1644,9 @@ bool OurReader::decodeDouble(Token& token) {
 
 bool OurReader::decodeDouble(Token& token, Value& decoded) {
   double value = 0;
-  const String buffer(token.start_, token.end_);
-  IStringStream is(buffer);
-  if (!(is >> value)) {
-    if (value == std::numeric_limits<double>::max())
-      value = std::numeric_limits<double>::infinity();
-    else if (value == std::numeric_limits<double>::lowest())
-      value = -std::numeric_limits<double>::infinity();
-    else if (!std::isinf(value))
-      return addError(
+  if (!parseDouble(token.start_, token.end_, &value))
+    return addError(
         "'" + String(token.start_, token.end_) + "' is not a number.", token);
-  }
   decoded = value;
   return true;
 }
@@ -1874,14 +1859,20 @@ std::vector<OurReader::StructuredError> OurReader::getStructuredErrors() const {
 
 class OurCharReader : public CharReader {
   bool const collectComments_;
+  Arena* const arena_;
   OurReader reader_;
 
 public:
-  OurCharReader(bool collectComments, OurFeatures const& features)
-      : collectComments_(collectComments), reader_(features) {}
+  OurCharReader(bool collectComments, OurFeatures const& features,
+                Arena* arena)
+      : collectComments_(collectComments), arena_(arena), reader_(features) {}
   bool parse(char const* beginDoc, char const* endDoc, Value* root,
              String* errs) override {
-    bool ok = reader_.parse(beginDoc, endDoc, *root, collectComments_);
+    bool ok;
+    {
+      ArenaScope arenaScope(arena_);
+      ok = reader_.parse(beginDoc, endDoc, *root, collectComments_);
+    }
     if (errs) {
       *errs = reader_.getFormattedErrorMessages();
     }
@@ -1909,7 +1900,7 @@ CharReader* CharReaderBuilder::newCharReader() const {
   features.rejectDupKeys_ = settings_["rejectDupKeys"].asBool();
   features.allowSpecialFloats_ = settings_["allowSpecialFloats"].asBool();
   features.skipBom_ = settings_["skipBom"].asBool();
-  return new OurCharReader(collectComments, features);
+  return new OurCharReader(collectComments, features, arena_);
 }
 
 bool CharReaderBuilder::validate(Json::Value* invalid) const {
@@ -0,0 +1,679 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "json_tool.h"
+#include <stream_reader.h>
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstdlib>
+#include <cstring>
+
+namespace Json {
+
+// //////////////////////////////////////////////////////////////////
+// StreamHandler
+// //////////////////////////////////////////////////////////////////
+
+StreamHandler::~StreamHandler() = default;
+bool StreamHandler::key(const char*, size_t) { return true; }
+bool StreamHandler::string(const char*, size_t) { return true; }
+bool StreamHandler::number(const char*, size_t) { return true; }
+bool StreamHandler::boolean(bool) { return true; }
+
+// //////////////////////////////////////////////////////////////////
+// StreamReader
+// //////////////////////////////////////////////////////////////////
+
+StreamReader::StreamReader(StreamHandler& handler, unsigned maxDepth)
+    : handler_(handler), maxDepth_(maxDepth) {}
+
+StreamReader::StreamReader(StreamHandler& handler, char* scratch,
+                           size_t scratchSize, unsigned maxDepth)
+    : handler_(handler), maxDepth_(maxDepth), scratch_(scratch),
+      scratchSize_(scratchSize) {
+  // The first maxDepth bytes hold the container stack, the rest the token.
+  if (scratchSize_ <= maxDepth_)
+    maxDepth_ = scratchSize_ ? static_cast<unsigned>(scratchSize_ - 1) : 0;
+}
+
+void StreamReader::reset() {
+  stack_.clear();
+  depth_ = 0;
+  expect_ = expectValue;
+  lex_ = lexNone;
+  isKey_ = false;
+  escape_ = false;
+  unicodeDigits_ = -1;
+  codePoint_ = 0;
+  highSurrogate_ = 0;
+  literal_ = nullptr;
+  literalPos_ = 0;
+  clearToken();
+  error_.clear();
+  offset_ = 0;
+  failed_ = false;
+  handler_.reset();
+}
+
+bool StreamReader::fail(const char* message) {
+  if (!failed_) {
+    failed_ = true;
+    error_ = message;
+  }
+  return false;
+}
+
+bool StreamReader::feed(const char* data, size_t len) {
+  return consume(data, len, nullptr);
+}
+
+bool StreamReader::parseInSitu(char* doc, size_t len) {
+  return consume(doc, len, doc) && finish();
+}
+
+// inSitu: data itself, writable, when the strings can stay in it
+bool StreamReader::consume(const char* data, size_t len, char* inSitu) {
+  if (failed_)
+    return false;
+  for (size_t i = 0; i < len;) {
+    // Plain string content is copied in runs instead of char by char.
+    if (lex_ == lexString && !escape_ && unicodeDigits_ < 0 && !highSurrogate_) {
+      size_t end = i;
+      while (end < len && data[end] != '"' && data[end] != '\\' &&
+             static_cast<unsigned char>(data[end]) >= 0x20)
+        ++end;
+      if (inSitu && tokenSize() == 0 && end < len && data[end] == '"') {
+        // The whole string, without escapes: it stays where it is
+        inSitu[end] = '\0';
+        if (!endString(data + i, end - i, true))
+          return false;
+        offset_ += end + 1 - i;
+        i = end + 1;
+        continue;
+      }
+      if (end > i) {
+        if (!appendTokenRun(data + i, end - i))
+          return false;
+        offset_ += end - i;
+        i = end;
+        continue;
+      }
+    }
+    if (!step(data[i]))
+      return false;
+    ++offset_;
+    ++i;
+  }
+  return true;
+}
+
+bool StreamReader::finish() {
+  if (failed_)
+    return false;
+  // A top-level number has no terminator other than end of input.
+  if (lex_ == lexNumber && !endNumber())
+    return false;
+  if (!complete())
+    return fail("Unexpected end of input");
+  return true;
+}
+
+bool StreamReader::step(char c) {
+  switch (lex_) {
+  case lexString:
+    return stringChar(c);
+  case lexLiteral:
+    return literalChar(c);
+  case lexNumber:
+    if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' ||
+        c == '+' || c == '-')
+      return appendToken(c);
+    if (!endNumber())
+      return false;
+    break; // c still has to be handled as a structural character
+  case lexNone:
+    break;
+  }
+  return structural(c);
+}
+
+bool StreamReader::structural(char c) {
+  if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+    return true;
+
+  const bool wantValue = expect_ == expectValue || expect_ == expectValueOrArrayEnd;
+  switch (c) {
+  case '{':
+    if (!wantValue)
+      return fail("Unexpected '{'");
+    if (!push('{'))
+      return false;
+    if (!handler_.startObject())
+      return fail("Aborted by handler");
+    expect_ = expectKeyOrEnd;
+    return true;
+  case '[':
+    if (!wantValue)
+      return fail("Unexpected '['");
+    if (!push('['))
+      return false;
+    if (!handler_.startArray())
+      return fail("Aborted by handler");
+    expect_ = expectValueOrArrayEnd;
+    return true;
+  case '}':
+    if (expect_ != expectKeyOrEnd && expect_ != expectCommaOrObjectEnd)
+      return fail("Unexpected '}'");
+    pop();
+    if (!handler_.endObject())
+      return fail("Aborted by handler");
+    return afterValue();
+  case ']':
+    if (expect_ != expectValueOrArrayEnd && expect_ != expectCommaOrArrayEnd)
+      return fail("Unexpected ']'");
+    pop();
+    if (!handler_.endArray())
+      return fail("Aborted by handler");
+    return afterValue();
+  case ',':
+    if (expect_ == expectCommaOrObjectEnd)
+      expect_ = expectKey;
+    else if (expect_ == expectCommaOrArrayEnd)
+      expect_ = expectValue;
+    else
+      return fail("Unexpected ','");
+    return true;
+  case ':':
+    if (expect_ != expectColon)
+      return fail("Unexpected ':'");
+    expect_ = expectValue;
+    return true;
+  case '"':
+    if (expect_ == expectKeyOrEnd || expect_ == expectKey)
+      isKey_ = true;
+    else if (wantValue)
+      isKey_ = false;
+    else
+      return fail("Unexpected string");
+    lex_ = lexString;
+    clearToken();
+    return true;
+  case 't':
+  case 'f':
+  case 'n':
+    if (!wantValue)
+      return fail("Unexpected literal");
+    literal_ = c == 't' ? "true" : c == 'f' ? "false" : "null";
+    literalPos_ = 1;
+    lex_ = lexLiteral;
+    return true;
+  default:
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      if (!wantValue)
+        return fail("Unexpected number");
+      clearToken();
+      lex_ = lexNumber;
+      return appendToken(c);
+    }
+    return fail("Syntax error: value, object or array expected.");
+  }
+}
+
+bool StreamReader::push(char container) {
+  if (depth() >= maxDepth_)
+    return fail("Exceeded stackLimit.");
+  if (scratch_)
+    scratch_[depth_++] = container;
+  else
+    stack_.push_back(container);
+  return true;
+}
+
+void StreamReader::pop() {
+  if (scratch_)
+    --depth_;
+  else
+    stack_.pop_back();
+}
+
+size_t StreamReader::depth() const {
+  return scratch_ ? depth_ : stack_.size();
+}
+
+char StreamReader::top() const {
+  return scratch_ ? scratch_[depth_ - 1] : stack_.back();
+}
+
+bool StreamReader::afterValue() {
+  lex_ = lexNone;
+  if (depth() == 0)
+    expect_ = expectDone;
+  else if (top() == '{')
+    expect_ = expectCommaOrObjectEnd;
+  else
+    expect_ = expectCommaOrArrayEnd;
+  return true;
+}
+
+void StreamReader::clearToken() {
+  if (scratch_)
+    tokenLen_ = 0;
+  else
+    token_.clear();
+}
+
+const char* StreamReader::tokenData() const {
+  return scratch_ ? scratch_ + maxDepth_ : token_.data();
+}
+
+size_t StreamReader::tokenSize() const {
+  return scratch_ ? tokenLen_ : token_.size();
+}
+
+bool StreamReader::appendToken(char c) {
+  if (!scratch_) {
+    token_ += c;
+    return true;
+  }
+  if (maxDepth_ + tokenLen_ >= scratchSize_)
+    return fail("Token exceeds the scratch buffer");
+  scratch_[maxDepth_ + tokenLen_++] = c;
+  return true;
+}
+
+bool StreamReader::appendTokenRun(const char* data, size_t len) {
+  if (!scratch_) {
+    token_.append(data, len);
+    return true;
+  }
+  if (maxDepth_ + tokenLen_ + len > scratchSize_)
+    return fail("Token exceeds the scratch buffer");
+  std::memcpy(scratch_ + maxDepth_ + tokenLen_, data, len);
+  tokenLen_ += len;
+  return true;
+}
+
+bool StreamReader::appendCodePoint(unsigned int cp) {
+  if (cp <= 0x7F)
+    return appendToken(static_cast<char>(cp));
+  if (cp <= 0x7FF)
+    return appendToken(static_cast<char>(0xC0 | (cp >> 6))) &&
+           appendToken(static_cast<char>(0x80 | (cp & 0x3F)));
+  if (cp <= 0xFFFF)
+    return appendToken(static_cast<char>(0xE0 | (cp >> 12))) &&
+           appendToken(static_cast<char>(0x80 | ((cp >> 6) & 0x3F))) &&
+           appendToken(static_cast<char>(0x80 | (cp & 0x3F)));
+  return appendToken(static_cast<char>(0xF0 | (cp >> 18))) &&
+         appendToken(static_cast<char>(0x80 | ((cp >> 12) & 0x3F))) &&
+         appendToken(static_cast<char>(0x80 | ((cp >> 6) & 0x3F))) &&
+         appendToken(static_cast<char>(0x80 | (cp & 0x3F)));
+}
+
+bool StreamReader::stringChar(char c) {
+  if (unicodeDigits_ >= 0) {
+    unsigned int digit;
+    if (c >= '0' && c <= '9')
+      digit = static_cast<unsigned int>(c - '0');
+    else if (c >= 'a' && c <= 'f')
+      digit = static_cast<unsigned int>(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F')
+      digit = static_cast<unsigned int>(c - 'A' + 10);
+    else
+      return fail("Bad unicode escape sequence in string: hexadecimal digit expected.");
+    codePoint_ = (codePoint_ << 4) | digit;
+    if (++unicodeDigits_ < 4)
+      return true;
+    unicodeDigits_ = -1;
+    if (highSurrogate_) {
+      if (codePoint_ < 0xDC00 || codePoint_ > 0xDFFF)
+        return fail("expecting another \\u token to begin the second half of a unicode surrogate pair");
+      unsigned int cp = 0x10000 + ((highSurrogate_ & 0x3FF) << 10) + (codePoint_ & 0x3FF);
+      highSurrogate_ = 0;
+      return appendCodePoint(cp);
+    }
+    if (codePoint_ >= 0xD800 && codePoint_ <= 0xDBFF) {
+      highSurrogate_ = codePoint_;
+      return true;
+    }
+    return appendCodePoint(codePoint_);
+  }
+
+  if (escape_) {
+    escape_ = false;
+    if (highSurrogate_ && c != 'u')
+      return fail("expecting another \\u token to begin the second half of a unicode surrogate pair");
+    switch (c) {
+    case '"': return appendToken('"');
+    case '\\': return appendToken('\\');
+    case '/': return appendToken('/');
+    case 'b': return appendToken('\b');
+    case 'f': return appendToken('\f');
+    case 'n': return appendToken('\n');
+    case 'r': return appendToken('\r');
+    case 't': return appendToken('\t');
+    case 'u':
+      unicodeDigits_ = 0;
+      codePoint_ = 0;
+      return true;
+    default:
+      return fail("Bad escape sequence in string");
+    }
+  }
+
+  if (highSurrogate_ && c != '\\')
+    return fail("expecting another \\u token to begin the second half of a unicode surrogate pair");
+  if (c == '\\') {
+    escape_ = true;
+    return true;
+  }
+  if (c == '"')
+    return endString(tokenData(), tokenSize(), false);
+  if (static_cast<unsigned char>(c) < 0x20)
+    return fail("Control character in string");
+  return appendToken(c);
+}
+
+bool StreamReader::endString(const char* str, size_t len, bool inSitu) {
+  bool ok;
+  if (isKey_)
+    ok = inSitu ? handler_.keyInSitu(str, len) : handler_.key(str, len);
+  else
+    ok = inSitu ? handler_.stringInSitu(str, len) : handler_.string(str, len);
+  if (!ok)
+    return fail("Aborted by handler");
+  if (isKey_) {
+    lex_ = lexNone;
+    expect_ = expectColon;
+    return true;
+  }
+  return afterValue();
+}
+
+bool StreamReader::literalChar(char c) {
+  if (c != literal_[literalPos_])
+    return fail("Syntax error: value, object or array expected.");
+  if (literal_[++literalPos_] != '\0')
+    return true;
+  bool ok = literal_[0] == 't'   ? handler_.boolean(true)
+            : literal_[0] == 'f' ? handler_.boolean(false)
+                                 : handler_.null();
+  if (!ok)
+    return fail("Aborted by handler");
+  return afterValue();
+}
+
+bool StreamReader::endNumber() {
+  if (!validNumber(tokenData(), tokenSize()))
+    return fail("Syntax error: malformed number.");
+  if (!handler_.number(tokenData(), tokenSize()))
+    return fail("Aborted by handler");
+  return afterValue();
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+bool StreamReader::validNumber(const char* str, size_t len) {
+  size_t i = 0;
+  auto digits = [&]() {
+    size_t start = i;
+    while (i < len && str[i] >= '0' && str[i] <= '9')
+      ++i;
+    return i > start;
+  };
+  if (i < len && str[i] == '-')
+    ++i;
+  if (i < len && str[i] == '0')
+    ++i;
+  else if (!digits())
+    return false;
+  if (i < len && str[i] == '.') {
+    ++i;
+    if (!digits())
+      return false;
+  }
+  if (i < len && (str[i] == 'e' || str[i] == 'E')) {
+    ++i;
+    if (i < len && (str[i] == '+' || str[i] == '-'))
+      ++i;
+    if (!digits())
+      return false;
+  }
+  return i == len;
+}
+
+// //////////////////////////////////////////////////////////////////
+// ValueBuilder
+// //////////////////////////////////////////////////////////////////
+
+ValueBuilder::ValueBuilder(Value& root, Arena* arena)
+    : root_(root), arena_(arena) {}
+
+void ValueBuilder::reset() {
+  nodes_.clear();
+  key_.clear();
+  keyInSitu_ = nullptr;
+  root_ = Value();
+}
+
+Value* ValueBuilder::slot() {
+  if (nodes_.empty())
+    return &root_;
+  Value* parent = nodes_.back();
+  if (parent->isArray())
+    return &parent->append(Value());
+  if (keyInSitu_)
+    return &(*parent)[StaticString(keyInSitu_)];
+  return &(*parent)[key_];
+}
+
+bool ValueBuilder::put(Value&& value) {
+  ArenaScope arenaScope(arena_);
+  Value* target = slot();
+  target->swapPayload(value);
+  return true;
+}
+
+bool ValueBuilder::startObject() {
+  ArenaScope arenaScope(arena_);
+  Value* target = slot();
+  *target = Value(objectValue);
+  nodes_.push_back(target);
+  return true;
+}
+
+bool ValueBuilder::endObject() {
+  nodes_.pop_back();
+  return true;
+}
+
+bool ValueBuilder::startArray() {
+  ArenaScope arenaScope(arena_);
+  Value* target = slot();
+  *target = Value(arrayValue);
+  nodes_.push_back(target);
+  return true;
+}
+
+bool ValueBuilder::endArray() {
+  nodes_.pop_back();
+  return true;
+}
+
+bool ValueBuilder::key(const char* str, size_t len) {
+  key_.assign(str, len);
+  keyInSitu_ = nullptr;
+  return true;
+}
+
+bool ValueBuilder::keyInSitu(const char* str, size_t) {
+  keyInSitu_ = str;
+  return true;
+}
+
+bool ValueBuilder::string(const char* str, size_t len) {
+  ArenaScope arenaScope(arena_);
+  return put(Value(str, str + len));
+}
+
+bool ValueBuilder::number(const char* str, size_t len) {
+  Value decoded;
+  if (!decodeNumber(str, len, decoded))
+    return false;
+  return put(std::move(decoded));
+}
+
+bool ValueBuilder::stringInSitu(const char* str, size_t) {
+  return put(Value(StaticString(str)));
+}
+
+bool ValueBuilder::boolean(bool value) { return put(Value(value)); }
+
+bool ValueBuilder::null() { return put(Value()); }
+
+bool ValueBuilder::decodeNumber(const char* str, size_t len, Value& decoded) {
+  const char* current = str;
+  const char* end = str + len;
+  bool isNegative = *current == '-';
+  if (isNegative)
+    ++current;
+  Value::LargestUInt maxIntegerValue =
+      isNegative ? Value::LargestUInt(Value::maxLargestInt) + 1
+                 : Value::maxLargestUInt;
+  Value::LargestUInt threshold = maxIntegerValue / 10;
+  Value::LargestUInt value = 0;
+  bool isInteger = true;
+  while (current < end) {
+    char c = *current++;
+    if (c < '0' || c > '9') {
+      isInteger = false;
+      break;
+    }
+    auto digit(static_cast<Value::UInt>(c - '0'));
+    if (value >= threshold &&
+        (value > threshold || current != end || digit > maxIntegerValue % 10)) {
+      isInteger = false;
+      break;
+    }
+    value = value * 10 + digit;
+  }
+  if (isInteger) {
+    if (isNegative && value == maxIntegerValue)
+      decoded = Value::minLargestInt;
+    else if (isNegative)
+      decoded = -Value::LargestInt(value);
+    else if (value <= Value::LargestUInt(Value::maxInt))
+      decoded = Value::LargestInt(value);
+    else
+      decoded = value;
+    return true;
+  }
+
+  double d = 0;
+  if (!parseDouble(str, str + len, &d))
+    return false;
+  decoded = d;
+  return true;
+}
+
+// //////////////////////////////////////////////////////////////////
+// FieldExtractor
+// //////////////////////////////////////////////////////////////////
+
+FieldExtractor::FieldExtractor(Field* fields, size_t count)
+    : fields_(fields), count_(count) {
+  reset();
+}
+
+void FieldExtractor::reset() {
+  for (size_t i = 0; i < count_; ++i) {
+    fields_[i].found = false;
+    fields_[i].truncated = false;
+    if (fields_[i].out && fields_[i].capacity)
+      fields_[i].out[0] = '\0';
+  }
+  current_ = nullptr;
+  depth_ = 0;
+}
+
+bool FieldExtractor::startObject() {
+  current_ = nullptr;
+  ++depth_;
+  return true;
+}
+
+bool FieldExtractor::endObject() {
+  --depth_;
+  return true;
+}
+
+bool FieldExtractor::startArray() {
+  current_ = nullptr;
+  ++depth_;
+  return true;
+}
+
+bool FieldExtractor::endArray() {
+  --depth_;
+  return true;
+}
+
+bool FieldExtractor::key(const char* str, size_t len) {
+  current_ = nullptr;
+  if (depth_ != 1)
+    return true;
+  for (size_t i = 0; i < count_; ++i) {
+    const char* name = fields_[i].name;
+    if (std::strlen(name) == len && std::memcmp(name, str, len) == 0) {
+      current_ = &fields_[i];
+      break;
+    }
+  }
+  return true;
+}
+
+bool FieldExtractor::value(const char* str, size_t len) {
+  Field* field = current_;
+  current_ = nullptr;
+  if (!field || depth_ != 1)
+    return true;
+  if (!field->out || len >= field->capacity) {
+    field->truncated = true;
+    field->found = false;
+    if (field->out && field->capacity)
+      field->out[0] = '\0';
+    return true;
+  }
+  std::memcpy(field->out, str, len);
+  field->out[len] = '\0';
+  field->found = true;
+  field->truncated = false;
+  return true;
+}
+
+bool FieldExtractor::string(const char* str, size_t len) {
+  return value(str, len);
+}
+
+bool FieldExtractor::number(const char* str, size_t len) {
+  return value(str, len);
+}
+
+bool FieldExtractor::boolean(bool b) {
+  return b ? value("true", 4) : value("false", 5);
+}
+
+bool FieldExtractor::null() {
+  current_ = nullptr;
+  return true;
+}
+
+bool FieldExtractor::extract(const char* doc, size_t len, Field* fields,
+                             size_t count, char* scratch, size_t scratchSize) {
+  FieldExtractor extractor(fields, count);
+  StreamReader reader(extractor, scratch, scratchSize);
+  reader.feed(doc, len);
+  return reader.finish();
+}
+
+} // namespace Json
@@ -133,6 +133,21 @@ Iter fixZerosInTheEnd(Iter begin, Iter end, unsigned int precision) {
   return end;
 }
 
+/** Writes value as "%.*f" would (C locale), without floating point math.
+ * Returns false, writing nothing, when the fast path does not apply
+ * (decimals > 9, non-finite values, or |value| * 10^decimals >= 2^64):
+ * use snprintf then.
+ * @param out At least 32 chars.
+ */
+bool writeFixedDouble(double value, unsigned int decimals, char* out,
+                      size_t* length);
+
+/** Parses the JSON number in [begin, end) into *value, correctly rounded and
+ * with '.' as decimal point whatever the locale. Out of range values give
+ * +/-infinity or +/-0. Returns false if the range is not a number.
+ */
+bool parseDouble(const char* begin, const char* end, double* value);
+
 } // namespace Json
 
 #endif // LIB_JSONCPP_JSON_TOOL_H_INCLUDED
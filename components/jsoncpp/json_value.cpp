@@ -105,20 +105,39 @@ static inline bool InRange(double d, T min, U max) {
 }
 #endif // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
 
+/** Payload memory: from the current Arena (see ArenaScope) if there is one,
+ * else from the heap.
+ * @param inArena Set to true if the block belongs to the arena (never freed).
+ */
+static inline void* allocatePayload(size_t size, bool* inArena) {
+  Arena* arena = Arena::current();
+  if (arena != nullptr) {
+    void* p = arena->allocate(size);
+    if (p != nullptr) {
+      *inArena = true;
+      return p;
+    }
+  }
+  *inArena = false;
+  return malloc(size);
+}
+
 /** Duplicates the specified string value.
  * @param value Pointer to the string to duplicate. Must be zero-terminated if
  *              length is "unknown".
  * @param length Length of the value. if equals to unknown, then it will be
  *               computed using strlen(value).
+ * @param inArena Set to true if the copy lives in an Arena.
  * @return Pointer on the duplicate instance of string.
  */
-static inline char* duplicateStringValue(const char* value, size_t length) {
+static inline char* duplicateStringValue(const char* value, size_t length,
+                                         bool* inArena) {
   // Avoid an integer overflow in the call to malloc below by limiting length
   // to a sane value.
   if (length >= static_cast<size_t>(Value::maxInt))
     length = Value::maxInt - 1;
 
-  auto newString = static_cast<char*>(malloc(length + 1));
+  auto newString = static_cast<char*>(allocatePayload(length + 1, inArena));
   if (newString == nullptr) {
     throwRuntimeError("in Json::Value::duplicateStringValue(): "
                       "Failed to allocate string value buffer");
@@ -131,7 +150,8 @@ static inline char* duplicateStringValue(const char* value, size_t length) {
 /* Record the length as a prefix.
  */
 static inline char* duplicateAndPrefixStringValue(const char* value,
-                                                  unsigned int length) {
+                                                  unsigned int length,
+                                                  bool* inArena) {
   // Avoid an integer overflow in the call to malloc below by limiting length
   // to a sane value.
   JSON_ASSERT_MESSAGE(length <= static_cast<unsigned>(Value::maxInt) -
@@ -139,7 +159,7 @@ static inline char* duplicateAndPrefixStringValue(const char* value,
                       "in Json::Value::duplicateAndPrefixStringValue(): "
                       "length too big for prefixing");
   size_t actualLength = sizeof(length) + length + 1;
-  auto newString = static_cast<char*>(malloc(actualLength));
+  auto newString = static_cast<char*>(allocatePayload(actualLength, inArena));
   if (newString == nullptr) {
     throwRuntimeError("in Json::Value::duplicateAndPrefixStringValue(): "
                       "Failed to allocate string value buffer");
@@ -244,8 +264,10 @@ Value::CZString::CZString(char const* str, unsigned length,
 }
 
 Value::CZString::CZString(const CZString& other) {
+  bool inArenaCopy = false;
   cstr_ = (other.storage_.policy_ != noDuplication && other.cstr_ != nullptr
-               ? duplicateStringValue(other.cstr_, other.storage_.length_)
+               ? duplicateStringValue(other.cstr_, other.storage_.length_,
+                                      &inArenaCopy)
                : other.cstr_);
   storage_.policy_ =
       static_cast<unsigned>(
@@ -253,7 +275,7 @@ Value::CZString::CZString(const CZString& other) {
               ? (static_cast<DuplicationPolicy>(other.storage_.policy_) ==
                          noDuplication
                      ? noDuplication
-                     : duplicate)
+                     : (inArenaCopy ? inArena : duplicate))
               : static_cast<DuplicationPolicy>(other.storage_.policy_)) &
       3U;
   storage_.length_ = other.storage_.length_;
@@ -363,7 +385,7 @@ Value::Value(ValueType type) {
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues();
+    value_.map_ = newObjectValues(nullptr);
     break;
   case booleanValue:
     value_.bool_ = false;
@@ -402,20 +424,26 @@ Value::Value(const char* value) {
   initBasic(stringValue, true);
   JSON_ASSERT_MESSAGE(value != nullptr,
                       "Null Value Passed to Value Constructor");
+  bool inArena = false;
   value_.string_ = duplicateAndPrefixStringValue(
-      value, static_cast<unsigned>(strlen(value)));
+      value, static_cast<unsigned>(strlen(value)), &inArena);
+  setIsInArena(inArena);
 }
 
 Value::Value(const char* begin, const char* end) {
   initBasic(stringValue, true);
-  value_.string_ =
-      duplicateAndPrefixStringValue(begin, static_cast<unsigned>(end - begin));
+  bool inArena = false;
+  value_.string_ = duplicateAndPrefixStringValue(
+      begin, static_cast<unsigned>(end - begin), &inArena);
+  setIsInArena(inArena);
 }
 
 Value::Value(const String& value) {
   initBasic(stringValue, true);
+  bool inArena = false;
   value_.string_ = duplicateAndPrefixStringValue(
-      value.data(), static_cast<unsigned>(value.length()));
+      value.data(), static_cast<unsigned>(value.length()), &inArena);
+  setIsInArena(inArena);
 }
 
 Value::Value(const StaticString& value) {
@@ -475,6 +503,36 @@ void Value::copy(const Value& other) {
   dupMeta(other);
 }
 
+Value Value::deepCopy() const {
+  Value out;
+  switch (type()) {
+  case stringValue: {
+    char const* begin;
+    char const* end;
+    out = getString(&begin, &end) ? Value(begin, end) : Value(stringValue);
+    break;
+  }
+  case arrayValue:
+    out = Value(arrayValue);
+    for (auto const& item : *value_.map_)
+      out[item.first.index()] = item.second.deepCopy();
+    break;
+  case objectValue:
+    out = Value(objectValue);
+    for (auto const& item : *value_.map_) {
+      char const* key = item.first.data();
+      out.resolveReference(key, key + item.first.length()) =
+          item.second.deepCopy();
+    }
+    break;
+  default:
+    out = *this;
+    break;
+  }
+  out.dupMeta(*this);
+  return out;
+}
+
 ValueType Value::type() const {
   return static_cast<ValueType>(bits_.value_type_);
 }
@@ -968,6 +1026,7 @@ const Value& Value::operator[](int index) const {
 void Value::initBasic(ValueType type, bool allocated) {
   setType(type);
   setIsAllocated(allocated);
+  setIsInArena(false);
   comments_ = Comments{};
   start_ = 0;
   limit_ = 0;
@@ -976,6 +1035,7 @@ void Value::initBasic(ValueType type, bool allocated) {
 void Value::dupPayload(const Value& other) {
   setType(other.type());
   setIsAllocated(false);
+  setIsInArena(false);
   switch (type()) {
   case nullValue:
   case intValue:
@@ -990,15 +1050,17 @@ void Value::dupPayload(const Value& other) {
       char const* str;
       decodePrefixedString(other.isAllocated(), other.value_.string_, &len,
                            &str);
-      value_.string_ = duplicateAndPrefixStringValue(str, len);
+      bool inArena = false;
+      value_.string_ = duplicateAndPrefixStringValue(str, len, &inArena);
       setIsAllocated(true);
+      setIsInArena(inArena);
     } else {
       value_.string_ = other.value_.string_;
     }
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues(*other.value_.map_);
+    value_.map_ = newObjectValues(other.value_.map_);
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -1014,18 +1076,34 @@ void Value::releasePayload() {
   case booleanValue:
     break;
   case stringValue:
-    if (isAllocated())
+    if (isAllocated() && !isInArena())
       releasePrefixedStringValue(value_.string_);
     break;
   case arrayValue:
   case objectValue:
-    delete value_.map_;
+    if (isInArena())
+      value_.map_->~ObjectValues();
+    else
+      delete value_.map_;
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
   }
 }
 
+Value::ObjectValues* Value::newObjectValues(const ObjectValues* other) {
+  // The container takes the current arena too (see ArenaAllocator)
+  Arena* arena = Arena::current();
+  void* storage =
+      arena != nullptr ? arena->allocate(sizeof(ObjectValues)) : nullptr;
+  setIsInArena(storage != nullptr);
+  if (storage == nullptr)
+    return other != nullptr ? new ObjectValues(*other) : new ObjectValues();
+  if (other != nullptr)
+    return new (storage) ObjectValues(*other);
+  return new (storage) ObjectValues();
+}
+
 void Value::dupMeta(const Value& other) {
   comments_ = other.comments_;
   start_ = other.start_;
@@ -1047,8 +1125,8 @@ Value& Value::resolveReference(const char* key) {
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  // The key is copied (duplicated if it must be) once, straight into the node
+  it = value_.map_->emplace_hint(it, CZString(actualKey), nullSingleton());
   Value& value = (*it).second;
   return value;
 }
@@ -1066,8 +1144,8 @@ Value& Value::resolveReference(char const* key, char const* end) {
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  // The key is copied (duplicated if it must be) once, straight into the node
+  it = value_.map_->emplace_hint(it, CZString(actualKey), nullSingleton());
   Value& value = (*it).second;
   return value;
 }
@@ -136,20 +136,31 @@ String valueToString(double value, bool useSpecialFloats,
                [isnan(value) ? 0 : (value < 0) ? 1 : 2];
   }
 
+  if (precisionType == PrecisionType::shortestRoundTrip) {
+    char shortest[32];
+    return String(shortest, writeShortestDouble(value, shortest));
+  }
+
   String buffer(size_t(36), '\0');
-  while (true) {
-    int len = jsoncpp_snprintf(
-        &*buffer.begin(), buffer.size(),
-        (precisionType == PrecisionType::significantDigits) ? "%.*g" : "%.*f",
-        precision, value);
-    assert(len >= 0);
-    auto wouldPrint = static_cast<size_t>(len);
-    if (wouldPrint >= buffer.size()) {
-      buffer.resize(wouldPrint + 1);
-      continue;
+  size_t fixedLength = 0;
+  if (precisionType == PrecisionType::decimalPlaces &&
+      writeFixedDouble(value, precision, &*buffer.begin(), &fixedLength)) {
+    buffer.resize(fixedLength);
+  } else {
+    while (true) {
+      int len = jsoncpp_snprintf(
+          &*buffer.begin(), buffer.size(),
+          (precisionType == PrecisionType::significantDigits) ? "%.*g" : "%.*f",
+          precision, value);
+      assert(len >= 0);
+      auto wouldPrint = static_cast<size_t>(len);
+      if (wouldPrint >= buffer.size()) {
+        buffer.resize(wouldPrint + 1);
+        continue;
+      }
+      buffer.resize(wouldPrint);
+      break;
     }
-    buffer.resize(wouldPrint);
-    break;
   }
 
   buffer.erase(fixNumericLocale(buffer.begin(), buffer.end()), buffer.end());
@@ -1181,8 +1192,11 @@ StreamWriter* StreamWriterBuilder::newStreamWriter() const {
     precisionType = PrecisionType::significantDigits;
   } else if (pt_str == "decimal") {
     precisionType = PrecisionType::decimalPlaces;
+  } else if (pt_str == "shortest") {
+    precisionType = PrecisionType::shortestRoundTrip;
   } else {
-    throwRuntimeError("precisionType must be 'significant' or 'decimal'");
+    throwRuntimeError(
+        "precisionType must be 'significant', 'decimal' or 'shortest'");
   }
   String colonSymbol = " : ";
   if (eyc) {
@@ -155,6 +155,12 @@ public:
    */
   bool good() const;
 
+  /** \brief Build the parsed trees in \p arena (see Arena), or in the heap
+   * if nullptr (the default). The caller resets the arena once the trees
+   * are gone.
+   */
+  void setArena(Arena* arena) { arena_ = arena; }
+
 private:
   enum TokenType {
     tokenEndOfStream = 0,
@@ -238,6 +244,7 @@ private:
   String commentsBefore_;
   Features features_;
   bool collectComments_{};
+  Arena* arena_{};
 }; // Reader
 
 /** Interface for reading JSON from a char array.
@@ -339,6 +346,11 @@ public:
 
   CharReader* newCharReader() const override;
 
+  /** Readers created from now on build their trees in \p arena (see Arena);
+   * nullptr goes back to the heap. The arena must outlive those readers.
+   */
+  void setArena(Arena* arena) { arena_ = arena; }
+
   /** \return true if 'settings' are legal and consistent;
    *   otherwise, indicate bad settings via 'invalid'.
    */
@@ -360,6 +372,9 @@ public:
    * \snippet src/lib_json/json_reader.cpp CharReaderBuilderStrictMode
    */
   static void strictMode(Json::Value* settings);
+
+private:
+  Arena* arena_ = nullptr;
 };
 
 /** Consume entire stream and use its begin/end.
@@ -0,0 +1,260 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_STREAM_READER_H_INCLUDED
+#define JSON_STREAM_READER_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "value.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstddef>
+#include <vector>
+
+#pragma pack(push)
+#pragma pack()
+
+namespace Json {
+
+/** \brief Receives the events produced by a StreamReader (SAX style).
+ *
+ * Strings and keys are delivered fully unescaped (UTF-8); numbers are
+ * delivered as their source text so the handler decides how to decode them.
+ * The pointers are only valid during the call. Returning false from any
+ * callback aborts the parse.
+ */
+class JSON_API StreamHandler {
+public:
+  virtual ~StreamHandler();
+
+  virtual bool startObject() { return true; }
+  virtual bool endObject() { return true; }
+  virtual bool startArray() { return true; }
+  virtual bool endArray() { return true; }
+  virtual bool key(const char* str, size_t len);
+  virtual bool string(const char* str, size_t len);
+  virtual bool number(const char* str, size_t len);
+  virtual bool boolean(bool value);
+  virtual bool null() { return true; }
+
+  /** Same as key()/string(), for a string without escapes when parsing with
+   * StreamReader::parseInSitu(): str points into the document, is
+   * NUL-terminated there and stays valid as long as the document does.
+   */
+  virtual bool keyInSitu(const char* str, size_t len) { return key(str, len); }
+  virtual bool stringInSitu(const char* str, size_t len) {
+    return string(str, len);
+  }
+
+  /// Called by StreamReader::reset() so the handler can drop partial state.
+  virtual void reset() {}
+};
+
+/** \brief Incremental (push) JSON parser.
+ *
+ * The document can be fed in arbitrary chunks as they arrive, e.g. straight
+ * from an HTTP data callback; it never needs to be contiguous in memory. Only
+ * the token being scanned is buffered. Strict RFC 8259 syntax: no comments,
+ * a single top-level value.
+ *
+ * \code
+ * Json::Value root;
+ * Json::ValueBuilder builder(root);
+ * Json::StreamReader reader(builder);
+ * reader.feed(chunk1, len1);
+ * reader.feed(chunk2, len2);
+ * bool ok = reader.finish();
+ * \endcode
+ */
+class JSON_API StreamReader {
+public:
+  explicit StreamReader(StreamHandler& handler, unsigned maxDepth = 64);
+
+  /** Same, but never allocates: the container stack (maxDepth bytes) and the
+   * token being scanned live in the caller's scratch buffer. A string or
+   * number longer than scratchSize - maxDepth fails the parse.
+   */
+  StreamReader(StreamHandler& handler, char* scratch, size_t scratchSize,
+               unsigned maxDepth = 16);
+
+  /// Consumes a chunk. Returns false once a syntax error or abort happened.
+  bool feed(const char* data, size_t len);
+
+  /// Signals end of input. Returns true if exactly one complete value was read.
+  bool finish();
+
+  /** Parses a whole document held in a writable buffer (feed() + finish() in
+   * one call). Strings and keys without escapes are not copied: their
+   * closing quote is overwritten with '\0' and they reach the handler
+   * through keyInSitu()/stringInSitu() as pointers into \p doc. Escaped ones
+   * are decoded as usual. The buffer is left modified.
+   */
+  bool parseInSitu(char* doc, size_t len);
+
+  /// Forgets all state (and resets the handler) to parse a new document.
+  void reset();
+
+  bool failed() const { return failed_; }
+  bool complete() const { return expect_ == expectDone && lex_ == lexNone; }
+  /// Human readable description of the first error, empty if none.
+  const String& error() const { return error_; }
+  /// Bytes consumed so far (position of the error if failed()).
+  size_t offset() const { return offset_; }
+
+private:
+  enum Expect {
+    expectValue,
+    expectKeyOrEnd,
+    expectKey,
+    expectColon,
+    expectCommaOrObjectEnd,
+    expectValueOrArrayEnd,
+    expectCommaOrArrayEnd,
+    expectDone
+  };
+  enum Lex { lexNone, lexString, lexNumber, lexLiteral };
+
+  bool consume(const char* data, size_t len, char* inSitu);
+  bool step(char c);
+  bool structural(char c);
+  bool stringChar(char c);
+  bool endString(const char* str, size_t len, bool inSitu);
+  bool literalChar(char c);
+  bool endNumber();
+  bool afterValue();
+  bool push(char container);
+  void pop();
+  size_t depth() const;
+  char top() const;
+  void clearToken();
+  const char* tokenData() const;
+  size_t tokenSize() const;
+  bool appendToken(char c);
+  bool appendTokenRun(const char* data, size_t len);
+  bool appendCodePoint(unsigned int cp);
+  bool fail(const char* message);
+  static bool validNumber(const char* str, size_t len);
+
+  StreamHandler& handler_;
+  unsigned maxDepth_;
+  std::vector<char> stack_; // '{' or '[' per open container
+  Expect expect_{expectValue};
+  Lex lex_{lexNone};
+  bool isKey_{false};
+  bool escape_{false};
+  int unicodeDigits_{-1}; // >= 0 while reading \uXXXX
+  unsigned int codePoint_{0};
+  unsigned int highSurrogate_{0};
+  const char* literal_{nullptr};
+  size_t literalPos_{0};
+  String token_;
+  String error_;
+  size_t offset_{0};
+  bool failed_{false};
+  // Scratch mode (no heap): stack in scratch_[0, maxDepth_), token after it
+  char* scratch_{nullptr};
+  size_t scratchSize_{0};
+  size_t depth_{0};
+  size_t tokenLen_{0};
+};
+
+/** \brief StreamHandler that builds a Value tree (DOM) from the events.
+ */
+class JSON_API ValueBuilder : public StreamHandler {
+public:
+  /// With an arena the tree is built in it (see Arena) instead of the heap;
+  /// only the builder's own allocations go there, not the feeding code's.
+  /// Fed by StreamReader::parseInSitu(), the strings and keys without escapes
+  /// are not copied: the tree (and any plain copy of it) must not outlive
+  /// the document. Value::deepCopy() gives one that can.
+  explicit ValueBuilder(Value& root, Arena* arena = nullptr);
+
+  bool startObject() override;
+  bool endObject() override;
+  bool startArray() override;
+  bool endArray() override;
+  bool key(const char* str, size_t len) override;
+  bool string(const char* str, size_t len) override;
+  bool number(const char* str, size_t len) override;
+  bool boolean(bool value) override;
+  bool null() override;
+  bool keyInSitu(const char* str, size_t len) override;
+  bool stringInSitu(const char* str, size_t len) override;
+  void reset() override;
+
+  /// Decodes JSON number text the same way Reader does (integers first).
+  static bool decodeNumber(const char* str, size_t len, Value& decoded);
+
+private:
+  Value* slot();
+  bool put(Value&& value);
+
+  Value& root_;
+  Arena* arena_;
+  std::vector<Value*> nodes_;
+  String key_;
+  const char* keyInSitu_{nullptr}; // instead of key_: left in the document
+};
+
+/** \brief StreamHandler that copies a fixed set of top-level fields into
+ * caller buffers in one pass, skipping everything else. Strings are copied
+ * unescaped, numbers as their source text, booleans as "true"/"false"; a null
+ * field counts as missing. Does not allocate.
+ *
+ * \code
+ * char token[1024], expires[16];
+ * Json::FieldExtractor::Field fields[] = {
+ *     {"access_token", token, sizeof(token)},
+ *     {"expires_in", expires, sizeof(expires)}};
+ * char scratch[1100];
+ * Json::FieldExtractor::extract(doc, len, fields, 2, scratch, sizeof(scratch));
+ * if (fields[0].found) ...
+ * \endcode
+ */
+class JSON_API FieldExtractor : public StreamHandler {
+public:
+  struct Field {
+    Field(const char* fieldName, char* buffer, size_t size)
+        : name(fieldName), out(buffer), capacity(size), found(false),
+          truncated(false) {}
+
+    const char* name;
+    char* out;       ///< NUL-terminated copy of the value
+    size_t capacity; ///< including the terminator
+    bool found;      ///< set by the extractor
+    bool truncated;  ///< value did not fit in out (found stays false)
+  };
+
+  FieldExtractor(Field* fields, size_t count);
+
+  bool startObject() override;
+  bool endObject() override;
+  bool startArray() override;
+  bool endArray() override;
+  bool key(const char* str, size_t len) override;
+  bool string(const char* str, size_t len) override;
+  bool number(const char* str, size_t len) override;
+  bool boolean(bool value) override;
+  bool null() override;
+  void reset() override;
+
+  /// Parses a complete document with a StreamReader over 'scratch' (see the
+  /// no-heap StreamReader constructor). Returns true if the document is valid.
+  static bool extract(const char* doc, size_t len, Field* fields, size_t count,
+                      char* scratch, size_t scratchSize);
+
+private:
+  bool value(const char* str, size_t len);
+
+  Field* fields_;
+  size_t count_;
+  Field* current_{nullptr}; // field whose value comes next
+  unsigned depth_{0};
+};
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_STREAM_READER_H_INCLUDED
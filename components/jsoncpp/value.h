@@ -7,6 +7,7 @@
 #define JSON_H_INCLUDED
 
 #if !defined(JSON_IS_AMALGAMATION)
+#include "arena.h"
 #include "forwards.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
 
@@ -128,7 +129,8 @@ enum CommentPlacement {
  */
 enum PrecisionType {
   significantDigits = 0, ///< we set max number of significant digits in string
-  decimalPlaces          ///< we set max number of digits after "." in string
+  decimalPlaces,         ///< we set max number of digits after "." in string
+  shortestRoundTrip ///< shortest string that reads back as the same double
 };
 
 /** \brief Lightweight wrapper to tag static string.
@@ -260,7 +262,13 @@ private:
 #ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
   class CZString {
   public:
-    enum DuplicationPolicy { noDuplication = 0, duplicate, duplicateOnCopy };
+    // inArena: a duplicate whose buffer belongs to an Arena (never freed)
+    enum DuplicationPolicy {
+      noDuplication = 0,
+      duplicate,
+      duplicateOnCopy,
+      inArena
+    };
     CZString(ArrayIndex index);
     CZString(char const* str, unsigned length, DuplicationPolicy allocate);
     CZString(CZString const& other);
@@ -293,7 +301,9 @@ private:
   };
 
 public:
-  typedef std::map<CZString, Value> ObjectValues;
+  typedef std::map<CZString, Value, std::less<CZString>,
+                   ArenaAllocator<std::pair<const CZString, Value>>>
+      ObjectValues;
 #endif // ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
 
 public:
@@ -363,6 +373,16 @@ public:
   /// copy values but leave comments and source offsets in place.
   void copyPayload(const Value& other);
 
+  /** \brief Copy that shares no memory with this tree.
+   *
+   * A plain copy duplicates containers and owned strings but keeps pointing
+   * at StaticString data, which includes every string and key that
+   * StreamReader::parseInSitu() left in the source buffer. deepCopy() duplicates those too, so the result survives the
+   * buffer. Like any copy it allocates in the current arena, if there is
+   * one: call it outside an ArenaScope to move a tree off the arena.
+   */
+  Value deepCopy() const;
+
   ValueType type() const;
 
   /// Compare payload only, not comments etc.
@@ -598,10 +618,14 @@ private:
   }
   bool isAllocated() const { return bits_.allocated_; }
   void setIsAllocated(bool v) { bits_.allocated_ = v; }
+  bool isInArena() const { return bits_.inArena_; }
+  void setIsInArena(bool v) { bits_.inArena_ = v; }
 
   void initBasic(ValueType type, bool allocated = false);
   void dupPayload(const Value& other);
   void releasePayload();
+  // Container for map_, in the current arena or the heap (sets inArena_)
+  ObjectValues* newObjectValues(const ObjectValues* other);
   void dupMeta(const Value& other);
 
   Value& resolveReference(const char* key);
@@ -630,6 +654,8 @@ private:
     unsigned int value_type_ : 8;
     // Unless allocated_, string_ must be null-terminated.
     unsigned int allocated_ : 1;
+    // string_ (if allocated_) or map_ lives in an Arena: not freed.
+    unsigned int inArena_ : 1;
   } bits_;
 
   class Comments {
@@ -109,8 +109,10 @@ public:
    *  infinity as "-Infinity".
    *  - "precision": int
    *  - Number of precision digits for formatting of real values.
-   *  - "precisionType": "significant"(default) or "decimal"
-   *  - Type of precision for formatting of real values.
+   *  - "precisionType": "significant"(default), "decimal" or "shortest"
+   *  - Type of precision for formatting of real values. "shortest" writes
+   *    a short text that reads back as the same double (the shortest for
+   *    nearly all values) and ignores "precision".
    *  - "emitUTF8": false or true
    *  - If true, outputs raw UTF8 strings instead of escaping them.
 
@@ -355,6 +357,13 @@ String JSON_API valueToString(
 String JSON_API valueToString(bool value);
 String JSON_API valueToQuotedString(const char* value);
 
+/** Writes a text that reads back as exactly \p value ("0.1", "1.0",
+ * "1e+21"), using integer arithmetic only, and returns its length. It is the
+ * shortest one for all but ~0.1% of the values (Grisu2).
+ * \p value must be finite; \p out needs 32 chars (NUL-terminated).
+ */
+size_t JSON_API writeShortestDouble(double value, char* out);
+
 /// \brief Output using the StyledStreamWriter.
 /// \see Json::operator>>()
 JSON_API OStream& operator<<(OStream&, const Value& root);
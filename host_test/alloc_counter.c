@@ -0,0 +1,100 @@
+#include "alloc_counter.h"
+
+#include <malloc.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+// Las de glibc por debajo de las que se reemplazan acá
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void* p);
+
+static atomic_uint_least64_t s_allocs;
+static atomic_uint_least64_t s_frees;
+static atomic_size_t s_in_use;
+static atomic_size_t s_peak;
+
+static void added(void* p)
+{
+    if (!p) return;
+    s_allocs++;
+    size_t now = atomic_fetch_add(&s_in_use, malloc_usable_size(p)) + malloc_usable_size(p);
+    size_t peak = atomic_load(&s_peak);
+    while (now > peak && !atomic_compare_exchange_weak(&s_peak, &peak, now)) {
+    }
+}
+
+static void removed(void* p)
+{
+    if (!p) return;
+    s_frees++;
+    atomic_fetch_sub(&s_in_use, malloc_usable_size(p));
+}
+
+void* malloc(size_t size)
+{
+    void* p = __libc_malloc(size);
+    added(p);
+    return p;
+}
+
+void* calloc(size_t n, size_t size)
+{
+    void* p = __libc_calloc(n, size);
+    added(p);
+    return p;
+}
+
+void* realloc(void* old, size_t size)
+{
+    if (!old) return malloc(size);
+    size_t old_size = malloc_usable_size(old);
+    void* p = __libc_realloc(old, size);
+    if (p) {
+        // Cuenta como un bloque nuevo en lugar del viejo
+        atomic_fetch_sub(&s_in_use, old_size);
+        s_frees++;
+        added(p);
+    }
+    return p;
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    void* p = __libc_memalign(alignment, size);
+    added(p);
+    return p;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size)
+{
+    void* p = memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void free(void* p)
+{
+    removed(p);
+    __libc_free(p);
+}
+
+alloc_stats_t alloc_counter_get(void)
+{
+    alloc_stats_t stats = {atomic_load(&s_allocs), atomic_load(&s_frees), atomic_load(&s_in_use),
+                           atomic_load(&s_peak)};
+    return stats;
+}
+
+void alloc_counter_reset_peak(void)
+{
+    atomic_store(&s_peak, atomic_load(&s_in_use));
+}
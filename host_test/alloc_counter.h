@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Heap del proceso contado desde malloc/calloc/realloc/free (new/delete pasan
+// por ahí): llamadas, bytes en uso y pico. Para los benchmarks de memoria;
+// reemplaza el malloc de glibc en el ejecutable que lo enlace.
+typedef struct {
+    uint64_t allocs;       // malloc + calloc + realloc que piden un bloque nuevo
+    uint64_t frees;
+    size_t in_use;         // bytes (tamaño usable de cada bloque)
+    size_t peak;           // máximo de in_use desde alloc_counter_reset_peak()
+} alloc_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+alloc_stats_t alloc_counter_get(void);
+// El pico vuelve a in_use: medir el de un tramo de código
+void alloc_counter_reset_peak(void);
+
+#ifdef __cplusplus
+}
+#endif
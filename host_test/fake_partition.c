@@ -0,0 +1,79 @@
+#define _POSIX_C_SOURCE 200809L
+#include "fake_partition.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+static esp_err_t fp_read(void *ctx, uint32_t off, void *buf, size_t len) {
+    fake_partition_t *fp = ctx;
+    if (off + len > fp->size) return ESP_ERR_INVALID_SIZE;
+    return pread(fp->fd, buf, len, off) == (ssize_t)len ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t fp_write(void *ctx, uint32_t off, const void *buf, size_t len) {
+    fake_partition_t *fp = ctx;
+    if (off + len > fp->size) return ESP_ERR_INVALID_SIZE;
+    if (fp->fail_writes_after == 0) return ESP_FAIL;
+    if (fp->fail_writes_after > 0) fp->fail_writes_after--;
+
+    size_t n = len;
+    esp_err_t ret = ESP_OK;
+    if (fp->torn_after >= 0) {
+        if ((size_t)fp->torn_after < n) n = (size_t)fp->torn_after;
+        fp->torn_after = -1;
+        ret = ESP_FAIL;
+    }
+    uint8_t cur[256];
+    const uint8_t *src = buf;
+    for (size_t done = 0; done < n; ) {
+        size_t chunk = n - done < sizeof(cur) ? n - done : sizeof(cur);
+        if (pread(fp->fd, cur, chunk, off + done) != (ssize_t)chunk) return ESP_FAIL;
+        for (size_t i = 0; i < chunk; i++) cur[i] &= src[done + i];
+        if (pwrite(fp->fd, cur, chunk, off + done) != (ssize_t)chunk) return ESP_FAIL;
+        done += chunk;
+    }
+    fp->writes++;
+    return ret;
+}
+
+static esp_err_t fp_erase(void *ctx, uint32_t off, size_t len) {
+    fake_partition_t *fp = ctx;
+    if (off % fp->sector_size || len % fp->sector_size || off + len > fp->size) return ESP_ERR_INVALID_ARG;
+    uint8_t ff[256];
+    memset(ff, 0xFF, sizeof(ff));
+    for (size_t done = 0; done < len; done += sizeof(ff)) {
+        if (pwrite(fp->fd, ff, sizeof(ff), off + done) != (ssize_t)sizeof(ff)) return ESP_FAIL;
+    }
+    fp->erases++;
+    return ESP_OK;
+}
+
+int fake_partition_open(fake_partition_t *fp, const char *path, uint32_t size, uint32_t sector_size,
+                        int fresh, batch_log_io_t *io) {
+    memset(fp, 0, sizeof(*fp));
+    fp->torn_after = -1;
+    fp->fail_writes_after = -1;
+    fp->size = size;
+    fp->sector_size = sector_size;
+    fp->fd = open(path, O_RDWR | O_CREAT | (fresh ? O_TRUNC : 0), 0644);
+    if (fp->fd < 0) return -1;
+    if (fresh) {
+        // Flash nueva: todo borrado
+        for (uint32_t off = 0; off < size; off += sector_size) {
+            if (ftruncate(fp->fd, off + sector_size) != 0 || fp_erase(fp, off, sector_size) != ESP_OK) return -1;
+        }
+        fp->erases = 0;
+    }
+    io->read = fp_read;
+    io->write = fp_write;
+    io->erase = fp_erase;
+    io->size = size;
+    io->sector_size = sector_size;
+    io->ctx = fp;
+    return 0;
+}
+
+void fake_partition_close(fake_partition_t *fp) {
+    if (fp->fd >= 0) close(fp->fd);
+    fp->fd = -1;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "batch_log.h"
+
+// Partición de flash simulada sobre un archivo, con semántica NOR: borrar
+// pone 0xFF y escribir solo baja bits. Como el estado vive en el archivo,
+// cerrar y volver a abrir equivale a un reinicio del equipo.
+//
+// Inyección de fallos (una sola vez, se desarma al dispararse):
+//   torn_after: la próxima escritura graba solo sus primeros N bytes y falla
+//               (corte de luz a mitad de un write).
+//   fail_writes_after: tras N escrituras correctas, las siguientes fallan
+//               sin tocar la flash hasta que se vuelva a poner a -1.
+typedef struct {
+    int fd;
+    uint32_t size;
+    uint32_t sector_size;
+    int torn_after;          // -1: desarmado
+    int fail_writes_after;   // -1: desarmado
+    uint32_t writes;
+    uint32_t erases;
+} fake_partition_t;
+
+// Crea (o trunca, si 'fresh') el archivo 'path' y arma el backend 'io'
+int fake_partition_open(fake_partition_t *fp, const char *path, uint32_t size, uint32_t sector_size,
+                        int fresh, batch_log_io_t *io);
+void fake_partition_close(fake_partition_t *fp);
@@ -0,0 +1,7 @@
+#pragma once
+// Credenciales de mentira para el build de host (las reales, en main/Privado.h,
+// no están en el repo). Los tests hablan con el server simulado de fake_http.h.
+#define API_KEY       "clave-de-prueba"
+#define DATABASE_URL  "https://db.test"
+#define USER_EMAIL    "equipo@test"
+#define USER_PASSWORD "secreto"
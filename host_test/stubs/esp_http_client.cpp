@@ -0,0 +1,293 @@
+// esp_http_client sobre el server simulado de fake_http.h
+#include <time.h>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <strings.h>
+
+#include "esp_http_client.h"
+#include "fake_http.h"
+
+namespace {
+
+std::mutex s_lock;
+fake_http_handler_t s_handler = nullptr;
+void* s_handler_user = nullptr;
+std::atomic<uint32_t> s_requests(0);
+std::atomic<uint32_t> s_connects(0);
+std::atomic<uint32_t> s_in_flight(0);
+std::atomic<uint32_t> s_max_in_flight(0);
+
+struct nocase_less
+{
+    bool operator()(const std::string& a, const std::string& b) const { return strcasecmp(a.c_str(), b.c_str()) < 0; }
+};
+
+}
+
+struct esp_http_client
+{
+    http_event_handle_cb handler;
+    void* user_data;
+    std::string url;
+    std::string host;
+    esp_http_client_method_t method;
+    const char* post;
+    int post_len;
+    std::map<std::string, std::string, nocase_less> headers;
+    int timeout_ms;
+    bool connected;
+    int status;
+    // open()/read()
+    std::string stream_body;
+    size_t stream_pos;
+};
+
+namespace {
+
+void emit(esp_http_client* c, esp_http_client_event_id_t id, const void* data = nullptr, int len = 0,
+          const char* key = nullptr, const char* value = nullptr)
+{
+    if (!c->handler) return;
+    esp_http_client_event_t evt = {};
+    evt.event_id = id;
+    evt.client = c;
+    evt.data = const_cast<void*>(data);
+    evt.data_len = len;
+    evt.user_data = c->user_data;
+    evt.header_key = const_cast<char*>(key);
+    evt.header_value = const_cast<char*>(value);
+    c->handler(&evt);
+}
+
+void set_host(esp_http_client* c)
+{
+    const char* p = strstr(c->url.c_str(), "://");
+    p = p ? p + 3 : c->url.c_str();
+    c->host.assign(p, strcspn(p, "/?:"));
+}
+
+void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    nanosleep(&ts, nullptr);
+}
+
+// Pide la respuesta al handler. Fuera de s_lock: el handler puede bloquearse.
+void ask(esp_http_client* c, bool streaming, fake_http_response_t& resp, std::string& body)
+{
+    fake_http_request_t req = {};
+    req.host = c->host.c_str();
+    req.url = c->url.c_str();
+    req.method = c->method;
+    req.body = c->post;
+    req.body_len = c->post ? c->post_len : 0;
+    req.reused = c->connected;
+    req.timeout_ms = c->timeout_ms;
+    req.streaming = streaming;
+    req.client = c;
+
+    resp = {};
+    resp.err = ESP_OK;
+    resp.status = 200;
+    resp.body_len = -1;
+    fake_http_handler_t handler;
+    void* user;
+    {
+        std::lock_guard<std::mutex> g(s_lock);
+        handler = s_handler;
+        user = s_handler_user;
+    }
+    s_requests++;
+    if (handler) handler(&req, &resp, user);
+    if (resp.body) body.assign(resp.body, resp.body_len < 0 ? strlen(resp.body) : (size_t)resp.body_len);
+    else body.clear();
+    if (resp.delay_ms > 0) sleep_ms(resp.delay_ms);
+}
+
+// Conexión y envío. false si el request falló antes de tener respuesta.
+bool connect_and_send(esp_http_client* c, const fake_http_response_t& resp)
+{
+    if (resp.err == ESP_ERR_HTTP_CONNECT) {
+        if (c->connected) {
+            c->connected = false;
+            emit(c, HTTP_EVENT_DISCONNECTED);
+        }
+        emit(c, HTTP_EVENT_ERROR);
+        return false;
+    }
+    if (!c->connected) {
+        c->connected = true;
+        s_connects++;
+        emit(c, HTTP_EVENT_ON_CONNECTED);
+    }
+    emit(c, HTTP_EVENT_HEADER_SENT);
+    if (resp.err != ESP_OK) {
+        emit(c, HTTP_EVENT_ERROR);
+        c->connected = false;
+        emit(c, HTTP_EVENT_DISCONNECTED);
+        return false;
+    }
+    return true;
+}
+
+void enter()
+{
+    uint32_t now = ++s_in_flight;
+    uint32_t max = s_max_in_flight.load();
+    while (now > max && !s_max_in_flight.compare_exchange_weak(max, now)) {}
+}
+
+}
+
+extern "C" {
+
+void fake_http_set_handler(fake_http_handler_t handler, void* user)
+{
+    std::lock_guard<std::mutex> g(s_lock);
+    s_handler = handler;
+    s_handler_user = user;
+    s_requests = 0;
+    s_connects = 0;
+    s_max_in_flight = 0;
+}
+
+const char* fake_http_header(const fake_http_request_t* req, const char* key)
+{
+    auto it = req->client->headers.find(key);
+    return it == req->client->headers.end() ? nullptr : it->second.c_str();
+}
+
+uint32_t fake_http_requests(void) { return s_requests; }
+uint32_t fake_http_connects(void) { return s_connects; }
+uint32_t fake_http_max_in_flight(void) { return s_max_in_flight; }
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t* config)
+{
+    esp_http_client* c = new esp_http_client();
+    c->handler = config->event_handler;
+    c->user_data = config->user_data;
+    c->url = config->url ? config->url : "";
+    set_host(c);
+    c->method = HTTP_METHOD_GET;
+    c->timeout_ms = config->timeout_ms;
+    c->status = -1;
+    return c;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t c)
+{
+    enter();
+    fake_http_response_t resp;
+    std::string body;
+    ask(c, false, resp, body);
+    if (!connect_and_send(c, resp)) {
+        c->status = -1;
+        s_in_flight--;
+        return resp.err;
+    }
+    c->status = resp.status;
+    if (resp.etag) emit(c, HTTP_EVENT_ON_HEADER, nullptr, 0, "ETag", resp.etag);
+    else emit(c, HTTP_EVENT_ON_HEADER, nullptr, 0, "Content-Type", "application/json");
+    size_t chunk = resp.chunk > 0 ? (size_t)resp.chunk : body.size();
+    for (size_t off = 0; off < body.size(); off += chunk) {
+        size_t n = body.size() - off < chunk ? body.size() - off : chunk;
+        emit(c, HTTP_EVENT_ON_DATA, body.data() + off, (int)n);
+    }
+    emit(c, HTTP_EVENT_ON_FINISH);
+    if (resp.close) esp_http_client_close(c);
+    s_in_flight--;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t c, const char* url)
+{
+    c->url = url;
+    set_host(c);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t c, const char* data, int len)
+{
+    c->post = data;
+    c->post_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char* key, const char* value)
+{
+    c->headers[key] = value;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t c, const char* key)
+{
+    c->headers.erase(key);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t c, esp_http_client_method_t method)
+{
+    c->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t c, int timeout_ms)
+{
+    c->timeout_ms = timeout_ms;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t c, void* data)
+{
+    c->user_data = data;
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t c) { return c->status; }
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t c)
+{
+    if (c->connected) {
+        c->connected = false;
+        emit(c, HTTP_EVENT_DISCONNECTED);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t c) { return ESP_OK; }
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c)
+{
+    esp_http_client_close(c);
+    delete c;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t c, int write_len)
+{
+    fake_http_response_t resp;
+    ask(c, true, resp, c->stream_body);
+    c->stream_pos = 0;
+    if (!connect_and_send(c, resp)) {
+        c->status = -1;
+        return resp.err;
+    }
+    c->status = resp.status;
+    return ESP_OK;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t c) { return -1; }
+
+int esp_http_client_read(esp_http_client_handle_t c, char* buffer, int len)
+{
+    size_t left = c->stream_body.size() - c->stream_pos;
+    size_t n = left < (size_t)len ? left : (size_t)len;
+    memcpy(buffer, c->stream_body.data() + c->stream_pos, n);
+    c->stream_pos += n;
+    return (int)n;  // 0: el server cerró
+}
+
+}
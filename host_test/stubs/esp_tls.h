@@ -0,0 +1,5 @@
+#pragma once
+#include "esp_err.h"
+// Build de host: el TLS no se simula (esp_http_client es un server falso)
+typedef struct esp_tls esp_tls_t;
+typedef struct esp_tls_client_session esp_tls_client_session_t;
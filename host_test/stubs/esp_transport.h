@@ -0,0 +1,11 @@
+#pragma once
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef struct esp_transport_item_t* esp_transport_handle_t;
+esp_err_t esp_transport_destroy(esp_transport_handle_t t);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Server simulado detrás de esp_http_client (host). Cada perform()/open()
+// le pasa el request al handler del test, que llena la respuesta. El handler
+// puede correr en varias tareas a la vez (una por cliente).
+typedef struct {
+    const char* host;
+    const char* url;
+    esp_http_client_method_t method;
+    const char* body;          // lo fijado con set_post_field (no termina en '\0')
+    int body_len;
+    bool reused;               // la conexión ya estaba abierta
+    int timeout_ms;
+    bool streaming;            // open()/read() en vez de perform()
+    esp_http_client_handle_t client;
+} fake_http_request_t;
+
+typedef struct {
+    esp_err_t err;         // != ESP_OK: falla de transporte (ESP_ERR_HTTP_CONNECT: ni conecta)
+    int status;
+    const char* body;      // se copia al volver del handler
+    int body_len;          // -1: strlen(body)
+    const char* etag;      // header ETag, nullptr: sin él
+    int chunk;             // bytes por HTTP_EVENT_ON_DATA; 0: todo de una vez
+    int delay_ms;          // espera real antes de responder
+    bool close;            // el server cierra la conexión tras responder
+} fake_http_response_t;
+
+typedef void (*fake_http_handler_t)(const fake_http_request_t* req, fake_http_response_t* resp, void* user);
+
+// También pone a cero los contadores
+void fake_http_set_handler(fake_http_handler_t handler, void* user);
+// Header fijado en el cliente del request (nullptr si no está)
+const char* fake_http_header(const fake_http_request_t* req, const char* key);
+
+uint32_t fake_http_requests(void);      // perform/open atendidos
+uint32_t fake_http_connects(void);      // conexiones abiertas
+uint32_t fake_http_max_in_flight(void); // requests atendidos a la vez (máximo)
+
+#ifdef __cplusplus
+}
+#endif
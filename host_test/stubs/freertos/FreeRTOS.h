@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// FreeRTOS para host: tareas sobre pthreads y semáforos con mutex + condvar
+// (ver freertos.cpp). Un tick son 10 ms, como CONFIG_FREERTOS_HZ=100.
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef struct host_task* TaskHandle_t;
+typedef struct host_semaphore* SemaphoreHandle_t;
+
+#define configTICK_RATE_HZ 100
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(t) ((uint32_t)(t) * portTICK_PERIOD_MS)
+#define portMAX_DELAY ((TickType_t)0xffffffffu)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define tskIDLE_PRIORITY 0
@@ -0,0 +1,20 @@
+#pragma once
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out);
+// Solo vTaskDelete(NULL): termina la tarea que llama
+void vTaskDelete(TaskHandle_t task);
+// No duerme: adelanta el reloj virtual (ver host_rtos.h)
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,209 @@
+// FreeRTOS, esp_timer, esp_random, esp_log y demás para el build de host
+#include <pthread.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_crt_bundle.h"
+#include "esp_transport.h"
+#include "host_rtos.h"
+
+namespace {
+
+std::atomic<int64_t> s_virtual_us(0);
+std::mutex s_hook_lock;
+host_delay_hook_t s_delay_hook = nullptr;
+void* s_delay_user = nullptr;
+std::atomic<uint32_t> s_deadlock_ms(10000);
+std::atomic<uint32_t> s_random(12345);
+
+int64_t real_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct task_start_t
+{
+    TaskFunction_t fn;
+    void* arg;
+};
+
+void* task_main(void* pv)
+{
+    task_start_t start = *static_cast<task_start_t*>(pv);
+    delete static_cast<task_start_t*>(pv);
+    start.fn(start.arg);
+    return nullptr;
+}
+
+}
+
+struct host_task
+{
+    pthread_t thread;
+};
+
+struct host_semaphore
+{
+    std::mutex m;
+    std::condition_variable cv;
+    unsigned count;
+    unsigned max;
+};
+
+extern "C" {
+
+void host_set_delay_hook(host_delay_hook_t hook, void* user)
+{
+    std::lock_guard<std::mutex> g(s_hook_lock);
+    s_delay_hook = hook;
+    s_delay_user = user;
+}
+
+void host_advance_us(int64_t us) { s_virtual_us += us; }
+void host_set_deadlock_ms(uint32_t ms) { s_deadlock_ms = ms; }
+void host_set_random_seed(uint32_t seed) { s_random = seed ? seed : 1; }
+
+int64_t esp_timer_get_time(void) { return real_us() + s_virtual_us.load(); }
+
+uint32_t esp_random(void)
+{
+    // xorshift32: reproducible con host_set_random_seed
+    uint32_t x = s_random.load(), next;
+    do {
+        next = x;
+        next ^= next << 13;
+        next ^= next >> 17;
+        next ^= next << 5;
+    } while (!s_random.compare_exchange_weak(x, next));
+    return next;
+}
+
+uint32_t esp_get_free_heap_size(void) { return 200 * 1024; }
+uint32_t esp_get_minimum_free_heap_size(void) { return 180 * 1024; }
+
+esp_err_t esp_crt_bundle_attach(void* conf) { return ESP_OK; }
+esp_err_t esp_transport_destroy(esp_transport_handle_t t) { return ESP_OK; }
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...)
+{
+    static int max_level = -1;
+    if (max_level < 0) {
+        const char* env = getenv("ESP_LOG_LEVEL");
+        max_level = env ? atoi(env) : ESP_LOG_ERROR;
+    }
+    if ((int)level > max_level) return;
+    static const char letters[] = "NEWIDV";
+    fprintf(stderr, "%c (%s) ", letters[level], tag);
+    va_list ap;
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out)
+{
+    host_task* task = new host_task;
+    task_start_t* start = new task_start_t{fn, arg};
+    if (pthread_create(&task->thread, nullptr, task_main, start) != 0) {
+        delete start;
+        delete task;
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (out) *out = task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr) pthread_exit(nullptr);
+    abort(); // borrar otra tarea no se usa
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint32_t ms = pdTICKS_TO_MS(ticks);
+    s_virtual_us += (int64_t)ms * 1000;
+    host_delay_hook_t hook;
+    void* user;
+    {
+        std::lock_guard<std::mutex> g(s_hook_lock);
+        hook = s_delay_hook;
+        user = s_delay_user;
+    }
+    if (hook) hook(ms, user);
+    // Cede la CPU: un bucle con vTaskDelay no debe girar en vacío
+    struct timespec ts = {0, 200000};
+    nanosleep(&ts, nullptr);
+}
+
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    host_semaphore* sem = new host_semaphore;
+    sem->count = initial;
+    sem->max = max;
+    return sem;
+}
+
+// Sin herencia de prioridad ni dueño: alcanza para la exclusión mutua
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return xSemaphoreCreateCounting(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xSemaphoreCreateCounting(1, 0); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> g(sem->m);
+    if (ticks == portMAX_DELAY) {
+        uint32_t limit = s_deadlock_ms.load();
+        auto ready = [sem] { return sem->count > 0; };
+        if (limit == 0) {
+            sem->cv.wait(g, ready);
+        } else if (!sem->cv.wait_for(g, std::chrono::milliseconds(limit), ready)) {
+            fprintf(stderr, "xSemaphoreTake: %u ms esperando con portMAX_DELAY: posible deadlock\n", (unsigned)limit);
+            abort();
+        }
+    } else if (!sem->cv.wait_for(g, std::chrono::milliseconds(pdTICKS_TO_MS(ticks)), [sem] { return sem->count > 0; })) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    std::lock_guard<std::mutex> g(sem->m);
+    if (sem->count >= sem->max) return pdFALSE;
+    sem->count++;
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem)
+{
+    std::lock_guard<std::mutex> g(sem->m);
+    return sem->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Control de los stubs desde los tests.
+//
+// Reloj: esp_timer_get_time() es el monotónico real más un desfase virtual.
+// vTaskDelay() no duerme: suma su espera al desfase y avisa al hook, así un
+// test ve el calendario exacto de reintentos sin esperarlo.
+typedef void (*host_delay_hook_t)(uint32_t ms, void* user);
+void host_set_delay_hook(host_delay_hook_t hook, void* user);
+void host_advance_us(int64_t us);
+
+// Una espera con portMAX_DELAY que pasa de este plazo (real) aborta el test
+// con "posible deadlock" en vez de colgar ctest. 0: sin límite.
+void host_set_deadlock_ms(uint32_t ms);
+
+void host_set_random_seed(uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,2 @@
+#pragma once
+// Build de host: sin mbedTLS (ver esp_tls.h)
@@ -0,0 +1,2 @@
+#pragma once
+// Build de host: sin NVS; nada de lo que se compila acá lo usa
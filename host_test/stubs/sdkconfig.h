@@ -0,0 +1,3 @@
+#pragma once
+// Build de host: sin CONFIG_ESP_HTTP_CLIENT_ENABLE_CUSTOM_TRANSPORT ni
+// CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS (el TLS no se simula)
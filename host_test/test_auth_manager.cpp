@@ -0,0 +1,221 @@
+// Gestor de auth de FirebaseApp contra identitytoolkit/securetoken simulados:
+// un solo refresh en vuelo, renovación según expires_in (reloj virtual), login
+// solo si el refresh token es rechazado, y cuántos round-trips a cada host
+// cuesta un día de operación.
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "rtdb.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+const char* DB_URL = "https://db.test";
+
+enum refresh_mode_t { REFRESH_OK, REFRESH_REJECTED, REFRESH_DOWN };
+
+struct auth_server_t
+{
+    std::atomic<int> logins{0};
+    std::atomic<int> refreshes{0};
+    std::atomic<int> db_requests{0};
+    std::atomic<int> db_unauthorized{0};
+    std::atomic<int> mode{REFRESH_OK};
+    std::atomic<int> refresh_delay_ms{0};
+    std::atomic<int> expires_in{3600};
+    std::atomic<int> token_serial{0};
+    std::mutex m;
+    char body[256];
+    char current[32] = "";
+    char revoked[32] = "";       // la RTDB responde 401 a este token
+};
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    auth_server_t* s = static_cast<auth_server_t*>(user);
+    std::lock_guard<std::mutex> g(s->m);
+    if (strcmp(req->host, "identitytoolkit.googleapis.com") == 0) {
+        s->logins++;
+        resp->status = 200;
+        resp->body = "{\"kind\":\"identitytoolkit#VerifyPasswordResponse\",\"refreshToken\":\"refresh-1\","
+                     "\"idToken\":\"no-se-usa\",\"expiresIn\":\"3600\"}";
+    } else if (strcmp(req->host, "securetoken.googleapis.com") == 0) {
+        s->refreshes++;
+        resp->delay_ms = s->refresh_delay_ms;
+        if (s->mode == REFRESH_REJECTED) {
+            resp->status = 400;
+            resp->body = "{\"error\":{\"code\":400,\"message\":\"INVALID_REFRESH_TOKEN\"}}";
+            s->mode = REFRESH_OK;  // el login siguiente trae un refresh token nuevo
+        } else if (s->mode == REFRESH_DOWN) {
+            resp->status = 503;
+        } else {
+            snprintf(s->current, sizeof(s->current), "id-%d", ++s->token_serial);
+            snprintf(s->body, sizeof(s->body),
+                     "{\"access_token\":\"%s\",\"expires_in\":\"%d\",\"token_type\":\"Bearer\","
+                     "\"refresh_token\":\"refresh-1\"}", s->current, (int)s->expires_in);
+            resp->status = 200;
+            resp->body = s->body;
+        }
+    } else {
+        s->db_requests++;
+        const char* auth = strstr(req->url, "auth=");
+        if (s->revoked[0] && auth && strcmp(auth + 5, s->revoked) == 0) {
+            s->db_unauthorized++;
+            resp->status = 401;
+        } else {
+            resp->status = 204;
+        }
+    }
+}
+
+struct fixture_t
+{
+    auth_server_t server;
+    FirebaseApp app{"clave"};
+    fixture_t()
+    {
+        fake_http_set_handler(::server, &server);
+        CHECK_EQ(app.loginUserAccount({"equipo@test", "secreto"}), ESP_OK);
+    }
+    ~fixture_t() { fake_http_set_handler(nullptr, nullptr); }
+};
+
+void test_login_once_then_refresh()
+{
+    fixture_t f;
+    CHECK_EQ(f.server.logins, 1);
+    CHECK_EQ(f.server.refreshes, 1);
+    uint32_t gen = f.app.tokenGeneration();
+    CHECK(gen > 0);
+    // Token nuevo: nada que hacer
+    CHECK_EQ(f.app.validTokenGeneration(), gen);
+    CHECK_EQ(f.server.refreshes, 1);
+    // Pasada la renovación programada (como mucho expires_in - margen)
+    host_advance_us(3300LL * 1000000);
+    CHECK_EQ(f.app.validTokenGeneration(), gen + 1);
+    CHECK_EQ(f.server.refreshes, 2);
+    CHECK_EQ(f.server.logins, 1);
+    CHECK_EQ(f.app.getStats().auth_logins, 1);
+    CHECK_EQ(f.app.getStats().auth_refreshes, 1);
+}
+
+struct waiter_t
+{
+    FirebaseApp* app;
+    uint32_t generation;
+    SemaphoreHandle_t done;
+};
+
+void waiter_task(void* pv)
+{
+    waiter_t* w = static_cast<waiter_t*>(pv);
+    w->generation = w->app->validTokenGeneration();
+    xSemaphoreGive(w->done);
+    vTaskDelete(NULL);
+}
+
+void test_single_flight()
+{
+    fixture_t f;
+    uint32_t gen = f.app.tokenGeneration();
+    f.server.refresh_delay_ms = 30;
+    host_advance_us(3600LL * 1000000);
+    waiter_t waiters[6];
+    for (waiter_t& w : waiters) {
+        w = {&f.app, 0, xSemaphoreCreateBinary()};
+        CHECK(xTaskCreate(waiter_task, "waiter", 8192, &w, 5, NULL) == pdPASS);
+    }
+    for (waiter_t& w : waiters) {
+        CHECK(xSemaphoreTake(w.done, pdMS_TO_TICKS(5000)) == pdTRUE);
+        CHECK_EQ(w.generation, gen + 1);
+        vSemaphoreDelete(w.done);
+    }
+    // Seis tareas con el token vencido: un solo refresh, las demás lo esperan
+    CHECK_EQ(f.server.refreshes, 2);
+    CHECK(f.app.getStats().auth_waits >= 1);
+}
+
+void test_rejected_refresh_logs_in()
+{
+    fixture_t f;
+    f.server.mode = REFRESH_REJECTED;
+    CHECK_EQ(f.app.forceRefreshAuth(), ESP_OK);
+    CHECK_EQ(f.server.logins, 2);
+    CHECK_EQ(f.server.refreshes, 3);   // inicial, rechazado, el del login
+}
+
+void test_refresh_down_keeps_token()
+{
+    fixture_t f;
+    uint32_t gen = f.app.tokenGeneration();
+    f.server.mode = REFRESH_DOWN;
+    host_advance_us(3600LL * 1000000);
+    // Sin securetoken: se sigue con el token actual y sin login
+    CHECK_EQ(f.app.validTokenGeneration(), gen);
+    // El inicial más los intentos de DEFAULT_RETRY_POLICY
+    CHECK_EQ(f.server.refreshes, 1 + DEFAULT_RETRY_POLICY.max_attempts);
+    CHECK_EQ(f.app.validTokenGeneration(), gen);
+    CHECK_EQ(f.server.refreshes, 1 + DEFAULT_RETRY_POLICY.max_attempts);  // reintento en AUTH_RETRY_S
+    host_advance_us(31LL * 1000000);
+    f.server.mode = REFRESH_OK;
+    CHECK_EQ(f.app.validTokenGeneration(), gen + 1);
+    CHECK_EQ(f.server.logins, 1);
+    CHECK_EQ(f.app.getStats().auth_refresh_failures, 1);
+}
+
+void test_unauthorized_write()
+{
+    fixture_t f;
+    RTDB db(&f.app, DB_URL);
+    CHECK_EQ(db.putData("/x", "1"), ESP_OK);
+    // La RTDB revoca el token vigente: un 401, refresh y el mismo PUT otra vez
+    {
+        std::lock_guard<std::mutex> g(f.server.m);
+        strcpy(f.server.revoked, f.server.current);
+    }
+    int before = f.server.db_requests;
+    CHECK_EQ(db.putData("/x", "2"), ESP_OK);
+    CHECK_EQ(f.server.db_unauthorized, 1);
+    CHECK_EQ(f.server.db_requests - before, 2);
+    CHECK_EQ(f.server.logins, 1);
+    CHECK_EQ(f.server.refreshes, 2);
+}
+
+// Un día con una escritura por minuto: todo el tráfico de auth que genera
+void bench_one_day()
+{
+    fixture_t f;
+    RTDB db(&f.app, DB_URL);
+    for (int minute = 0; minute < 24 * 60; ++minute) {
+        db.putData("/ultima", "{\"v\":1}");
+        host_advance_us(60LL * 1000000);
+    }
+    printf("24 h, 1440 escrituras: %d logins (identitytoolkit), %d refresh (securetoken)\n",
+           (int)f.server.logins, (int)f.server.refreshes);
+    // expires_in 3600 menos 300..420 s de margen: de 25 a 28 renovaciones
+    CHECK_EQ(f.server.logins, 1);
+    CHECK(f.server.refreshes >= 25 && f.server.refreshes <= 28);
+}
+
+}
+
+int main()
+{
+    test_login_once_then_refresh();
+    test_single_flight();
+    test_rejected_refresh_logs_in();
+    test_refresh_down_keeps_token();
+    test_unauthorized_write();
+    bench_one_day();
+    printf("auth_manager: OK\n");
+    return 0;
+}
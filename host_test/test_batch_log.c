@@ -0,0 +1,197 @@
+// Log store-and-forward (components/batch_log) sobre una partición simulada
+// en archivo: confirmación, remontaje (reinicio), escrituras cortadas por un
+// corte de luz y log lleno.
+#include <stdio.h>
+#include <string.h>
+#include "batch_log.h"
+#include "fake_partition.h"
+#include "test_util.h"
+
+#define SECTOR 4096
+#define SLOTS_PER_SECTOR (SECTOR / 96)
+
+static const char *s_path = "batch_log_test.bin";
+
+static uint32_t append_n(batch_log_t *log, uint32_t n) {
+    uint32_t seq = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        char p[32];
+        int len = snprintf(p, sizeof(p), "batch %u", (unsigned)log->next_seq);
+        CHECK_EQ(batch_log_append(log, 1700000000 + log->next_seq, p, (size_t)len, &seq), ESP_OK);
+    }
+    return seq;
+}
+
+// Los pendientes salen en orden, consecutivos, terminan en 'last_seq' y su
+// cantidad coincide con batch_log_pending(). Devuelve el seq del primero.
+static uint32_t check_pending(batch_log_t *log, uint32_t last_seq) {
+    static batch_log_entry_t e[4 * SLOTS_PER_SECTOR];
+    size_t n = batch_log_peek(log, e, sizeof(e) / sizeof(e[0]));
+    CHECK_EQ(n, batch_log_pending(log));
+    for (size_t i = 0; i < n; i++) {
+        char p[32];
+        int len = snprintf(p, sizeof(p), "batch %u", (unsigned)e[i].seq);
+        CHECK_EQ(e[i].len, len);
+        CHECK(memcmp(e[i].payload, p, (size_t)len) == 0);
+        CHECK_EQ(e[i].ts, 1700000000 + (int64_t)e[i].seq);
+        if (i) CHECK_EQ(e[i].seq, e[i - 1].seq + 1);
+    }
+    if (n) CHECK_EQ(e[n - 1].seq, last_seq);
+    return n ? e[0].seq : 0;
+}
+
+// Cierra y reabre el archivo (reinicio) y vuelve a montar
+static void remount(batch_log_t *log, fake_partition_t *fp, uint32_t size) {
+    batch_log_io_t io;
+    fake_partition_close(fp);
+    CHECK_EQ(fake_partition_open(fp, s_path, size, SECTOR, 0, &io), 0);
+    CHECK_EQ(batch_log_mount(log, &io), ESP_OK);
+}
+
+static void test_ack(void) {
+    fake_partition_t fp;
+    batch_log_io_t io;
+    batch_log_t log;
+    CHECK_EQ(fake_partition_open(&fp, s_path, 2 * SECTOR, SECTOR, 1, &io), 0);
+    CHECK_EQ(batch_log_mount(&log, &io), ESP_OK);
+    CHECK_EQ(batch_log_pending(&log), 0);
+
+    uint32_t last = append_n(&log, 10);
+    CHECK_EQ(last, 10);
+    CHECK_EQ(check_pending(&log, last), 1);
+
+    CHECK_EQ(batch_log_ack(&log, 4), ESP_OK);
+    CHECK_EQ(batch_log_pending(&log), 6);
+    CHECK_EQ(check_pending(&log, last), 5);
+
+    // Confirmar más de los que hay deja el log vacío
+    CHECK_EQ(batch_log_ack(&log, 100), ESP_OK);
+    CHECK_EQ(batch_log_pending(&log), 0);
+    CHECK_EQ(check_pending(&log, last), 0);
+
+    last = append_n(&log, 3);
+    CHECK_EQ(check_pending(&log, last), 11);
+    fake_partition_close(&fp);
+}
+
+static void test_remount(void) {
+    fake_partition_t fp;
+    batch_log_io_t io;
+    batch_log_t log;
+    const uint32_t size = 2 * SECTOR;
+    CHECK_EQ(fake_partition_open(&fp, s_path, size, SECTOR, 1, &io), 0);
+    CHECK_EQ(batch_log_mount(&log, &io), ESP_OK);
+
+    uint32_t last = append_n(&log, 10);
+    CHECK_EQ(batch_log_ack(&log, 3), ESP_OK);
+    remount(&log, &fp, size);
+    CHECK_EQ(batch_log_pending(&log), 7);
+    CHECK_EQ(check_pending(&log, last), 4);
+    CHECK_EQ(log.next_seq, 11);
+
+    // Cruzando el borde de sector y con todo confirmado
+    last = append_n(&log, SLOTS_PER_SECTOR);
+    CHECK_EQ(batch_log_ack(&log, 100), ESP_OK);
+    remount(&log, &fp, size);
+    CHECK_EQ(batch_log_pending(&log), 0);
+    CHECK_EQ(log.next_seq, last + 1);
+
+    // La secuencia sigue creciendo aunque la flash no tenga pendientes
+    CHECK_EQ(append_n(&log, 1), last + 1);
+    fake_partition_close(&fp);
+}
+
+static void test_torn_write(void) {
+    fake_partition_t fp;
+    batch_log_io_t io;
+    batch_log_t log;
+    const uint32_t size = 2 * SECTOR;
+    CHECK_EQ(fake_partition_open(&fp, s_path, size, SECTOR, 1, &io), 0);
+    CHECK_EQ(batch_log_mount(&log, &io), ESP_OK);
+    append_n(&log, 5);
+
+    // Corte de luz en medio del payload del registro 6
+    fp.torn_after = 40;
+    CHECK(batch_log_append(&log, 0, "x", 1, NULL) != ESP_OK);
+    remount(&log, &fp, size);
+    CHECK_EQ(batch_log_pending(&log), 5);
+    CHECK_EQ(log.next_seq, 6);
+
+    // El slot cortado se salta; el siguiente registro reusa el seq perdido
+    CHECK_EQ(append_n(&log, 1), 6);
+    CHECK_EQ(check_pending(&log, 6), 1);
+    remount(&log, &fp, size);
+    CHECK_EQ(check_pending(&log, 6), 1);
+
+    // Corte escribiendo el ack: la palabra queda a medias y el registro cuenta
+    // como confirmado (el servidor ya respondió 2xx, reenviarlo duplicaría)
+    fp.torn_after = 2;
+    CHECK(batch_log_ack(&log, 1) != ESP_OK);
+    remount(&log, &fp, size);
+    CHECK_EQ(batch_log_pending(&log), 5);
+    CHECK_EQ(check_pending(&log, 6), 2);
+
+    // Escritura que falla sin tocar la flash: el registro no existe
+    fp.fail_writes_after = 0;
+    CHECK(batch_log_append(&log, 0, "y", 1, NULL) != ESP_OK);
+    fp.fail_writes_after = -1;
+    CHECK_EQ(append_n(&log, 1), 7);
+    remount(&log, &fp, size);
+    CHECK_EQ(check_pending(&log, 7), 2);
+    fake_partition_close(&fp);
+}
+
+static void test_overflow(void) {
+    fake_partition_t fp;
+    batch_log_io_t io;
+    batch_log_t log;
+    const uint32_t size = 4 * SECTOR;
+    const uint32_t slots = 4 * SLOTS_PER_SECTOR;
+    CHECK_EQ(fake_partition_open(&fp, s_path, size, SECTOR, 1, &io), 0);
+    CHECK_EQ(batch_log_mount(&log, &io), ESP_OK);
+
+    // Sin confirmar nada: dos vueltas y media al anillo
+    uint32_t total = slots * 5 / 2;
+    uint32_t last = append_n(&log, total);
+    CHECK(log.overwritten > 0);
+    CHECK(batch_log_pending(&log) <= slots);
+    // Al menos tres sectores completos siguen disponibles
+    CHECK(batch_log_pending(&log) >= slots - SLOTS_PER_SECTOR);
+    CHECK_EQ(batch_log_pending(&log) + log.overwritten, total);
+    uint32_t first = check_pending(&log, last);
+    CHECK_EQ(first, last - batch_log_pending(&log) + 1);
+
+    // Tras un reinicio se ve lo mismo
+    uint32_t pending = (uint32_t)batch_log_pending(&log);
+    remount(&log, &fp, size);
+    CHECK_EQ(batch_log_pending(&log), pending);
+    CHECK_EQ(check_pending(&log, last), first);
+
+    // Confirmar la mitad y seguir llenando: se pierden solo pendientes viejos
+    CHECK_EQ(batch_log_ack(&log, pending / 2), ESP_OK);
+    last = append_n(&log, slots);
+    CHECK_EQ(check_pending(&log, last), last - batch_log_pending(&log) + 1);
+    pending = (uint32_t)batch_log_pending(&log);
+    remount(&log, &fp, size);
+    CHECK_EQ(batch_log_pending(&log), pending);
+    check_pending(&log, last);
+
+    // Vaciado: todo confirmado y nada vuelve tras reiniciar
+    CHECK_EQ(batch_log_ack(&log, pending), ESP_OK);
+    CHECK_EQ(batch_log_pending(&log), 0);
+    remount(&log, &fp, size);
+    CHECK_EQ(batch_log_pending(&log), 0);
+    CHECK_EQ(log.next_seq, last + 1);
+    fake_partition_close(&fp);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) s_path = argv[1];
+    test_ack();
+    test_remount();
+    test_torn_write();
+    test_overflow();
+    remove(s_path);
+    printf("batch_log: ok\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Cola de firebase_async.cpp con dobles de las funciones firebase_* que usa el
+// worker: orden por prioridad, PUT agrupados en un PATCH, y varias tareas
+// encolando a la vez con la cola llena (cada request se despacha una sola vez).
+#include <time.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "firebase.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+namespace {
+
+std::mutex s_log_lock;
+std::vector<std::string> s_log;        // ops despachadas, en orden
+SemaphoreHandle_t s_gate = nullptr;    // si no es nullptr, el primer op espera acá
+std::atomic<uint32_t> s_key(0);
+
+void record(const std::string& what)
+{
+    {
+        std::lock_guard<std::mutex> g(s_log_lock);
+        s_log.push_back(what);
+    }
+    if (s_gate) {
+        SemaphoreHandle_t gate = s_gate;
+        s_gate = nullptr;
+        xSemaphoreTake(gate, portMAX_DELAY);
+    }
+}
+
+}
+
+// Dobles de firebase_c_shim.cpp
+extern "C" {
+
+int firebase_putData(const char* path, const char* json) { record(std::string("PUT ") + path); return 0; }
+int firebase_push(const char* path, const char* json) { record(std::string("POST ") + path); return 0; }
+int firebase_patch(const char* path, const char* json) { record(std::string("PATCH ") + path); return 0; }
+int firebase_delete(const char* path) { record(std::string("DELETE ") + path); return 0; }
+int firebase_trim_oldest_batch(const char* root_path, int batch_size) { record("TRIM"); return batch_size; }
+int firebase_purge_page(const char* root_path, const char* end_key, int page_size) { record("PURGE"); return 0; }
+int firebase_new_key(char* out, size_t len)
+{
+    snprintf(out, len, "k%019u", (unsigned)s_key++);
+    return 0;
+}
+int firebase_multi_update(const char* root_path, const char* const* rel_paths, const char* const* jsons, int count)
+{
+    std::string what = std::string("MULTI ") + root_path;
+    for (int i = 0; i < count; ++i) {
+        what += " ";
+        what += rel_paths[i];
+    }
+    record(what);
+    return count;
+}
+
+}
+
+namespace {
+
+struct done_t
+{
+    std::mutex m;
+    std::vector<int> calls;    // callbacks por handle
+    int failures = 0;
+};
+
+void on_done(firebase_async_handle_t handle, int result, void* user)
+{
+    done_t* d = static_cast<done_t*>(user);
+    std::lock_guard<std::mutex> g(d->m);
+    if ((size_t)handle >= d->calls.size()) d->calls.resize(handle + 1, 0);
+    d->calls[handle]++;
+    if (result < 0) d->failures++;
+}
+
+bool wait_done(firebase_async_handle_t handle)
+{
+    for (int i = 0; i < 5000; ++i) {
+        if (firebase_async_poll(handle, nullptr) == FIREBASE_ASYNC_DONE) return true;
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, nullptr);
+    }
+    return false;
+}
+
+void test_priority_and_batching()
+{
+    s_log.clear();
+    SemaphoreHandle_t gate = xSemaphoreCreateBinary();
+    s_gate = gate;
+    done_t done;
+    // El primero ocupa al worker; el resto se acumula mientras tanto
+    firebase_async_handle_t first = firebase_submit_async(FIREBASE_OP_DELETE, "/viejo", nullptr,
+                                                          FIREBASE_PRIO_NORMAL, on_done, &done);
+    CHECK(first > 0);
+    while (s_gate) {
+        struct timespec ts = {0, 100000};
+        nanosleep(&ts, nullptr);
+    }
+    firebase_submit_async(FIREBASE_OP_PUT, "/h/a", "1", FIREBASE_PRIO_LOW, on_done, &done);
+    firebase_submit_async(FIREBASE_OP_PUT, "/h/b", "2", FIREBASE_PRIO_LOW, on_done, &done);
+    firebase_submit_async(FIREBASE_OP_PATCH, "/config", "{}", FIREBASE_PRIO_HIGH, on_done, &done);
+    firebase_submit_async(FIREBASE_OP_PUT, "/h/c", "3", FIREBASE_PRIO_LOW, on_done, &done);
+    firebase_async_handle_t last = firebase_submit_async(FIREBASE_OP_PUT, "/otro/x", "4", FIREBASE_PRIO_LOW,
+                                                         on_done, &done);
+    CHECK_EQ(firebase_async_poll(last, nullptr), FIREBASE_ASYNC_PENDING);
+    xSemaphoreGive(gate);
+    CHECK(wait_done(last));
+
+    std::lock_guard<std::mutex> g(s_log_lock);
+    CHECK_EQ(s_log.size(), 4);
+    CHECK(s_log[0] == "DELETE /viejo");
+    CHECK(s_log[1] == "PATCH /config");
+    CHECK(s_log[2] == "MULTI /h a b c");
+    CHECK(s_log[3] == "PUT /otro/x");
+    CHECK_EQ(done.failures, 0);
+    vSemaphoreDelete(gate);
+}
+
+struct producer_t
+{
+    int id;
+    int count;
+    done_t* done;
+    int rejected;              // veces que encontró la cola llena
+    std::vector<firebase_async_handle_t> handles;
+    SemaphoreHandle_t finished;
+};
+
+void producer_task(void* pv)
+{
+    producer_t* p = static_cast<producer_t*>(pv);
+    char path[48];
+    for (int i = 0; i < p->count; ++i) {
+        snprintf(path, sizeof(path), "/h/p%d_%d", p->id, i);  // mismo padre: se agrupan
+        firebase_async_handle_t h;
+        while ((h = firebase_submit_async(FIREBASE_OP_PUT, path, "1", FIREBASE_PRIO_NORMAL, on_done, p->done)) == -2) {
+            p->rejected++;
+            struct timespec ts = {0, 50000};
+            nanosleep(&ts, nullptr);
+        }
+        CHECK(h > 0);
+        p->handles.push_back(h);
+    }
+    xSemaphoreGive(p->finished);
+    vTaskDelete(NULL);
+}
+
+void test_concurrent_producers()
+{
+    const int PRODUCERS = 8, EACH = 5000;
+    done_t done;
+    producer_t producers[PRODUCERS];
+    for (int i = 0; i < PRODUCERS; ++i) {
+        producers[i].id = i;
+        producers[i].count = EACH;
+        producers[i].done = &done;
+        producers[i].rejected = 0;
+        producers[i].finished = xSemaphoreCreateBinary();
+        CHECK(xTaskCreate(producer_task, "prod", 4096, &producers[i], 5, NULL) == pdPASS);
+    }
+    int rejected = 0;
+    for (producer_t& p : producers) {
+        CHECK(xSemaphoreTake(p.finished, pdMS_TO_TICKS(20000)) == pdTRUE);
+        vSemaphoreDelete(p.finished);
+        rejected += p.rejected;
+    }
+    // firebase_async_poll solo recuerda los últimos resultados: se espera a
+    // que lleguen todos los callbacks
+    int total = 0;
+    for (int tries = 0; tries < 5000 && total < PRODUCERS * EACH; ++tries) {
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, nullptr);
+        std::lock_guard<std::mutex> g(done.m);
+        total = 0;
+        for (int c : done.calls) total += c;
+    }
+    CHECK_EQ(total, PRODUCERS * EACH);
+    std::lock_guard<std::mutex> g(done.m);
+    // Cada handle, un solo callback
+    for (producer_t& p : producers) {
+        for (firebase_async_handle_t h : p.handles) CHECK_EQ(done.calls[h], 1);
+    }
+    CHECK_EQ(done.failures, 0);
+    printf("async: %d requests de %d tareas, %d rechazos por cola llena\n", PRODUCERS * EACH, PRODUCERS, rejected);
+}
+
+}
+
+int main()
+{
+    CHECK_EQ(firebase_async_start(), 0);
+    test_priority_and_batching();
+    test_concurrent_producers();
+    printf("firebase_async: OK\n");
+    return 0;
+}
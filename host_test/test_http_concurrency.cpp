@@ -0,0 +1,118 @@
+// Dos requests simultáneos (dos tareas, dos hosts) por FirebaseApp::httpEventHandler:
+// cada uno tiene que terminar con su propio body en su request_ctx_t.
+#include <cstring>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+
+#include "freertos/task.h"
+#include "app.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+// El server no responde a ninguno hasta tener los dos en vuelo
+struct barrier_t
+{
+    std::mutex m;
+    std::condition_variable cv;
+    int arrived = 0;
+};
+
+std::string body_for(const char* host)
+{
+    std::string body = "{\"host\":\"";
+    body += host;
+    body += "\",\"relleno\":\"";
+    for (int i = 0; i < 500; ++i) body += (char)('a' + (i + host[0]) % 26);
+    body += "\"}";
+    return body;
+}
+
+std::string s_bodies[2];
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    barrier_t* b = static_cast<barrier_t*>(user);
+    {
+        std::unique_lock<std::mutex> g(b->m);
+        b->arrived++;
+        b->cv.notify_all();
+        b->cv.wait(g, [b] { return b->arrived >= 2; });
+    }
+    const std::string& body = strcmp(req->host, "uno.test") == 0 ? s_bodies[0] : s_bodies[1];
+    resp->status = 200;
+    resp->body = body.c_str();
+    resp->chunk = 7;  // muchos ON_DATA chicos
+}
+
+struct job_t
+{
+    FirebaseApp* app;
+    const char* url;
+    std::string got;
+    http_ret_t ret;
+    bool truncated;
+    SemaphoreHandle_t done;
+};
+
+void request_task(void* pv)
+{
+    job_t* job = static_cast<job_t*>(pv);
+    FirebaseApp::request_ctx_t* ctx = job->app->acquireRequest();
+    job->ret = job->app->performRequest(job->url, HTTP_METHOD_GET, nullptr, 0, ctx);
+    job->got.assign(ctx->buffer, ctx->len);
+    job->truncated = ctx->truncated;
+    job->app->releaseRequest(ctx);
+    xSemaphoreGive(job->done);
+    vTaskDelete(NULL);
+}
+
+void test_two_requests_in_flight()
+{
+    s_bodies[0] = body_for("uno.test");
+    s_bodies[1] = body_for("dos.test");
+    barrier_t barrier;
+    fake_http_set_handler(server, &barrier);
+
+    FirebaseApp app("clave");
+    job_t jobs[2] = {};
+    jobs[0].url = "https://uno.test/a.json";
+    jobs[1].url = "https://dos.test/b.json";
+    for (job_t& job : jobs) {
+        job.app = &app;
+        job.done = xSemaphoreCreateBinary();
+        CHECK(xTaskCreate(request_task, "req", 8192, &job, 5, NULL) == pdPASS);
+    }
+    for (job_t& job : jobs) {
+        CHECK(xSemaphoreTake(job.done, pdMS_TO_TICKS(5000)) == pdTRUE);
+        vSemaphoreDelete(job.done);
+    }
+
+    CHECK_EQ(fake_http_max_in_flight(), 2);
+    CHECK_EQ(fake_http_requests(), 2);
+    for (int i = 0; i < 2; ++i) {
+        CHECK_EQ(jobs[i].ret.err, ESP_OK);
+        CHECK_EQ(jobs[i].ret.status_code, 200);
+        CHECK(!jobs[i].truncated);
+        CHECK(jobs[i].got == s_bodies[i]);
+    }
+    const firebase_stats_t& stats = app.getStats();
+    CHECK_EQ(stats.requests, 2);
+    CHECK_EQ(stats.handshakes, 2);
+    CHECK_EQ(stats.rx_body_bytes, s_bodies[0].size() + s_bodies[1].size());
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+}
+
+int main()
+{
+    test_two_requests_in_flight();
+    printf("http_concurrency: OK\n");
+    return 0;
+}
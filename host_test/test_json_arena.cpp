@@ -0,0 +1,196 @@
+// Json::Arena en el ciclo parse/uso/liberar de getData y trimOldestBatch: el
+// mismo árbol que en el heap, el heap de vuelta a donde estaba tras reset(),
+// y el benchmark contra el camino de siempre (allocations, pico de heap y
+// tiempo por documento) con Reader, CharReader y ValueBuilder.
+#include <time.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "json.h"
+#include "stream_reader.h"
+#include "alloc_counter.h"
+#include "test_util.h"
+
+namespace {
+
+// Una página del historial: 60 lotes con la forma de los que sube el equipo
+std::string history_page()
+{
+    std::string doc = "{";
+    char item[256];
+    for (int i = 0; i < 60; ++i) {
+        snprintf(item, sizeof(item),
+                 "%s\"-Nk%017d\":{\"ts\":%d,\"pm25\":%.1f,\"pm10\":%.1f,\"temp\":%.2f,\"hum\":%.1f,"
+                 "\"equipo\":\"c3-01\",\"ok\":true}",
+                 i ? "," : "", 4000000 + i * 7919, 1760000000 + i * 60, 5 + (i % 30) * 0.7,
+                 9 + (i % 17) * 1.3, 18 + (i % 40) * 0.25, 40 + (i % 25) * 1.1);
+        doc += item;
+    }
+    return doc + "}";
+}
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Lo que se hace con la página: recorrerla (como trimOldestBatch con las claves)
+double use(const Json::Value& root)
+{
+    double sum = 0;
+    for (Json::Value::const_iterator it = root.begin(); it != root.end(); ++it) {
+        const char* end;
+        const char* name = it.memberName(&end);
+        sum += (*it)["pm25"].asDouble() + (end - name);
+    }
+    return sum;
+}
+
+struct parser_t
+{
+    const char* name;
+    Json::Arena* arena;
+    // Un ciclo completo: parsear, usar, destruir el árbol (y reset de la arena)
+    double (*cycle)(const std::string& doc, Json::Arena* arena);
+};
+
+double reader_cycle(const std::string& doc, Json::Arena* arena)
+{
+    double sum;
+    {
+        Json::Reader reader;
+        reader.setArena(arena);
+        Json::Value root;
+        CHECK(reader.parse(doc.data(), doc.data() + doc.size(), root, false));
+        sum = use(root);
+    }
+    if (arena) arena->reset();
+    return sum;
+}
+
+double char_reader_cycle(const std::string& doc, Json::Arena* arena)
+{
+    double sum;
+    {
+        Json::CharReaderBuilder builder;
+        builder.setArena(arena);
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        Json::Value root;
+        CHECK(reader->parse(doc.data(), doc.data() + doc.size(), &root, nullptr));
+        sum = use(root);
+    }
+    if (arena) arena->reset();
+    return sum;
+}
+
+double value_builder_cycle(const std::string& doc, Json::Arena* arena)
+{
+    double sum;
+    {
+        Json::Value root;
+        Json::ValueBuilder builder(root, arena);
+        Json::StreamReader reader(builder);
+        CHECK(reader.feed(doc.data(), doc.size()) && reader.finish());
+        sum = use(root);
+    }
+    if (arena) arena->reset();
+    return sum;
+}
+
+void test_same_tree_and_heap_back()
+{
+    std::string doc = history_page();
+    Json::Value heap_root;
+    Json::Reader heap_reader;
+    CHECK(heap_reader.parse(doc, heap_root));
+
+    Json::Arena arena(16 * 1024);
+    alloc_stats_t before = alloc_counter_get();
+    {
+        Json::Reader reader;
+        reader.setArena(&arena);
+        Json::Value root;
+        CHECK(reader.parse(doc, root));
+        CHECK(root == heap_root);
+        CHECK_EQ(root.size(), 60);
+        CHECK(arena.used() > 0);
+        CHECK_EQ(arena.failures(), 0);
+        // Copia fuera de la arena: sobrevive al reset
+        heap_root = root["-Nk00000000004000000"];
+    }
+    arena.reset();
+    CHECK_EQ(arena.used(), 0);
+    CHECK_EQ(arena.chunks(), 1);
+    CHECK_EQ(heap_root["ts"].asInt(), 1760000000);
+    // Queda la copia y el chunk que guarda la arena para la próxima
+    alloc_stats_t after = alloc_counter_get();
+    CHECK((long long)after.in_use - (long long)before.in_use <= (long long)arena.reserved() + 1024);
+}
+
+struct cost_t
+{
+    double allocs;
+    size_t peak;
+    double us;
+};
+
+cost_t measure(const parser_t& p, const std::string& doc, int n)
+{
+    double expected = p.cycle(doc, p.arena);  // calentar (chunk de la arena incluido)
+    alloc_stats_t before = alloc_counter_get();
+    alloc_counter_reset_peak();
+    int64_t t0 = now_ns();
+    for (int i = 0; i < n; ++i) CHECK(p.cycle(doc, p.arena) == expected);
+    int64_t elapsed = now_ns() - t0;
+    alloc_stats_t after = alloc_counter_get();
+    CHECK_EQ(after.in_use, before.in_use);   // nada queda colgado entre ciclos
+    return {(after.allocs - before.allocs) / (double)n, after.peak - before.in_use, elapsed / 1000.0 / n};
+}
+
+void bench_arena()
+{
+    const int N = 2000;
+    std::string doc = history_page();
+    // Chunks por defecto (2 KB, se piden y devuelven en cada ciclo) y uno que
+    // entra entero en el chunk que reset() conserva
+    Json::Arena small;
+    Json::Arena big(64 * 1024);
+    const parser_t parsers[] = {
+        {"Reader, heap", nullptr, reader_cycle},
+        {"Reader, arena 2K", &small, reader_cycle},
+        {"Reader, arena 64K", &big, reader_cycle},
+        {"CharReader, heap", nullptr, char_reader_cycle},
+        {"CharReader, arena 2K", &small, char_reader_cycle},
+        {"CharReader, arena 64K", &big, char_reader_cycle},
+        {"ValueBuilder, heap", nullptr, value_builder_cycle},
+        {"ValueBuilder, arena 2K", &small, value_builder_cycle},
+        {"ValueBuilder, arena 64K", &big, value_builder_cycle},
+    };
+    printf("página de 60 lotes (%u bytes), %d ciclos parse/uso/liberar:\n", (unsigned)doc.size(), N);
+    cost_t costs[9];
+    for (int i = 0; i < 9; ++i) {
+        costs[i] = measure(parsers[i], doc, N);
+        printf("  %-24s %7.1f allocations, pico %6u B, %7.2f us\n", parsers[i].name, costs[i].allocs,
+               (unsigned)costs[i].peak, costs[i].us);
+    }
+    // Con la arena el árbol no pasa por malloc: lo que queda es del parser y,
+    // con chunks chicos, los chunks
+    for (int i = 0; i < 9; i += 3) {
+        CHECK(costs[i + 1].allocs * 5 < costs[i].allocs);
+        CHECK(costs[i + 2].allocs * 10 < costs[i].allocs);
+        CHECK(costs[i + 2].peak * 4 < costs[i].peak);
+    }
+}
+}
+
+int main()
+{
+    test_same_tree_and_heap_back();
+    bench_arena();
+    printf("json_arena: OK\n");
+    return 0;
+}
@@ -0,0 +1,387 @@
+// writeShortestDouble / writeFixedDouble contra la libc, sobre millones de
+// doubles al azar (patrones de bits de todo el rango, valores de sensores) y
+// los bordes: el texto corto siempre vuelve al mismo double, y se cuenta cuántas
+// veces no es el más corto ni el más cercano (Grisu2: la excepción); el fijo
+// es idéntico a "%.*f".
+// JSON_DTOA_ROUNDS cambia la cantidad de cada tanda (por defecto 1000000).
+// Benchmark contra snprintf y el valueToString de siempre.
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "json.h"
+#include "json_tool.h"
+#include "test_util.h"
+
+namespace {
+
+uint64_t s_state = 0x9E3779B97F4A7C15ull;
+
+uint64_t next_random()
+{
+    // xorshift64*
+    s_state ^= s_state >> 12;
+    s_state ^= s_state << 25;
+    s_state ^= s_state >> 27;
+    return s_state * 0x2545F4914F6CDD1Dull;
+}
+
+double from_bits(uint64_t bits)
+{
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+uint64_t to_bits(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+// Dígitos significativos de un número en texto ("-0.00120e+05" -> 3)
+int significant_digits(const char* s)
+{
+    int count = 0, pending_zeros = 0;
+    bool started = false;
+    for (; *s && *s != 'e' && *s != 'E'; ++s) {
+        if (*s < '0' || *s > '9') continue;
+        if (*s == '0') {
+            if (started) pending_zeros++;
+            continue;
+        }
+        started = true;
+        count += pending_zeros + 1;
+        pending_zeros = 0;
+    }
+    return count ? count : 1;
+}
+
+// Los dígitos significativos, sin ceros a los costados ("0.0120e+05" -> "12")
+std::string digit_string(const char* s)
+{
+    std::string out;
+    for (; *s && *s != 'e' && *s != 'E'; ++s) {
+        if (*s >= '0' && *s <= '9' && (*s != '0' || !out.empty())) out += *s;
+    }
+    while (!out.empty() && out.back() == '0') out.pop_back();
+    return out;
+}
+
+bool round_trips(const char* s, double d)
+{
+    return to_bits(strtod(s, nullptr)) == to_bits(d);
+}
+
+// El texto más corto con 'precision' dígitos cae justo en el medio entre d
+// y un vecino: strtod lo lleva a d solo por el redondeo al par. Grisu2 deja
+// afuera esos bordes (1e23 sale como 9.999999999999999e+22). Se corre el
+// texto un pelo hacia el vecino: si está en el borde, ya no vuelve a d.
+bool on_boundary(double d, int precision)
+{
+    d = fabs(d);
+    char text[80];
+    snprintf(text, sizeof(text), "%.*e", precision - 1, d);
+    char* e = strchr(text, 'e');
+    std::string exponent(e), mantissa(text, e);
+    if (mantissa.find('.') == std::string::npos) mantissa += '.';
+    if (strtold(text, nullptr) > d) {
+        mantissa += "000000000000000000000000000001";
+    } else {
+        // Restar uno en el último dígito y seguir con nueves
+        for (size_t i = mantissa.size(); i-- > 0;) {
+            if (mantissa[i] == '.') continue;
+            if (mantissa[i] != '0') {
+                mantissa[i]--;
+                break;
+            }
+            mantissa[i] = '9';
+        }
+        mantissa += "999999999999999999999999999999";
+    }
+    return !round_trips((mantissa + exponent).c_str(), d);
+}
+
+struct shortest_stats_t
+{
+    uint64_t checked;
+    uint64_t longer;       // no es el más corto (Grisu2)
+    uint64_t two_longer;   // de esos, con dos dígitos de más
+    uint64_t boundary;     // el más corto solo vuelve por el redondeo al par
+    uint64_t not_closest;  // otros dígitos que "%.*e" con el mismo largo
+};
+
+void check_shortest(double d, shortest_stats_t& stats)
+{
+    char out[32];
+    size_t len = Json::writeShortestDouble(d, out);
+    CHECK_EQ(len, strlen(out));
+    if (!round_trips(out, d)) {
+        fprintf(stderr, "%.17g (0x%016llx) -> \"%s\" no vuelve\n", d, (unsigned long long)to_bits(d), out);
+        exit(1);
+    }
+    // Siempre se lee como real, y nunca más largo que %.17g
+    CHECK(strchr(out, '.') || strchr(out, 'e'));
+    int digits = significant_digits(out);
+    CHECK(digits <= 17);
+    stats.checked++;
+    char closest[40];
+    snprintf(closest, sizeof(closest), "%.*e", digits - 1, d);
+    if (digit_string(closest) != digit_string(out)) stats.not_closest++;
+    char shorter[40];
+    int extra = 0;
+    bool boundary = false;
+    while (extra < 2 && digits - extra > 1) {
+        snprintf(shorter, sizeof(shorter), "%.*g", digits - extra - 1, d);
+        if (!round_trips(shorter, d)) break;
+        boundary = boundary || on_boundary(d, digits - extra - 1);
+        extra++;
+    }
+    if (!extra) return;
+    if (boundary) {
+        stats.boundary++;
+        return;
+    }
+    stats.longer++;
+    if (extra > 1) stats.two_longer++;
+}
+
+void check_fixed(double d, unsigned decimals, uint64_t& fast, uint64_t& fallback)
+{
+    char out[40];
+    size_t len = 0;
+    if (!Json::writeFixedDouble(d, decimals, out, &len)) {
+        fallback++;
+        return;
+    }
+    fast++;
+    char want[400];
+    snprintf(want, sizeof(want), "%.*f", (int)decimals, d);
+    if (strcmp(out, want) != 0 || len != strlen(want)) {
+        fprintf(stderr, "%.17g con %u decimales: \"%s\", libc \"%s\"\n", d, decimals, out, want);
+        exit(1);
+    }
+}
+
+uint64_t rounds()
+{
+    const char* env = getenv("JSON_DTOA_ROUNDS");
+    return env ? strtoull(env, nullptr, 10) : 1000000;
+}
+
+void test_shortest_edges()
+{
+    shortest_stats_t stats = {};
+    const double edges[] = {0.1, 0.2, 0.3, 1.0 / 3, 2.0 / 3, 1e23, 9007199254740993.0, 9007199254740992.0,
+                            5e-324, 2.2250738585072009e-308, DBL_MIN, DBL_MAX, DBL_EPSILON, 1e21, 1e22,
+                            123456789012345680000.0, 1e-7, 1e-6, 0.000001234, 22.85, 48.2, 7.4, 1760000000.5};
+    for (double d : edges) {
+        check_shortest(d, stats);
+        check_shortest(-d, stats);
+    }
+    // Potencias de 2 y de 10 en todo el rango
+    for (int e = -1074; e <= 1023; ++e) check_shortest(ldexp(1.0, e), stats);
+    for (int e = -323; e <= 308; ++e) check_shortest(strtod(("1e" + std::to_string(e)).c_str(), nullptr), stats);
+    // Cada double alrededor de cambios de exponente
+    for (int e = -1022; e <= 1023; e += 7) {
+        double p = ldexp(1.0, e);
+        check_shortest(nextafter(p, 0), stats);
+        check_shortest(nextafter(p, INFINITY), stats);
+    }
+
+    char out[32];
+    Json::writeShortestDouble(0.0, out);
+    CHECK(strcmp(out, "0.0") == 0);
+    Json::writeShortestDouble(-0.0, out);
+    CHECK(strcmp(out, "-0.0") == 0);
+    Json::writeShortestDouble(0.1, out);
+    CHECK(strcmp(out, "0.1") == 0);
+    Json::writeShortestDouble(1e21, out);
+    CHECK(strcmp(out, "1e+21") == 0);
+    Json::writeShortestDouble(100.0, out);
+    CHECK(strcmp(out, "100.0") == 0);
+    Json::writeShortestDouble(1.5e-7, out);
+    CHECK(strcmp(out, "1.5e-07") == 0);
+}
+
+void test_shortest_random()
+{
+    const uint64_t n = rounds();
+    shortest_stats_t bits = {}, sensor = {};
+    for (uint64_t i = 0; i < n; ++i) {
+        // Cualquier patrón finito (incluye subnormales)
+        uint64_t b = next_random();
+        if (((b >> 52) & 0x7FF) == 0x7FF) continue;
+        check_shortest(from_bits(b), bits);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        // Lecturas con 1 a 4 decimales, como las que sube el equipo
+        uint64_t r = next_random();
+        int decimals = 1 + (int)(r % 4);
+        double v = (double)(int64_t)((r >> 8) % 20000000) / pow(10.0, decimals);
+        check_shortest((r >> 63) ? -v : v, sensor);
+    }
+    const shortest_stats_t* sets[] = {&bits, &sensor};
+    const char* names[] = {"patrones de bits", "lecturas"};
+    for (int i = 0; i < 2; ++i) {
+        const shortest_stats_t& st = *sets[i];
+        printf("shortest, %s: %llu, %.4f%% no son el más corto (%llu con dos dígitos de más), "
+               "%llu en un borde, %llu no son los más cercanos\n", names[i], (unsigned long long)st.checked,
+               100.0 * st.longer / st.checked, (unsigned long long)st.two_longer,
+               (unsigned long long)st.boundary, (unsigned long long)st.not_closest);
+        // Grisu2: los dígitos de más son la excepción
+        CHECK(st.longer * 100 < st.checked);
+        CHECK(st.two_longer * 1000 < st.checked);
+        CHECK(st.not_closest * 1000 < st.checked);
+    }
+}
+
+void test_fixed_random()
+{
+    const uint64_t n = rounds();
+    // Por tipo de valor: en el camino rápido / devuelto a snprintf
+    uint64_t fast[4] = {}, fallback[4] = {};
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t r = next_random();
+        unsigned decimals = (unsigned)(r % 10);
+        double v;
+        int kind = (int)((r >> 4) % 4);
+        switch (kind) {
+        case 0:  // cualquier patrón de bits
+            v = from_bits(next_random());
+            if (!isfinite(v)) continue;
+            break;
+        case 1:  // magnitudes de sensores
+            v = (double)(int64_t)(next_random() % 2000000000) / 1e6 - 1000;
+            break;
+        case 2:  // mitades exactas: redondeo al par
+            v = (double)(int64_t)(next_random() % 100000) / 8.0;
+            break;
+        default: // cerca del límite de 64 bits
+            v = ldexp((double)(next_random() >> 11), (int)(next_random() % 24));
+            break;
+        }
+        check_fixed(v, decimals, fast[kind], fallback[kind]);
+        check_fixed(-v, decimals, fast[kind], fallback[kind]);
+    }
+    const char* kinds[] = {"patrones de bits", "sensores", "mitades", "cerca de 2^64"};
+    for (int k = 0; k < 4; ++k) {
+        printf("fixed, %s: %llu iguales a %%.*f, %llu devueltos a snprintf\n", kinds[k],
+               (unsigned long long)fast[k], (unsigned long long)fallback[k]);
+    }
+    // Lo que manda el equipo nunca sale del camino rápido
+    CHECK_EQ(fallback[1], 0);
+    CHECK_EQ(fallback[2], 0);
+
+    uint64_t f = 0, b = 0;
+    check_fixed(0.125, 2, f, b);
+    check_fixed(0.375, 2, f, b);
+    check_fixed(2.5, 0, f, b);
+    check_fixed(5e-324, 9, f, b);
+    check_fixed(0.5, 0, f, b);
+    check_fixed(1e10, 9, f, b);
+    CHECK_EQ(b, 0);
+    CHECK(!Json::writeFixedDouble(1.0, 10, nullptr, nullptr));
+    char out[40];
+    size_t len;
+    CHECK(!Json::writeFixedDouble(NAN, 2, out, &len));
+    CHECK(!Json::writeFixedDouble(1e300, 2, out, &len));
+}
+
+void test_writer_settings()
+{
+    Json::Value v(Json::objectValue);
+    v["temp"] = 22.85;
+    v["pm25"] = 0.1 + 0.2;
+    v["ts"] = 1760000000.0;
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    builder["precisionType"] = "shortest";
+    CHECK(Json::writeString(builder, v) == "{\"pm25\":0.30000000000000004,\"temp\":22.85,\"ts\":1760000000.0}");
+    builder["precisionType"] = "decimal";
+    builder["precision"] = 2;
+    CHECK(Json::writeString(builder, v) == "{\"pm25\":0.3,\"temp\":22.85,\"ts\":1760000000.0}");
+}
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+volatile size_t s_sink;
+
+template <typename F>
+double ns_per_value(const double* values, int count, int passes, F format)
+{
+    int64_t t0 = now_ns();
+    for (int p = 0; p < passes; ++p) {
+        for (int i = 0; i < count; ++i) s_sink += format(values[i]);
+    }
+    return (now_ns() - t0) / (double)(passes * count);
+}
+
+void bench_formatting()
+{
+    const int COUNT = 4096, PASSES = 50;
+    static double sensor[COUNT], any[COUNT];
+    for (int i = 0; i < COUNT; ++i) {
+        uint64_t r = next_random();
+        sensor[i] = (double)(int64_t)(r % 200000) / 100.0;
+        uint64_t b;
+        do b = next_random(); while (((b >> 52) & 0x7FF) == 0x7FF);
+        any[i] = from_bits(b);
+    }
+    struct {
+        const char* name;
+        const double* values;
+    } sets[] = {{"lecturas (2 decimales)", sensor}, {"patrones de bits", any}};
+    for (auto& set : sets) {
+        size_t len_shortest = 0, len_17g = 0;
+        char out[400];
+        for (int i = 0; i < COUNT; ++i) {
+            len_shortest += Json::writeShortestDouble(set.values[i], out);
+            len_17g += (size_t)snprintf(out, sizeof(out), "%.17g", set.values[i]);
+        }
+        double shortest = ns_per_value(set.values, COUNT, PASSES,
+                                       [&out](double d) { return Json::writeShortestDouble(d, out); });
+        double g17 = ns_per_value(set.values, COUNT, PASSES,
+                                  [&out](double d) { return (size_t)snprintf(out, sizeof(out), "%.17g", d); });
+        double legacy = ns_per_value(set.values, COUNT, PASSES,
+                                     [](double d) { return Json::valueToString(d).size(); });
+        printf("%s: writeShortestDouble %.0f ns (%.1f chars), snprintf %%.17g %.0f ns (%.1f chars), "
+               "valueToString %.0f ns\n", set.name, shortest, len_shortest / (double)COUNT, g17,
+               len_17g / (double)COUNT, legacy);
+    }
+    double fixed = ns_per_value(sensor, COUNT, PASSES, [](double d) {
+        char out[40];
+        size_t len = 0;
+        Json::writeFixedDouble(d, 2, out, &len);
+        return len;
+    });
+    double printf_fixed = ns_per_value(sensor, COUNT, PASSES, [](double d) {
+        char out[40];
+        return (size_t)snprintf(out, sizeof(out), "%.2f", d);
+    });
+    printf("lecturas con 2 decimales: writeFixedDouble %.0f ns, snprintf %%.2f %.0f ns\n", fixed, printf_fixed);
+}
+
+}
+
+int main()
+{
+    test_shortest_edges();
+    test_shortest_random();
+    test_fixed_random();
+    test_writer_settings();
+    bench_formatting();
+    printf("json_dtoa: OK\n");
+    return 0;
+}
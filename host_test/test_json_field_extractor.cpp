@@ -0,0 +1,178 @@
+// Json::FieldExtractor sobre respuestas de auth con la forma real de
+// identitytoolkit (signInWithPassword) y securetoken (refresh): los mismos
+// campos que el DOM de Json::Reader, solo los del primer nivel, y cero
+// allocations. Benchmark contra el DOM: heap y tiempo por respuesta.
+#include <time.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "json.h"
+#include "stream_reader.h"
+#include "alloc_counter.h"
+#include "test_util.h"
+
+namespace {
+
+// JWT de mentira con el largo de uno real (~950 bytes en base64url)
+std::string fake_jwt(unsigned seed)
+{
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string out;
+    for (int part = 0; part < 3; ++part) {
+        int len = part == 0 ? 130 : part == 1 ? 560 : 342;
+        for (int i = 0; i < len; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            out += ALPHABET[(seed >> 16) & 63];
+        }
+        if (part < 2) out += '.';
+    }
+    return out;
+}
+
+std::string login_response(const std::string& id_token, const std::string& refresh)
+{
+    return "{\n"
+           "  \"kind\": \"identitytoolkit#VerifyPasswordResponse\",\n"
+           "  \"localId\": \"q8ZbS2yV1mXcP0fT3kLw9aRj4Hn2\",\n"
+           "  \"email\": \"equipo-c3-01@example.com\",\n"
+           "  \"displayName\": \"\",\n"
+           "  \"idToken\": \"" + id_token + "\",\n"
+           "  \"registered\": true,\n"
+           "  \"refreshToken\": \"" + refresh + "\",\n"
+           "  \"expiresIn\": \"3600\"\n"
+           "}\n";
+}
+
+std::string refresh_response(const std::string& id_token, const std::string& refresh)
+{
+    return "{\n"
+           "  \"access_token\": \"" + id_token + "\",\n"
+           "  \"expires_in\": \"3600\",\n"
+           "  \"token_type\": \"Bearer\",\n"
+           "  \"refresh_token\": \"" + refresh + "\",\n"
+           "  \"id_token\": \"" + id_token + "\",\n"
+           "  \"user_id\": \"q8ZbS2yV1mXcP0fT3kLw9aRj4Hn2\",\n"
+           "  \"project_id\": \"123456789012\"\n"
+           "}\n";
+}
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Lo que hace getAuthToken: access_token, refresh_token y expires_in
+struct extracted_t
+{
+    char access_token[1100];
+    char refresh_token[300];
+    char expires_in[16];
+    bool ok;
+};
+
+void extract_refresh(const std::string& doc, extracted_t& out)
+{
+    char scratch[1200];
+    Json::FieldExtractor::Field fields[] = {
+        {"access_token", out.access_token, sizeof(out.access_token)},
+        {"refresh_token", out.refresh_token, sizeof(out.refresh_token)},
+        {"expires_in", out.expires_in, sizeof(out.expires_in)},
+    };
+    out.ok = Json::FieldExtractor::extract(doc.data(), doc.size(), fields, 3, scratch, sizeof(scratch)) &&
+             fields[0].found && fields[1].found && fields[2].found;
+}
+
+// El camino de antes: DOM completo con Json::Reader
+void dom_refresh(const std::string& doc, extracted_t& out)
+{
+    Json::Reader reader;
+    Json::Value root;
+    out.ok = reader.parse(doc, root) && root["access_token"].isString();
+    if (!out.ok) return;
+    snprintf(out.access_token, sizeof(out.access_token), "%s", root["access_token"].asCString());
+    snprintf(out.refresh_token, sizeof(out.refresh_token), "%s", root["refresh_token"].asCString());
+    snprintf(out.expires_in, sizeof(out.expires_in), "%s", root["expires_in"].asCString());
+}
+
+void test_same_fields_as_dom()
+{
+    std::string id_token = fake_jwt(1), refresh = fake_jwt(2).substr(0, 220);
+    std::string doc = refresh_response(id_token, refresh);
+    extracted_t a = {}, b = {};
+    extract_refresh(doc, a);
+    dom_refresh(doc, b);
+    CHECK(a.ok && b.ok);
+    CHECK(id_token == a.access_token);
+    CHECK(strcmp(a.access_token, b.access_token) == 0);
+    CHECK(strcmp(a.refresh_token, b.refresh_token) == 0);
+    CHECK(strcmp(a.expires_in, "3600") == 0);
+
+    // Login: refreshToken, y un expiresIn anidado no cuenta
+    std::string login = login_response(id_token, refresh);
+    login.insert(login.find("\"registered\""), "\"providerUserInfo\": [{\"expiresIn\": \"1\"}],\n  ");
+    char token[300], expires[16];
+    char scratch[1200];
+    Json::FieldExtractor::Field fields[] = {
+        {"refreshToken", token, sizeof(token)},
+        {"expiresIn", expires, sizeof(expires)},
+        {"registered", expires, 2},   // "true" no cabe: truncated
+    };
+    CHECK(Json::FieldExtractor::extract(login.data(), login.size(), fields, 3, scratch, sizeof(scratch)));
+    CHECK(fields[0].found && refresh == token);
+    CHECK(fields[1].found && strcmp(expires, "3600") == 0);
+    CHECK(!fields[2].found && fields[2].truncated);
+
+    // Error de securetoken: sin access_token
+    const std::string error = "{\"error\":{\"code\":400,\"message\":\"INVALID_REFRESH_TOKEN\",\"errors\":[]}}";
+    extracted_t c = {};
+    extract_refresh(error, c);
+    CHECK(!c.ok);
+}
+
+struct cost_t
+{
+    double allocs;         // por respuesta
+    size_t peak;           // bytes de heap por encima de lo que había
+    double us;             // por respuesta
+};
+
+cost_t measure(void (*parse)(const std::string&, extracted_t&), const std::string& doc, int n)
+{
+    extracted_t out;
+    parse(doc, out);   // calentar
+    CHECK(out.ok);
+    alloc_stats_t before = alloc_counter_get();
+    alloc_counter_reset_peak();
+    int64_t t0 = now_ns();
+    for (int i = 0; i < n; ++i) parse(doc, out);
+    int64_t elapsed = now_ns() - t0;
+    alloc_stats_t after = alloc_counter_get();
+    CHECK(out.ok);
+    return {(after.allocs - before.allocs) / (double)n, after.peak - before.in_use, elapsed / 1000.0 / n};
+}
+
+void bench_auth_responses()
+{
+    const int N = 20000;
+    std::string doc = refresh_response(fake_jwt(3), fake_jwt(4).substr(0, 220));
+    cost_t dom = measure(dom_refresh, doc, N);
+    cost_t sax = measure(extract_refresh, doc, N);
+    printf("refresh (%u bytes), %d respuestas:\n", (unsigned)doc.size(), N);
+    printf("  Reader + DOM:    %6.1f allocations, pico %6u B, %6.2f us\n", dom.allocs, (unsigned)dom.peak, dom.us);
+    printf("  FieldExtractor:  %6.1f allocations, pico %6u B, %6.2f us\n", sax.allocs, (unsigned)sax.peak, sax.us);
+    CHECK(sax.allocs == 0);
+    CHECK_EQ(sax.peak, 0);
+}
+
+}
+
+int main()
+{
+    test_same_fields_as_dom();
+    bench_auth_responses();
+    printf("json_field_extractor: OK\n");
+    return 0;
+}
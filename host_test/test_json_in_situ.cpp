@@ -0,0 +1,216 @@
+// StreamReader::parseInSitu deja strings y claves sin escapes apuntando al
+// documento. Value::deepCopy() tiene que dar un árbol que no dependa de ese
+// texto ni de la arena donde se armó: se pisa el documento, se vacía la
+// arena y la copia tiene que seguir igual. Benchmark: listado shallow de
+// miles de claves con Reader, con StreamReader copiando y en in situ.
+#include <time.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "json.h"
+#include "stream_reader.h"
+#include "alloc_counter.h"
+#include "test_util.h"
+
+namespace {
+
+const char* DOC =
+    "{\"equipo\":\"c3-01\",\"sin\\\"escape\":\"con \\\"escape\\\"\",\"lista\":[\"a\",\"bb\",{\"k\":\"v\"}],"
+    "\"n\":1.25,\"ok\":true,\"nada\":null,\"vacio\":\"\"}";
+
+void check_tree(const Json::Value& v)
+{
+    CHECK(v.isObject());
+    CHECK_EQ(v.size(), 7);
+    CHECK(v["equipo"].asString() == "c3-01");
+    CHECK(v["sin\"escape"].asString() == "con \"escape\"");
+    CHECK_EQ(v["lista"].size(), 3);
+    CHECK(v["lista"][1].asString() == "bb");
+    CHECK(v["lista"][2]["k"].asString() == "v");
+    CHECK(v["n"].asDouble() == 1.25);
+    CHECK(v["ok"].asBool());
+    CHECK(v["nada"].isNull());
+    CHECK(v["vacio"].isString() && v["vacio"].asString().empty());
+}
+
+void test_deep_copy_in_situ()
+{
+    std::string text = DOC;
+    Json::Arena arena;
+    Json::Value copy;
+    Json::Value plain;
+    {
+        Json::Value root;
+        Json::ValueBuilder builder(root, &arena);
+        Json::StreamReader reader(builder);
+        CHECK(reader.parseInSitu(&text[0], text.size()));
+        check_tree(root);
+        copy = root.deepCopy();
+        plain = root;
+        CHECK(copy == root);
+    }
+    arena.reset();
+    // Una copia común sigue apuntando al documento: la clave "equipo" deja
+    // de encontrarse cuando se pisa el texto
+    memset(&text[0], 'x', text.size());
+    CHECK(!plain.isMember("equipo"));
+    check_tree(copy);
+    // Y se puede modificar sin tocar nada prestado
+    copy["equipo"] = "c3-02";
+    copy["lista"].append("ccc");
+    CHECK(copy["equipo"].asString() == "c3-02");
+    CHECK_EQ(copy["lista"].size(), 4);
+}
+
+void test_deep_copy_plain()
+{
+    // Escalares, StaticString y un árbol del heap: misma semántica que copiar
+    static const Json::StaticString label("etiqueta");
+    Json::Value v(Json::objectValue);
+    v[label] = Json::StaticString("fijo");
+    v["i"] = -3;
+    v["u"] = 7u;
+    v["a"] = Json::Value(Json::arrayValue);
+    Json::Value copy = v.deepCopy();
+    CHECK(copy == v);
+    CHECK(copy["etiqueta"].asCString() != v["etiqueta"].asCString());
+    CHECK(Json::Value(12).deepCopy() == Json::Value(12));
+    CHECK(Json::Value().deepCopy().isNull());
+    CHECK(Json::Value(Json::arrayValue).deepCopy().isArray());
+}
+
+// Respuesta de GET ?shallow=true sobre el historial: clave -> true
+std::string shallow_listing(int keys)
+{
+    std::string doc = "{";
+    char item[48];
+    for (int i = 0; i < keys; ++i) {
+        snprintf(item, sizeof(item), "%s\"-Nk%017d\":true", i ? "," : "", 4000000 + i * 7919);
+        doc += item;
+    }
+    return doc + "}";
+}
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Un ciclo: parsear, contar las claves, liberar. 'work' es el buffer del
+// documento (in situ lo pisa: se recarga en cada vuelta, como llega de la red)
+typedef size_t (*cycle_t)(const std::string& doc, std::vector<char>& work, Json::Arena* arena);
+
+size_t reader_cycle(const std::string& doc, std::vector<char>&, Json::Arena*)
+{
+    Json::Reader reader;
+    Json::Value root;
+    CHECK(reader.parse(doc.data(), doc.data() + doc.size(), root, false));
+    return root.size();
+}
+
+size_t stream_cycle(const std::string& doc, std::vector<char>&, Json::Arena* arena)
+{
+    size_t n;
+    {
+        Json::Value root;
+        Json::ValueBuilder builder(root, arena);
+        Json::StreamReader reader(builder);
+        CHECK(reader.feed(doc.data(), doc.size()) && reader.finish());
+        n = root.size();
+    }
+    if (arena) arena->reset();
+    return n;
+}
+
+size_t in_situ_cycle(const std::string& doc, std::vector<char>& work, Json::Arena* arena)
+{
+    memcpy(work.data(), doc.data(), doc.size());
+    size_t n;
+    {
+        Json::Value root;
+        Json::ValueBuilder builder(root, arena);
+        Json::StreamReader reader(builder);
+        CHECK(reader.parseInSitu(work.data(), doc.size()));
+        n = root.size();
+    }
+    if (arena) arena->reset();
+    return n;
+}
+
+struct cost_t
+{
+    double allocs;
+    size_t peak;
+    double us;
+    size_t arena_used;     // bytes del árbol en la arena
+};
+
+cost_t measure(cycle_t cycle, const std::string& doc, Json::Arena* arena, size_t keys, int n)
+{
+    std::vector<char> work(doc.size());
+    CHECK_EQ(cycle(doc, work, arena), keys);   // calentar
+    alloc_stats_t before = alloc_counter_get();
+    alloc_counter_reset_peak();
+    int64_t t0 = now_ns();
+    for (int i = 0; i < n; ++i) CHECK_EQ(cycle(doc, work, arena), keys);
+    int64_t elapsed = now_ns() - t0;
+    alloc_stats_t after = alloc_counter_get();
+    size_t used = 0;
+    if (arena) {
+        // Una vuelta más sin el reset del final para ver lo que ocupó
+        std::vector<char> copy(doc.begin(), doc.end());
+        Json::Value root;
+        Json::ValueBuilder builder(root, arena);
+        Json::StreamReader reader(builder);
+        CHECK(cycle == in_situ_cycle ? reader.parseInSitu(copy.data(), copy.size())
+                                     : reader.feed(doc.data(), doc.size()) && reader.finish());
+        used = arena->used();
+    }
+    if (arena) arena->reset();
+    return {(after.allocs - before.allocs) / (double)n, after.peak - before.in_use, elapsed / 1000.0 / n, used};
+}
+
+void bench_shallow_listing()
+{
+    const int KEYS = 3000, N = 100;
+    std::string doc = shallow_listing(KEYS);
+    Json::Arena arena(512 * 1024);   // el árbol entra en el chunk que se conserva
+    struct {
+        const char* name;
+        cycle_t cycle;
+        Json::Arena* arena;
+    } runs[] = {
+        {"Reader", reader_cycle, nullptr},
+        {"StreamReader", stream_cycle, nullptr},
+        {"StreamReader, arena", stream_cycle, &arena},
+        {"in situ", in_situ_cycle, nullptr},
+        {"in situ, arena", in_situ_cycle, &arena},
+    };
+    printf("shallow de %d claves (%u bytes), %d ciclos:\n", KEYS, (unsigned)doc.size(), N);
+    cost_t costs[5];
+    for (int i = 0; i < 5; ++i) {
+        costs[i] = measure(runs[i].cycle, doc, runs[i].arena, KEYS, N);
+        printf("  %-20s %7.0f allocations, pico %7u B, arena %7u B, %8.1f us\n", runs[i].name,
+               costs[i].allocs, (unsigned)costs[i].peak, (unsigned)costs[i].arena_used, costs[i].us);
+    }
+    // In situ no copia las claves: la mitad de las allocations en el heap, y
+    // con la arena casi ninguna
+    CHECK(costs[3].allocs * 2 <= costs[0].allocs + 10);
+    CHECK(costs[4].allocs * 100 < costs[0].allocs);
+    CHECK(costs[4].arena_used < costs[2].arena_used);
+}
+
+}
+
+int main()
+{
+    test_deep_copy_in_situ();
+    test_deep_copy_plain();
+    bench_shallow_listing();
+    printf("json_in_situ: OK\n");
+    return 0;
+}
@@ -0,0 +1,306 @@
+// Json::parseDouble contra strtod de la libc, bit por bit: doubles al azar
+// escritos con todas las precisiones y formatos, mantisas largas (el camino
+// que vuelve a strtod), exponentes fuera de rango, subnormales y puntos
+// medios exactos entre dos doubles (redondeo al par). JSON_STRTOD_ROUNDS
+// cambia la cantidad de cada tanda (por defecto 300000). Benchmark con los
+// números que sube el equipo contra istringstream (el Reader de antes) y strtod.
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "json.h"
+#include "json_tool.h"
+#include "test_util.h"
+
+namespace {
+
+uint64_t s_state = 0x2545F4914F6CDD1Dull;
+
+uint64_t next_random()
+{
+    // xorshift64*
+    s_state ^= s_state >> 12;
+    s_state ^= s_state << 25;
+    s_state ^= s_state >> 27;
+    return s_state * 0x2545F4914F6CDD1Dull;
+}
+
+uint64_t to_bits(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+double finite_random()
+{
+    for (;;) {
+        uint64_t b = next_random();
+        if (((b >> 52) & 0x7FF) == 0x7FF) continue;
+        double d;
+        memcpy(&d, &b, sizeof(d));
+        return d;
+    }
+}
+
+uint64_t s_checked = 0;
+
+void check_text(const std::string& text)
+{
+    double got = 0;
+    if (!Json::parseDouble(text.data(), text.data() + text.size(), &got)) {
+        fprintf(stderr, "\"%s\" rechazado\n", text.c_str());
+        exit(1);
+    }
+    double want = strtod(text.c_str(), nullptr);
+    if (to_bits(got) != to_bits(want)) {
+        fprintf(stderr, "\"%s\": %.17g (0x%016llx), strtod %.17g (0x%016llx)\n", text.c_str(), got,
+                (unsigned long long)to_bits(got), want, (unsigned long long)to_bits(want));
+        exit(1);
+    }
+    s_checked++;
+}
+
+uint64_t rounds()
+{
+    const char* env = getenv("JSON_STRTOD_ROUNDS");
+    return env ? strtoull(env, nullptr, 10) : 300000;
+}
+
+void test_edges()
+{
+    const char* edges[] = {
+        "0", "-0", "0.0", "-0.0", "0e10", "-0e-10", "1", "-1", "0.1", "0.2", "0.3", "1e23", "8.98846567431158e307",
+        "22.85", "48.2", "7.4", "1760000000", "-3.5e-4", "1013.25", "1E5", "1e+5", "2.5E-3",
+        // Rango: infinito y cero, con signo
+        "1e309", "-1e309", "1e400", "1e99999999", "1.7976931348623157e308", "1.7976931348623158e308",
+        "1.7976931348623159e308", "1e-324", "-1e-400", "1e-99999999",
+        // Subnormales y el borde con los normales
+        "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324",
+        "2.2250738585072011e-308", "2.2250738585072012e-308", "2.2250738585072014e-308",
+        "1.1125369292536007e-308", "4.4501477170144023e-308",
+        // Puntos medios exactos: redondeo al par
+        "9007199254740993", "9007199254740995", "9007199254740993.0000000000000000001",
+        "18014398509481986", "0.500000000000000027755575615628913510590791702270507812",
+        // Mantisas largas, ceros a los costados
+        "0.1000000000000000055511151231257827021181583404541015625",
+        "0.10000000000000000555111512312578270211815834045410156250000000000001",
+        "123456789012345678901234567890", "1234567890123456789", "12345678901234567890",
+        "0.000000000000000000000000000001", "100000000000000000000000000000000e-32",
+        "00000000000000000000000000000000000000000001.5", "3.14159265358979323846264338327950288419716939937510",
+        "179769313486231570814527423731704356798070567525844996598917476803157260780028538760589558632766878"
+        "17154045895351438246423432132688946418276846754670353751698604991057655128207624549009038932894407"
+        "58685084551339423045832369032229481658085593321233482747978262041447231687381771809192998812504040"
+        "26184124858368",
+    };
+    for (const char* e : edges) check_text(e);
+
+    // Lo que no es un número
+    const char* bad[] = {"", "-", ".", "e5", "-e5", "1e", "1e+", "1e-", "1x", "--1", "1.5.2", "0x10", " 1"};
+    for (const char* b : bad) {
+        double d;
+        CHECK(!Json::parseDouble(b, b + strlen(b), &d));
+    }
+}
+
+void test_printed_doubles()
+{
+    const uint64_t n = rounds();
+    char text[64];
+    for (uint64_t i = 0; i < n; ++i) {
+        double d = finite_random();
+        snprintf(text, sizeof(text), "%.17g", d);
+        check_text(text);
+        int precision = 1 + (int)(next_random() % 17);
+        snprintf(text, sizeof(text), "%.*g", precision, d);
+        check_text(text);
+        snprintf(text, sizeof(text), "%.*e", precision, d);
+        check_text(text);
+        // Magnitudes de sensores en notación fija
+        double v = (double)(int64_t)(next_random() % 200000000) / pow(10.0, (double)(next_random() % 7)) - 1000;
+        snprintf(text, sizeof(text), "%.*f", (int)(next_random() % 8), v);
+        check_text(text);
+    }
+}
+
+void test_random_digits()
+{
+    // Mantisas de 1 a 30 dígitos con el punto en cualquier lado y exponentes
+    // de todo el rango (y un poco más)
+    const uint64_t n = rounds();
+    std::string text;
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t r = next_random();
+        int count = 1 + (int)(r % 30);
+        int point = (int)((r >> 8) % (count + 1));
+        text.clear();
+        if ((r >> 16) & 1) text += '-';
+        for (int k = 0; k < count; ++k) {
+            if (k == point && k > 0) text += '.';
+            text += (char)('0' + next_random() % 10);
+        }
+        if ((r >> 17) & 1) {
+            text += (r >> 18) & 1 ? "e" : "E";
+            text += std::to_string((int)((r >> 20) % 701) - 350);
+        }
+        check_text(text);
+    }
+}
+
+void test_midpoints()
+{
+    // d y su vecino en [2^48, 2^64): el medio es un múltiplo de 2^-5, se
+    // escribe exacto en decimal y queda en el camino de 19 dígitos o justo
+    // por encima. Y un pelo a cada lado del medio.
+    const uint64_t n = rounds();
+    char text[80];
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t r = next_random();
+        double d = ldexp((double)((r >> 11) | (1ull << 52)), (int)(r % 12) - 56);
+        long double mid = ((long double)d + (long double)nextafter(d, INFINITY)) / 2;
+        snprintf(text, sizeof(text), "%.5Lf", mid);
+        std::string exact(text);
+        while (exact.back() == '0') exact.pop_back();
+        if (exact.back() == '.') exact.pop_back();
+        check_text(exact);
+        check_text(std::string(exact.find('.') == std::string::npos ? exact + "." : exact) + "0000000001");
+        snprintf(text, sizeof(text), "%.5Lf", mid - 1.0L / 1024);
+        check_text(text);
+    }
+    // Medios en los subnormales y en el borde de los normales, exactos (largos)
+    for (int i = 0; i < 2000; ++i) {
+        uint64_t bits = next_random() % (1ull << 53);
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        long double mid = ((long double)d + (long double)nextafter(d, INFINITY)) / 2;
+        char exact[1200];
+        snprintf(exact, sizeof(exact), "%.800Le", mid);
+        check_text(exact);
+    }
+}
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+volatile double s_sink;
+
+// Lo que hacía Reader::decodeDouble antes de parseDouble
+double istringstream_parse(const char* begin, const char* end)
+{
+    double value = 0;
+    std::istringstream is(std::string(begin, end));
+    is >> value;
+    return value;
+}
+
+double strtod_parse(const char* begin, const char* end)
+{
+    // El token no termina en '\0' dentro del documento: copia, como antes
+    char buffer[64];
+    size_t len = (size_t)(end - begin);
+    memcpy(buffer, begin, len);
+    buffer[len] = '\0';
+    return strtod(buffer, nullptr);
+}
+
+double json_parse(const char* begin, const char* end)
+{
+    double value = 0;
+    Json::parseDouble(begin, end, &value);
+    return value;
+}
+
+double ns_per_number(double (*parse)(const char*, const char*), const std::string* texts, int count, int passes)
+{
+    int64_t t0 = now_ns();
+    for (int p = 0; p < passes; ++p) {
+        for (int i = 0; i < count; ++i) s_sink += parse(texts[i].data(), texts[i].data() + texts[i].size());
+    }
+    return (now_ns() - t0) / (double)(passes * count);
+}
+
+// Una página del historial: 60 lotes con la forma de los que sube el equipo
+std::string history_page()
+{
+    std::string doc = "{";
+    char item[256];
+    for (int i = 0; i < 60; ++i) {
+        snprintf(item, sizeof(item),
+                 "%s\"-Nk%017d\":{\"ts\":%d,\"pm25\":%.1f,\"pm10\":%.1f,\"temp\":%.2f,\"hum\":%.1f,"
+                 "\"co2\":%.4e}",
+                 i ? "," : "", 4000000 + i * 7919, 1760000000 + i * 60, 5 + (i % 30) * 0.7,
+                 9 + (i % 17) * 1.3, 18 + (i % 40) * 0.25, 40 + (i % 25) * 1.1, 4.1e-4 + i * 1e-6);
+        doc += item;
+    }
+    return doc + "}";
+}
+
+void bench_numbers()
+{
+    const int COUNT = 2000, PASSES = 50;
+    static std::string texts[COUNT];
+    const char* typical[] = {"22.85", "48.2", "7.4", "1760000000", "-3.5e-4", "1013.25", "0.1", "-12.5"};
+    for (int i = 0; i < COUNT; ++i) {
+        if (i < 8) {
+            texts[i] = typical[i];
+            continue;
+        }
+        char text[32];
+        uint64_t r = next_random();
+        switch (r % 4) {
+        case 0: snprintf(text, sizeof(text), "%.1f", (double)(r >> 8 & 0xFFFF) / 100); break;
+        case 1: snprintf(text, sizeof(text), "%.2f", (double)(r >> 8 & 0xFFFF) / 1000 - 20); break;
+        case 2: snprintf(text, sizeof(text), "%d", 1760000000 + (int)(r >> 40 & 0xFFFFF)); break;
+        default: snprintf(text, sizeof(text), "%.1e", -(double)(r >> 8 & 0xFFF) * 1e-6); break;
+        }
+        texts[i] = text;
+    }
+    for (int i = 0; i < COUNT; ++i) check_text(texts[i]);
+
+    double stream = ns_per_number(istringstream_parse, texts, COUNT, PASSES / 5);
+    double libc = ns_per_number(strtod_parse, texts, COUNT, PASSES);
+    double json = ns_per_number(json_parse, texts, COUNT, PASSES);
+    printf("%d números de sensores: istringstream %.0f ns, strtod %.0f ns, parseDouble %.0f ns\n", COUNT, stream,
+           libc, json);
+    CHECK(json < libc);
+    CHECK(json * 5 < stream);
+
+    // Punta a punta: la página entera con Reader
+    std::string doc = history_page();
+    const int DOCS = 500;
+    Json::Value root;
+    Json::Reader reader;
+    CHECK(reader.parse(doc, root));
+    CHECK(fabs(root["-Nk00000000004000000"]["co2"].asDouble() - 4.1e-4) < 1e-12);
+    int64_t t0 = now_ns();
+    for (int i = 0; i < DOCS; ++i) {
+        Json::Value page;
+        CHECK(reader.parse(doc.data(), doc.data() + doc.size(), page, false));
+    }
+    double us = (now_ns() - t0) / 1000.0 / DOCS;
+    printf("página de 60 lotes (%u bytes, 360 números, 300 reales): Reader %.1f us, %.0f ns por número "
+           "con todo lo demás\n", (unsigned)doc.size(), us, us * 1000 / 360);
+}
+
+}
+
+int main()
+{
+    test_edges();
+    test_printed_doubles();
+    test_random_digits();
+    test_midpoints();
+    printf("%llu textos iguales a strtod\n", (unsigned long long)s_checked);
+    bench_numbers();
+    printf("json_strtod: OK\n");
+    return 0;
+}
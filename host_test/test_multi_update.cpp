@@ -0,0 +1,230 @@
+// RTDB::multiUpdate contra el server simulado: trozos que respetan
+// max_body_bytes (justo en el borde incluido), claves escapadas, un item que
+// no cabe solo y corte en el primer trozo que falla. Al final, el benchmark de
+// vaciado del backlog: un PUT por batch contra PATCH multi-ruta.
+#include <time.h>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rtdb.h"
+#include "reader.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+const char* DB_URL = "https://db.test";
+
+struct server_t
+{
+    std::mutex m;
+    std::vector<std::string> bodies;   // PATCH recibidos
+    std::vector<std::string> urls;
+    int fail_at = -1;                  // índice de PATCH que responde 500
+    int handshake_ms = 0;              // costo de abrir conexión
+    int rtt_ms = 0;                    // costo de cada request
+    bool close_each = false;           // el server cierra tras cada respuesta
+};
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    server_t* s = static_cast<server_t*>(user);
+    std::lock_guard<std::mutex> g(s->m);
+    s->urls.push_back(req->url);
+    int index = (int)s->bodies.size();
+    s->bodies.push_back(std::string(req->body ? req->body : "", req->body_len));
+    resp->status = index == s->fail_at ? 500 : 204;
+    resp->delay_ms = s->rtt_ms + (req->reused ? 0 : s->handshake_ms);
+    resp->close = s->close_each;
+}
+
+// Sesión ya iniciada: los tests no pasan por identitytoolkit/securetoken
+void start_session(FirebaseApp& app)
+{
+    CHECK_EQ(app.restoreSession("refresh", "token", (int64_t)time(NULL) + 3600), ESP_OK);
+}
+
+// Reintentos sin esperas reales ni repeticiones: cada fallo cuenta una vez
+void no_retries(FirebaseApp& app)
+{
+    retry_policy_t policy = DEFAULT_RETRY_POLICY;
+    policy.max_attempts = 1;
+    app.setRetryPolicy(policy);
+}
+
+Json::Value parse(const std::string& text)
+{
+    Json::Value root;
+    Json::Reader reader;
+    CHECK(reader.parse(text, root));
+    return root;
+}
+
+void test_chunks()
+{
+    server_t s;
+    fake_http_set_handler(server, &s);
+    FirebaseApp app("clave");
+    start_session(app);
+    RTDB db(&app, DB_URL);
+
+    // Claves con comillas y barras invertidas: tienen que llegar escapadas
+    std::vector<std::string> paths, jsons;
+    for (int i = 0; i < 40; ++i) {
+        paths.push_back("lote/" + std::to_string(i) + (i % 3 == 0 ? "\"q\\" : ""));
+        jsons.push_back("{\"v\":" + std::to_string(i * 7) + ",\"txt\":\"" + std::string(i % 11, 'x') + "\"}");
+    }
+    std::vector<const char*> p, j;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        p.push_back(paths[i].c_str());
+        j.push_back(jsons[i].c_str());
+    }
+    const size_t max = 300;
+    CHECK_EQ(db.multiUpdate("/historial", p.data(), j.data(), p.size(), max), 40);
+
+    size_t seen = 0;
+    for (const std::string& body : s.bodies) {
+        CHECK(body.size() <= max);
+        Json::Value root = parse(body);
+        CHECK(root.isObject());
+        // En orden: los miembros de cada trozo son los siguientes items
+        size_t n = root.size();
+        for (size_t k = 0; k < n; ++k, ++seen) {
+            CHECK(root.isMember(paths[seen]));
+            CHECK_EQ(root[paths[seen]]["v"].asInt(), (int)seen * 7);
+        }
+    }
+    CHECK_EQ(seen, 40);
+    CHECK(s.bodies.size() > 1);
+    CHECK(s.urls[0].find("/historial.json?print=silent") != std::string::npos);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+void test_exact_fit()
+{
+    // Dos items que llenan max_body_bytes justo: van en un solo PATCH
+    const char* paths[] = {"a", "b"};
+    const char* jsons[] = {"1", "22"};
+    const std::string expected = "{\"a\":1,\"b\":22}";
+    for (size_t max = expected.size() - 1; max <= expected.size(); ++max) {
+        server_t s;
+        fake_http_set_handler(server, &s);
+        FirebaseApp app("clave");
+        start_session(app);
+        RTDB db(&app, DB_URL);
+        CHECK_EQ(db.multiUpdate("/r", paths, jsons, 2, max), 2);
+        if (max == expected.size()) {
+            CHECK_EQ(s.bodies.size(), 1);
+            CHECK(s.bodies[0] == expected);
+        } else {
+            CHECK_EQ(s.bodies.size(), 2);
+            CHECK(s.bodies[0] == "{\"a\":1}");
+            CHECK(s.bodies[1] == "{\"b\":22}");
+        }
+    }
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+void test_spill_and_failure()
+{
+    server_t s;
+    fake_http_set_handler(server, &s);
+    FirebaseApp app("clave");
+    start_session(app);
+    no_retries(app);
+    RTDB db(&app, DB_URL);
+
+    std::string big = "\"" + std::string(500, 'z') + "\"";
+    const char* paths[] = {"uno", "grande", "dos", "tres", "cuatro"};
+    const char* jsons[] = {"1", big.c_str(), "2", "3", "4"};
+    s.fail_at = 2;  // el trozo de "dos"
+    CHECK_EQ(db.multiUpdate("/r", paths, jsons, 5, 16), 2);
+    CHECK_EQ(s.bodies.size(), 3);
+    CHECK(s.bodies[0] == "{\"uno\":1}");
+    CHECK(s.bodies[1] == "{\"grande\":" + big + "}");
+    CHECK(s.bodies[2] == "{\"dos\":2}");
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+int64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Vaciado del backlog: 'batches' batches de ~160 bytes, con un handshake de
+// 20 ms y 4 ms por request. Devuelve batches/s.
+double drain(int batches, bool multi, bool close_each, uint32_t& requests, uint32_t& connects)
+{
+    server_t s;
+    s.handshake_ms = 20;
+    s.rtt_ms = 4;
+    s.close_each = close_each;
+    fake_http_set_handler(server, &s);
+    FirebaseApp app("clave");
+    start_session(app);
+    RTDB db(&app, DB_URL);
+
+    std::vector<std::string> paths, jsons;
+    for (int i = 0; i < batches; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "-Nx%08d", i);
+        paths.push_back(key);
+        jsons.push_back("{\"ts\":" + std::to_string(1760000000 + i * 60) +
+                        ",\"pm1\":3.1,\"pm25\":7.4,\"pm4\":9.0,\"pm10\":11.2,\"voc\":101,\"nox\":1,"
+                        "\"co2\":612,\"temp\":22.85,\"hum\":48.2,\"n\":10}");
+    }
+    int64_t t0 = now_us();
+    if (multi) {
+        std::vector<const char*> p, j;
+        for (int i = 0; i < batches; ++i) {
+            p.push_back(paths[i].c_str());
+            j.push_back(jsons[i].c_str());
+        }
+        CHECK_EQ(db.multiUpdate("/historial_mediciones", p.data(), j.data(), p.size()), batches);
+    } else {
+        for (int i = 0; i < batches; ++i) {
+            std::string path = "/historial_mediciones/" + paths[i];
+            CHECK_EQ(db.putData(path.c_str(), jsons[i].c_str()), ESP_OK);
+        }
+    }
+    int64_t elapsed = now_us() - t0;
+    requests = fake_http_requests();
+    connects = fake_http_connects();
+    fake_http_set_handler(nullptr, nullptr);
+    return batches * 1e6 / (double)elapsed;
+}
+
+void bench_drain()
+{
+    const int batches = 120;
+    uint32_t req, conn;
+    double put_close = drain(batches, false, true, req, conn);
+    printf("drain %d batches, PUT por batch y conexion nueva: %.0f batches/s (%u requests, %u conexiones)\n",
+           batches, put_close, (unsigned)req, (unsigned)conn);
+    double put = drain(batches, false, false, req, conn);
+    printf("drain %d batches, PUT por batch con keep-alive:   %.0f batches/s (%u requests, %u conexiones)\n",
+           batches, put, (unsigned)req, (unsigned)conn);
+    double multi = drain(batches, true, false, req, conn);
+    printf("drain %d batches, multiUpdate (8 KB por PATCH):   %.0f batches/s (%u requests, %u conexiones)\n",
+           batches, multi, (unsigned)req, (unsigned)conn);
+    CHECK(multi > put);
+}
+
+}
+
+int main()
+{
+    test_chunks();
+    test_exact_fit();
+    test_spill_and_failure();
+    bench_drain();
+    printf("multi_update: OK\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Claves de push_id.cpp: estrictamente crecientes dentro de un mismo ms y a lo
+// largo de muchas llamadas, también con el reloj yendo hacia atrás; equipos y
+// arranques distintos nunca chocan, ni con las de pushIdMake; pushIdBound
+// corta donde debe; y el orden de la RTDB (rtdbKeyLess) es el de strcmp.
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "push_id.h"
+#include "rtdb_query.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+const int64_t T0 = 1760000000000LL;   // ms, octubre de 2025
+
+const char ALPHABET[] = "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+
+void check_format(const char* key)
+{
+    CHECK_EQ(strlen(key), PUSH_ID_LEN);
+    for (size_t i = 0; i < PUSH_ID_LEN; ++i) CHECK(strchr(ALPHABET, key[i]) != nullptr);
+    // Después de las claves viejas ("yy-mm-dd_HH-MM-SS")
+    CHECK(strcmp(key, "99-99-99_99-99-99") > 0);
+}
+
+push_id_gen_t generator(uint32_t node, uint32_t boot)
+{
+    push_id_gen_t gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.node = node;
+    gen.boot = boot;
+    return gen;
+}
+
+void test_increasing_same_ms()
+{
+    push_id_gen_t gen = generator(0xC301, 7);
+    char prev[PUSH_ID_LEN + 1], key[PUSH_ID_LEN + 1];
+    pushIdNext(gen, T0, prev);
+    check_format(prev);
+    for (int i = 0; i < 100000; ++i) {
+        pushIdNext(gen, T0, key);
+        CHECK(strcmp(key, prev) > 0);
+        memcpy(prev, key, sizeof(key));
+    }
+
+    // El contador se agota: pasa al ms siguiente sin perder el orden
+    gen.counter = (1u << 24) - 2;
+    for (int i = 0; i < 4; ++i) {
+        pushIdNext(gen, T0, key);
+        CHECK(strcmp(key, prev) > 0);
+        memcpy(prev, key, sizeof(key));
+    }
+    CHECK_EQ(gen.last_ms, T0 + 1);
+}
+
+void test_increasing_over_time()
+{
+    push_id_gen_t gen = generator(0xC301, 7);
+    char prev[PUSH_ID_LEN + 1] = "", key[PUSH_ID_LEN + 1];
+    uint32_t state = 12345;
+    int64_t now = T0;
+    for (int i = 0; i < 200000; ++i) {
+        state = state * 1103515245u + 12345u;
+        now += (state >> 16) % 3 == 0 ? (state >> 20) % 5000 : 0;   // a veces el mismo ms
+        pushIdNext(gen, now, key);
+        CHECK(strcmp(key, prev) > 0);
+        memcpy(prev, key, sizeof(key));
+    }
+}
+
+void test_clock_backwards()
+{
+    push_id_gen_t gen = generator(0xC301, 7);
+    char prev[PUSH_ID_LEN + 1], key[PUSH_ID_LEN + 1];
+    pushIdNext(gen, T0 + 60000, prev);
+    // SNTP corrige una hora para atrás, y después vuelve a avanzar de a poco
+    const int64_t steps[] = {T0 + 59999, T0, T0 - 3600000, T0 - 3600000, T0 + 1, T0 + 60000, T0 + 60001};
+    for (int64_t now : steps) {
+        pushIdNext(gen, now, key);
+        CHECK(strcmp(key, prev) > 0);
+        memcpy(prev, key, sizeof(key));
+    }
+    CHECK_EQ(gen.last_ms, T0 + 60001);
+
+    // Sin hora todavía (0 o negativo): las claves siguen creciendo
+    push_id_gen_t cold = generator(1, 1);
+    pushIdNext(cold, 0, prev);
+    pushIdNext(cold, -5, key);
+    CHECK(strcmp(key, prev) > 0);
+}
+
+void test_no_collisions()
+{
+    // Mismo reloj, mismos contadores: solo cambia el equipo o el arranque
+    std::set<std::string> seen;
+    const uint32_t nodes[] = {0, 1, 0xC301, 0xFFFFFF};
+    const uint32_t boots[] = {0, 1, 2, 0x7FFFFF};
+    char key[PUSH_ID_LEN + 1];
+    size_t total = 0;
+    for (uint32_t node : nodes) {
+        for (uint32_t boot : boots) {
+            push_id_gen_t gen = generator(node, boot);
+            for (int i = 0; i < 500; ++i) {
+                pushIdNext(gen, T0 + i / 100, key);
+                seen.insert(key);
+                total++;
+            }
+        }
+    }
+    // Y las deterministas de un log en flash, con los mismos tiempos y equipos
+    for (uint32_t node : nodes) {
+        for (uint32_t seq = 0; seq < 500; ++seq) {
+            pushIdMake(T0 + seq / 100, node, seq, key);
+            check_format(key);
+            seen.insert(key);
+            total++;
+        }
+    }
+    CHECK_EQ(seen.size(), total);
+
+    // pushIdMake es determinista: un reintento pisa la misma clave
+    char again[PUSH_ID_LEN + 1];
+    pushIdMake(T0, 0xC301, 42, key);
+    pushIdMake(T0, 0xC301, 42, again);
+    CHECK(strcmp(key, again) == 0);
+}
+
+void test_bound()
+{
+    char bound[PUSH_ID_LEN + 1], key[PUSH_ID_LEN + 1];
+    pushIdBound(T0, bound);
+    check_format(bound);
+    push_id_gen_t gen = generator(0xFFFFFF, 0x7FFFFF);
+    gen.counter = (1u << 24) - 10;
+    for (int64_t ts = T0 - 2; ts <= T0; ++ts) {
+        pushIdMake(ts, 0xFFFFFF, 0xFFFFFFFF, key);
+        CHECK(strcmp(key, bound) <= 0);
+        pushIdNext(gen, ts, key);
+        CHECK(strcmp(key, bound) <= 0);
+    }
+    pushIdMake(T0 + 1, 0, 0, key);
+    CHECK(strcmp(key, bound) > 0);
+}
+
+void test_rtdb_order_matches_strcmp()
+{
+    std::vector<std::string> keys;
+    char key[PUSH_ID_LEN + 1];
+    push_id_gen_t gen = generator(0xC301, 3);
+    for (int i = 0; i < 300; ++i) {
+        pushIdNext(gen, T0 + (i % 7) * 1000 + i / 50, key);
+        keys.push_back(key);
+        pushIdMake(T0 + i * 37, (uint32_t)i * 7919, (uint32_t)i, key);
+        keys.push_back(key);
+    }
+    pushIdBound(T0 + 3000, key);
+    keys.push_back(key);
+    for (const std::string& a : keys) {
+        for (const std::string& b : keys) {
+            CHECK_EQ(rtdbKeyLess(a, b), strcmp(a.c_str(), b.c_str()) < 0);
+        }
+    }
+}
+
+}
+
+int main()
+{
+    test_increasing_same_ms();
+    test_increasing_over_time();
+    test_clock_backwards();
+    test_no_collisions();
+    test_bound();
+    test_rtdb_order_matches_strcmp();
+    printf("push_id: OK\n");
+    return 0;
+}
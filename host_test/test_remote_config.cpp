@@ -0,0 +1,208 @@
+// main/remote_config.c sobre firebase_listen contra un stream SSE simulado
+// (text/event-stream de la RTDB): put del nodo completo, patch, put de un
+// campo, valores fuera de rango o no enteros, reconexión con el valor
+// completo. También los accesores firebase_json_* que reciben los callbacks
+// en C, y una copia del evento que dura más que el callback.
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+#include "firebase.h"
+#include "remote_config.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+namespace {
+
+const char* CONFIG_FIRST =
+    "event: put\n"
+    "data: {\"path\":\"/\",\"data\":{\"muestreo_min\":5,\"muestras_por_lote\":7,\"retencion_mb\":20}}\n\n"
+    "event: patch\n"
+    "data: {\"path\":\"/\",\"data\":{\"muestras_por_lote\":9}}\n\n"
+    "event: keep-alive\n"
+    "data: null\n\n"
+    "event: put\n"
+    "data: {\"path\":\"/muestreo_min\",\"data\":3}\n\n"
+    "event: put\n"
+    "data: {\"path\":\"/muestreo_min\",\"data\":2.5}\n\n"
+    "event: put\n"
+    "data: {\"path\":\"/retencion_mb\",\"data\":500}\n\n"
+    "event: put\n"
+    "data: {\"path\":\"/muestras_por_lote\",\"data\":\"mucho\"}\n\n";
+
+// Tras reconectar llega el nodo completo: lo que falta o es null vuelve al defecto
+const char* CONFIG_RECONNECT =
+    "event: put\n"
+    "data: {\"path\":\"/\",\"data\":{\"muestreo_min\":2,\"retencion_mb\":null}}\n\n";
+
+const char* TYPES =
+    "event: put\n"
+    "data: {\"path\":\"/\",\"data\":{\"b\":true,\"n\":1.5,\"s\":\"ho\\\"la\",\"a\":[1,2,3],\"o\":{\"x\":null}}}\n\n";
+
+struct server_t
+{
+    std::mutex m;
+    std::condition_variable cv;
+    int config_connects = 0;
+    bool release = false;      // deja pasar la reconexión de /config
+    bool done = false;
+};
+
+server_t s_server;
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    server_t* s = static_cast<server_t*>(user);
+    std::unique_lock<std::mutex> g(s->m);
+    resp->status = 200;
+    if (strstr(req->url, "/config.json")) {
+        int n = s->config_connects++;
+        s->cv.notify_all();
+        if (n == 0) {
+            resp->body = CONFIG_FIRST;
+        } else if (n == 1) {
+            s->cv.wait(g, [s] { return s->release; });
+            resp->body = CONFIG_RECONNECT;
+        } else {
+            s->cv.wait(g, [s] { return s->done; });
+            resp->status = 503;
+        }
+    } else if (strstr(req->url, "/tipos.json")) {
+        static bool sent = false;
+        if (!sent) {
+            sent = true;
+            resp->body = TYPES;
+        } else {
+            s->cv.wait(g, [s] { return s->done; });
+            resp->status = 503;
+        }
+    } else {
+        resp->status = 404;
+    }
+}
+
+// Espera (tiempo real) a que el server vea 'n' conexiones a /config
+bool wait_connects(int n)
+{
+    std::unique_lock<std::mutex> g(s_server.m);
+    return s_server.cv.wait_for(g, std::chrono::seconds(5), [n] { return s_server.config_connects >= n; });
+}
+
+bool config_is(int sample_min, int batch, int retention_mb)
+{
+    for (int i = 0; i < 2000; ++i) {
+        if (remote_config_sample_every_min() == sample_min && remote_config_samples_per_batch() == batch &&
+            remote_config_retention_bytes() == (size_t)retention_mb * 1024 * 1024) {
+            return true;
+        }
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, nullptr);
+    }
+    fprintf(stderr, "config: %d %d %u\n", remote_config_sample_every_min(), remote_config_samples_per_batch(),
+            (unsigned)(remote_config_retention_bytes() >> 20));
+    return false;
+}
+
+void test_remote_config()
+{
+    remote_config_init(1, 5, 10);
+    CHECK_EQ(remote_config_listen("/config"), 0);
+
+    // Primera conexión entera procesada cuando el listener reconecta
+    CHECK(wait_connects(2));
+    // 2.5 min, 500 MB y "mucho" se ignoran: quedan 3, 20 y 9
+    CHECK(config_is(3, 9, 20));
+
+    {
+        std::lock_guard<std::mutex> g(s_server.m);
+        s_server.release = true;
+        s_server.cv.notify_all();
+    }
+    CHECK(wait_connects(3));
+    CHECK(config_is(2, 5, 10));
+}
+
+struct types_seen_t
+{
+    std::mutex m;
+    std::condition_variable cv;
+    bool checked = false;
+    firebase_json_t* copy = nullptr;
+};
+
+types_seen_t s_types;
+
+void on_types(const char* event, const char* path, const firebase_json_t* data, void* user)
+{
+    CHECK(strcmp(event, "put") == 0);
+    CHECK(strcmp(path, "/") == 0);
+    CHECK_EQ(firebase_json_type(data), FIREBASE_JSON_OBJECT);
+    CHECK_EQ(firebase_json_size(data), 5);
+
+    bool b = false;
+    CHECK_EQ(firebase_json_type(firebase_json_get(data, "b")), FIREBASE_JSON_BOOL);
+    CHECK_EQ(firebase_json_bool(firebase_json_get(data, "b"), &b), 0);
+    CHECK(b);
+    double n = 0;
+    CHECK_EQ(firebase_json_number(firebase_json_get(data, "n"), &n), 0);
+    CHECK(n == 1.5);
+    CHECK_EQ(firebase_json_number(firebase_json_get(data, "s"), &n), -1);
+    const char* str = firebase_json_string(firebase_json_get(data, "s"));
+    CHECK(str && strcmp(str, "ho\"la") == 0);
+    CHECK_EQ(firebase_json_type(firebase_json_get(data, "a")), FIREBASE_JSON_ARRAY);
+    CHECK_EQ(firebase_json_size(firebase_json_get(data, "a")), 3);
+    CHECK(firebase_json_get(firebase_json_get(data, "a"), "0") == NULL);
+
+    const firebase_json_t* o = firebase_json_get(data, "o");
+    CHECK_EQ(firebase_json_type(o), FIREBASE_JSON_OBJECT);
+    // Presente y null no es lo mismo que ausente
+    CHECK(firebase_json_get(o, "x") != NULL);
+    CHECK_EQ(firebase_json_type(firebase_json_get(o, "x")), FIREBASE_JSON_NULL);
+    CHECK(firebase_json_get(o, "y") == NULL);
+    CHECK_EQ(firebase_json_type(NULL), FIREBASE_JSON_NULL);
+    CHECK(firebase_json_string(NULL) == NULL);
+
+    std::lock_guard<std::mutex> g(s_types.m);
+    s_types.copy = firebase_json_copy(data);
+    s_types.checked = true;
+    s_types.cv.notify_all();
+}
+
+void test_json_accessors()
+{
+    CHECK_EQ(firebase_listen("/tipos", on_types, NULL), 0);
+    std::unique_lock<std::mutex> g(s_types.m);
+    CHECK(s_types.cv.wait_for(g, std::chrono::seconds(5), [] { return s_types.checked; }));
+
+    // La copia sigue valiendo con el texto del evento y la arena ya reusados
+    firebase_json_t* copy = s_types.copy;
+    CHECK(copy != NULL);
+    CHECK_EQ(firebase_json_size(copy), 5);
+    const char* str = firebase_json_string(firebase_json_get(copy, "s"));
+    CHECK(str && strcmp(str, "ho\"la") == 0);
+    double n = 0;
+    CHECK_EQ(firebase_json_number(firebase_json_get(copy, "n"), &n), 0);
+    CHECK(n == 1.5);
+    CHECK_EQ(firebase_json_type(firebase_json_get(firebase_json_get(copy, "o"), "x")), FIREBASE_JSON_NULL);
+    firebase_json_free(copy);
+}
+
+}
+
+int main()
+{
+    fake_http_set_handler(server, &s_server);
+    CHECK_EQ(firebase_init_session("refresh", "token", (int64_t)time(NULL) + 3600), 0);
+    test_remote_config();
+    test_json_accessors();
+    {
+        std::lock_guard<std::mutex> g(s_server.m);
+        s_server.done = true;
+        s_server.cv.notify_all();
+    }
+    printf("remote_config: OK\n");
+    return 0;
+}
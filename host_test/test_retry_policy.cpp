@@ -0,0 +1,249 @@
+// Inyección de fallos en FirebaseApp::performRequest: calendario de
+// reintentos (backoff exponencial con jitter, reproducible con la semilla de
+// esp_random), clasificación de errores, plazo total, reintento por conexión
+// reusada caída y circuit breaker. vTaskDelay no duerme (ver host_rtos.h): el
+// hook anota cada espera y el reloj virtual avanza lo mismo.
+#include <cstring>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_random.h"
+#include "app.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+const char* URL = "https://db.test/x.json";
+
+// Guion del server: una respuesta por request; después de la última, 'last'
+struct script_t
+{
+    std::vector<fake_http_response_t> steps;
+    fake_http_response_t last;
+    size_t next = 0;
+    int reused = 0;            // requests que llegaron por una conexión reusada
+};
+
+fake_http_response_t status(int code)
+{
+    fake_http_response_t r = {};
+    r.err = ESP_OK;
+    r.status = code;
+    r.body_len = -1;
+    return r;
+}
+
+fake_http_response_t failure(esp_err_t err)
+{
+    fake_http_response_t r = status(-1);
+    r.err = err;
+    return r;
+}
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    script_t* s = static_cast<script_t*>(user);
+    if (req->reused) s->reused++;
+    *resp = s->next < s->steps.size() ? s->steps[s->next++] : s->last;
+}
+
+void record_delay(uint32_t ms, void* user)
+{
+    static_cast<std::vector<uint32_t>*>(user)->push_back(ms);
+}
+
+// Lo que espera performRequest antes del intento 'attempt' (vTaskDelay va en ticks)
+uint32_t expected_delay(const retry_policy_t& policy, int attempt)
+{
+    return pdTICKS_TO_MS(pdMS_TO_TICKS(retryBackoffMs(policy, attempt, esp_random())));
+}
+
+void test_backoff_schedule()
+{
+    script_t s;
+    // El error de conexión va primero: sobre una conexión reusada sería un
+    // reintento "stale" sin espera (ver test_stale_connection)
+    s.steps = {failure(ESP_ERR_HTTP_CONNECT), status(503), status(429)};
+    s.last = status(200);
+    std::vector<uint32_t> delays;
+    fake_http_set_handler(server, &s);
+    host_set_delay_hook(record_delay, &delays);
+
+    for (uint32_t seed : {1u, 42u, 0xdeadbeefu}) {
+        s.next = 0;
+        delays.clear();
+        FirebaseApp app("clave");
+        host_set_random_seed(seed);
+        http_ret_t ret = app.performRequest(URL, HTTP_METHOD_GET);
+        CHECK_EQ(ret.err, ESP_OK);
+        CHECK_EQ(ret.status_code, 200);
+        CHECK_EQ(app.getStats().retries, 3);
+
+        // Mismo calendario que retryBackoffMs con la misma secuencia aleatoria
+        const retry_policy_t& policy = DEFAULT_RETRY_POLICY;
+        host_set_random_seed(seed);
+        CHECK_EQ(delays.size(), 3);
+        for (int attempt = 2; attempt <= 4; ++attempt) {
+            uint32_t want = expected_delay(policy, attempt);
+            CHECK_EQ(delays[attempt - 2], want);
+            // base * 2^(n-2) menos hasta un 50 %
+            uint32_t full = 500u << (attempt - 2);
+            CHECK(delays[attempt - 2] <= full && delays[attempt - 2] >= full / 2 - 10);
+        }
+    }
+    host_set_delay_hook(nullptr, nullptr);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+void test_max_attempts_and_cap()
+{
+    script_t s;
+    s.last = status(500);
+    std::vector<uint32_t> delays;
+    fake_http_set_handler(server, &s);
+    host_set_delay_hook(record_delay, &delays);
+
+    FirebaseApp app("clave");
+    retry_policy_t policy = {7, 1000, 4000, 0, 0, nullptr};  // sin jitter ni plazo
+    app.setRetryPolicy(policy);
+    http_ret_t ret = app.performRequest(URL, HTTP_METHOD_GET);
+    CHECK_EQ(ret.status_code, 500);
+    CHECK_EQ(fake_http_requests(), 7);
+    const uint32_t want[] = {1000, 2000, 4000, 4000, 4000, 4000};
+    CHECK_EQ(delays.size(), 6);
+    for (size_t i = 0; i < 6; ++i) CHECK_EQ(delays[i], want[i]);
+    host_set_delay_hook(nullptr, nullptr);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+void test_permanent_errors()
+{
+    std::vector<uint32_t> delays;
+    host_set_delay_hook(record_delay, &delays);
+    // 4xx (incluido 401: lo resuelve el token, no un reintento) y errores locales
+    const fake_http_response_t permanent[] = {status(400), status(401), status(403), status(404),
+                                              failure(ESP_ERR_NO_MEM), failure(ESP_ERR_INVALID_ARG)};
+    for (const fake_http_response_t& r : permanent) {
+        script_t s;
+        s.last = r;
+        fake_http_set_handler(server, &s);
+        FirebaseApp app("clave");
+        app.performRequest(URL, HTTP_METHOD_PUT, "{}");
+        CHECK_EQ(fake_http_requests(), 1);
+        CHECK_EQ(app.getStats().retries, 0);
+    }
+    CHECK_EQ(delays.size(), 0);
+    host_set_delay_hook(nullptr, nullptr);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+void test_deadline()
+{
+    script_t s;
+    s.last = status(503);
+    std::vector<uint32_t> delays;
+    fake_http_set_handler(server, &s);
+    host_set_delay_hook(record_delay, &delays);
+
+    FirebaseApp app("clave");
+    // Esperas 500, 1000, 2000...: tras la primera, 500 + 1000 llega al plazo
+    retry_policy_t policy = {10, 500, 8000, 0, 1500, nullptr};
+    app.setRetryPolicy(policy);
+    app.performRequest(URL, HTTP_METHOD_GET);
+    CHECK_EQ(fake_http_requests(), 2);
+    CHECK_EQ(delays.size(), 1);
+    CHECK_EQ(delays[0], 500);
+    host_set_delay_hook(nullptr, nullptr);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+void test_stale_connection()
+{
+    // Conexión persistente que el server cerró: se reabre y se repite una vez,
+    // sin espera y sin contarlo como reintento
+    script_t s;
+    s.steps = {status(200), failure(ESP_ERR_HTTP_CONNECTION_CLOSED)};
+    s.last = status(200);
+    std::vector<uint32_t> delays;
+    fake_http_set_handler(server, &s);
+    host_set_delay_hook(record_delay, &delays);
+
+    FirebaseApp app("clave");
+    app.setPersistentHost("https://db.test");
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 200);
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 200);
+    CHECK_EQ(fake_http_requests(), 3);
+    CHECK_EQ(s.reused, 1);
+    CHECK_EQ(fake_http_connects(), 2);
+    CHECK_EQ(delays.size(), 0);
+    CHECK_EQ(app.getStats().stale_retries, 1);
+    CHECK_EQ(app.getStats().retries, 0);
+    host_set_delay_hook(nullptr, nullptr);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+void test_breaker()
+{
+    script_t s;
+    s.last = status(503);
+    fake_http_set_handler(server, &s);
+
+    FirebaseApp app("clave");
+    retry_policy_t policy = {1, 500, 8000, 0, 0, nullptr};
+    app.setRetryPolicy(policy);
+    breaker_config_t breaker = {3, 1000, 2500};
+    app.setBreakerConfig(breaker);
+
+    // Tres fallos seguidos lo abren
+    for (int i = 0; i < 3; ++i) CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 503);
+    CHECK(app.circuitOpen(URL));
+    CHECK_EQ(app.getStats().breaker_opens, 1);
+    http_ret_t ret = app.performRequest(URL, HTTP_METHOD_GET);
+    CHECK_EQ(ret.err, ESP_ERR_NOT_FINISHED);
+    CHECK_EQ(fake_http_requests(), 3);   // no tocó la red
+    // Otro host no se ve afectado
+    CHECK(!app.circuitOpen("https://otro.test/y.json"));
+
+    // Pasado open_ms: un request de prueba; falla y se reabre por el doble
+    host_advance_us(1000 * 1000);
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 503);
+    CHECK_EQ(fake_http_requests(), 4);
+    CHECK_EQ(app.getStats().breaker_opens, 2);
+    host_advance_us(1000 * 1000);
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).err, ESP_ERR_NOT_FINISHED);
+    CHECK_EQ(fake_http_requests(), 4);
+
+    // 2000 ms en total; la tercera apertura quedaría en 4000: tope de 2500
+    host_advance_us(1000 * 1000);
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 503);
+    CHECK_EQ(app.getStats().breaker_opens, 3);
+    host_advance_us(2400 * 1000);
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).err, ESP_ERR_NOT_FINISHED);
+
+    // El server vuelve: la prueba sale bien y el circuito se cierra
+    s.last = status(200);
+    host_advance_us(100 * 1000);
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 200);
+    CHECK(!app.circuitOpen(URL));
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 200);
+    CHECK_EQ(app.getStats().breaker_rejects, 3);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+}
+
+int main()
+{
+    test_backoff_schedule();
+    test_max_attempts_and_cap();
+    test_permanent_errors();
+    test_deadline();
+    test_stale_connection();
+    test_breaker();
+    printf("retry_policy: OK\n");
+    return 0;
+}
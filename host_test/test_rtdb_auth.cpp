@@ -0,0 +1,237 @@
+// Token y pool de request_ctx_t (user-012):
+//  - un refresh en curso tiene auth_lock y espera un contexto del pool; las
+//    tareas que ya tienen los dos contextos tienen que poder leer el token
+//    (RTDB::buildUrl) sin esperar a ese refresh. Si no, deadlock: el watchdog
+//    de host_rtos aborta el test.
+//  - benchmark: allocations de heap por putData con la URL y el body armados
+//    en los buffers del contexto (objetivo: cero).
+#include <time.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "rtdb.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+// Cuenta las allocations de C++ (std::string, Json::Value, vectores...)
+static std::atomic<uint64_t> s_news(0);
+
+void* operator new(size_t size)
+{
+    s_news++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+using namespace ESPFirebase;
+
+namespace {
+
+const char* DB_URL = "https://db.test";
+
+void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    nanosleep(&ts, nullptr);
+}
+
+std::atomic<int> s_refreshes(0);
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    if (strcmp(req->host, "securetoken.googleapis.com") == 0) {
+        s_refreshes++;
+        resp->status = 200;
+        resp->body = "{\"access_token\":\"token-nuevo\",\"expires_in\":\"3600\",\"refresh_token\":\"refresh\"}";
+        return;
+    }
+    resp->status = 204;
+}
+
+struct holder_t
+{
+    FirebaseApp* app;
+    SemaphoreHandle_t holding;   // ya tiene su contexto
+    SemaphoreHandle_t go;        // leer el token
+    SemaphoreHandle_t done;
+    uint32_t generation;
+};
+
+// Lo que hace RTDB::send: contexto tomado y después el token para la URL
+void holder_task(void* pv)
+{
+    holder_t* h = static_cast<holder_t*>(pv);
+    FirebaseApp::request_ctx_t* ctx = h->app->acquireRequest();
+    xSemaphoreGive(h->holding);
+    xSemaphoreTake(h->go, portMAX_DELAY);
+    char token[64];
+    h->app->copyToken(token, sizeof(token), &h->generation);
+    h->generation = h->app->tokenGeneration();
+    h->app->releaseRequest(ctx);
+    xSemaphoreGive(h->done);
+    vTaskDelete(NULL);
+}
+
+struct refresher_t
+{
+    FirebaseApp* app;
+    esp_err_t err;
+    SemaphoreHandle_t done;
+};
+
+void refresher_task(void* pv)
+{
+    refresher_t* r = static_cast<refresher_t*>(pv);
+    r->err = r->app->forceRefreshAuth();
+    xSemaphoreGive(r->done);
+    vTaskDelete(NULL);
+}
+
+void test_refresh_with_pool_exhausted()
+{
+    host_set_deadlock_ms(3000);
+    s_refreshes = 0;
+    fake_http_set_handler(server, nullptr);
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token-viejo", (int64_t)time(NULL) + 3600), ESP_OK);
+    uint32_t before = app.tokenGeneration();
+
+    holder_t holders[HTTP_REQUEST_POOL_SIZE];
+    for (holder_t& h : holders) {
+        h.app = &app;
+        h.holding = xSemaphoreCreateBinary();
+        h.go = xSemaphoreCreateBinary();
+        h.done = xSemaphoreCreateBinary();
+        CHECK(xTaskCreate(holder_task, "holder", 8192, &h, 5, NULL) == pdPASS);
+        CHECK(xSemaphoreTake(h.holding, pdMS_TO_TICKS(2000)) == pdTRUE);
+    }
+    // Pool agotado: el refresh toma auth_lock y se queda esperando un contexto
+    refresher_t refresher = {&app, ESP_FAIL, xSemaphoreCreateBinary()};
+    CHECK(xTaskCreate(refresher_task, "refresh", 8192, &refresher, 5, NULL) == pdPASS);
+    sleep_ms(50);
+    for (holder_t& h : holders) xSemaphoreGive(h.go);
+    for (holder_t& h : holders) {
+        CHECK(xSemaphoreTake(h.done, pdMS_TO_TICKS(2000)) == pdTRUE);
+        // El primero que suelta su contexto deja pasar al refresh
+        CHECK(h.generation == before || h.generation == before + 1);
+    }
+    CHECK(xSemaphoreTake(refresher.done, pdMS_TO_TICKS(2000)) == pdTRUE);
+    CHECK_EQ(refresher.err, ESP_OK);
+    CHECK_EQ(s_refreshes.load(), 1);
+    CHECK_EQ(app.tokenGeneration(), before + 1);
+    char token[64];
+    CHECK_EQ(app.copyToken(token, sizeof(token), nullptr), strlen("token-nuevo"));
+    CHECK(strcmp(token, "token-nuevo") == 0);
+
+    for (holder_t& h : holders) {
+        vSemaphoreDelete(h.holding);
+        vSemaphoreDelete(h.go);
+        vSemaphoreDelete(h.done);
+    }
+    vSemaphoreDelete(refresher.done);
+    fake_http_set_handler(nullptr, nullptr);
+    host_set_deadlock_ms(10000);
+}
+
+// Muchas escrituras desde varias tareas mientras el token se renueva: ninguna
+// puede quedar colgada
+struct writer_t
+{
+    RTDB* db;
+    int count;
+    int failures;
+    SemaphoreHandle_t done;
+};
+
+void writer_task(void* pv)
+{
+    writer_t* w = static_cast<writer_t*>(pv);
+    for (int i = 0; i < w->count; ++i) {
+        if (w->db->putData("/estado", "{\"ok\":true}") != ESP_OK) w->failures++;
+    }
+    xSemaphoreGive(w->done);
+    vTaskDelete(NULL);
+}
+
+void test_writes_during_refreshes()
+{
+    host_set_deadlock_ms(3000);
+    s_refreshes = 0;
+    fake_http_set_handler(server, nullptr);
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token-viejo", (int64_t)time(NULL) + 3600), ESP_OK);
+    RTDB db(&app, DB_URL);
+
+    writer_t writers[3];
+    for (writer_t& w : writers) {
+        w = {&db, 300, 0, xSemaphoreCreateBinary()};
+        CHECK(xTaskCreate(writer_task, "writer", 8192, &w, 5, NULL) == pdPASS);
+    }
+    for (int i = 0; i < 20; ++i) {
+        CHECK_EQ(app.forceRefreshAuth(), ESP_OK);
+        sleep_ms(1);
+    }
+    for (writer_t& w : writers) {
+        CHECK(xSemaphoreTake(w.done, pdMS_TO_TICKS(10000)) == pdTRUE);
+        CHECK_EQ(w.failures, 0);
+        vSemaphoreDelete(w.done);
+    }
+    CHECK_EQ(s_refreshes.load(), 20);
+    fake_http_set_handler(nullptr, nullptr);
+    host_set_deadlock_ms(10000);
+}
+
+void bench_put_allocations()
+{
+    fake_http_set_handler(server, nullptr);
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token", (int64_t)time(NULL) + 3600), ESP_OK);
+    RTDB db(&app, DB_URL);
+
+    Json::Value value;
+    value["ts"] = 1760000000;
+    value["pm25"] = 7.4;
+    value["temp"] = 22.85;
+    value["hum"] = 48.2;
+    const char* text = "{\"ts\":1760000000,\"pm25\":7.4,\"temp\":22.85,\"hum\":48.2}";
+
+    // Primera vuelta: conexión, slot del host, caché del auth=...
+    CHECK_EQ(db.putData("/ultima", text), ESP_OK);
+    CHECK_EQ(db.putData("/ultima", value), ESP_OK);
+
+    const int N = 2000;
+    uint64_t before = s_news.load();
+    for (int i = 0; i < N; ++i) CHECK_EQ(db.putData("/ultima", text), ESP_OK);
+    uint64_t text_news = s_news.load() - before;
+    before = s_news.load();
+    for (int i = 0; i < N; ++i) CHECK_EQ(db.putData("/ultima", value), ESP_OK);
+    uint64_t value_news = s_news.load() - before;
+
+    printf("putData(const char*):  %.2f allocations por llamada\n", text_news / (double)N);
+    printf("putData(Json::Value):  %.2f allocations por llamada\n", value_news / (double)N);
+    CHECK_EQ(text_news, 0);
+    CHECK_EQ(value_news, 0);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+}
+
+int main()
+{
+    test_refresh_with_pool_exhausted();
+    test_writes_during_refreshes();
+    bench_put_allocations();
+    printf("rtdb_auth: OK\n");
+    return 0;
+}
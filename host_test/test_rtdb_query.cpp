@@ -0,0 +1,310 @@
+// Query, rtdbKeyLess y PageIterator contra una RTDB simulada que aplica
+// orderBy="$key", startAt, endAt y limitToFirst como la real (enteros de 32
+// bits primero, en orden numérico; el resto por texto) y contesta el objeto
+// en cualquier orden. El recorrido por páginas ve cada clave una sola vez
+// (cursor = última clave, limitToFirst = página + 1, la repetida se
+// descarta) y trimRange no borra nada después de endAt: de eso depende el
+// purgador del historial.
+#include <time.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rtdb.h"
+#include "rtdb_query.h"
+#include "request_builder.h"
+#include "fake_http.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+const char* DB_URL = "https://db.test";
+
+std::string render(const Query& q)
+{
+    char buffer[256];
+    RequestBuilder out(buffer, sizeof(buffer));
+    CHECK(q.build(out));
+    return out.c_str();
+}
+
+void test_render()
+{
+    CHECK(render(Query().orderByKey().limitToFirst(3)) == "?orderBy=%22%24key%22&limitToFirst=3");
+    CHECK(render(Query().orderByKey().startAt("-Nk 1").endAt("b/c").limitToFirst(51)) ==
+          "?orderBy=%22%24key%22&startAt=%22-Nk%201%22&endAt=%22b%2Fc%22&limitToFirst=51");
+    CHECK(render(Query().orderByChild("ts").startAt(1760000000.0).endAt(-2.5)) ==
+          "?orderBy=%22ts%22&startAt=1760000000&endAt=-2.5");
+    // limitToFirst y limitToLast se excluyen: manda el último
+    CHECK(render(Query().orderByValue().limitToFirst(5).limitToLast(2)) == "?orderBy=%22%24value%22&limitToLast=2");
+    CHECK(render(Query().shallow()) == "?shallow=true");
+    char buffer[64];
+    RequestBuilder out(buffer, sizeof(buffer));
+    CHECK(!Query().shallow().limitToFirst(2).build(out));
+}
+
+void test_key_order()
+{
+    // Enteros de 32 bits (sin ceros a la izquierda) primero y en orden numérico
+    const char* sorted[] = {"-2147483648", "-5", "0", "2", "10", "2147483647",
+                            "-0", "-Nk1", "007", "1.5", "10a", "2147483648", "A", "a", "b"};
+    const size_t n = sizeof(sorted) / sizeof(sorted[0]);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) CHECK_EQ(rtdbKeyLess(sorted[i], sorted[j]), i < j);
+    }
+}
+
+// ---- RTDB simulada ----
+
+struct server_t
+{
+    std::map<std::string, std::vector<std::string>> nodes;   // ruta -> claves (valor: {"v":<i>})
+    std::vector<std::string> queries;                          // query de cada GET, sin auth
+    int patches = 0;
+    bool fail_gets = false;
+    std::string body;
+};
+
+server_t s_server;
+
+std::string decode(const std::string& s)
+{
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size()) {
+            out += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+std::map<std::string, std::string> parse_query(const char* query, std::string& kept)
+{
+    std::map<std::string, std::string> params;
+    if (!query) return params;
+    std::string q(query + 1);
+    size_t pos = 0;
+    while (pos <= q.size()) {
+        size_t amp = q.find('&', pos);
+        if (amp == std::string::npos) amp = q.size();
+        std::string item = q.substr(pos, amp - pos);
+        size_t eq = item.find('=');
+        std::string name = item.substr(0, eq);
+        if (name != "auth") {
+            kept += kept.empty() ? "?" : "&";
+            kept += item;
+            params[name] = decode(item.substr(eq + 1));
+        }
+        pos = amp + 1;
+    }
+    return params;
+}
+
+std::string unquote(const std::string& s)
+{
+    return s.size() >= 2 && s.front() == '"' ? s.substr(1, s.size() - 2) : s;
+}
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    server_t* s = static_cast<server_t*>(user);
+    std::string url = req->url + strlen(DB_URL);
+    const char* query = strchr(req->url, '?');
+    std::string path = url.substr(0, url.find(".json"));
+    auto it = s->nodes.find(path);
+    std::string kept;
+    std::map<std::string, std::string> params = parse_query(query, kept);
+
+    if (req->method == HTTP_METHOD_PATCH) {
+        // {"k1":null,"k2":null}: borra esas claves
+        s->patches++;
+        Json::Value body;
+        Json::Reader reader;
+        CHECK(reader.parse(req->body, req->body + req->body_len, body));
+        CHECK(params["print"] == "silent");
+        if (it != s->nodes.end()) {
+            for (const std::string& key : body.getMemberNames()) {
+                CHECK(body[key].isNull());
+                std::vector<std::string>& keys = it->second;
+                keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+            }
+        }
+        resp->status = 204;
+        return;
+    }
+    s->queries.push_back(kept);
+    if (s->fail_gets) {
+        resp->status = 500;
+        return;
+    }
+    resp->status = 200;
+    if (it == s->nodes.end() || it->second.empty()) {
+        s->body = "null";
+        resp->body = s->body.c_str();
+        return;
+    }
+    CHECK(params["orderBy"] == "\"$key\"");
+    std::vector<std::string> keys = it->second;
+    std::sort(keys.begin(), keys.end(), rtdbKeyLess);
+    std::vector<std::string> selected;
+    int limit = params.count("limitToFirst") ? atoi(params["limitToFirst"].c_str()) : 1 << 30;
+    for (const std::string& k : keys) {
+        if (params.count("startAt") && rtdbKeyLess(k, unquote(params["startAt"]))) continue;
+        if (params.count("endAt") && rtdbKeyLess(unquote(params["endAt"]), k)) continue;
+        if ((int)selected.size() == limit) break;
+        selected.push_back(k);
+    }
+    // El orden del objeto en la respuesta no se garantiza: al revés
+    s->body = "{";
+    for (size_t i = selected.size(); i-- > 0;) {
+        if (s->body.size() > 1) s->body += ",";
+        s->body += "\"" + selected[i] + "\":{\"v\":" + std::to_string(i) + ",\"datos\":[1,2,3]}";
+    }
+    s->body += "}";
+    resp->body = s->body.c_str();
+}
+
+std::vector<std::string> mixed_keys()
+{
+    return {"b", "10", "-Nk00000000000000001", "2", "a", "007", "-5", "1.5", "2147483648", "A",
+            "0", "-Nk00000000000000000", "3", "zz", "-0", "11", "c", "Vzzzzzzz0000aaaaaaaa"};
+}
+
+std::vector<std::string> sorted(std::vector<std::string> keys)
+{
+    std::sort(keys.begin(), keys.end(), rtdbKeyLess);
+    return keys;
+}
+
+std::vector<std::string> walk(RTDB& db, const char* path, int page, bool with_values, const char* start = nullptr,
+                              const char* end = nullptr)
+{
+    PageIterator pages(db, path, page, with_values);
+    if (start) pages.startAt(start);
+    if (end) pages.endAt(end);
+    std::vector<std::string> seen;
+    while (pages.next()) {
+        CHECK(!pages.keys().empty());
+        CHECK((int)pages.keys().size() <= page);
+        CHECK(std::is_sorted(pages.keys().begin(), pages.keys().end(), rtdbKeyLess));
+        if (with_values) {
+            CHECK_EQ(pages.values().size(), pages.keys().size());
+            for (const std::string& k : pages.keys()) CHECK(pages.values().isMember(k));
+        }
+        seen.insert(seen.end(), pages.keys().begin(), pages.keys().end());
+    }
+    CHECK(!pages.failed());
+    CHECK(!pages.next());
+    return seen;
+}
+
+void test_pagination(RTDB& db)
+{
+    s_server.nodes["/historial"] = mixed_keys();
+    const std::vector<std::string> all = sorted(mixed_keys());
+    for (int page = 1; page <= 20; ++page) {
+        for (bool with_values : {false, true}) {
+            s_server.queries.clear();
+            CHECK(walk(db, "/historial", page, with_values) == all);
+            // Primera página sin cursor; las siguientes piden una más desde la última clave
+            CHECK(s_server.queries[0] == "?orderBy=%22%24key%22&limitToFirst=" + std::to_string(page));
+            for (size_t i = 1; i < s_server.queries.size(); ++i) {
+                const std::string& cursor = all[i * page - 1];
+                char encoded[128];
+                RequestBuilder enc(encoded, sizeof(encoded));
+                enc.appendEncoded(cursor.c_str(), cursor.size());
+                CHECK(s_server.queries[i] == std::string("?orderBy=%22%24key%22&startAt=%22") + encoded +
+                                                 "%22&limitToFirst=" + std::to_string(page + 1));
+            }
+            // Una vuelta por página y, si la última vino llena, una más vacía
+            size_t pages = (all.size() + page - 1) / page + (all.size() % page == 0 ? 1 : 0);
+            CHECK_EQ(s_server.queries.size(), pages);
+        }
+    }
+
+    // Límites inclusivos
+    std::vector<std::string> want;
+    for (const std::string& k : all) {
+        if (!rtdbKeyLess(k, "2") && !rtdbKeyLess("a", k)) want.push_back(k);
+    }
+    CHECK(walk(db, "/historial", 3, false, "2", "a") == want);
+    CHECK(walk(db, "/historial", 3, false, "zzz").empty());
+
+    // Nodo vacío o inexistente: ninguna página, sin error
+    CHECK(walk(db, "/nada", 5, false).empty());
+
+    // La lectura falla: failed() y no hay más páginas
+    s_server.fail_gets = true;
+    PageIterator pages(db, "/historial", 4);
+    CHECK(!pages.next());
+    CHECK(pages.failed());
+    CHECK(!pages.next());
+    s_server.fail_gets = false;
+}
+
+void test_trim_range(RTDB& db)
+{
+    // Claves del historial: viejas (texto de fecha), push IDs y alguna entera
+    std::vector<std::string> keys = {"25-10-01_10-00-00", "25-10-02_10-00-00", "7", "12",
+                                     "VzzA0000c301-0000001", "VzzA0000c301-0000002", "VzzB0000c301-0000001",
+                                     "VzzB0000c301-0000002", "VzzC0000c301-0000001", "VzzD0000c301-0000001"};
+    s_server.nodes["/historial"] = keys;
+    const char* end_key = "VzzB0000c301-0000002";
+    s_server.patches = 0;
+    int rounds = 0, deleted = 0;
+    for (;;) {
+        int n = db.trimRange("/historial", end_key, 3);
+        CHECK(n >= 0);
+        if (n == 0) break;
+        deleted += n;
+        rounds++;
+        CHECK(rounds < 10);
+    }
+    CHECK_EQ(deleted, 8);
+    CHECK_EQ(s_server.patches, 3);
+    // endAt va en cada lectura, y lo posterior a end_key queda
+    for (const std::string& q : s_server.queries) CHECK(q.find("endAt=%22VzzB0000c301-0000002%22") != std::string::npos);
+    CHECK(sorted(s_server.nodes["/historial"]) ==
+          std::vector<std::string>({"VzzC0000c301-0000001", "VzzD0000c301-0000001"}));
+
+    // Sin end_key (trimOldestBatch): los más viejos primero
+    s_server.nodes["/historial"] = keys;
+    CHECK_EQ(db.trimOldestBatch("/historial", 4), 4);
+    const std::vector<std::string> oldest_first = sorted(keys);
+    CHECK(sorted(s_server.nodes["/historial"]) ==
+          std::vector<std::string>(oldest_first.begin() + 4, oldest_first.end()));
+
+    // Falla la lectura: -1 y no se borra nada
+    s_server.fail_gets = true;
+    size_t before = s_server.nodes["/historial"].size();
+    CHECK_EQ(db.trimRange("/historial", end_key, 3), -1);
+    CHECK_EQ(s_server.nodes["/historial"].size(), before);
+    s_server.fail_gets = false;
+}
+
+}
+
+int main()
+{
+    test_render();
+    test_key_order();
+
+    fake_http_set_handler(server, &s_server);
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token", (int64_t)time(NULL) + 3600), ESP_OK);
+    RTDB db(&app, DB_URL);
+    test_pagination(db);
+    s_server.queries.clear();
+    test_trim_range(db);
+    fake_http_set_handler(nullptr, nullptr);
+    printf("rtdb_query: OK\n");
+    return 0;
+}
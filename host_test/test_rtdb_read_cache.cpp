@@ -0,0 +1,234 @@
+// Caché de RTDB::getData (user-016) contra una RTDB simulada que, como la
+// real, contesta 200 con el body y el ETag aunque no haya cambios:
+//  - por defecto no se manda if-none-match: mismo ETag -> body descartado y
+//    copia de la caché; ETag nuevo -> se parsea y reemplaza la entrada.
+//  - con setIfNoneMatch(true) y un server que sí contesta 304: sin body.
+//  - la entrada desalojada por otras lecturas entre el request y la consulta
+//    a la caché: se lee entero otra vez, sin restos del intento anterior.
+#include <time.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "rtdb.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+const char* DB_URL = "https://db.test";
+
+struct node_t
+{
+    std::string body;
+    std::string etag;
+};
+
+struct server_t
+{
+    std::mutex m;
+    std::map<std::string, node_t> nodes;   // por ruta, sin ".json"
+    bool answer_304 = false;               // responder 304 a un if-none-match igual
+    int with_etag_request = 0;             // GET con X-Firebase-ETag
+    int with_if_none_match = 0;
+    int not_modified = 0;
+    size_t body_bytes = 0;
+    std::string body;                      // respuesta en curso
+    std::string etag;
+    int config_gets = 0;
+};
+
+server_t s_server;
+
+void set_node(const char* path, const char* body, const char* etag)
+{
+    std::lock_guard<std::mutex> g(s_server.m);
+    s_server.nodes[path] = {body, etag};
+}
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    server_t* s = static_cast<server_t*>(user);
+    std::lock_guard<std::mutex> g(s->m);
+    const char* path = req->url + strlen(DB_URL);
+    const char* end = strstr(path, ".json");
+    auto it = s->nodes.find(std::string(path, end ? end - path : strlen(path)));
+    if (req->method != HTTP_METHOD_GET || it == s->nodes.end()) {
+        resp->status = 404;
+        return;
+    }
+    if (it->first == "/config") s->config_gets++;
+    const char* want_etag = fake_http_header(req, "X-Firebase-ETag");
+    const char* if_none_match = fake_http_header(req, "if-none-match");
+    if (want_etag) s->with_etag_request++;
+    if (if_none_match) s->with_if_none_match++;
+    s->etag = it->second.etag;
+    resp->etag = want_etag ? s->etag.c_str() : nullptr;
+    if (s->answer_304 && if_none_match && it->second.etag == if_none_match) {
+        s->not_modified++;
+        resp->status = 304;
+        return;
+    }
+    s->body = it->second.body;
+    s->body_bytes += s->body.size();
+    resp->status = 200;
+    resp->body = s->body.c_str();
+}
+
+void reset_counters()
+{
+    std::lock_guard<std::mutex> g(s_server.m);
+    s_server.with_etag_request = s_server.with_if_none_match = s_server.not_modified = 0;
+    s_server.body_bytes = 0;
+}
+
+void test_same_etag_default()
+{
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token", (int64_t)time(NULL) + 3600), ESP_OK);
+    RTDB db(&app, DB_URL);
+    set_node("/config", "{\"muestreo_min\":5,\"modo\":\"normal\"}", "etag-1");
+    reset_counters();
+
+    Json::Value first = db.getData("/config");
+    CHECK_EQ(first["muestreo_min"].asInt(), 5);
+    Json::Value second = db.getData("/config");
+    CHECK(second == first);
+    uint32_t hits = 0, misses = 0;
+    db.readCacheStats(hits, misses);
+    CHECK_EQ(hits, 1);
+    CHECK_EQ(misses, 1);
+    // Sin if-none-match: el server manda el body igual, solo se ahorra el parseo
+    CHECK_EQ(s_server.with_etag_request, 2);
+    CHECK_EQ(s_server.with_if_none_match, 0);
+    CHECK_EQ(s_server.body_bytes, 2 * strlen("{\"muestreo_min\":5,\"modo\":\"normal\"}"));
+
+    // Cambió: ETag nuevo, se parsea y reemplaza la copia
+    set_node("/config", "{\"muestreo_min\":2}", "etag-2");
+    Json::Value third = db.getData("/config");
+    CHECK_EQ(third["muestreo_min"].asInt(), 2);
+    CHECK(!third.isMember("modo"));
+    CHECK(db.getData("/config") == third);
+    db.readCacheStats(hits, misses);
+    CHECK_EQ(hits, 2);
+    CHECK_EQ(misses, 2);
+}
+
+void test_if_none_match_flag()
+{
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token", (int64_t)time(NULL) + 3600), ESP_OK);
+    RTDB db(&app, DB_URL);
+    db.setIfNoneMatch(true);
+    set_node("/config", "{\"muestreo_min\":5}", "etag-1");
+    s_server.answer_304 = true;
+    reset_counters();
+
+    Json::Value first = db.getData("/config");
+    CHECK(db.getData("/config") == first);
+    CHECK(db.getData("/config") == first);
+    CHECK_EQ(s_server.with_if_none_match, 2);
+    CHECK_EQ(s_server.not_modified, 2);
+    CHECK_EQ(s_server.body_bytes, strlen("{\"muestreo_min\":5}"));
+    uint32_t hits = 0, misses = 0;
+    db.readCacheStats(hits, misses);
+    CHECK_EQ(hits, 2);
+    s_server.answer_304 = false;
+}
+
+// Lectores de otras rutas llenan la caché mientras una tarea relee /config:
+// a veces la entrada se desaloja entre la pregunta al server (mismo ETag, body
+// descartado) y la consulta a la caché, y getData tiene que leerlo entero.
+// Ninguna lectura puede devolver algo distinto de /config.
+struct reader_t
+{
+    RTDB* db;
+    const char* const* paths;
+    int count;
+    std::atomic<bool>* stop;
+    int reads;
+    int wrong;
+    SemaphoreHandle_t done;
+};
+
+void reader_task(void* pv)
+{
+    reader_t* r = static_cast<reader_t*>(pv);
+    while (!*r->stop) {
+        const char* path = r->paths[r->reads % r->count];
+        Json::Value v = r->db->getData(path);
+        if (v["n"].asInt() != (int)(path[1] - 'a')) r->wrong++;
+        r->reads++;
+    }
+    xSemaphoreGive(r->done);
+    vTaskDelete(NULL);
+}
+
+int config_gets()
+{
+    std::lock_guard<std::mutex> g(s_server.m);
+    return s_server.config_gets;
+}
+
+void test_evicted_while_reading()
+{
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token", (int64_t)time(NULL) + 3600), ESP_OK);
+    RTDB db(&app, DB_URL);
+    set_node("/config", "{\"muestreo_min\":5,\"lista\":[1,2,3]}", "etag-1");
+    static const char* const paths[] = {"/a", "/b", "/c", "/d", "/e"};
+    char etag[8];
+    for (int i = 0; i < 5; ++i) {
+        char body[16];
+        snprintf(body, sizeof(body), "{\"n\":%d}", i);
+        snprintf(etag, sizeof(etag), "etag-%c", 'a' + i);
+        set_node(paths[i], body, etag);
+    }
+    Json::Value expected = db.getData("/config");
+    CHECK_EQ(expected["lista"].size(), 3);
+
+    std::atomic<bool> stop(false);
+    reader_t readers[3];
+    for (int i = 0; i < 3; ++i) {
+        readers[i] = {&db, paths + i, 5 - i, &stop, 0, 0, xSemaphoreCreateBinary()};
+        CHECK(xTaskCreate(reader_task, "reader", 8192, &readers[i], 5, NULL) == pdPASS);
+    }
+    // Hasta ver varias relecturas completas (o un tope de vueltas)
+    int calls = 0, wrong = 0, base = config_gets();
+    while (calls < 20000 && config_gets() - base - calls < 5) {
+        if (!(db.getData("/config") == expected)) wrong++;
+        calls++;
+    }
+    stop = true;
+    for (reader_t& r : readers) {
+        CHECK(xSemaphoreTake(r.done, pdMS_TO_TICKS(5000)) == pdTRUE);
+        CHECK_EQ(r.wrong, 0);
+        vSemaphoreDelete(r.done);
+    }
+    int rereads = config_gets() - base - calls;
+    printf("/config: %d lecturas, %d desalojadas durante el request y leídas otra vez\n", calls, rereads);
+    CHECK_EQ(wrong, 0);
+    CHECK(rereads > 0);
+}
+
+}
+
+int main()
+{
+    fake_http_set_handler(server, &s_server);
+    test_same_etag_default();
+    test_if_none_match_flag();
+    test_evicted_while_reading();
+    fake_http_set_handler(nullptr, nullptr);
+    printf("rtdb_read_cache: OK\n");
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Modos de escritura de la RTDB: con print=silent el servidor contesta 204 sin
+// body y PUT, POST (PUT con clave del equipo) y PATCH lo cuentan como éxito; en
+// ECHO vuelve el dato entero. Se miden los bytes de respuesta de cada modo con
+// el lote que sube el equipo: silent no recibe nada.
+#include <time.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "rtdb.h"
+#include "fake_http.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+const char* DB_URL = "https://db.test";
+
+const char* BATCH =
+    "{\"ts\":1760000000,\"pm25\":12.4,\"pm10\":20.1,\"temp\":22.85,\"hum\":48.2,\"co2\":4.1e-4,"
+    "\"muestras\":[12.1,12.3,12.4,12.9,13.0,12.2,11.8,12.0,12.5,12.7]}";
+
+struct server_t
+{
+    int status;                 // 0: 204 con silent, 200 con el dato si no
+    int requests = 0;
+    bool last_silent = false;
+    esp_http_client_method_t last_method = HTTP_METHOD_GET;
+    std::string body;
+};
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    server_t* s = static_cast<server_t*>(user);
+    s->requests++;
+    s->last_method = req->method;
+    s->last_silent = strstr(req->url, "print=silent") != nullptr;
+    if (s->status) {
+        resp->status = s->status;
+        return;
+    }
+    if (s->last_silent) {
+        resp->status = 204;
+        return;
+    }
+    s->body.assign(req->body, req->body_len);
+    resp->status = 200;
+    resp->body = s->body.c_str();
+}
+
+uint64_t rx_bytes(FirebaseApp& app)
+{
+    return app.getStats().rx_body_bytes;
+}
+
+esp_err_t write(RTDB& db, esp_http_client_method_t method, firebase_write_mode_t mode)
+{
+    if (method == HTTP_METHOD_POST) return db.postData("/lotes", BATCH, mode);
+    if (method == HTTP_METHOD_PATCH) return db.patchData("/equipo", BATCH, mode);
+    return db.putData("/equipo/ultimo", BATCH, mode);
+}
+
+void test_silent_204_is_success(FirebaseApp& app, RTDB& db, server_t& s)
+{
+    const esp_http_client_method_t methods[] = {HTTP_METHOD_PUT, HTTP_METHOD_POST, HTTP_METHOD_PATCH};
+    for (esp_http_client_method_t method : methods) {
+        uint64_t before = rx_bytes(app);
+        int requests = s.requests;
+        CHECK_EQ(write(db, method, FIREBASE_WRITE_SILENT), ESP_OK);
+        CHECK(s.last_silent);
+        CHECK_EQ(s.last_method, method == HTTP_METHOD_PATCH ? HTTP_METHOD_PATCH : HTTP_METHOD_PUT);
+        CHECK_EQ(s.requests, requests + 1);   // 204 no se reintenta
+        CHECK_EQ(rx_bytes(app), before);
+
+        // 204 aunque se haya pedido el dato: sigue siendo éxito
+        s.status = 204;
+        CHECK_EQ(write(db, method, FIREBASE_WRITE_ECHO), ESP_OK);
+        CHECK(!s.last_silent);
+        // Un 4xx no
+        s.status = 400;
+        CHECK_EQ(write(db, method, FIREBASE_WRITE_SILENT), ESP_FAIL);
+        s.status = 0;
+    }
+
+    // El modo global: SILENT por defecto, setWriteMode lo cambia
+    CHECK_EQ(db.putData("/equipo/ultimo", BATCH), ESP_OK);
+    CHECK(s.last_silent);
+    db.setWriteMode(FIREBASE_WRITE_ECHO);
+    CHECK_EQ(db.putData("/equipo/ultimo", BATCH), ESP_OK);
+    CHECK(!s.last_silent);
+    db.setWriteMode(FIREBASE_WRITE_SILENT);
+}
+
+void test_response_bytes(FirebaseApp& app, RTDB& db)
+{
+    const int WRITES = 100;
+    const firebase_write_mode_t modes[] = {FIREBASE_WRITE_ECHO, FIREBASE_WRITE_SILENT};
+    uint64_t received[2];
+    for (int m = 0; m < 2; ++m) {
+        uint64_t before = rx_bytes(app);
+        for (int i = 0; i < WRITES; ++i) {
+            CHECK_EQ(write(db, i % 3 == 0 ? HTTP_METHOD_POST : HTTP_METHOD_PUT, modes[m]), ESP_OK);
+        }
+        received[m] = rx_bytes(app) - before;
+    }
+    printf("%d escrituras de %u bytes: echo recibe %llu bytes de body, silent %llu\n", WRITES,
+           (unsigned)strlen(BATCH), (unsigned long long)received[0], (unsigned long long)received[1]);
+    CHECK_EQ(received[0], (uint64_t)WRITES * strlen(BATCH));
+    CHECK_EQ(received[1], 0);
+}
+
+}
+
+int main()
+{
+    server_t s;
+    s.status = 0;
+    fake_http_set_handler(server, &s);
+    FirebaseApp app("clave");
+    CHECK_EQ(app.restoreSession("refresh", "token", (int64_t)time(NULL) + 3600), ESP_OK);
+    RTDB db(&app, DB_URL);
+    test_silent_204_is_success(app, db, s);
+    test_response_bytes(app, db);
+    fake_http_set_handler(nullptr, nullptr);
+    printf("rtdb_write_mode: OK\n");
+    return 0;
+}
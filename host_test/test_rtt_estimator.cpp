@@ -0,0 +1,195 @@
+// Estimador de RTT (RFC 6298): primera muestra y actualizaciones, piso G del
+// término de varianza, backoff por timeout (tope 6), recorte a piso/techo
+// del perfil y fallback sin muestras. En performRequest, solo un timeout de
+// verdad (intento que agota el plazo) duplica el RTO: un DNS que falla, un
+// RST o una alerta TLS fallan rápido y no lo tocan.
+#include <cstring>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "app.h"
+#include "fake_http.h"
+#include "host_rtos.h"
+#include "rtt_estimator.h"
+#include "test_util.h"
+
+using namespace ESPFirebase;
+
+namespace {
+
+void test_first_sample_and_updates()
+{
+    rtt_estimator_t est;
+    memset(&est, 0, sizeof(est));
+    CHECK_EQ(rttRtoMs(est), 0);
+
+    // Primera muestra: srtt = R, rttvar = R/2, RTO = R + 4 * R/2
+    rttSample(est, 200);
+    CHECK_EQ(est.srtt_ms, 200);
+    CHECK_EQ(est.rttvar_ms, 100);
+    CHECK_EQ(rttRtoMs(est), 600);
+
+    // rttvar += (|srtt - R| - rttvar) / 4, después srtt += (R - srtt) / 8
+    rttSample(est, 280);
+    CHECK_EQ(est.rttvar_ms, 100 + (80 - 100) / 4);
+    CHECK_EQ(est.srtt_ms, 200 + 80 / 8);
+    CHECK_EQ(rttRtoMs(est), 210 + 4 * 95);
+    CHECK_EQ(est.samples, 2);
+
+    // Muestras iguales: la varianza converge a 0 y el srtt al RTT
+    for (int i = 0; i < 200; ++i) rttSample(est, 120);
+    CHECK(est.srtt_ms >= 120 && est.srtt_ms < 128);   // la división entera deja (srtt - R) < 8
+    CHECK(est.rttvar_ms <= 10);
+
+    // RTT 0 cuenta como 1 ms
+    rtt_estimator_t zero;
+    memset(&zero, 0, sizeof(zero));
+    rttSample(zero, 0);
+    CHECK_EQ(zero.srtt_ms, 1);
+}
+
+void test_granularity_floor()
+{
+    // Sin varianza el término 4 * rttvar no baja de G = 10 ms
+    rtt_estimator_t est;
+    memset(&est, 0, sizeof(est));
+    rttSample(est, 1);
+    CHECK_EQ(est.rttvar_ms, 0);
+    CHECK_EQ(rttRtoMs(est), 1 + 10);
+    rttSample(est, 4);   // rttvar = 0 + (3 - 0) / 4 = 0
+    CHECK_EQ(rttRtoMs(est), est.srtt_ms + 10);
+}
+
+void test_backoff_cap()
+{
+    const timeout_profile_t wide = {1, 1, 1000000};
+    rtt_estimator_t est;
+    memset(&est, 0, sizeof(est));
+    rttSample(est, 100);   // RTO 300
+    CHECK_EQ(rttTimeoutMs(est, wide, 5000), 300);
+    for (int i = 1; i <= 10; ++i) {
+        rttOnTimeout(est);
+        int shift = i < 6 ? i : 6;
+        CHECK_EQ(est.backoff, shift);
+        CHECK_EQ(rttTimeoutMs(est, wide, 5000), 300 << shift);
+    }
+    CHECK_EQ(est.timeouts, 10);
+    // Una muestra nueva termina el backoff (el total de timeouts queda)
+    rttSample(est, 100);
+    CHECK_EQ(est.backoff, 0);
+    CHECK_EQ(est.timeouts, 10);
+    CHECK_EQ(rttTimeoutMs(est, wide, 5000), rttRtoMs(est));
+}
+
+void test_profile_clamp_and_fallback()
+{
+    rtt_estimator_t est;
+    memset(&est, 0, sizeof(est));
+    // Sin muestras: fallback, acotado al techo
+    CHECK_EQ(rttTimeoutMs(est, DEFAULT_TIMEOUT_PROFILE, 5000), 5000);
+    CHECK_EQ(rttTimeoutMs(est, DEFAULT_TIMEOUT_PROFILE, 60000), DEFAULT_TIMEOUT_PROFILE.ceiling_ms);
+    // Con muestras el fallback ya no cuenta
+    rttSample(est, 50);   // RTO 150, * 2 = 300: sube al piso
+    CHECK_EQ(rttTimeoutMs(est, DEFAULT_TIMEOUT_PROFILE, 60000), DEFAULT_TIMEOUT_PROFILE.floor_ms);
+    CHECK_EQ(rttTimeoutMs(est, CONNECT_TIMEOUT_PROFILE, 60000), CONNECT_TIMEOUT_PROFILE.floor_ms);
+    // Enlace lento: RTO * multiplicador entre piso y techo, y el techo manda
+    memset(&est, 0, sizeof(est));
+    rttSample(est, 1500);   // RTO 4500, * 2 = 9000
+    CHECK_EQ(rttTimeoutMs(est, DEFAULT_TIMEOUT_PROFILE, 0), 9000);
+    rttOnTimeout(est);
+    CHECK_EQ(rttTimeoutMs(est, DEFAULT_TIMEOUT_PROFILE, 0), 18000);
+    rttOnTimeout(est);
+    CHECK_EQ(rttTimeoutMs(est, DEFAULT_TIMEOUT_PROFILE, 0), DEFAULT_TIMEOUT_PROFILE.ceiling_ms);
+}
+
+// ---- performRequest: qué fallas cuentan como timeout ----
+
+const char* URL = "https://db.test/x.json";
+
+struct server_t
+{
+    esp_err_t err;               // ESP_OK: 200
+    bool hang;                   // la falla llega cuando se agota el plazo
+    std::vector<int> timeouts;   // el plazo de cada request
+};
+
+void server(const fake_http_request_t* req, fake_http_response_t* resp, void* user)
+{
+    server_t* s = static_cast<server_t*>(user);
+    s->timeouts.push_back(req->timeout_ms);
+    resp->err = s->err;
+    resp->status = s->err == ESP_OK ? 200 : -1;
+    if (s->err != ESP_OK && s->hang) host_advance_us((int64_t)req->timeout_ms * 1000);
+}
+
+void no_delay(uint32_t, void*) {}
+
+firebase_host_rtt_t host_rtt(FirebaseApp& app)
+{
+    firebase_host_rtt_t h;
+    CHECK_EQ(app.hostRtt(&h, 1), 1);
+    return h;
+}
+
+void test_fast_failures_do_not_back_off()
+{
+    server_t s = {ESP_OK, false, {}};
+    fake_http_set_handler(server, &s);
+    host_set_delay_hook(no_delay, nullptr);
+    FirebaseApp app("clave");
+    retry_policy_t policy = {4, 100, 100, 0, 0, nullptr};
+    app.setRetryPolicy(policy);
+
+    CHECK_EQ(app.performRequest(URL, HTTP_METHOD_GET).status_code, 200);
+    const int base = (int)host_rtt(app).timeout_ms;
+    CHECK(base > 0);
+
+    // Ráfagas de fallas rápidas (DNS, conexión rechazada, alerta TLS, RST)
+    const esp_err_t fast[] = {ESP_ERR_HTTP_CONNECT, ESP_FAIL, ESP_ERR_HTTP_FETCH_HEADER,
+                              ESP_ERR_HTTP_CONNECTION_CLOSED};
+    for (esp_err_t err : fast) {
+        s.err = err;
+        app.performRequest(URL, HTTP_METHOD_GET);
+    }
+    firebase_host_rtt_t h = host_rtt(app);
+    CHECK_EQ(h.timeouts, 0);
+    CHECK_EQ(h.connect_timeouts, 0);
+    CHECK_EQ((int)h.timeout_ms, base);
+
+    // Un intento que agota el plazo sí: el siguiente espera el doble
+    s.err = ESP_ERR_HTTP_FETCH_HEADER;
+    s.hang = true;
+    s.timeouts.clear();
+    app.performRequest(URL, HTTP_METHOD_GET);
+    h = host_rtt(app);
+    CHECK(h.timeouts + h.connect_timeouts == 4);
+    CHECK(s.timeouts.size() == 4);
+    CHECK(s.timeouts.back() > s.timeouts.front());
+
+    // ESP_ERR_HTTP_EAGAIN es timeout aunque vuelva rápido
+    FirebaseApp other("clave");
+    other.setRetryPolicy(policy);
+    s.err = ESP_OK;
+    s.hang = false;
+    CHECK_EQ(other.performRequest(URL, HTTP_METHOD_GET).status_code, 200);
+    s.err = ESP_ERR_HTTP_EAGAIN;
+    other.performRequest(URL, HTTP_METHOD_GET);
+    h = host_rtt(other);
+    CHECK(h.timeouts + h.connect_timeouts > 0);
+
+    host_set_delay_hook(nullptr, nullptr);
+    fake_http_set_handler(nullptr, nullptr);
+}
+
+}
+
+int main()
+{
+    test_first_sample_and_updates();
+    test_granularity_floor();
+    test_backoff_cap();
+    test_profile_clamp_and_fallback();
+    test_fast_failures_do_not_back_off();
+    printf("rtt_estimator: OK\n");
+    return 0;
+}
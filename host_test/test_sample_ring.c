@@ -0,0 +1,161 @@
+// Ring SPSC de sampling_task -> uploader_task (main/sample_ring.c).
+//
+// El productor empuja una muestra por periodo según un calendario absoluto
+// (como vTaskDelayUntil); el consumidor imita a uploader_task y cada tanto se
+// queda "colgado" en un upload. Mientras las esperas quepan en el ring no se
+// pierde ninguna ranura; si no caben, la pérdida se detecta por el salto de slot.
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "sample_ring.h"
+#include "test_util.h"
+
+#define PERIOD_US 2000
+
+typedef struct {
+    sample_ring_t ring;
+    uint32_t samples;        // ranuras que genera el productor
+    int max_stall_ms;        // espera máxima inyectada en el consumidor
+    int stall_every;         // cada cuántas muestras se cuelga
+    uint32_t push_failures;
+    int64_t max_push_ns;     // la llamada más lenta a sample_ring_push
+    uint32_t received;
+    uint32_t gaps;           // ranuras que el consumidor vio saltadas
+    uint32_t out_of_order;
+    int stalled_ms;          // total de esperas inyectadas
+} pipeline_t;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sleep_until_ns(int64_t t)
+{
+    struct timespec ts = { (time_t)(t / 1000000000), (long)(t % 1000000000) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {}
+}
+
+static void sleep_ms(int ms)
+{
+    sleep_until_ns(now_ns() + (int64_t)ms * 1000000);
+}
+
+static volatile int s_producer_done;
+
+static void *producer(void *pv)
+{
+    pipeline_t *p = pv;
+    int64_t next = now_ns();
+    for (uint32_t slot = 0; slot < p->samples; ++slot) {
+        sample_t s = { .slot = slot, .ts = (time_t)slot, .valid = true };
+        s.data.co2 = (uint16_t)slot;
+        int64_t t0 = now_ns();
+        if (!sample_ring_push(&p->ring, &s)) p->push_failures++;
+        int64_t dt = now_ns() - t0;
+        if (dt > p->max_push_ns) p->max_push_ns = dt;
+        next += PERIOD_US * 1000;
+        sleep_until_ns(next);
+    }
+    __atomic_store_n(&s_producer_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *consumer(void *pv)
+{
+    pipeline_t *p = pv;
+    uint32_t next_slot = 0;
+    unsigned seed = 12345;
+    for (;;) {
+        sample_t s;
+        bool got = false;
+        while (sample_ring_pop(&p->ring, &s)) {
+            got = true;
+            // Igual que uploader_task: un salto de slot es una pérdida
+            if (s.slot != next_slot) {
+                if (s.slot > next_slot) p->gaps += s.slot - next_slot;
+                else p->out_of_order++;
+            }
+            if (s.data.co2 != (uint16_t)s.slot) p->out_of_order++;
+            next_slot = s.slot + 1;
+            p->received++;
+            if (p->received % (uint32_t)p->stall_every == 0) {
+                // "Upload" lento: timeout de red, reintentos, reconexión Wi-Fi...
+                seed = seed * 1103515245u + 12345u;
+                int ms = (int)((seed >> 16) % (unsigned)(p->max_stall_ms + 1));
+                p->stalled_ms += ms;
+                sleep_ms(ms);
+            }
+        }
+        if (!got) {
+            if (__atomic_load_n(&s_producer_done, __ATOMIC_ACQUIRE) && sample_ring_count(&p->ring) == 0) break;
+            sleep_ms(1);
+        }
+    }
+    return NULL;
+}
+
+static void run(pipeline_t *p)
+{
+    sample_ring_init(&p->ring);
+    s_producer_done = 0;
+    pthread_t prod, cons;
+    pthread_create(&cons, NULL, consumer, p);
+    pthread_create(&prod, NULL, producer, p);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+}
+
+// Esperas de hasta 50 ms con un periodo de 2 ms: como mucho ~25 muestras se
+// acumulan y el ring tiene 64. Ninguna ranura se pierde ni se desordena, y el
+// productor nunca se bloquea. El push más lento solo se informa: en un host
+// cargado (CI, valgrind) el scheduler puede desalojar al productor en medio de
+// un push y un tope de tiempo real fallaría sin que el ring espere a nadie.
+static void test_stalls_within_capacity(void)
+{
+    pipeline_t p;
+    memset(&p, 0, sizeof(p));
+    p.samples = 1500;
+    p.max_stall_ms = 50;
+    p.stall_every = 20;
+    run(&p);
+    printf("stalls: %u muestras, %d ms colgado, push mas lento %lld us\n",
+           (unsigned)p.received, p.stalled_ms, (long long)(p.max_push_ns / 1000));
+    CHECK(p.stalled_ms > 500);           // las esperas existieron de verdad
+    CHECK_EQ(p.push_failures, 0);
+    CHECK_EQ(sample_ring_dropped(&p.ring), 0);
+    CHECK_EQ(p.received, p.samples);
+    CHECK_EQ(p.gaps, 0);
+    CHECK_EQ(p.out_of_order, 0);
+}
+
+// Un upload colgado más de lo que cubre el ring: el productor sigue a su
+// ritmo, descarta y el consumidor ve exactamente esas ranuras como salto.
+static void test_stall_beyond_capacity_is_detected(void)
+{
+    pipeline_t p;
+    memset(&p, 0, sizeof(p));
+    p.samples = 400;
+    p.max_stall_ms = 400;                // hasta 200 periodos
+    p.stall_every = 100;
+    run(&p);
+    printf("overflow: %u recibidas, %u descartadas, %u vistas como salto\n",
+           (unsigned)p.received, sample_ring_dropped(&p.ring), (unsigned)p.gaps);
+    CHECK_EQ(p.push_failures, sample_ring_dropped(&p.ring));
+    CHECK_EQ(p.received + sample_ring_dropped(&p.ring), p.samples);
+    CHECK_EQ(p.out_of_order, 0);
+    // Los descartes del final (si los hay) no llegan a verse como salto
+    CHECK(p.gaps <= sample_ring_dropped(&p.ring));
+}
+
+int main(void)
+{
+    test_stalls_within_capacity();
+    test_stall_beyond_capacity_is_detected();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+// Aserciones mínimas para los tests de host: el primer fallo termina el
+// proceso con código 1 (ctest lo marca como fallido).
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) fallo\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        long long a_ = (long long)(a), b_ = (long long)(b); \
+        if (a_ != b_) { \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) fallo: %lld != %lld\n", \
+                    __FILE__, __LINE__, #a, #b, a_, b_); \
+            exit(1); \
+        } \
+    } while (0)
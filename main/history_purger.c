@@ -0,0 +1,126 @@
+#include "history_purger.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "firebase.h"
+
+#define PURGER_TAG       "PURGER"
+#define PURGER_NS        "purger"
+#define PURGER_KEY_ROOT  "root"
+#define PURGER_KEY_END   "end"
+#define PURGER_KEY_DONE  "done"
+
+#define PURGER_RETRY_US  (30LL * 1000000)   // tras un fallo
+#define PURGER_PAUSE_US  (200LL * 1000)     // entre páginas: deja pasar al resto de la cola
+
+static char s_root[64];
+static char s_end[HISTORY_PURGER_KEY_MAX];
+static uint32_t s_deleted;
+static atomic_bool s_running = false;
+static esp_timer_handle_t s_timer;
+
+static void purger_save(void) {
+    nvs_handle_t h;
+    if (nvs_open(PURGER_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_set_str(h, PURGER_KEY_ROOT, s_root);
+    nvs_set_str(h, PURGER_KEY_END, s_end);
+    nvs_set_u32(h, PURGER_KEY_DONE, s_deleted);
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+static void purger_clear(void) {
+    nvs_handle_t h;
+    if (nvs_open(PURGER_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_erase_all(h);
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+// Purga pendiente de un arranque anterior para el mismo root
+static bool purger_load(const char *root, char *end, size_t end_len, uint32_t *deleted) {
+    nvs_handle_t h;
+    if (nvs_open(PURGER_NS, NVS_READONLY, &h) != ESP_OK) return false;
+    char saved_root[sizeof(s_root)];
+    size_t len = sizeof(saved_root);
+    bool ok = nvs_get_str(h, PURGER_KEY_ROOT, saved_root, &len) == ESP_OK && strcmp(saved_root, root) == 0;
+    len = end_len;
+    ok = ok && nvs_get_str(h, PURGER_KEY_END, end, &len) == ESP_OK;
+    if (ok && nvs_get_u32(h, PURGER_KEY_DONE, deleted) != ESP_OK) *deleted = 0;
+    nvs_close(h);
+    return ok;
+}
+
+static void purger_page_done(firebase_async_handle_t handle, int result, void *user);
+
+static void purger_submit(void) {
+    if (firebase_submit_async(FIREBASE_OP_PURGE_PAGE, s_root, s_end, FIREBASE_PRIO_LOW,
+                              purger_page_done, NULL) <= 0) {
+        // Cola llena o no arrancada: probar más tarde
+        esp_timer_start_once(s_timer, PURGER_RETRY_US);
+    }
+}
+
+static void purger_timer_cb(void *arg) {
+    purger_submit();
+}
+
+// Corre en la tarea worker de la cola asíncrona
+static void purger_page_done(firebase_async_handle_t handle, int result, void *user) {
+    if (result < 0) {
+        ESP_LOGW(PURGER_TAG, "Página de purga falló (%d); reintento en %lld s", result, PURGER_RETRY_US / 1000000);
+        esp_timer_start_once(s_timer, PURGER_RETRY_US);
+        return;
+    }
+    if (result == 0) {
+        ESP_LOGI(PURGER_TAG, "Purga de %s completa: %u borrados", s_root, (unsigned)s_deleted);
+        purger_clear();
+        atomic_store(&s_running, false);
+        return;
+    }
+    s_deleted += (uint32_t)result;
+    purger_save();
+    ESP_LOGI(PURGER_TAG, "Purga de %s: %u borrados", s_root, (unsigned)s_deleted);
+    esp_timer_start_once(s_timer, PURGER_PAUSE_US);
+}
+
+void history_purger_start(const char *root_path, const char *end_key) {
+    if (atomic_exchange(&s_running, true)) {
+        ESP_LOGW(PURGER_TAG, "Ya hay una purga en curso");
+        return;
+    }
+    if (!s_timer) {
+        const esp_timer_create_args_t args = { .callback = purger_timer_cb, .name = "purger" };
+        if (esp_timer_create(&args, &s_timer) != ESP_OK) {
+            atomic_store(&s_running, false);
+            return;
+        }
+    }
+
+    strncpy(s_root, root_path, sizeof(s_root) - 1);
+    s_root[sizeof(s_root) - 1] = '\0';
+    strncpy(s_end, end_key, sizeof(s_end) - 1);
+    s_end[sizeof(s_end) - 1] = '\0';
+    s_deleted = 0;
+
+    char prev_end[HISTORY_PURGER_KEY_MAX];
+    uint32_t prev_deleted = 0;
+    if (purger_load(s_root, prev_end, sizeof(prev_end), &prev_deleted)) {
+        ESP_LOGI(PURGER_TAG, "Retomando purga de %s (hasta %s, %u ya borrados)", s_root, prev_end, (unsigned)prev_deleted);
+        if (strcmp(prev_end, s_end) > 0) strcpy(s_end, prev_end);
+        s_deleted = prev_deleted;
+    }
+    purger_save();
+    ESP_LOGI(PURGER_TAG, "Purga de %s en segundo plano (claves <= %s)", s_root, s_end);
+    purger_submit();
+}
+
+bool history_purger_running(void) {
+    return atomic_load(&s_running);
+}
+
+uint32_t history_purger_deleted(void) {
+    return s_deleted;
+}
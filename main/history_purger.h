@@ -0,0 +1,30 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Borrado incremental en segundo plano de un subárbol de la RTDB.
+//
+// Borra por páginas (listado por clave + PATCH a null) a través de la cola
+// asíncrona de Firebase con prioridad baja, así que nunca bloquea a quien lo
+// arranca. Tras cada página guarda el progreso en NVS: si el equipo se reinicia
+// a mitad, el siguiente arranque sigue desde ahí. Un fallo (sin red, 5xx) se
+// reintenta más tarde sin perder lo ya hecho.
+//
+// Requiere firebase_async_start() y NVS inicializado.
+
+#define HISTORY_PURGER_KEY_MAX 32
+
+// Borra todos los hijos de root_path con clave <= end_key. Si quedó a medias
+// una purga anterior, se retoma con el mayor de los dos límites.
+void history_purger_start(const char *root_path, const char *end_key);
+
+bool history_purger_running(void);
+uint32_t history_purger_deleted(void); // hijos borrados por la purga en curso/última
+
+#ifdef __cplusplus
+}
+#endif
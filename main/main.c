@@ -3,6 +3,7 @@
 #include <time.h>
 #include <stdint.h>
 #include <string.h>
+#include <stdatomic.h>
 
 // ESP-IDF
 #include "sdkconfig.h"
@@ -22,18 +23,25 @@
 
 // Project
 #include "sensors.h"
+#include "sample_ring.h"
+#include "batch_log.h"
+#include "history_purger.h"
+#include "remote_config.h"
 #include "firebase.h"
 #include "Privado.h"
 #include "captive_manager.h"
 
 #include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_mac.h"
 #include "esp_log.h"
 #include "wifi_store.h"
+#include "auth_store.h"
 
 void geoapify_fetch_once_wifi_unwired(void);
 
 #define SENSOR_TASK_STACK 10240
-#define ENABLE_HTTP_VERBOSE 1
+#define ENABLE_HTTP_VERBOSE 0   // los tiempos por request ya van en las métricas (/metricas)
 #define LOG_EACH_SAMPLE 1
 static inline int64_t minutes_to_us(int m) { return (int64_t)m * 60 * 1000000; }
 
@@ -106,124 +114,400 @@ static void init_sntp_and_time(void) {
     }
 }
 
-// ------------ SENSOR TASK ------------
-void sensor_task(void *pv) {
-    SensorData data;
+// ------------ PIPELINE DE MUESTREO ------------
+// sampling_task (productor) lee sensores a cadencia fija y empuja cada ranura al
+// ring SPSC; uploader_task (consumidor) promedia, persiste y envía.
+// Así un PUT lento o una ventana de reconexión no desplaza ni pierde muestras.
 
+// 1 muestra/minuto, envío cada 5 min (por defecto: se pueden cambiar en vivo
+// desde /config, ver remote_config.h)
+#define SAMPLE_EVERY_MIN    1
+#define SAMPLES_PER_BATCH   5
+#define RETENTION_MB        10
+#define UPLOADER_STACK      SENSOR_TASK_STACK
+#define SAMPLING_STACK      4096
+#define UPLOADER_IDLE_WAIT_MS 5000
+
+static sample_ring_t s_ring;
+static TaskHandle_t s_uploader_task = NULL;
+
+static void sampling_task(void *pv) {
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t slot = 0;
+
+    while (1) {
+        sample_t s = { .slot = slot++ };
+        time(&s.ts);
+        s.valid = (sensors_read(&s.data) == ESP_OK);
+        if (!s.valid) {
+            ESP_LOGW(TAG, "Error leyendo sensores (slot %u)", (unsigned)s.slot);
+        }
+        if (!sample_ring_push(&s_ring, &s)) {
+            ESP_LOGW(TAG, "Ring lleno: slot %u descartado (total descartados=%u)",
+                     (unsigned)s.slot, sample_ring_dropped(&s_ring));
+        }
+        if (s_uploader_task) xTaskNotifyGive(s_uploader_task);
+
+        // DelayUntil: la cadencia no depende de lo que tarde sensors_read()
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(remote_config_sample_every_min() * 60000));
+    }
+}
+
+// ------------ STORE-AND-FORWARD ------------
+// Cada batch promediado se persiste en el log de flash antes de intentar subirlo;
+// el cursor de reenvío solo avanza tras un 2xx, así que cortes de Wi-Fi o
+// reinicios no dejan huecos en el historial.
+#define UPLOAD_MAX_PER_ROUND  12                 // batches por PATCH multi-ruta
+#define BATCH_LOG_RAM_FALLBACK (8 * 4096)        // si no hay partición: log volátil
+
+static batch_log_t s_log;
+static bool s_firebase_ready = false;
+
+// Estado del formato: el primer envío lleva la cabecera completa, luego solo
+// se añade "fecha" al cambiar de día. Se actualiza solo tras un envío OK.
+static bool s_first_send = true;
+static char s_inicio_str[20];
+static char s_last_fecha_str[20] = "";
+
+static void mount_batch_log(void) {
+    batch_log_io_t io;
+    esp_err_t err = batch_log_partition_io(BATCH_LOG_PARTITION_LABEL, &io);
+    if (err == ESP_OK) err = batch_log_mount(&s_log, &io);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Log de batches en flash no disponible (%s); uso RAM", esp_err_to_name(err));
+        ESP_ERROR_CHECK(batch_log_ram_io(BATCH_LOG_RAM_FALLBACK, 4096, &io));
+        ESP_ERROR_CHECK(batch_log_mount(&s_log, &io));
+    }
+    ESP_LOGI(TAG, "Batch log: %u pendientes, próximo seq=%u", (unsigned)batch_log_pending(&s_log),
+             (unsigned)s_log.next_seq);
+}
+
+// Semilla de las claves RTDB: 24 bits propios de la MAC + contador de arranques
+#define BOOT_NS        "sistema"
+#define BOOT_KEY_COUNT "arranques"
+
+static uint32_t s_device_id = 0;
+
+static void init_key_seed(void) {
+    uint32_t boots = 0;
+    nvs_handle_t h;
+    if (nvs_open(BOOT_NS, NVS_READWRITE, &h) == ESP_OK) {
+        if (nvs_get_u32(h, BOOT_KEY_COUNT, &boots) != ESP_OK) boots = 0;
+        boots++;
+        nvs_set_u32(h, BOOT_KEY_COUNT, boots);
+        nvs_commit(h);
+        nvs_close(h);
+    }
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    s_device_id = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    firebase_set_key_seed(s_device_id, boots);
+    ESP_LOGI(TAG, "Claves RTDB: equipo %06x, arranque %u", (unsigned)s_device_id, (unsigned)boots);
+}
+
+// Clave RTDB de un batch: su hora + su seq del log. Orden por clave = cronológico
+// y, como el seq no cambia, reenviar un batch no confirmado pisa el mismo hijo.
+static void format_batch_key(const batch_log_entry_t *e, char *key, size_t key_len) {
+    firebase_make_key(e->ts * 1000, e->seq, key, key_len);
+}
+
+static void format_batch_json(const SensorData *avg, const struct tm *tm_info, bool full, bool with_fecha,
+                              char *json, size_t json_len) {
+    char hora_envio[16];
+    strftime(hora_envio, sizeof(hora_envio), "%H:%M:%S", tm_info);
+    char fecha_actual[20];
+    strftime(fecha_actual, sizeof(fecha_actual), "%d-%m-%Y", tm_info);
+
+    if (full) {
+        sensors_format_json(avg, hora_envio, fecha_actual, s_inicio_str, json, json_len);
+    } else if (with_fecha) {
+        snprintf(json, json_len,
+            "{\"pm1p0\":%.2f,\"pm2p5\":%.2f,\"pm4p0\":%.2f,\"pm10p0\":%.2f,"
+            "\"voc\":%.1f,\"nox\":%.1f,\"cTe\":%.2f,\"cHu\":%.2f,\"co2\":%u,"
+            "\"fecha\":\"%s\",\"hora\":\"%s\"}",
+            avg->pm1p0, avg->pm2p5, avg->pm4p0, avg->pm10p0,
+            avg->voc, avg->nox, avg->avg_temp, avg->avg_hum,
+            avg->co2, fecha_actual, hora_envio);
+    } else {
+        snprintf(json, json_len,
+            "{\"pm1p0\":%.2f,\"pm2p5\":%.2f,\"pm4p0\":%.2f,\"pm10p0\":%.2f,"
+            "\"voc\":%.1f,\"nox\":%.1f,\"cTe\":%.2f,\"cHu\":%.2f,\"co2\":%u,"
+            "\"hora\":\"%s\"}",
+            avg->pm1p0, avg->pm2p5, avg->pm4p0, avg->pm10p0,
+            avg->voc, avg->nox, avg->avg_temp, avg->avg_hum,
+            avg->co2, hora_envio);
+    }
+}
+
+// Retención aproximada. El recorte va a la cola asíncrona (prioridad baja) para
+// no frenar la subida; su resultado se descuenta en la siguiente llamada.
+static atomic_int s_trim_deleted = 0;
+static atomic_bool s_trim_in_flight = false;
+
+static void retention_trim_done(firebase_async_handle_t handle, int deleted, void *user) {
+    if (deleted > 0) atomic_fetch_add(&s_trim_deleted, deleted);
+    atomic_store(&s_trim_in_flight, false);
+}
+
+static void retention_after_put(size_t item_len) {
+    const size_t MAX_BYTES = remote_config_retention_bytes();
+    static double   avg_size = 256.0;
+    static uint32_t approx_count = 0;
+    avg_size = (avg_size * 0.9) + (0.1 * (double)item_len);
+    approx_count++;
+    uint32_t max_items  = (uint32_t)(MAX_BYTES / (avg_size > 1.0 ? avg_size : 1.0));
+    uint32_t high_water = max_items + 50;
+
+    int deleted = atomic_exchange(&s_trim_deleted, 0);
+    if (deleted > 0) {
+        approx_count = (approx_count > (uint32_t)deleted) ? (approx_count - (uint32_t)deleted) : 0;
+        ESP_LOGI(TAG, "Retención: borrados %d antiguos. approx_count=%u max_items=%u avg=%.1fB",
+                deleted, approx_count, max_items, avg_size);
+    }
+    if (approx_count > high_water && !atomic_exchange(&s_trim_in_flight, true)) {
+        if (firebase_submit_async(FIREBASE_OP_TRIM_OLDEST, "/historial_mediciones", "50",
+                                  FIREBASE_PRIO_LOW, retention_trim_done, NULL) <= 0) {
+            atomic_store(&s_trim_in_flight, false);
+        }
+    }
+}
+
+// esp_timer al pasar a CAP_STATE_OPERATIONAL: mide cuánto tarda el arranque en caliente
+static int64_t s_operational_us = 0;
+static bool s_first_put_logged = false;
+static bool s_session_restored = false;   // para separar arranques en caliente y en frío
+
+// Cada token nuevo (refresh/login) se guarda para el próximo arranque
+static void session_saved(const char *refresh, const char *id_token, int64_t expires_at) {
+    esp_err_t err = auth_store_save(USER_EMAIL, refresh, id_token, expires_at);
+    if (err != ESP_OK) ESP_LOGW(TAG, "No se pudo guardar la sesión: %s", esp_err_to_name(err));
+}
+
+// Sesión de un arranque anterior (si la hay) para evitar el login
+static int firebase_init_saved_session(void) {
+    static char refresh[AUTH_STORE_REFRESH_MAX];
+    static char id_token[AUTH_STORE_ID_MAX];
+    int64_t expires_at = 0;
+    firebase_set_session_listener(session_saved);
+    if (auth_store_load(USER_EMAIL, refresh, sizeof(refresh), id_token, sizeof(id_token), &expires_at) != ESP_OK) {
+        s_session_restored = false;
+        return firebase_init();
+    }
+    ESP_LOGI(TAG, "Sesión guardada encontrada; restaurando sin login");
+    int ret = firebase_init_session(refresh, id_token, expires_at);
+    s_session_restored = (ret == 0);
+    memset(id_token, 0, sizeof(id_token));
+    memset(refresh, 0, sizeof(refresh));
+    return ret;
+}
+
+// Wi-Fi + Firebase + token listos para enviar. No bloquea más de una ventana de reconexión.
+static bool uploader_ensure_online(void) {
+    if (!wifi_is_connected()) {
+        ESP_LOGW(TAG, "No hay WiFi -> %u batches en espera", (unsigned)batch_log_pending(&s_log));
+        if (!wifi_reconnect_blocking(WIFI_RECONNECT_WINDOW_MS)) return false;
+    }
+
+    if (!s_firebase_ready) {
+        if (firebase_init_saved_session() != 0) {
+            ESP_LOGE(TAG, "Error inicializando Firebase; reintento luego");
+            return false;
+        }
+        s_firebase_ready = true;
+        ESP_LOGI(TAG, "Firebase listo a los %lld ms de operativo",
+                 (long long)((esp_timer_get_time() - s_operational_us) / 1000));
+        if (firebase_async_start() != 0) ESP_LOGE(TAG, "No se pudo arrancar la cola asíncrona de Firebase");
+        // El historial de arranques anteriores se borra en segundo plano y por
+        // páginas; solo lo anterior a este arranque y a lo que queda por subir.
+        time_t cutoff = time(NULL);
+        batch_log_entry_t oldest;
+        if (batch_log_peek(&s_log, &oldest, 1) == 1 && (time_t)oldest.ts < cutoff) cutoff = (time_t)oldest.ts;
+        char end_key[HISTORY_PURGER_KEY_MAX];
+        firebase_key_bound((int64_t)cutoff * 1000 - 1, end_key, sizeof(end_key));
+        history_purger_start("/historial_mediciones", end_key);
+        remote_config_listen("/config");
+        return true;
+    }
+
+    // El token lo renueva el cliente de Firebase antes de que expire (ver validToken)
+    return true;
+}
+
+// Métricas del cliente HTTP: un nodo JSON por equipo, reemplazado en cada
+// publicación (acumuladas desde el arranque, así perder una no deja huecos)
+#define METRICS_EVERY_US  (15LL * 60 * 1000000)
+#define METRICS_JSON_MAX  2048
+
+static void metrics_maybe_publish(void) {
+    static int64_t s_last_us = 0;
+    static char json[METRICS_JSON_MAX];
+    int64_t now = esp_timer_get_time();
+    if (s_last_us != 0 && now - s_last_us < METRICS_EVERY_US) return;
+    if (firebase_metrics_json(json, sizeof(json)) < 0) {
+        ESP_LOGW(TAG, "Métricas no caben en %d bytes", METRICS_JSON_MAX);
+        return;
+    }
+    char path[32];
+    snprintf(path, sizeof(path), "/metricas/%06x", (unsigned)s_device_id);
+    if (firebase_submit_async(FIREBASE_OP_PUT, path, json, FIREBASE_PRIO_LOW, NULL, NULL) > 0) s_last_us = now;
+}
+
+// Reenvía los batches pendientes, del más antiguo al más nuevo, en un solo
+// PATCH multi-ruta (una conexión para todo el backlog de la ronda).
+static void upload_pending(void) {
+    static batch_log_entry_t entries[UPLOAD_MAX_PER_ROUND];
+    static char keys[UPLOAD_MAX_PER_ROUND][FIREBASE_KEY_LEN + 1];
+    static char jsons[UPLOAD_MAX_PER_ROUND][384];
+    static char fechas[UPLOAD_MAX_PER_ROUND][20];
+    const char *key_ptrs[UPLOAD_MAX_PER_ROUND];
+    const char *json_ptrs[UPLOAD_MAX_PER_ROUND];
+
+    size_t n = batch_log_peek(&s_log, entries, UPLOAD_MAX_PER_ROUND);
+    if (n == 0) return;
+    if (firebase_circuit_open()) {
+        // Caída del server: los batches esperan en flash hasta que el circuito se cierre
+        ESP_LOGW(TAG, "Firebase no responde (circuito abierto); %u batches en espera",
+                 (unsigned)batch_log_pending(&s_log));
+        return;
+    }
+
+    // El formato de cada batch depende del anterior (cabecera/fecha): se calcula
+    // en orden como si todos fueran a salir, y se confirma solo lo escrito.
+    bool first = s_first_send;
+    const char *prev_fecha = s_last_fecha_str;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        const batch_log_entry_t *e = &entries[i];
+        if (e->len != sizeof(SensorData)) {
+            // Solo se puede descartar si es el más antiguo; si no, cortar la ronda aquí
+            if (count > 0) break;
+            ESP_LOGW(TAG, "Batch seq=%u con formato desconocido (len=%u); descartado", (unsigned)e->seq, e->len);
+            batch_log_ack(&s_log, 1);
+            return;
+        }
+        SensorData avg;
+        memcpy(&avg, e->payload, sizeof(avg));
+
+        time_t ts = (time_t)e->ts;
+        struct tm tm_info;
+        localtime_r(&ts, &tm_info);
+        strftime(fechas[count], sizeof(fechas[count]), "%d-%m-%Y", &tm_info);
+        bool with_fecha = strncmp(prev_fecha, fechas[count], sizeof(fechas[count])) != 0;
+
+        format_batch_json(&avg, &tm_info, first, with_fecha, jsons[count], sizeof(jsons[count]));
+        format_batch_key(e, keys[count], sizeof(keys[count]));
+        ESP_LOGI(TAG, "JSON promedio %dm (seq=%u) %s: %s",
+                 remote_config_samples_per_batch() * remote_config_sample_every_min(),
+                 (unsigned)e->seq, keys[count], jsons[count]);
+
+        key_ptrs[count] = keys[count];
+        json_ptrs[count] = jsons[count];
+        first = false;
+        prev_fecha = fechas[count];
+        count++;
+    }
+
+    int written = firebase_multi_update("/historial_mediciones", key_ptrs, json_ptrs, (int)count);
+    if (written <= 0) {
+        ESP_LOGW(TAG, "Envío falló; %u batches siguen pendientes", (unsigned)batch_log_pending(&s_log));
+        return;
+    }
+
+    // Solo tras 2xx: avanzar cursor y estado de formato
+    batch_log_ack(&s_log, (size_t)written);
+    s_first_send = false;
+    strncpy(s_last_fecha_str, fechas[written - 1], sizeof(s_last_fecha_str)-1);
+    s_last_fecha_str[sizeof(s_last_fecha_str)-1] = '\0';
+    ESP_LOGI(TAG, "Enviados %d batches (%u pendientes)", written, (unsigned)batch_log_pending(&s_log));
+    if (!s_first_put_logged) {
+        s_first_put_logged = true;
+        ESP_LOGI(TAG, "Primer envío a los %lld ms de operativo (%s)",
+                 (long long)((esp_timer_get_time() - s_operational_us) / 1000),
+                 s_session_restored ? "sesión restaurada" : "login");
+    }
+
+    firebase_stats_t st;
+    if (firebase_get_stats(&st) == 0 && st.requests > 0) {
+        uint32_t full = st.handshakes - st.ticket_handshakes;
+        ESP_LOGI(TAG, "HTTP: %u req, %u reusos, %u reconexiones ociosas, %u RST; %u ms/req",
+                 (unsigned)st.requests, (unsigned)st.reused, (unsigned)st.idle_reconnects,
+                 (unsigned)st.stale_retries, (unsigned)(st.request_time_us / st.requests / 1000));
+        ESP_LOGI(TAG, "TLS: %u handshakes completos (%u ms prom), %u reanudados (%u ms prom) de %u con ticket",
+                 (unsigned)full,
+                 (unsigned)(full ? (st.handshake_time_us - st.ticket_handshake_time_us) / full / 1000 : 0),
+                 (unsigned)st.ticket_handshakes,
+                 (unsigned)(st.ticket_handshakes ? st.ticket_handshake_time_us / st.ticket_handshakes / 1000 : 0),
+                 (unsigned)st.ticket_offers);
+        ESP_LOGI(TAG, "Auth: %u logins, %u refresh (%u fallidos), %u esperas a un refresh en vuelo",
+                 (unsigned)st.auth_logins, (unsigned)st.auth_refreshes,
+                 (unsigned)st.auth_refresh_failures, (unsigned)st.auth_waits);
+        ESP_LOGI(TAG, "Bodies: %llu B enviados, %llu B recibidos",
+                 (unsigned long long)st.tx_body_bytes, (unsigned long long)st.rx_body_bytes);
+        ESP_LOGI(TAG, "Reintentos: %u; circuito abierto %u veces (%u requests no intentados)",
+                 (unsigned)st.retries, (unsigned)st.breaker_opens, (unsigned)st.breaker_rejects);
+        firebase_host_rtt_t rtt[3];
+        int hosts = firebase_get_host_rtt(rtt, 3);
+        for (int i = 0; i < hosts; i++) {
+            ESP_LOGI(TAG, "RTT %s: srtt=%u ms var=%u ms rto=%u ms -> timeout %u ms (%u muestras, %u timeouts); conexión %u ms",
+                     rtt[i].host, (unsigned)rtt[i].srtt_ms, (unsigned)rtt[i].rttvar_ms, (unsigned)rtt[i].rto_ms,
+                     (unsigned)rtt[i].timeout_ms, (unsigned)rtt[i].samples, (unsigned)rtt[i].timeouts,
+                     (unsigned)rtt[i].connect_srtt_ms);
+        }
+        uint32_t check_srtt, check_var, check_timeout;
+        connectivity_check_rtt(&check_srtt, &check_var, &check_timeout);
+        ESP_LOGI(TAG, "RTT chequeo de conectividad: srtt=%u ms var=%u ms -> timeout %u ms",
+                 (unsigned)check_srtt, (unsigned)check_var, (unsigned)check_timeout);
+    }
+
+    metrics_maybe_publish();
+
+    for (int i = 0; i < written; i++) retention_after_put(strlen(jsons[i]));
+}
+
+static void uploader_task(void *pv) {
     time_t start_epoch;
     struct tm start_tm_info;
-    char inicio_str[20];
     time(&start_epoch);
     localtime_r(&start_epoch, &start_tm_info);
-    strftime(inicio_str, sizeof(inicio_str), "%H:%M:%S", &start_tm_info);
+    strftime(s_inicio_str, sizeof(s_inicio_str), "%H:%M:%S", &start_tm_info);
 
-    bool first_send = true;
+    mount_batch_log();
 
-    //geoapify_fetch_once_wifi_unwired();
-    app_init_nvs();         // 1) NVS listo antes de usar wifi_store_*
-    app_cargar_ubicacion(); // 2) Leer y dejar en g_ubicacion
-
-    if (firebase_init() != 0) {
-        ESP_LOGE(TAG, "Error inicializando Firebase");
-        vTaskDelete(NULL);
-        return;
-    }
-    
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    firebase_delete("/historial_mediciones");
-
-    // 1 muestra/minuto, envío cada 5 min
-    const int SAMPLE_EVERY_MIN = 1;
-    const int SAMPLES_PER_BATCH = 5;
-    const TickType_t SAMPLE_DELAY_TICKS = pdMS_TO_TICKS(SAMPLE_EVERY_MIN * 60000);
     int sample_count = 0;
+    uint32_t next_slot = 0;
 
     double sum_pm1p0=0, sum_pm2p5=0, sum_pm4p0=0, sum_pm10p0=0, sum_voc=0, sum_nox=0, sum_avg_temp=0, sum_avg_hum=0;
     uint32_t sum_co2 = 0;
-    char last_fecha_str[20] = "";
-
-    const int64_t REFRESH_US = minutes_to_us(50);
-    int64_t next_refresh_us = esp_timer_get_time() + REFRESH_US;
-
-    bool refresh_overdue = false; // hubo un refresh vencido mientras no había Wi-Fi
 
     while (1) {
-        // === (A) Gestion de refresh de token ligada a la conectividad ===
-        int64_t now_us = esp_timer_get_time();
-        bool refresh_due = (now_us >= next_refresh_us);
-
-        if (refresh_due) {
-            if (wifi_is_connected()) {
-                ESP_LOGI(TAG, "Refrescando token (50m)...");
-                int r = firebase_refresh_token();
-                if (r == 0) {
-                    ESP_LOGI(TAG, "Token refresh OK");
-                    next_refresh_us = esp_timer_get_time() + REFRESH_US; // reprograma desde ahora
-                    refresh_overdue = false;
-                } else {
-                    ESP_LOGW(TAG, "Fallo refresh token (%d). Reintento cuando haya red.", r);
-                    // no movemos el next_refresh_us para reintentar pronto
-                }
-            } else {
-                // no hay Wi-Fi: marca pendiente
-                refresh_overdue = true;
+        // === (A) Vaciar el ring: acumular y cerrar batches al log de flash ===
+        sample_t s;
+        while (sample_ring_pop(&s_ring, &s)) {
+            if (s.slot != next_slot) {
+                ESP_LOGW(TAG, "Se perdieron %u ranuras de muestreo (esperaba %u, llegó %u)",
+                         (unsigned)(s.slot - next_slot), (unsigned)next_slot, (unsigned)s.slot);
             }
-        }
+            next_slot = s.slot + 1;
+            if (!s.valid) continue;
 
-        // === (B) Guard de Wi-Fi para sensado/envío ===
-        if (!wifi_is_connected()) {
-            ESP_LOGW(TAG, "No hay WiFi -> pauso medición/envío y reconecto");
-            bool ok = wifi_reconnect_blocking(WIFI_RECONNECT_WINDOW_MS);
-            if (!ok) {
-                vTaskDelay(pdMS_TO_TICKS(WIFI_BACKOFF_IDLE_MS));
-                continue; // NO leer, NO acumular, NO enviar
-            }
-            // Recién recuperado Wi-Fi: si había refresh pendiente o ya venció, hazlo AHORA
-            now_us = esp_timer_get_time();
-            if (refresh_overdue || now_us >= next_refresh_us) {
-                ESP_LOGI(TAG, "Red restaurada: refrescando token pendiente...");
-                int r = firebase_refresh_token();
-                if (r == 0) {
-                    ESP_LOGI(TAG, "Token refresh OK tras reconexión");
-                    next_refresh_us = esp_timer_get_time() + REFRESH_US;
-                    refresh_overdue = false;
-                } else {
-                    ESP_LOGW(TAG, "Fallo refresh tras reconexión (%d). Continuo y reintento luego.", r);
-                }
-            }
-        }
-
-        // === (C) Desde aquí solo con Wi-Fi OK ===
-        if (sensors_read(&data) == ESP_OK) {
+            SensorData *data = &s.data;
             sample_count++;
-            sum_pm1p0 += data.pm1p0;
-            sum_pm2p5 += data.pm2p5;
-            sum_pm4p0 += data.pm4p0;
-            sum_pm10p0 += data.pm10p0;
-            sum_voc += data.voc;
-            sum_nox += data.nox;
-            sum_avg_temp += data.avg_temp;
-            sum_avg_hum += data.avg_hum;
-            sum_co2 += data.co2;
-    #if LOG_EACH_SAMPLE
+            sum_pm1p0 += data->pm1p0;
+            sum_pm2p5 += data->pm2p5;
+            sum_pm4p0 += data->pm4p0;
+            sum_pm10p0 += data->pm10p0;
+            sum_voc += data->voc;
+            sum_nox += data->nox;
+            sum_avg_temp += data->avg_temp;
+            sum_avg_hum += data->avg_hum;
+            sum_co2 += data->co2;
+#if LOG_EACH_SAMPLE
             ESP_LOGI(TAG,
                 "Muestra %d/%d: PM1.0=%.2f PM2.5=%.2f PM4.0=%.2f PM10=%.2f VOC=%.1f NOx=%.1f CO2=%u Temp=%.2fC Hum=%.2f%%",
-                sample_count, SAMPLES_PER_BATCH, data.pm1p0, data.pm2p5, data.pm4p0, data.pm10p0,
-                data.voc, data.nox, data.co2, data.avg_temp, data.avg_hum);
-    #endif
-        } else {
-            ESP_LOGW(TAG, "Error leyendo sensores (batch %d)", sample_count);
-        }
-
-        if (sample_count >= SAMPLES_PER_BATCH) {
-            time_t now_epoch;
-            struct tm tm_info;
-            time(&now_epoch);
-            localtime_r(&now_epoch, &tm_info);
-            char hora_envio[16];
-            strftime(hora_envio, sizeof(hora_envio), "%H:%M:%S", &tm_info);
-            char fecha_actual[20];
-            strftime(fecha_actual, sizeof(fecha_actual), "%d-%m-%Y", &tm_info);
+                sample_count, remote_config_samples_per_batch(), data->pm1p0, data->pm2p5, data->pm4p0, data->pm10p0,
+                data->voc, data->nox, data->co2, data->avg_temp, data->avg_hum);
+#endif
+            if (sample_count < remote_config_samples_per_batch()) continue;
 
             SensorData avg = (SensorData){0};
             double denom = (double)sample_count;
@@ -241,91 +525,32 @@ void sensor_task(void *pv) {
             avg.sen_temp= avg.avg_temp;
             avg.sen_hum = avg.avg_hum;
 
-            char json[384];
-            if (first_send) {
-                sensors_format_json(&avg, hora_envio, fecha_actual, inicio_str, json, sizeof(json));
-                strncpy(last_fecha_str, fecha_actual, sizeof(last_fecha_str)-1);
-                last_fecha_str[sizeof(last_fecha_str)-1] = '\0';
-                first_send = false;
+            // El batch se fecha con la hora de su última muestra, no con la del envío
+            uint32_t seq = 0;
+            esp_err_t err = batch_log_append(&s_log, (int64_t)s.ts, &avg, sizeof(avg), &seq);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "No se pudo guardar el batch en flash: %s", esp_err_to_name(err));
             } else {
-                if (strncmp(last_fecha_str, fecha_actual, sizeof(last_fecha_str)) != 0) {
-                    snprintf(json, sizeof(json),
-                        "{\"pm1p0\":%.2f,\"pm2p5\":%.2f,\"pm4p0\":%.2f,\"pm10p0\":%.2f,"
-                        "\"voc\":%.1f,\"nox\":%.1f,\"cTe\":%.2f,\"cHu\":%.2f,\"co2\":%u,"
-                        "\"fecha\":\"%s\",\"hora\":\"%s\"}",
-                        avg.pm1p0, avg.pm2p5, avg.pm4p0, avg.pm10p0,
-                        avg.voc, avg.nox, avg.avg_temp, avg.avg_hum,
-                        avg.co2, fecha_actual, hora_envio);
-                    strncpy(last_fecha_str, fecha_actual, sizeof(last_fecha_str)-1);
-                    last_fecha_str[sizeof(last_fecha_str)-1] = '\0';
-                } else {
-                    snprintf(json, sizeof(json),
-                        "{\"pm1p0\":%.2f,\"pm2p5\":%.2f,\"pm4p0\":%.2f,\"pm10p0\":%.2f,"
-                        "\"voc\":%.1f,\"nox\":%.1f,\"cTe\":%.2f,\"cHu\":%.2f,\"co2\":%u,"
-                        "\"hora\":\"%s\"}",
-                        avg.pm1p0, avg.pm2p5, avg.pm4p0, avg.pm10p0,
-                        avg.voc, avg.nox, avg.avg_temp, avg.avg_hum,
-                        avg.co2, hora_envio);
-                }
-            }
-
-            int batch_minutes = SAMPLES_PER_BATCH * SAMPLE_EVERY_MIN;
-            ESP_LOGI(TAG, "JSON promedio %dm: %s", batch_minutes, json);
-
-            char clave_min[20];
-            strftime(clave_min, sizeof(clave_min), "%y-%m-%d_%H-%M-%S", &tm_info);
-            char path_put[64];
-            snprintf(path_put, sizeof(path_put), "/historial_mediciones/%s", clave_min);
-
-            // === (D) Doble-check de Wi-Fi justo antes de enviar (evita perder el batch) ===
-            if (!wifi_is_connected()) {
-                bool ok = wifi_reconnect_blocking(WIFI_RECONNECT_WINDOW_MS);
-                if (!ok) {
-                    ESP_LOGW(TAG, "Se perdió WiFi antes de enviar; mantengo batch en RAM (sample_count=%d)", sample_count);
-                    vTaskDelay(pdMS_TO_TICKS(WIFI_BACKOFF_IDLE_MS));
-                    continue; // NO enviar, NO resetear acumuladores
-                }
-                // Tras reconectar, si había refresh pendiente, hazlo
-                now_us = esp_timer_get_time();
-                if (refresh_overdue || now_us >= next_refresh_us) {
-                    int r = firebase_refresh_token();
-                    if (r == 0) {
-                        next_refresh_us = esp_timer_get_time() + REFRESH_US;
-                        refresh_overdue = false;
-                    }
-                }
-            }
-
-            ESP_LOGI(TAG, "Path: %s", path_put);
-            firebase_putData(path_put, json);
-
-            // Retención aproximada (igual que tenías)
-            const size_t MAX_BYTES = 10 * 1024 * 1024;
-            static double   avg_size = 256.0;
-            static uint32_t approx_count = 0;
-            size_t item_len = strlen(json);
-            avg_size = (avg_size * 0.9) + (0.1 * (double)item_len);
-            approx_count++;
-            uint32_t max_items  = (uint32_t)(MAX_BYTES / (avg_size > 1.0 ? avg_size : 1.0));
-            uint32_t high_water = max_items + 50;
-            if (approx_count > high_water) {
-                int deleted = firebase_trim_oldest_batch("/historial_mediciones", 50);
-                if (deleted > 0) {
-                    approx_count = (approx_count > (uint32_t)deleted) ? (approx_count - (uint32_t)deleted) : 0;
-                    ESP_LOGI(TAG, "Retención: borrados %d antiguos. approx_count=%u max_items=%u avg=%.1fB",
-                            deleted, approx_count, max_items, avg_size);
-                }
+                ESP_LOGI(TAG, "Batch seq=%u guardado (%u pendientes)", (unsigned)seq, (unsigned)batch_log_pending(&s_log));
             }
 
-            // Reset acumuladores SOLO después de enviar
             sample_count = 0;
             sum_pm1p0=sum_pm2p5=sum_pm4p0=sum_pm10p0=sum_voc=sum_nox=sum_avg_temp=sum_avg_hum=0;
             sum_co2 = 0;
         }
 
-        vTaskDelay(SAMPLE_DELAY_TICKS);
-    }
+        // === (B) Reenviar pendientes si hay red (y Firebase listo desde el arranque) ===
+        if (!s_firebase_ready || batch_log_pending(&s_log) > 0) {
+            if (uploader_ensure_online()) {
+                upload_pending();
+            } else {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WIFI_BACKOFF_IDLE_MS));
+                continue;
+            }
+        }
 
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UPLOADER_IDLE_WAIT_MS));
+    }
 }
 
 // ---- Event handler (asegúrate de que coincide con la firma estándar) ----
@@ -375,13 +600,21 @@ void app_main(void) {
     while (true) {
         if (!operational_started && captive_manager_get_state() == CAP_STATE_OPERATIONAL) {
             operational_started = true;
+            s_operational_us = esp_timer_get_time();
             ESP_LOGI(TAG,"Red lista con internet. Iniciando SNTP, sensores y Firebase...");
             init_sntp_and_time();
             esp_err_t ret = sensors_init_all();
             if (ret != ESP_OK) {
                 ESP_LOGE(TAG, "Fallo al inicializar sensores: %s", esp_err_to_name(ret));
             } else {
-                xTaskCreate(sensor_task, "sensor_task", SENSOR_TASK_STACK, NULL, 5, NULL);
+                app_init_nvs();         // 1) NVS listo antes de usar wifi_store_*
+                app_cargar_ubicacion(); // 2) Leer y dejar en g_ubicacion
+                init_key_seed();        // 3) Antes de la primera clave RTDB
+                sample_ring_init(&s_ring);
+                remote_config_init(SAMPLE_EVERY_MIN, SAMPLES_PER_BATCH, RETENTION_MB);
+                // Uploader primero para que el muestreo ya tenga a quién notificar
+                xTaskCreate(uploader_task, "uploader_task", UPLOADER_STACK, NULL, 4, &s_uploader_task);
+                xTaskCreate(sampling_task, "sampling_task", SAMPLING_STACK, NULL, 5, NULL);
             }
         }
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -0,0 +1,102 @@
+#include "remote_config.h"
+#include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "firebase.h"
+
+#define RCFG_TAG "RCONFIG"
+
+#define KEY_SAMPLE_MIN   "muestreo_min"
+#define KEY_BATCH        "muestras_por_lote"
+#define KEY_RETENTION_MB "retencion_mb"
+
+typedef struct {
+    const char *key;
+    int min;
+    int max;
+    int def;
+    atomic_int value;
+} rcfg_param_t;
+
+static rcfg_param_t s_params[] = {
+    { KEY_SAMPLE_MIN,   1, REMOTE_CONFIG_SAMPLE_MIN_MAX,   1,  1 },
+    { KEY_BATCH,        1, REMOTE_CONFIG_BATCH_MAX,        5,  5 },
+    { KEY_RETENTION_MB, 1, REMOTE_CONFIG_RETENTION_MB_MAX, 10, 10 },
+};
+#define PARAM_COUNT (sizeof(s_params) / sizeof(s_params[0]))
+
+static rcfg_param_t *find_param(const char *key, size_t key_len) {
+    for (size_t i = 0; i < PARAM_COUNT; ++i) {
+        if (strlen(s_params[i].key) == key_len && strncmp(s_params[i].key, key, key_len) == 0) return &s_params[i];
+    }
+    return NULL;
+}
+
+// null o ausente: vuelve al valor por defecto
+static void apply_param(rcfg_param_t *p, const firebase_json_t *item) {
+    int value = p->def;
+    if (firebase_json_type(item) != FIREBASE_JSON_NULL) {
+        double number;
+        // 2.5 no se trunca a 2: un valor no entero se ignora igual que uno fuera de rango
+        if (firebase_json_number(item, &number) != 0 || number < p->min || number > p->max ||
+            number != (double)(int)number) {
+            ESP_LOGW(RCFG_TAG, "%s no es un entero en %d..%d: se ignora", p->key, p->min, p->max);
+            return;
+        }
+        value = (int)number;
+    }
+    int prev = atomic_exchange(&p->value, value);
+    if (prev != value) ESP_LOGI(RCFG_TAG, "%s: %d -> %d", p->key, prev, value);
+}
+
+static void on_config_event(const char *event, const char *path, const firebase_json_t *data, void *user) {
+    (void)user;
+    bool is_put = strcmp(event, "put") == 0;
+
+    if (strcmp(path, "/") == 0) {
+        // put en la raíz: el nodo completo (lo que falta vuelve al defecto);
+        // patch: solo los campos presentes
+        firebase_json_type_t type = firebase_json_type(data);
+        if (type != FIREBASE_JSON_NULL && type != FIREBASE_JSON_OBJECT) {
+            ESP_LOGW(RCFG_TAG, "Configuración con formato inesperado (tipo %d)", (int)type);
+        } else {
+            for (size_t i = 0; i < PARAM_COUNT; ++i) {
+                const firebase_json_t *item = firebase_json_get(data, s_params[i].key);
+                if (item || is_put) apply_param(&s_params[i], item);
+            }
+        }
+    } else if (is_put) {
+        // put de un solo campo: "/muestreo_min"
+        const char *key = path + 1;
+        size_t key_len = strcspn(key, "/");
+        rcfg_param_t *p = (key[key_len] == '\0') ? find_param(key, key_len) : NULL;
+        if (p) apply_param(p, data);
+    }
+}
+
+void remote_config_init(int sample_every_min, int samples_per_batch, int retention_mb) {
+    int defaults[] = { sample_every_min, samples_per_batch, retention_mb };
+    for (size_t i = 0; i < PARAM_COUNT; ++i) {
+        s_params[i].def = defaults[i];
+        atomic_store(&s_params[i].value, defaults[i]);
+    }
+}
+
+int remote_config_listen(const char *path) {
+    int ret = firebase_listen(path, on_config_event, NULL);
+    if (ret != 0) ESP_LOGE(RCFG_TAG, "No se pudo escuchar %s (%d)", path, ret);
+    return ret;
+}
+
+int remote_config_sample_every_min(void) {
+    return atomic_load(&s_params[0].value);
+}
+
+int remote_config_samples_per_batch(void) {
+    return atomic_load(&s_params[1].value);
+}
+
+size_t remote_config_retention_bytes(void) {
+    return (size_t)atomic_load(&s_params[2].value) * 1024 * 1024;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parámetros de operación que se pueden cambiar en vivo desde la RTDB.
+//
+// El nodo (p. ej. /config) tiene la forma
+//   { "muestreo_min": 1, "muestras_por_lote": 5, "retencion_mb": 10 }
+// Cada campo es opcional: si falta o es null rige el valor por defecto. Los
+// valores fuera de rango se ignoran. Los cambios se aplican en el siguiente
+// ciclo de muestreo/envío, sin reiniciar.
+
+#define REMOTE_CONFIG_SAMPLE_MIN_MAX   60
+#define REMOTE_CONFIG_BATCH_MAX        60
+#define REMOTE_CONFIG_RETENTION_MB_MAX 100
+
+// Valores por defecto (y vigentes hasta que llegue la configuración remota)
+void remote_config_init(int sample_every_min, int samples_per_batch, int retention_mb);
+// Empieza a escuchar el nodo. Requiere Firebase inicializado.
+int remote_config_listen(const char *path);
+
+int remote_config_sample_every_min(void);
+int remote_config_samples_per_batch(void);
+size_t remote_config_retention_bytes(void);
+
+#ifdef __cplusplus
+}
+#endif
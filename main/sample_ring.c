@@ -0,0 +1,45 @@
+#include "sample_ring.h"
+#include <string.h>
+
+#define SAMPLE_RING_MASK (SAMPLE_RING_CAPACITY - 1)
+_Static_assert((SAMPLE_RING_CAPACITY & SAMPLE_RING_MASK) == 0, "SAMPLE_RING_CAPACITY debe ser potencia de 2");
+
+void sample_ring_init(sample_ring_t *r) {
+    memset(r->items, 0, sizeof(r->items));
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->dropped, 0);
+}
+
+bool sample_ring_push(sample_ring_t *r, const sample_t *s) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail >= SAMPLE_RING_CAPACITY) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    r->items[head & SAMPLE_RING_MASK] = *s;
+    // release: la muestra queda visible antes que el nuevo head
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool sample_ring_pop(sample_ring_t *r, sample_t *out) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail == head) return false;
+    *out = r->items[tail & SAMPLE_RING_MASK];
+    // release: liberamos la ranura solo después de copiarla
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+unsigned sample_ring_count(sample_ring_t *r) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return head - tail;
+}
+
+unsigned sample_ring_dropped(sample_ring_t *r) {
+    return atomic_load_explicit(&r->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "sensors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Capacidad del ring (potencia de 2). 64 muestras = ~1 h a 1 muestra/min.
+#define SAMPLE_RING_CAPACITY 64
+
+// Una ranura de muestreo. 'slot' crece de 1 en 1 aunque la lectura falle,
+// así el consumidor puede detectar huecos (valid=false) o pérdidas (saltos).
+typedef struct {
+    uint32_t   slot;
+    time_t     ts;
+    bool       valid;
+    SensorData data;
+} sample_t;
+
+// Ring lock-free de un solo productor / un solo consumidor.
+// head lo escribe solo el productor y tail solo el consumidor.
+typedef struct {
+    sample_t items[SAMPLE_RING_CAPACITY];
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_uint dropped; // muestras descartadas por ring lleno
+} sample_ring_t;
+
+void sample_ring_init(sample_ring_t *r);
+
+// Productor: devuelve false (y cuenta en 'dropped') si el ring está lleno.
+bool sample_ring_push(sample_ring_t *r, const sample_t *s);
+
+// Consumidor: devuelve false si no hay muestras pendientes.
+bool sample_ring_pop(sample_ring_t *r, sample_t *out);
+
+unsigned sample_ring_count(sample_ring_t *r);
+unsigned sample_ring_dropped(sample_ring_t *r);
+
+#ifdef __cplusplus
+}
+#endif